@@ -0,0 +1,167 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file varint_benchmark.cc
+/// @brief Round-trips a million 32-bit values through a byte-loop LEB128
+/// decoder, Varint and StreamVByte.  Encoders are measured in MB/s of
+/// 32-bit values read, and decoders in MB/s of encoded bytes read.  Exits
+/// nonzero if any values fail to round-trip.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "nx/core/varint.h"
+
+namespace {
+
+const size_t kCount = 1u << 20u;
+const unsigned int kRepetitions = 20u;
+
+// xorshift64, so that runs are repeatable
+nx::uint64_t Random() {
+  static nx::uint64_t state = 0x9e3779b97f4a7c15ull;
+  state ^= state << 13u;
+  state ^= state >> 7u;
+  state ^= state << 17u;
+  return state;
+}
+
+// The usual byte-at-a-time decoder, as a baseline.
+size_t DecodeByteLoop(const nx::uint8_t* bytes, size_t size, size_t count,
+    nx::uint32_t* values) {
+  size_t length = 0;
+  for (size_t i = 0; i < count; ++i) {
+    nx::uint32_t value = 0;
+    for (unsigned int shift = 0; ; shift += 7u) {
+      if (length == size || shift > 28u) {
+        return 0;
+      }
+      const nx::uint8_t byte = bytes[length++];
+      value |= static_cast<nx::uint32_t>(byte & 0x7fu) << shift;
+      if (!(byte & 0x80u)) {
+        break;
+      }
+    }
+    values[i] = value;
+  }
+  return length;
+}
+
+// Runs function kRepetitions times, and provides the fastest in seconds.
+template <class Function>
+double Time(Function function) {
+  double best = 0;
+  for (unsigned int i = 0; i < kRepetitions; ++i) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    function();
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!i || seconds < best) {
+      best = seconds;
+    }
+  }
+  return best;
+}
+
+void Report(const char* name, size_t bytes, double seconds) {
+  printf("  %-24s %8.0f MB/s\n", name, static_cast<double>(bytes) / seconds /
+      1e6);
+}
+
+bool Run(const char* distribution, const std::vector<nx::uint32_t>& values) {
+  typedef nx::Varint<32> Varint;
+  const size_t count = values.size();
+  std::vector<nx::uint8_t> leb128(count * Varint::MaxSize());
+  std::vector<nx::uint8_t> stream(nx::StreamVByte::MaxSize(count));
+  std::vector<nx::uint32_t> decoded(count);
+  size_t leb128_size = 0;
+  size_t stream_size = 0;
+  size_t read = 0;
+  bool exact = true;
+
+  printf("%s\n", distribution);
+  Report("Varint::Encode", count * 4u, Time([&] {
+    leb128_size = Varint::Encode(values.data(), count, leb128.data());
+  }));
+  Report("StreamVByte::Encode", count * 4u, Time([&] {
+    stream_size = nx::StreamVByte::Encode(values.data(), count,
+        stream.data());
+  }));
+  printf("  %.2f bytes per value as LEB128, %.2f as Stream VByte\n",
+      static_cast<double>(leb128_size) / count,
+      static_cast<double>(stream_size) / count);
+
+  memset(decoded.data(), 0, count * sizeof(nx::uint32_t));
+  Report("byte loop Decode", leb128_size, Time([&] {
+    read = DecodeByteLoop(leb128.data(), leb128_size, count, decoded.data());
+  }));
+  exact = exact && read == leb128_size && decoded == values;
+
+  memset(decoded.data(), 0, count * sizeof(nx::uint32_t));
+  Report("Varint::Decode", leb128_size, Time([&] {
+    read = Varint::Decode(leb128.data(), leb128_size, count, decoded.data());
+  }));
+  exact = exact && read == leb128_size && decoded == values;
+
+  memset(decoded.data(), 0, count * sizeof(nx::uint32_t));
+  Report("StreamVByte::Decode", stream_size, Time([&] {
+    read = nx::StreamVByte::Decode(stream.data(), stream_size, count,
+        decoded.data());
+  }));
+  exact = exact && read == stream_size && decoded == values;
+
+  if (!exact) {
+    printf("  values did not round-trip\n");
+  }
+  return exact;
+}
+
+}  // namespace
+
+int main() {
+  std::vector<nx::uint32_t> values(kCount);
+  bool exact = true;
+
+  // posting list gaps; mostly one byte
+  for (size_t i = 0; i < kCount; ++i) {
+    values[i] = static_cast<nx::uint32_t>(Random() % 200u);
+  }
+  exact = Run("small (< 200)", values) && exact;
+
+  // every length equally likely
+  for (size_t i = 0; i < kCount; ++i) {
+    const nx::uint64_t random = Random();
+    values[i] = static_cast<nx::uint32_t>(random >> (32u + random % 32u));
+  }
+  exact = Run("mixed (1 to 32 bits)", values) && exact;
+
+  for (size_t i = 0; i < kCount; ++i) {
+    values[i] = static_cast<nx::uint32_t>(Random());
+  }
+  exact = Run("large (32 bits)", values) && exact;
+
+  // every value two bytes as LEB128
+  for (size_t i = 0; i < kCount; ++i) {
+    values[i] = static_cast<nx::uint32_t>(128u + Random() % 16256u);
+  }
+  exact = Run("uniform (8 to 14 bits)", values) && exact;
+
+  return (exact ? 0 : 1);
+}
@@ -0,0 +1,312 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file arithmetic_span.h
+/// @brief Overflow-checked and saturating arithmetic over contiguous ranges
+/// of integers, with SIMD kernels selected at runtime based upon the
+/// executing processor.
+
+#ifndef INCLUDE_NX_CORE_ARITHMETIC_SPAN_H_
+#define INCLUDE_NX_CORE_ARITHMETIC_SPAN_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// The kernels of ArithmeticSpan, one for each instruction set, of which
+// ArithmeticSpan selects the fastest the processor supports.
+template <typename T>
+class ArithmeticSpanKernels {
+ public:
+  typedef Function<void, const T*, const T*, size_t, T*> SaturatingKernel;
+  typedef Function<bool, const T*, const T*, size_t, T*> CheckedKernel;
+
+  static void SaturatingAddScalar(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    for (size_t i = 0; i < length; ++i) {
+      result[i] = Bits<T>::SaturatingAdd(lhs[i], rhs[i]);
+    }
+  }
+  static void SaturatingSubtractScalar(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    for (size_t i = 0; i < length; ++i) {
+      result[i] = Bits<T>::SaturatingSubtract(lhs[i], rhs[i]);
+    }
+  }
+  static bool AdditionOverflowScalar(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    bool overflow = false;
+    for (size_t i = 0; i < length; ++i) {
+      // no early exit, so that every result is stored
+      overflow |= Bits<T>::AdditionOverflow(lhs[i], rhs[i], result + i);
+    }
+    return overflow;
+  }
+  // The lane operations handle widths of up to 64 bits; wider types, such
+  // as __int128, are left to the scalar kernels.
+  static NX_FORCEINLINE constexpr bool Vectorizable() {
+    return sizeof(T) <= sizeof(uint64_t);
+  }
+#if defined(NX_SIMD_X86)
+  // Lane-width generic operations; the width is a constant, so each
+  // collapses to a single instruction.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Add(__m256i lhs, __m256i rhs) {
+    return (sizeof(T) == 1u ? _mm256_add_epi8(lhs, rhs) :
+        sizeof(T) == 2u ? _mm256_add_epi16(lhs, rhs) :
+        sizeof(T) == 4u ? _mm256_add_epi32(lhs, rhs) :
+        _mm256_add_epi64(lhs, rhs));
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Subtract(__m256i lhs, __m256i rhs) {
+    return (sizeof(T) == 1u ? _mm256_sub_epi8(lhs, rhs) :
+        sizeof(T) == 2u ? _mm256_sub_epi16(lhs, rhs) :
+        sizeof(T) == 4u ? _mm256_sub_epi32(lhs, rhs) :
+        _mm256_sub_epi64(lhs, rhs));
+  }
+  // Broadcasts the sign bit of each lane across the lane.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i SignMask(__m256i value) {
+    const __m256i zero = _mm256_setzero_si256();
+    return (sizeof(T) == 1u ? _mm256_cmpgt_epi8(zero, value) :
+        sizeof(T) == 2u ? _mm256_cmpgt_epi16(zero, value) :
+        sizeof(T) == 4u ? _mm256_cmpgt_epi32(zero, value) :
+        _mm256_cmpgt_epi64(zero, value));
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Broadcast(T value) {
+    return (sizeof(T) == 1u ? _mm256_set1_epi8(static_cast<char>(value)) :
+        sizeof(T) == 2u ? _mm256_set1_epi16(static_cast<int16_t>(value)) :
+        sizeof(T) == 4u ? _mm256_set1_epi32(static_cast<int32_t>(value)) :
+        _mm256_set1_epi64x(static_cast<int64_t>(value)));
+  }
+  // Selects saturated where the sign bit of overflow is set.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Select(
+      __m256i overflow, __m256i saturated, __m256i result) {
+    const __m256i mask = SignMask(overflow);
+    return _mm256_or_si256(_mm256_and_si256(mask, saturated),
+        _mm256_andnot_si256(mask, result));
+  }
+  // The sign bit of each lane is set where lhs + rhs, giving sum,
+  // overflowed: for unsigned lanes the carry out, for signed lanes a sum
+  // whose sign differs from that of both operands.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i AdditionOverflow(
+      __m256i lhs, __m256i rhs, __m256i sum) {
+    return (IsSigned<T>::value ?
+        _mm256_and_si256(_mm256_xor_si256(lhs, sum),
+            _mm256_xor_si256(rhs, sum)) :
+        _mm256_or_si256(_mm256_and_si256(lhs, rhs),
+            _mm256_andnot_si256(sum, _mm256_or_si256(lhs, rhs))));
+  }
+  // As above, for lhs - rhs giving difference; for unsigned lanes the
+  // borrow out.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i SubtractionOverflow(
+      __m256i lhs, __m256i rhs, __m256i difference) {
+    return (IsSigned<T>::value ?
+        _mm256_and_si256(_mm256_xor_si256(lhs, rhs),
+            _mm256_xor_si256(lhs, difference)) :
+        _mm256_or_si256(_mm256_andnot_si256(lhs, rhs),
+            _mm256_andnot_si256(_mm256_xor_si256(lhs, rhs), difference)));
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Load256(const T* data, size_t offset) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+        data + offset));
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE void Store256(T* data, size_t offset,
+      __m256i value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + offset), value);
+  }
+  // 8 and 16-bit lanes saturate in hardware; wider lanes detect overflow
+  // and blend in the saturated value.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i SaturatingAdd256(__m256i lhs, __m256i rhs) {
+    if (sizeof(T) == 1u) {
+      return (IsSigned<T>::value ? _mm256_adds_epi8(lhs, rhs) :
+          _mm256_adds_epu8(lhs, rhs));
+    }
+    if (sizeof(T) == 2u) {
+      return (IsSigned<T>::value ? _mm256_adds_epi16(lhs, rhs) :
+          _mm256_adds_epu16(lhs, rhs));
+    }
+    const __m256i sum = Add(lhs, rhs);
+    const __m256i overflow = AdditionOverflow(lhs, rhs, sum);
+    return (IsSigned<T>::value ?
+        Select(overflow, Saturated(lhs), sum) :
+        _mm256_or_si256(sum, SignMask(overflow)));
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i SaturatingSubtract256(
+      __m256i lhs, __m256i rhs) {
+    if (sizeof(T) == 1u) {
+      return (IsSigned<T>::value ? _mm256_subs_epi8(lhs, rhs) :
+          _mm256_subs_epu8(lhs, rhs));
+    }
+    if (sizeof(T) == 2u) {
+      return (IsSigned<T>::value ? _mm256_subs_epi16(lhs, rhs) :
+          _mm256_subs_epu16(lhs, rhs));
+    }
+    const __m256i difference = Subtract(lhs, rhs);
+    const __m256i overflow = SubtractionOverflow(lhs, rhs, difference);
+    return (IsSigned<T>::value ?
+        Select(overflow, Saturated(lhs), difference) :
+        _mm256_andnot_si256(SignMask(overflow), difference));
+  }
+  // The value an overflowing signed lane saturates to, which has the sign
+  // of lhs; the maximum if lhs is non-negative, otherwise the minimum.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Saturated(__m256i lhs) {
+    return _mm256_xor_si256(SignMask(lhs), Broadcast(Maximum()));
+  }
+  // The maximum of the signed counterpart of T; its complement is the sign
+  // bit.
+  static NX_FORCEINLINE constexpr T Maximum() {
+    return static_cast<T>(static_cast<MakeUnsigned<T>>(
+        ~static_cast<MakeUnsigned<T>>(0)) >> 1u);
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static void SaturatingAddAvx2(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t step = sizeof(__m256i) / sizeof(T);
+    size_t i = 0;
+    for (; i + step <= length; i += step) {
+      Store256(result, i, SaturatingAdd256(Load256(lhs, i),
+          Load256(rhs, i)));
+    }
+    SaturatingAddScalar(lhs + i, rhs + i, length - i, result + i);
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static void SaturatingSubtractAvx2(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t step = sizeof(__m256i) / sizeof(T);
+    size_t i = 0;
+    for (; i + step <= length; i += step) {
+      Store256(result, i, SaturatingSubtract256(Load256(lhs, i),
+          Load256(rhs, i)));
+    }
+    SaturatingSubtractScalar(lhs + i, rhs + i, length - i, result + i);
+  }
+  // Overflow is accumulated into the sign bits and tested once at the end.
+  NX_FUNCTION_TARGET("avx2")
+  static bool AdditionOverflowAvx2(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t step = sizeof(__m256i) / sizeof(T);
+    __m256i overflow = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + step <= length; i += step) {
+      const __m256i left = Load256(lhs, i);
+      const __m256i right = Load256(rhs, i);
+      const __m256i sum = Add(left, right);
+      overflow = _mm256_or_si256(overflow,
+          AdditionOverflow(left, right, sum));
+      Store256(result, i, sum);
+    }
+    const bool vector_overflow = !_mm256_testz_si256(overflow,
+        Broadcast(static_cast<T>(~Maximum())));
+    return AdditionOverflowScalar(lhs + i, rhs + i, length - i,
+        result + i) || vector_overflow;
+  }
+#endif
+  static SaturatingKernel SelectSaturatingAdd() {
+#if defined(NX_SIMD_X86)
+    if (Vectorizable() && Cpu::Supports(Cpu::kAvx2)) {
+      return &SaturatingAddAvx2;
+    }
+#endif
+    return &SaturatingAddScalar;
+  }
+  static SaturatingKernel SelectSaturatingSubtract() {
+#if defined(NX_SIMD_X86)
+    if (Vectorizable() && Cpu::Supports(Cpu::kAvx2)) {
+      return &SaturatingSubtractAvx2;
+    }
+#endif
+    return &SaturatingSubtractScalar;
+  }
+  static CheckedKernel SelectAdditionOverflow() {
+#if defined(NX_SIMD_X86)
+    if (Vectorizable() && Cpu::Supports(Cpu::kAvx2)) {
+      return &AdditionOverflowAvx2;
+    }
+#endif
+    return &AdditionOverflowScalar;
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ArithmeticSpanKernels);
+};
+
+template <typename T, class Enable = void>
+class ArithmeticSpan {
+ private:
+  NX_UNINSTANTIABLE(ArithmeticSpan);
+};
+template <typename T>
+class ArithmeticSpan<T, EnableIf<IsIntegral<T>>> {
+ private:
+  typedef ArithmeticSpanKernels<T> Detail;
+
+ public:
+  /// @brief Stores lhs[i] + rhs[i], clamped to the range of T, in result[i]
+  /// for each of the length elements.  result may be lhs or rhs.
+  static NX_FORCEINLINE void SaturatingAdd(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    static const typename Detail::SaturatingKernel kernel =
+        Detail::SelectSaturatingAdd();
+    kernel(lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs[i] - rhs[i], clamped to the range of T, in result[i]
+  /// for each of the length elements.  result may be lhs or rhs.
+  static NX_FORCEINLINE void SaturatingSubtract(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    static const typename Detail::SaturatingKernel kernel =
+        Detail::SelectSaturatingSubtract();
+    kernel(lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs[i] + rhs[i], wrapped as for unsigned arithmetic, in
+  /// result[i] for each of the length elements, and determines if any exact
+  /// sum is not representable by T.  result may be lhs or rhs.
+  static NX_FORCEINLINE bool AdditionOverflow(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    static const typename Detail::CheckedKernel kernel =
+        Detail::SelectAdditionOverflow();
+    return kernel(lhs, rhs, length, result);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ArithmeticSpan);
+};
+
+}  // namespace detail
+/// @endcond
+
+template <class T>
+using ArithmeticSpan = detail::ArithmeticSpan<T>;
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_ARITHMETIC_SPAN_H_
@@ -0,0 +1,199 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file atomic_bits.h
+/// @brief Provides atomic counterparts to the bitwise operations in bits.h,
+/// for flag words shared between threads.
+
+#ifndef INCLUDE_NX_CORE_ATOMIC_BITS_H_
+#define INCLUDE_NX_CORE_ATOMIC_BITS_H_
+
+#include <atomic>
+
+#include "nx/core/mpl.h"
+#include "nx/core/bits.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+template <typename T, class Enable = void>
+class AtomicBits {
+ private:
+  NX_UNINSTANTIABLE(AtomicBits);
+};
+template <typename T>
+class AtomicBits<T, EnableIf<std::is_integral<T>>> {
+ public:
+  typedef std::atomic<T> atomic_type;
+
+ private:
+  class Detail {
+   public:
+    // The strongest order permitted for a load, given that of an operation.
+    static NX_FORCEINLINE constexpr std::memory_order LoadOrder(
+        std::memory_order order) {
+      return (order == std::memory_order_release ?
+          std::memory_order_relaxed :
+          order == std::memory_order_acq_rel ?
+            std::memory_order_acquire :
+            order);
+    }
+    template <T mask_, T value_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ == static_cast<T>(0)>,  // empty
+        T> assign(atomic_type* data, std::memory_order order) {
+      // empty mask - do nothing
+      return data->load(LoadOrder(order));
+    }
+    template <T mask_, T value_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ == static_cast<T>(~static_cast<T>(0))>,  // full
+        T> assign(atomic_type* data, std::memory_order order) {
+      // full mask - exchange
+      return data->exchange(value_, order);
+    }
+    template <T mask_, T value_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ != static_cast<T>(0) &&  // not empty
+            mask_ != static_cast<T>(~static_cast<T>(0)) &&  // not full
+            (mask_ & value_)  // NOLINT(runtime/references)
+                == mask_>,  // all bits set
+        T> assign(atomic_type* data, std::memory_order order) {
+      // bit mask, all bits set - or
+      return data->fetch_or(mask_, order);
+    }
+    template <T mask_, T value_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ != static_cast<T>(0) &&  // not empty
+            mask_ != static_cast<T>(~static_cast<T>(0)) &&  // not full
+            (mask_ & value_)  // NOLINT(runtime/references)
+                == static_cast<T>(0)>,  // all bits unset
+        T> assign(atomic_type* data, std::memory_order order) {
+      // bit mask, all bits unset - and inverted mask
+      return data->fetch_and(static_cast<T>(~mask_), order);
+    }
+    template <T mask_, T value_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ != static_cast<T>(0) &&  // not empty
+            mask_ != static_cast<T>(~static_cast<T>(0)) &&  // not full
+            (mask_ & value_)  // NOLINT(runtime/references)
+                != static_cast<T>(0) &&  // all bits not unset
+            (mask_ & value_)  // NOLINT(runtime/references)
+                != mask_>,  // all bits not set
+        T> assign(atomic_type* data, std::memory_order order) {
+      // being extra sure that the 'and' is optimized out
+      typedef std::integral_constant<T, (value_ & mask_)> masked_value;
+      // bit mask, bits not all the same - merge bits
+      return assign(mask_, masked_value::value, data, order);
+    }
+    static NX_FORCEINLINE T assign(
+        T mask, T value, atomic_type* data, std::memory_order order) {
+      // generic bit mask - merge bits until no other thread intervenes
+      T expected = data->load(std::memory_order_relaxed);
+      while (!data->compare_exchange_weak(expected,
+          static_cast<T>((value & mask) | (expected & ~mask)),
+          order, LoadOrder(order))) {
+      }
+      return expected;
+    }
+    template <T mask_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ == static_cast<T>(0)>,  // empty
+        T> assign(T /* value */, atomic_type* data,
+            std::memory_order order) {
+      // empty mask - do nothing
+      return data->load(LoadOrder(order));
+    }
+    template <T mask_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ == static_cast<T>(~static_cast<T>(0))>,  // full
+        T> assign(T value, atomic_type* data, std::memory_order order) {
+      // full mask - exchange
+      return data->exchange(value, order);
+    }
+    template <T mask_>
+    static NX_FORCEINLINE EnableIf<Bool<
+            mask_ != static_cast<T>(0) &&  // not empty
+            mask_ != static_cast<T>(~static_cast<T>(0))>,  // not full
+        T> assign(T value, atomic_type* data, std::memory_order order) {
+      // bit mask - merge bits
+      return assign(mask_, value, data, order);
+    }
+  };
+
+ public:
+  static NX_FORCEINLINE T assign(T mask, T value, atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return Detail::assign(mask, value, data, order);
+  }
+  template <T mask_>
+  static NX_FORCEINLINE T assign(T value, atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return Detail::template assign<mask_>(value, data, order);
+  }
+  template <T mask_, T value_>
+  static NX_FORCEINLINE T assign(atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return Detail::template assign<mask_, value_>(data, order);
+  }
+  static NX_FORCEINLINE T get(T mask, const atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return static_cast<T>(data->load(order) & mask);
+  }
+  template <T mask_>
+  static NX_FORCEINLINE T get(const atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return get(mask_, data, order);
+  }
+  static NX_FORCEINLINE T set(T mask, atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return data->fetch_or(mask, order);
+  }
+  template <T mask_>
+  static NX_FORCEINLINE T set(atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return Detail::template assign<
+        mask_, static_cast<T>(~static_cast<T>(0))>(data, order);
+  }
+  static NX_FORCEINLINE T clear(T mask, atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return data->fetch_and(static_cast<T>(~mask), order);
+  }
+  template <T mask_>
+  static NX_FORCEINLINE T clear(atomic_type* data,
+      std::memory_order order = std::memory_order_seq_cst) {
+    return Detail::template assign<mask_, static_cast<T>(0)>(data, order);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(AtomicBits);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Atomic counterparts to Bits<T>::set/clear/assign/get, operating on
+/// std::atomic<T>.  Each modification is a single atomic read-modify-write
+/// with the requested memory order, and returns the value held prior to it.
+template <class T>
+using AtomicBits = detail::AtomicBits<T>;
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_ATOMIC_BITS_H_
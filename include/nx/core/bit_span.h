@@ -0,0 +1,534 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_span.h
+/// @brief Bitwise operations over contiguous ranges of integers, with SIMD
+/// kernels selected at runtime based upon the executing processor.
+
+#ifndef INCLUDE_NX_CORE_BIT_SPAN_H_
+#define INCLUDE_NX_CORE_BIT_SPAN_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// The kernels of BitSpan, one for each instruction set, of which BitSpan
+// selects the fastest the processor supports.
+template <typename T>
+class BitSpanKernels {
+ public:
+  typedef Function<uint64_t, const T*, size_t> PopCountKernel;
+  // Combines lhs and rhs into result, and/or counts the combined bits.
+  typedef Function<uint64_t, const T*, const T*, size_t, T*> CombineKernel;
+
+  // The element-wise operations, for single elements and whole vectors.
+  struct AndOperation {
+    static NX_FORCEINLINE T Apply(T lhs, T rhs) {
+      return static_cast<T>(lhs & rhs);
+    }
+#if defined(NX_SIMD_X86)
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Apply(__m256i lhs, __m256i rhs) {
+      return _mm256_and_si256(lhs, rhs);
+    }
+#if defined(NX_SIMD_AVX512)
+    NX_FUNCTION_TARGET("avx512f")
+    static NX_FORCEINLINE __m512i Apply(__m512i lhs, __m512i rhs) {
+      return _mm512_and_si512(lhs, rhs);
+    }
+#endif
+#endif
+  };
+  struct OrOperation {
+    static NX_FORCEINLINE T Apply(T lhs, T rhs) {
+      return static_cast<T>(lhs | rhs);
+    }
+#if defined(NX_SIMD_X86)
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Apply(__m256i lhs, __m256i rhs) {
+      return _mm256_or_si256(lhs, rhs);
+    }
+#if defined(NX_SIMD_AVX512)
+    NX_FUNCTION_TARGET("avx512f")
+    static NX_FORCEINLINE __m512i Apply(__m512i lhs, __m512i rhs) {
+      return _mm512_or_si512(lhs, rhs);
+    }
+#endif
+#endif
+  };
+  struct XorOperation {
+    static NX_FORCEINLINE T Apply(T lhs, T rhs) {
+      return static_cast<T>(lhs ^ rhs);
+    }
+#if defined(NX_SIMD_X86)
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Apply(__m256i lhs, __m256i rhs) {
+      return _mm256_xor_si256(lhs, rhs);
+    }
+#if defined(NX_SIMD_AVX512)
+    NX_FUNCTION_TARGET("avx512f")
+    static NX_FORCEINLINE __m512i Apply(__m512i lhs, __m512i rhs) {
+      return _mm512_xor_si512(lhs, rhs);
+    }
+#endif
+#endif
+  };
+  struct AndNotOperation {
+    static NX_FORCEINLINE T Apply(T lhs, T rhs) {
+      return static_cast<T>(lhs & ~rhs);
+    }
+#if defined(NX_SIMD_X86)
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Apply(__m256i lhs, __m256i rhs) {
+      return _mm256_andnot_si256(rhs, lhs);
+    }
+#if defined(NX_SIMD_AVX512)
+    NX_FUNCTION_TARGET("avx512f")
+    static NX_FORCEINLINE __m512i Apply(__m512i lhs, __m512i rhs) {
+      // _mm512_andnot_si512 trips GCC's uninitialized-use warnings
+      return _mm512_and_si512(lhs,
+          _mm512_xor_si512(rhs, _mm512_set1_epi64(-1)));
+    }
+#endif
+#endif
+  };
+
+  // Counts the elements not covered by a kernel's vectors.
+  static NX_FORCEINLINE uint64_t PopCountTail(
+      const T* data, size_t offset, size_t length) {
+    uint64_t count = 0;
+    for (size_t i = offset; i < length; ++i) {
+      count += Bits<T>::PopCount(data[i]);
+    }
+    return count;
+  }
+  static uint64_t PopCountScalar(const T* data, size_t length) {
+    return PopCountTail(data, 0, length);
+  }
+  // Combines the elements not covered by a kernel's vectors.
+  template <class Operation, bool kStore, bool kCount>
+  static NX_FORCEINLINE uint64_t CombineTail(const T* lhs, const T* rhs,
+      size_t offset, size_t length, T* result) {
+    uint64_t count = 0;
+    for (size_t i = offset; i < length; ++i) {
+      const T value = Operation::Apply(lhs[i], rhs[i]);
+      if (kStore) {
+        result[i] = value;
+      }
+      if (kCount) {
+        count += Bits<T>::PopCount(value);
+      }
+    }
+    return count;
+  }
+  template <class Operation, bool kStore, bool kCount>
+  static uint64_t CombineScalar(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return CombineTail<Operation, kStore, kCount>(
+        lhs, rhs, 0, length, result);
+  }
+#if defined(NX_SIMD_X86)
+  // Same as the scalar kernel, but the per-element count becomes popcnt.
+  NX_FUNCTION_TARGET("popcnt")
+  static uint64_t PopCountPopCnt(const T* data, size_t length) {
+    return PopCountTail(data, 0, length);
+  }
+  template <class Operation, bool kStore, bool kCount>
+  NX_FUNCTION_TARGET("popcnt")
+  static uint64_t CombinePopCnt(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return CombineTail<Operation, kStore, kCount>(
+        lhs, rhs, 0, length, result);
+  }
+
+  // Per-byte counts via a nibble lookup, summed into four 64-bit lanes.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i PopCount256(__m256i value) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i low = _mm256_and_si256(value, low_mask);
+    const __m256i high = _mm256_and_si256(
+        _mm256_srli_epi16(value, 4), low_mask);
+    const __m256i counts = _mm256_add_epi8(
+        _mm256_shuffle_epi8(lookup, low),
+        _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+  }
+  // Carry-save adder; three inputs of equal weight become one output of
+  // equal weight (low) and one of twice the weight (high).
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE void CarrySaveAdd(
+      __m256i* high, __m256i* low, __m256i a, __m256i b, __m256i c) {
+    const __m256i partial = _mm256_xor_si256(a, b);
+    *high = _mm256_or_si256(
+        _mm256_and_si256(a, b), _mm256_and_si256(partial, c));
+    *low = _mm256_xor_si256(partial, c);
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Load256(const T* data, size_t vector) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data) +
+        vector);
+  }
+  // The vectors of a single span.
+  struct LoadSource {
+    NX_FUNCTION_TARGET("avx2")
+    NX_FORCEINLINE __m256i operator()(size_t vector) const {
+      return Load256(data, vector);
+    }
+    const T* data;
+  };
+  // The vectors of two spans combined, stored to result if kStore.
+  template <class Operation, bool kStore>
+  struct CombineSource {
+    NX_FUNCTION_TARGET("avx2")
+    NX_FORCEINLINE __m256i operator()(size_t vector) const {
+      const __m256i value = Operation::Apply(
+          Load256(lhs, vector), Load256(rhs, vector));
+      if (kStore) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result) + vector,
+            value);
+      }
+      return value;
+    }
+    const T* lhs;
+    const T* rhs;
+    T* result;
+  };
+  // Harley-Seal: a tree of carry-save adders reduces sixteen vectors to one
+  // that needs counting, with the lower weights counted once at the end.
+  // Counts the bits of the first vectors vectors provided by source.
+  template <class Source>
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE uint64_t HarleySeal(
+      const Source& source, size_t vectors) {
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256();
+    __m256i twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256();
+    __m256i eights = _mm256_setzero_si256();
+    __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    size_t i = 0;
+    for (; i + 16u <= vectors; i += 16u) {
+      CarrySaveAdd(&twos_a, &ones, ones, source(i + 0u), source(i + 1u));
+      CarrySaveAdd(&twos_b, &ones, ones, source(i + 2u), source(i + 3u));
+      CarrySaveAdd(&fours_a, &twos, twos, twos_a, twos_b);
+      CarrySaveAdd(&twos_a, &ones, ones, source(i + 4u), source(i + 5u));
+      CarrySaveAdd(&twos_b, &ones, ones, source(i + 6u), source(i + 7u));
+      CarrySaveAdd(&fours_b, &twos, twos, twos_a, twos_b);
+      CarrySaveAdd(&eights_a, &fours, fours, fours_a, fours_b);
+      CarrySaveAdd(&twos_a, &ones, ones, source(i + 8u), source(i + 9u));
+      CarrySaveAdd(&twos_b, &ones, ones, source(i + 10u), source(i + 11u));
+      CarrySaveAdd(&fours_a, &twos, twos, twos_a, twos_b);
+      CarrySaveAdd(&twos_a, &ones, ones, source(i + 12u), source(i + 13u));
+      CarrySaveAdd(&twos_b, &ones, ones, source(i + 14u), source(i + 15u));
+      CarrySaveAdd(&fours_b, &twos, twos, twos_a, twos_b);
+      CarrySaveAdd(&eights_b, &fours, fours, fours_a, fours_b);
+      CarrySaveAdd(&sixteens, &eights, eights, eights_a, eights_b);
+      total = _mm256_add_epi64(total, PopCount256(sixteens));
+    }
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total,
+        _mm256_slli_epi64(PopCount256(eights), 3));
+    total = _mm256_add_epi64(total,
+        _mm256_slli_epi64(PopCount256(fours), 2));
+    total = _mm256_add_epi64(total,
+        _mm256_slli_epi64(PopCount256(twos), 1));
+    total = _mm256_add_epi64(total, PopCount256(ones));
+    for (; i < vectors; ++i) {
+      total = _mm256_add_epi64(total, PopCount256(source(i)));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static uint64_t PopCountAvx2(const T* data, size_t length) {
+    const size_t vectors = (length * sizeof(T)) / sizeof(__m256i);
+    const LoadSource source = {data};
+    return HarleySeal(source, vectors) + PopCountTail(
+        data, (vectors * sizeof(__m256i)) / sizeof(T), length);
+  }
+  template <class Operation, bool kStore, bool kCount>
+  NX_FUNCTION_TARGET("avx2")
+  static uint64_t CombineAvx2(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t vectors = (length * sizeof(T)) / sizeof(__m256i);
+    const CombineSource<Operation, kStore> source = {lhs, rhs, result};
+    uint64_t count = 0;
+    if (kCount) {
+      count = HarleySeal(source, vectors);
+    } else {
+      for (size_t i = 0; i < vectors; ++i) {
+        source(i);
+      }
+    }
+    return count + CombineTail<Operation, kStore, kCount>(lhs, rhs,
+        (vectors * sizeof(__m256i)) / sizeof(T), length, result);
+  }
+#if defined(NX_SIMD_AVX512)
+  NX_FUNCTION_TARGET("avx512f,avx512vpopcntdq")
+  static uint64_t PopCountAvx512(const T* data, size_t length) {
+    const size_t vectors = (length * sizeof(T)) / sizeof(__m512i);
+    const __m512i* source = reinterpret_cast<const __m512i*>(data);
+    // independent accumulators hide the latency of the adds
+    __m512i total_a = _mm512_setzero_si512();
+    __m512i total_b = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 2u <= vectors; i += 2u) {
+      total_a = _mm512_add_epi64(total_a,
+          _mm512_popcnt_epi64(_mm512_loadu_si512(source + i)));
+      total_b = _mm512_add_epi64(total_b,
+          _mm512_popcnt_epi64(_mm512_loadu_si512(source + i + 1u)));
+    }
+    if (i < vectors) {
+      total_a = _mm512_add_epi64(total_a,
+          _mm512_popcnt_epi64(_mm512_loadu_si512(source + i)));
+    }
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, _mm512_add_epi64(total_a, total_b));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] +
+        lanes[5] + lanes[6] + lanes[7] + PopCountTail(
+            data, (vectors * sizeof(__m512i)) / sizeof(T), length);
+  }
+  // Counting requires VPOPCNTDQ, so storing alone has a kernel of its own
+  // that requires only AVX-512F.
+  template <class Operation, bool kStore>
+  NX_FUNCTION_TARGET("avx512f,avx512vpopcntdq")
+  static uint64_t CountAvx512(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t vectors = (length * sizeof(T)) / sizeof(__m512i);
+    const __m512i* left = reinterpret_cast<const __m512i*>(lhs);
+    const __m512i* right = reinterpret_cast<const __m512i*>(rhs);
+    __m512i* out = reinterpret_cast<__m512i*>(result);
+    __m512i total = _mm512_setzero_si512();
+    for (size_t i = 0; i < vectors; ++i) {
+      const __m512i value = Operation::Apply(
+          _mm512_loadu_si512(left + i), _mm512_loadu_si512(right + i));
+      if (kStore) {
+        _mm512_storeu_si512(out + i, value);
+      }
+      total = _mm512_add_epi64(total, _mm512_popcnt_epi64(value));
+    }
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] +
+        lanes[5] + lanes[6] + lanes[7] + CombineTail<Operation, kStore,
+            true>(lhs, rhs, (vectors * sizeof(__m512i)) / sizeof(T),
+                length, result);
+  }
+  template <class Operation>
+  NX_FUNCTION_TARGET("avx512f")
+  static uint64_t StoreAvx512(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    const size_t vectors = (length * sizeof(T)) / sizeof(__m512i);
+    const __m512i* left = reinterpret_cast<const __m512i*>(lhs);
+    const __m512i* right = reinterpret_cast<const __m512i*>(rhs);
+    __m512i* out = reinterpret_cast<__m512i*>(result);
+    for (size_t i = 0; i < vectors; ++i) {
+      _mm512_storeu_si512(out + i, Operation::Apply(
+          _mm512_loadu_si512(left + i), _mm512_loadu_si512(right + i)));
+    }
+    return CombineTail<Operation, true, false>(lhs, rhs,
+        (vectors * sizeof(__m512i)) / sizeof(T), length, result);
+  }
+  // The AVX-512 kernel, or null if the processor lacks what it requires.
+  template <class Operation, bool kStore>
+  static CombineKernel SelectAvx512(Bool<true> /* count */) {
+    return (Cpu::Supports(Cpu::kAvx512VPopCntDq) ?
+        &CountAvx512<Operation, kStore> :
+        nullptr);
+  }
+  template <class Operation, bool kStore>
+  static CombineKernel SelectAvx512(Bool<false> /* count */) {
+    return (Cpu::Supports(Cpu::kAvx512F) ?
+        &StoreAvx512<Operation> :
+        nullptr);
+  }
+#endif
+#endif
+  static PopCountKernel SelectPopCount() {
+#if defined(NX_SIMD_X86)
+#if defined(NX_SIMD_AVX512)
+    if (Cpu::Supports(Cpu::kAvx512VPopCntDq)) {
+      return &PopCountAvx512;
+    }
+#endif
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &PopCountAvx2;
+    }
+    if (Cpu::Supports(Cpu::kPopCnt)) {
+      return &PopCountPopCnt;
+    }
+#endif
+    return &PopCountScalar;
+  }
+  template <class Operation, bool kStore, bool kCount>
+  static CombineKernel SelectCombine() {
+#if defined(NX_SIMD_X86)
+#if defined(NX_SIMD_AVX512)
+    const CombineKernel avx512 =
+        SelectAvx512<Operation, kStore>(Bool<kCount>());
+    if (avx512) {
+      return avx512;
+    }
+#endif
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &CombineAvx2<Operation, kStore, kCount>;
+    }
+    if (kCount && Cpu::Supports(Cpu::kPopCnt)) {
+      return &CombinePopCnt<Operation, kStore, kCount>;
+    }
+#endif
+    return &CombineScalar<Operation, kStore, kCount>;
+  }
+  template <class Operation, bool kStore, bool kCount>
+  static NX_FORCEINLINE uint64_t Combine(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    static const CombineKernel kernel =
+        SelectCombine<Operation, kStore, kCount>();
+    return kernel(lhs, rhs, length, result);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(BitSpanKernels);
+};
+
+template <typename T, class Enable = void>
+class BitSpan {
+ private:
+  NX_UNINSTANTIABLE(BitSpan);
+};
+template <typename T>
+class BitSpan<T, EnableIf<IsIntegral<T>>> {
+ private:
+  typedef BitSpanKernels<T> Detail;
+
+ public:
+  /// @brief Provides the number of set bits in the length elements starting
+  /// at data, using the fastest kernel the executing processor supports.
+  static NX_FORCEINLINE uint64_t PopCount(const T* data, size_t length) {
+    static const typename Detail::PopCountKernel kernel =
+        Detail::SelectPopCount();
+    return kernel(data, length);
+  }
+
+  // Element-wise operations over two spans of length elements.  The result
+  // may be the same span as either operand, but may not otherwise overlap
+  // them.  The PopCount variants count the bits of the result in the same
+  // pass, and without a result, count them without storing anything.
+
+  /// @brief Stores lhs & rhs to result.
+  static NX_FORCEINLINE void And(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    Detail::template Combine<typename Detail::AndOperation, true, false>(
+        lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs & rhs to result, providing how many bits
+  /// are set in it.
+  static NX_FORCEINLINE uint64_t AndPopCount(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return Detail::template Combine<typename Detail::AndOperation, true,
+        true>(lhs, rhs, length, result);
+  }
+  /// @brief Provides the number of set bits in lhs & rhs.
+  static NX_FORCEINLINE uint64_t AndPopCount(
+      const T* lhs, const T* rhs, size_t length) {
+    return Detail::template Combine<typename Detail::AndOperation, false,
+        true>(lhs, rhs, length, nullptr);
+  }
+
+  /// @brief Stores lhs | rhs to result.
+  static NX_FORCEINLINE void Or(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    Detail::template Combine<typename Detail::OrOperation, true, false>(
+        lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs | rhs to result, providing how many bits
+  /// are set in it.
+  static NX_FORCEINLINE uint64_t OrPopCount(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return Detail::template Combine<typename Detail::OrOperation, true,
+        true>(lhs, rhs, length, result);
+  }
+  /// @brief Provides the number of set bits in lhs | rhs.
+  static NX_FORCEINLINE uint64_t OrPopCount(
+      const T* lhs, const T* rhs, size_t length) {
+    return Detail::template Combine<typename Detail::OrOperation, false,
+        true>(lhs, rhs, length, nullptr);
+  }
+
+  /// @brief Stores lhs ^ rhs to result.
+  static NX_FORCEINLINE void Xor(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    Detail::template Combine<typename Detail::XorOperation, true, false>(
+        lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs ^ rhs to result, providing how many bits
+  /// are set in it.
+  static NX_FORCEINLINE uint64_t XorPopCount(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return Detail::template Combine<typename Detail::XorOperation, true,
+        true>(lhs, rhs, length, result);
+  }
+  /// @brief Provides the number of set bits in lhs ^ rhs.
+  static NX_FORCEINLINE uint64_t XorPopCount(
+      const T* lhs, const T* rhs, size_t length) {
+    return Detail::template Combine<typename Detail::XorOperation, false,
+        true>(lhs, rhs, length, nullptr);
+  }
+
+  /// @brief Stores lhs & ~rhs to result.
+  static NX_FORCEINLINE void AndNot(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    Detail::template Combine<typename Detail::AndNotOperation, true, false>(
+        lhs, rhs, length, result);
+  }
+  /// @brief Stores lhs & ~rhs to result, providing how many bits
+  /// are set in it.
+  static NX_FORCEINLINE uint64_t AndNotPopCount(
+      const T* lhs, const T* rhs, size_t length, T* result) {
+    return Detail::template Combine<typename Detail::AndNotOperation, true,
+        true>(lhs, rhs, length, result);
+  }
+  /// @brief Provides the number of set bits in lhs & ~rhs.
+  static NX_FORCEINLINE uint64_t AndNotPopCount(
+      const T* lhs, const T* rhs, size_t length) {
+    return Detail::template Combine<typename Detail::AndNotOperation, false,
+        true>(lhs, rhs, length, nullptr);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(BitSpan);
+};
+
+}  // namespace detail
+/// @endcond
+
+template <class T>
+using BitSpan = detail::BitSpan<T>;
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_BIT_SPAN_H_
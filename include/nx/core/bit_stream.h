@@ -0,0 +1,292 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_stream.h
+/// @brief Reading and writing streams of variable-width bit fields in byte
+/// buffers, through a 64-bit accumulator.
+
+#ifndef INCLUDE_NX_CORE_BIT_STREAM_H_
+#define INCLUDE_NX_CORE_BIT_STREAM_H_
+
+#include <string.h>
+
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/endian.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+class BitStreamWord {
+ public:
+  // The low bits bits of value, for bits of at most 64.
+  static NX_FORCEINLINE uint64_t Low(uint64_t value, unsigned int bits) {
+    return (bits < 64u ? value & Bits<uint64_t>::LowMask(bits) : value);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(BitStreamWord);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Appends bit fields of up to 64 bits to a growing byte buffer, least
+/// significant bit first.
+///
+/// Fields collect in a 64-bit accumulator, which is stored whole after each
+/// field; the position then advances by the number of complete bytes it
+/// held, without branching on how many there were.  The buffer is kept eight
+/// bytes longer than what has been written to allow this.
+class BitWriter {
+ public:
+  /// @brief Constructs a writer with nothing written.
+  BitWriter()
+      : accumulator_(0),
+        count_(0),
+        position_(0),
+        bytes_(kSlack, 0) {
+  }
+
+  /// @brief The number of bits written.
+  NX_FORCEINLINE uint64_t size() const {
+    return static_cast<uint64_t>(position_) * 8u + count_;
+  }
+
+  /// @brief Appends the low bits bits of value, for bits of at most 64.
+  NX_FORCEINLINE void Write(uint64_t value, unsigned int bits) {
+    if (bits > kMaxBits) {
+      Put(value & Bits<uint64_t>::LowMask<32>(), 32u);
+      value >>= 32u;
+      bits -= 32u;
+    }
+    Put(detail::BitStreamWord::Low(value, bits), bits);
+  }
+  /// @brief Appends value, of kBits bits.
+  template <unsigned int kBits>
+  NX_FORCEINLINE void Write(uint_least_t<kBits> value) {
+    Write(static_cast<uint64_t>(value), kBits);
+  }
+  /// @brief Appends the low bits bits of each of count values.
+  void Write(const uint64_t* values, size_t count, unsigned int bits) {
+    for (size_t i = 0; i < count; ++i) {
+      Write(values[i], bits);
+    }
+  }
+  /// @brief Appends each of count values, of kBits bits.
+  template <unsigned int kBits>
+  void Write(const uint_least_t<kBits>* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      Write<kBits>(values[i]);
+    }
+  }
+
+  /// @brief Pads what has been written with zeros to a whole byte, and
+  /// provides it, leaving the writer empty.
+  std::vector<uint8_t> Finish() {
+    if (count_) {
+      Put(0, 8u - count_);
+    }
+    bytes_.resize(position_);
+    std::vector<uint8_t> bytes;
+    bytes.swap(bytes_);
+    accumulator_ = 0;
+    position_ = 0;
+    bytes_.resize(kSlack, 0);
+    return bytes;
+  }
+
+ private:
+  enum {
+    // the most bits Put() accepts; the accumulator holds fewer than 8 more
+    kMaxBits = 56,
+    // bytes beyond position_ that a store of the accumulator may touch
+    kSlack = 8
+  };
+
+  // Adds a value of bits bits, which must not have any higher bits set.
+  NX_FORCEINLINE void Put(uint64_t value, unsigned int bits) {
+    accumulator_ |= value << count_;
+    count_ += bits;
+    if (NX_UNLIKELY(bytes_.size() - position_ < kSlack)) {
+      bytes_.resize(bytes_.size() * 2u, 0);
+    }
+    nx::Store<uint64_t, kLittleEndian>(&bytes_[position_], accumulator_);
+    // advance past the complete bytes, keeping the partial one
+    position_ += count_ / 8u;
+    accumulator_ >>= count_ & ~7u;
+    count_ %= 8u;
+  }
+
+  uint64_t accumulator_;
+  // the number of bits in the accumulator; always less than 8 between fields
+  unsigned int count_;
+  // the byte at which the accumulator begins
+  size_t position_;
+  std::vector<uint8_t> bytes_;
+};
+
+/// @brief Reads bit fields of up to 64 bits from a byte buffer, least
+/// significant bit first, as written by BitWriter.
+///
+/// Fields are taken from a 64-bit accumulator, refilled with a single
+/// unaligned load that tops it up to at least 56 bits, advancing by however
+/// many whole bytes fit without branching on how many there were.  Only the
+/// last eight bytes of the buffer are read more carefully, so as not to read
+/// past its end.  Reading beyond the end of the buffer provides zeros, and
+/// is reported by exhausted().
+class BitReader {
+ public:
+  /// @brief Constructs a reader of the size bytes at data, which must outlive
+  /// it.
+  BitReader(const uint8_t* data, size_t size)
+      : data_(data),
+        size_(size),
+        accumulator_(0),
+        count_(0),
+        position_(0) {
+  }
+
+  /// @brief The number of bits consumed.
+  NX_FORCEINLINE uint64_t consumed() const {
+    return static_cast<uint64_t>(position_) * 8u - count_;
+  }
+  /// @brief Determines if more bits have been consumed than the buffer holds.
+  NX_FORCEINLINE bool exhausted() const {
+    return consumed() > static_cast<uint64_t>(size_) * 8u;
+  }
+
+  /// @brief Provides the next bits bits without consuming them, for bits of
+  /// at most 56.
+  NX_FORCEINLINE uint64_t Peek(unsigned int bits) {
+    if (count_ < bits) {
+      Refill();
+    }
+    return accumulator_ & Bits<uint64_t>::LowMask(bits);
+  }
+  /// @brief Skips the next bits bits, which must have been peeked at.
+  NX_FORCEINLINE void Consume(unsigned int bits) {
+    accumulator_ >>= bits;
+    count_ -= bits;
+  }
+  /// @brief Consumes and provides the next bits bits, for bits of at most 64.
+  NX_FORCEINLINE uint64_t Read(unsigned int bits) {
+    if (bits > kMaxBits) {
+      const uint64_t low = Take(32u);
+      return low | (Take(bits - 32u) << 32u);
+    }
+    return Take(bits);
+  }
+  /// @brief Consumes and provides the next kBits bits.
+  template <unsigned int kBits>
+  NX_FORCEINLINE uint_least_t<kBits> Read() {
+    return static_cast<uint_least_t<kBits>>(Read(kBits));
+  }
+  /// @brief Reads count fields of bits bits into values, for bits of at most
+  /// 64.  The accumulator is refilled once per as many fields as it holds.
+  void Read(size_t count, unsigned int bits, uint64_t* values) {
+    if (bits > kMaxBits || !bits) {
+      for (size_t i = 0; i < count; ++i) {
+        values[i] = Read(bits);
+      }
+      return;
+    }
+    const uint64_t mask = Bits<uint64_t>::LowMask(bits);
+    const size_t per_refill = kMaxBits / bits;
+    size_t i = 0;
+    for (; i + per_refill <= count; i += per_refill) {
+      Refill();
+      for (size_t j = 0; j < per_refill; ++j) {
+        values[i + j] = accumulator_ & mask;
+        Consume(bits);
+      }
+    }
+    for (; i < count; ++i) {
+      values[i] = Read(bits);
+    }
+  }
+  /// @brief Reads count fields of kBits bits into values.  With the width
+  /// known, the fields taken per refill are unrolled.
+  template <unsigned int kBits>
+  void Read(size_t count, uint_least_t<kBits>* values) {
+    static_assert(kBits >= 1u && kBits <= 64u,
+        "Fields must be between 1 and 64 bits wide.");
+    typedef uint_least_t<kBits> value_type;
+    const size_t per_refill = (kBits <= kMaxBits ? kMaxBits / kBits : 0u);
+    size_t i = 0;
+    if (per_refill) {
+      const uint64_t mask = detail::BitStreamWord::Low(
+          ~static_cast<uint64_t>(0), kBits);
+      for (; i + per_refill <= count; i += per_refill) {
+        Refill();
+        for (size_t j = 0; j < per_refill; ++j) {
+          values[i + j] = static_cast<value_type>(accumulator_ & mask);
+          Consume(kBits);
+        }
+      }
+    }
+    for (; i < count; ++i) {
+      values[i] = Read<kBits>();
+    }
+  }
+
+ private:
+  enum {
+    // the fewest bits the accumulator holds after a refill
+    kMaxBits = 56
+  };
+
+  NX_FORCEINLINE uint64_t Take(unsigned int bits) {
+    const uint64_t value = Peek(bits);
+    Consume(bits);
+    return value;
+  }
+  // Tops the accumulator up to between 56 and 63 bits.
+  NX_FORCEINLINE void Refill() {
+    accumulator_ |= Load() << count_;
+    position_ += (63u - count_) / 8u;
+    count_ |= kMaxBits;
+  }
+  // The eight bytes at position_, as zero beyond the end of the buffer.
+  NX_FORCEINLINE uint64_t Load() const {
+    if (NX_LIKELY(position_ + 8u <= size_)) {
+      return nx::Load<uint64_t, kLittleEndian>(data_ + position_);
+    }
+    uint8_t bytes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    if (position_ < size_) {
+      memcpy(bytes, data_ + position_, size_ - position_);
+    }
+    return nx::Load<uint64_t, kLittleEndian>(bytes);
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  uint64_t accumulator_;
+  // the number of valid bits in the accumulator
+  unsigned int count_;
+  // the byte following those loaded into the accumulator
+  size_t position_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_BIT_STREAM_H_
@@ -0,0 +1,230 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_vector.h
+/// @brief A dynamically sized sequence of bits, operated upon a word at a
+/// time.
+
+#ifndef INCLUDE_NX_CORE_BIT_VECTOR_H_
+#define INCLUDE_NX_CORE_BIT_VECTOR_H_
+
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/bit_span.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief A dynamically sized sequence of bits stored contiguously in words of
+/// type Word.  Bits beyond size() in the final word are always kept clear, so
+/// that whole-word operations never need to special-case the tail.
+template <typename Word = uint_least_t<64>>
+class BitVector {
+  static_assert(std::is_unsigned<Word>::value,
+      "BitVector words must be of an unsigned integral type.");
+
+ public:
+  /// @brief The type of the words in which bits are stored.
+  typedef Word word_type;
+
+  /// @brief Constructs an empty bit vector.
+  BitVector() : size_(0) {
+  }
+  /// @brief Constructs a bit vector of the specified size, with every bit
+  /// initialized to value.
+  explicit BitVector(size_t size, bool value = false)
+      : size_(0) {
+    resize(size, value);
+  }
+
+  /// @brief The number of bits in a word.
+  static NX_FORCEINLINE constexpr size_t WordSize() {
+    return Bits<Word>::Size();
+  }
+  /// @brief The number of bits in the vector.
+  NX_FORCEINLINE size_t size() const {
+    return size_;
+  }
+  /// @brief Determines if the vector contains no bits.
+  NX_FORCEINLINE bool empty() const {
+    return size_ == 0;
+  }
+  /// @brief The number of words used to store the bits.
+  NX_FORCEINLINE size_t word_count() const {
+    return words_.size();
+  }
+  /// @brief The words in which bits are stored.
+  NX_FORCEINLINE const Word* data() const {
+    return words_.data();
+  }
+  /// @brief The words in which bits are stored.  If modified, bits beyond
+  /// size() in the final word must be left clear.
+  NX_FORCEINLINE Word* data() {
+    return words_.data();
+  }
+
+  /// @brief Changes the number of bits, initializing any new bits to value.
+  void resize(size_t size, bool value = false) {
+    if (value && size > size_ && (size_ % WordSize()) != 0) {
+      // fill the unused part of the current final word before growing
+      Bits<Word>::set(~Bits<Word>::LowMask(BitIndex(size_)),
+          &words_.back());
+    }
+    words_.resize(WordCount(size), value ? ~static_cast<Word>(0) : 0);
+    size_ = size;
+    ClearTail();
+  }
+
+  /// @brief Provides the value of the bit at index.
+  NX_FORCEINLINE bool get(size_t index) const {
+    return Bits<Word>::get(Mask(index), &words_[WordIndex(index)]) != 0;
+  }
+  /// @brief Sets the bit at index.
+  NX_FORCEINLINE void set(size_t index) {
+    Bits<Word>::set(Mask(index), &words_[WordIndex(index)]);
+  }
+  /// @brief Clears the bit at index.
+  NX_FORCEINLINE void clear(size_t index) {
+    Bits<Word>::clear(Mask(index), &words_[WordIndex(index)]);
+  }
+  /// @brief Sets or clears the bit at index as specified by value.
+  NX_FORCEINLINE void assign(size_t index, bool value) {
+    Bits<Word>::assign(Mask(index), value ? ~static_cast<Word>(0) : 0,
+        &words_[WordIndex(index)]);
+  }
+
+  /// @brief Sets every bit.
+  void SetAll() {
+    Word* words = words_.data();
+    for (size_t i = 0, count = words_.size(); i < count; ++i) {
+      words[i] = ~static_cast<Word>(0);
+    }
+    ClearTail();
+  }
+  /// @brief Clears every bit.
+  void ClearAll() {
+    Word* words = words_.data();
+    for (size_t i = 0, count = words_.size(); i < count; ++i) {
+      words[i] = 0;
+    }
+  }
+
+  /// @brief Provides the number of set bits.
+  uint64_t Count() const {
+    return BitSpan<Word>::PopCount(words_.data(), words_.size());
+  }
+  /// @brief Provides the index of the first set bit, or size() if none are
+  /// set.
+  size_t FindFirst() const {
+    return FindFrom(0);
+  }
+  /// @brief Provides the index of the first set bit after index, or size() if
+  /// none are set.
+  size_t FindNext(size_t index) const {
+    return (index >= size_ ? size_ : FindFrom(index + 1));
+  }
+
+  // Whole-word operations.  The other vector is treated as if it were
+  // zero-extended (or truncated) to the size of this one.
+
+  /// @brief Keeps only the bits also set in other.
+  BitVector& operator&=(const BitVector& other) {
+    Word* words = words_.data();
+    const Word* other_words = other.words_.data();
+    const size_t common = CommonWordCount(other);
+    BitSpan<Word>::And(words, other_words, common, words);
+    for (size_t i = common, count = words_.size(); i < count; ++i) {
+      words[i] = 0;
+    }
+    return *this;
+  }
+  /// @brief Sets the bits which are set in other.
+  BitVector& operator|=(const BitVector& other) {
+    Word* words = words_.data();
+    const Word* other_words = other.words_.data();
+    BitSpan<Word>::Or(words, other_words, CommonWordCount(other), words);
+    ClearTail();
+    return *this;
+  }
+  /// @brief Toggles the bits which are set in other.
+  BitVector& operator^=(const BitVector& other) {
+    Word* words = words_.data();
+    const Word* other_words = other.words_.data();
+    BitSpan<Word>::Xor(words, other_words, CommonWordCount(other), words);
+    ClearTail();
+    return *this;
+  }
+  /// @brief Clears the bits which are set in other.
+  BitVector& AndNot(const BitVector& other) {
+    Word* words = words_.data();
+    const Word* other_words = other.words_.data();
+    BitSpan<Word>::AndNot(words, other_words, CommonWordCount(other),
+        words);
+    return *this;
+  }
+
+ private:
+  static NX_FORCEINLINE size_t WordCount(size_t size) {
+    return (size + (WordSize() - 1)) / WordSize();
+  }
+  static NX_FORCEINLINE size_t WordIndex(size_t index) {
+    return index / WordSize();
+  }
+  static NX_FORCEINLINE unsigned int BitIndex(size_t index) {
+    return static_cast<unsigned int>(index % WordSize());
+  }
+  static NX_FORCEINLINE Word Mask(size_t index) {
+    return Bits<Word>::Mask(BitIndex(index));
+  }
+  NX_FORCEINLINE size_t CommonWordCount(const BitVector& other) const {
+    return (words_.size() < other.words_.size() ?
+        words_.size() : other.words_.size());
+  }
+  NX_FORCEINLINE void ClearTail() {
+    if ((size_ % WordSize()) != 0) {
+      Bits<Word>::clear(~Bits<Word>::LowMask(BitIndex(size_)),
+          &words_.back());
+    }
+  }
+  size_t FindFrom(size_t index) const {
+    if (index >= size_) {
+      return size_;
+    }
+    const Word* words = words_.data();
+    const size_t count = words_.size();
+    size_t word_index = WordIndex(index);
+    // ignore the bits preceding index in its word
+    Word word = Bits<Word>::get(~Bits<Word>::LowMask(BitIndex(index)),
+        &words[word_index]);
+    while (!word) {
+      if (++word_index == count) {
+        return size_;
+      }
+      word = words[word_index];
+    }
+    return word_index * WordSize() + Bits<Word>::ScanForward(word);
+  }
+
+  std::vector<Word> words_;
+  size_t size_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_BIT_VECTOR_H_
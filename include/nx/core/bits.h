@@ -22,6 +22,7 @@
 #define INCLUDE_NX_CORE_BITS_H_
 
 #include "nx/core/mpl.h"
+#include "nx/core/cpu.h"
 
 /// @brief Library namespace.
 namespace nx {
@@ -58,17 +59,30 @@ class Bits : public GenericBits<T> {
   NX_UNINSTANTIABLE(Bits);
 };
 template <typename T>
-class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
+class Bits<T, EnableIf<IsIntegral<T>>> : public GenericBits<T> {
  public:
   static NX_FORCEINLINE constexpr T LowMask(unsigned int length) {
-    return ~((~static_cast<T>(0)) << length);
+    // shift an unsigned value; types narrower than int promote to int, which
+    // must not be negative when shifted.
+    return static_cast<T>(~(static_cast<MakeUnsigned<T>>(
+        ~static_cast<MakeUnsigned<T>>(0)) << length));
   }
   template <T length_>
   static NX_FORCEINLINE constexpr T LowMask() {
-    return ~((~static_cast<T>(0)) << length_);
+    return LowMask(static_cast<unsigned int>(length_));
   }
   static NX_FORCEINLINE constexpr bool MultiplicationOverflow(T kLHS, T kRHS) {
-    return (kRHS != 0 && (static_cast<T>(kLHS * kRHS) / kRHS) != kLHS);
+#if defined(NX_TC_GCC) && NX_TC_GCC >= 70000
+    // usable in constant expressions, and avoids a division at runtime
+    return __builtin_mul_overflow_p(kLHS, kRHS, static_cast<T>(0));
+#else
+    // multiply without signed overflow; the wrapped product, divided by one
+    // operand, recovers the other unless it overflowed.
+    return (kRHS != 0 && ((IsSigned<T>::value &&
+        kRHS == static_cast<T>(-1) && kLHS == Detail::Minimum()) ||
+        static_cast<T>(Detail::Widen(kLHS) * Detail::Widen(kRHS)) / kRHS !=
+            kLHS));
+#endif
   }
   /// @brief Determines if multiplying kLHS with kRHS will result in an
   /// overflow.
@@ -83,6 +97,11 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
   static NX_FORCEINLINE constexpr bool PowerOfTwo() {
     return Bool<PowerOfTwo(value_)>::value;
   }
+  /// @brief Provides value with its least significant set bit cleared.
+  static NX_FORCEINLINE constexpr T ClearLowest(T value) {
+    return static_cast<T>(static_cast<MakeUnsigned<T>>(value) &
+        (static_cast<MakeUnsigned<T>>(value) - 1u));
+  }
 
  private:
   class Detail {
@@ -112,14 +131,21 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
         T> Power() {
       return value_;
     }
+    // Squares the half power, then multiplies in the remaining factor, so
+    // that the recursion is logarithmic in the power.
     template <T value_, unsigned int power_>
     static NX_FORCEINLINE constexpr EnableIf<Bool<
           power_ != 0u && power_ != 1u>,
         T> Power() {
       static_assert(!MultiplicationOverflow<
-          value_, Power<value_, power_ - 1>()>(),
+          Power<value_, power_ / 2u>(), Power<value_, power_ / 2u>()>() &&
+          !MultiplicationOverflow<static_cast<T>(
+              Power<value_, power_ / 2u>() * Power<value_, power_ / 2u>()),
+              Power<value_, power_ % 2u>()>(),
           "Multiplication overflows when computing this exponentiation.");
-      return static_cast<T>(value_ * Power<value_, power_ - 1>());
+      return static_cast<T>(
+          Power<value_, power_ / 2u>() * Power<value_, power_ / 2u>() *
+          Power<value_, power_ % 2u>());
     }
     template <T value_>
     static NX_FORCEINLINE constexpr EnableIf<
@@ -131,7 +157,7 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
     static NX_FORCEINLINE constexpr EnableIf<
           Bool<value_ && !(value_ & static_cast<T>(1))>,
         unsigned int> ScanForward() {
-      typedef typename std::make_unsigned<T>::type unsigned_T;
+      typedef MakeUnsigned<T> unsigned_T;
       return 1 + Bits<unsigned_T>::template ScanForward<
           (static_cast<unsigned_T>(value_) >> 1u)>();
     }
@@ -150,7 +176,7 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
     static NX_FORCEINLINE constexpr EnableIf<
         Bool<value_ && value_ != static_cast<T>(1)>,
         unsigned int> ScanReverse() {
-      typedef typename std::make_unsigned<T>::type unsigned_T;
+      typedef MakeUnsigned<T> unsigned_T;
       return 1 + Bits<unsigned_T>::template ScanReverse<
           (static_cast<unsigned_T>(value_) >> 1)>();
     }
@@ -162,10 +188,437 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
     template <T value_>
     static NX_FORCEINLINE constexpr EnableIf<Bool<value_ != static_cast<T>(0)>,
         unsigned int> PopCount() {
-      typedef typename std::make_unsigned<T>::type unsigned_T;
+      typedef MakeUnsigned<T> unsigned_T;
       return (value_ & 1) + Bits<unsigned_T>::template PopCount<
           (static_cast<unsigned_T>(value_) >> 1)>();
     }
+    // Runtime counterparts of the above.  Values are widened to the largest
+    // builtin type so that a single implementation serves every width; the
+    // intrinsics only take a word_type, so wider types are handled in halves.
+    typedef unsigned long long word_type;  // NOLINT(runtime/int)
+    typedef Conditional<Bool<(sizeof(T) > sizeof(word_type))>,
+        MakeUnsigned<T>, word_type> wide_type;
+    static NX_FORCEINLINE constexpr wide_type Widen(T value) {
+      return static_cast<wide_type>(static_cast<MakeUnsigned<T>>(value));
+    }
+    static NX_FORCEINLINE constexpr bool Split() {
+      return sizeof(wide_type) > sizeof(word_type);
+    }
+    static NX_FORCEINLINE constexpr word_type Low(wide_type value) {
+      return static_cast<word_type>(value);
+    }
+    static NX_FORCEINLINE constexpr word_type High(wide_type value) {
+      return static_cast<word_type>(
+          value >> (Split() ? sizeof(word_type) * CHAR_BIT : 0u));
+    }
+    // Portable fallbacks; a SWAR population count that every other fallback
+    // is expressed in terms of.
+    static NX_FORCEINLINE constexpr wide_type Ones() {
+      return ~static_cast<wide_type>(0);
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountBytes(
+        wide_type value) {
+      return static_cast<unsigned int>(static_cast<wide_type>(
+          value * (Ones() / 255u)) >> ((sizeof(wide_type) - 1) * CHAR_BIT));
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountNibbles(
+        wide_type value) {
+      return PopCountBytes((value + (value >> 4u)) & (Ones() / 255u * 15u));
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountPairs(
+        wide_type value) {
+      return PopCountNibbles((value & (Ones() / 15u * 3u)) +
+          ((value >> 2u) & (Ones() / 15u * 3u)));
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountFallback(
+        wide_type value) {
+      return PopCountPairs(value - ((value >> 1u) & (Ones() / 3u)));
+    }
+    // recursive, so it cannot be forcibly inlined
+    static constexpr wide_type SmearRight(
+        wide_type value, unsigned int shift = 1u) {
+      return (shift < sizeof(wide_type) * CHAR_BIT ?
+          SmearRight(value | (value >> shift), shift << 1u) :
+          value);
+    }
+    static NX_FORCEINLINE constexpr unsigned int ScanForwardFallback(
+        wide_type value) {
+      // isolate the lowest set bit, then count the bits below it
+      return PopCountFallback((value & (~value + 1u)) - 1u);
+    }
+    static NX_FORCEINLINE constexpr unsigned int ScanReverseFallback(
+        wide_type value) {
+      // set every bit below the highest set bit, then count them
+      return PopCountFallback(SmearRight(value)) - 1u;
+    }
+#if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    // Selects the narrowest builtin that holds T; these lower to tzcnt/bsf,
+    // lzcnt/bsr and popcnt when the target supports them.
+    static NX_FORCEINLINE constexpr unsigned int ScanForwardIntrinsic(
+        word_type value) {
+      return static_cast<unsigned int>(
+          Bits<T>::Size() <= Bits<unsigned int>::Size() ?
+            __builtin_ctz(static_cast<unsigned int>(value)) :
+          Bits<T>::Size() <= Bits<unsigned long>::Size() ?  // NOLINT
+            __builtin_ctzl(static_cast<unsigned long>(value)) :  // NOLINT
+            __builtin_ctzll(value));
+    }
+    static NX_FORCEINLINE constexpr unsigned int ScanReverseIntrinsic(
+        word_type value) {
+      return static_cast<unsigned int>(
+          Bits<T>::Size() <= Bits<unsigned int>::Size() ?
+            (Bits<unsigned int>::Size() - 1u) -
+                __builtin_clz(static_cast<unsigned int>(value)) :
+          Bits<T>::Size() <= Bits<unsigned long>::Size() ?  // NOLINT
+            (Bits<unsigned long>::Size() - 1u) -  // NOLINT(runtime/int)
+                __builtin_clzl(static_cast<unsigned long>(value)) :  // NOLINT
+            (Bits<word_type>::Size() - 1u) - __builtin_clzll(value));
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountIntrinsic(
+        word_type value) {
+      return static_cast<unsigned int>(
+          Bits<T>::Size() <= Bits<unsigned int>::Size() ?
+            __builtin_popcount(static_cast<unsigned int>(value)) :
+          Bits<T>::Size() <= Bits<unsigned long>::Size() ?  // NOLINT
+            __builtin_popcountl(static_cast<unsigned long>(value)) :  // NOLINT
+            __builtin_popcountll(value));
+    }
+#elif defined(NX_TC_VS)
+    static NX_FORCEINLINE unsigned int ScanForwardIntrinsic(word_type value) {
+      unsigned long index;  // NOLINT(runtime/int)
+#if defined(_M_X64) || defined(_M_ARM64)
+      _BitScanForward64(&index, value);
+#else
+      if (!_BitScanForward(&index,
+          static_cast<unsigned long>(value))) {  // NOLINT(runtime/int)
+        _BitScanForward(&index,
+            static_cast<unsigned long>(value >> 32u));  // NOLINT
+        index += 32u;
+      }
+#endif
+      return static_cast<unsigned int>(index);
+    }
+    static NX_FORCEINLINE unsigned int ScanReverseIntrinsic(word_type value) {
+      unsigned long index;  // NOLINT(runtime/int)
+#if defined(_M_X64) || defined(_M_ARM64)
+      _BitScanReverse64(&index, value);
+#else
+      if (_BitScanReverse(&index,
+          static_cast<unsigned long>(value >> 32u))) {  // NOLINT
+        index += 32u;
+      } else {
+        _BitScanReverse(&index,
+            static_cast<unsigned long>(value));  // NOLINT(runtime/int)
+      }
+#endif
+      return static_cast<unsigned int>(index);
+    }
+    static NX_FORCEINLINE unsigned int PopCountIntrinsic(word_type value) {
+      // popcnt is not guaranteed to exist prior to AVX capable processors
+#if defined(__AVX__) && defined(_M_X64)
+      return static_cast<unsigned int>(__popcnt64(value));
+#else
+      return PopCountFallback(value);
+#endif
+    }
+#else
+    static NX_FORCEINLINE constexpr unsigned int ScanForwardIntrinsic(
+        word_type value) {
+      return ScanForwardFallback(value);
+    }
+    static NX_FORCEINLINE constexpr unsigned int ScanReverseIntrinsic(
+        word_type value) {
+      return ScanReverseFallback(value);
+    }
+    static NX_FORCEINLINE constexpr unsigned int PopCountIntrinsic(
+        word_type value) {
+      return PopCountFallback(value);
+    }
+#endif
+    // The above over a nonzero wide_type, a half at a time when split.
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanForwardWide(
+        wide_type value) {
+      return (Split() && !Low(value) ?
+          Bits<word_type>::Size() + ScanForwardIntrinsic(High(value)) :
+          ScanForwardIntrinsic(Low(value)));
+    }
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanReverseWide(
+        wide_type value) {
+      return (Split() && High(value) ?
+          Bits<word_type>::Size() + ScanReverseIntrinsic(High(value)) :
+          ScanReverseIntrinsic(Low(value)));
+    }
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int PopCountWide(
+        wide_type value) {
+      return PopCountIntrinsic(Low(value)) +
+          (Split() ? PopCountIntrinsic(High(value)) : 0u);
+    }
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanForward(
+        T value) {
+      // Give a defined result for zero, matching ScanForward<0>()
+      return (value ? ScanForwardWide(Widen(value)) : 0u);
+    }
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanReverse(
+        T value) {
+      // Give a defined result for zero, matching ScanReverse<0>()
+      return (value ? ScanReverseWide(Widen(value)) : 0u);
+    }
+    static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int PopCount(
+        T value) {
+      return PopCountWide(Widen(value));
+    }
+    // Overflow-checked arithmetic.  The builtins compute the exact result and
+    // report whether it fits in T.  Elsewhere, the wrapped result is computed
+    // in the widest unsigned type, and overflow is derived from the signs of
+    // the operands and result, or from a wider product.
+    static NX_FORCEINLINE constexpr T Maximum() {
+      return static_cast<T>(IsSigned<T>::value ?
+          static_cast<MakeUnsigned<T>>(~static_cast<MakeUnsigned<T>>(0)) >> 1u :
+          static_cast<MakeUnsigned<T>>(~static_cast<MakeUnsigned<T>>(0)));
+    }
+    static NX_FORCEINLINE constexpr T Minimum() {
+      return static_cast<T>(~Maximum());
+    }
+    // The value to saturate to; the maximum if a result overflowed upwards,
+    // otherwise the minimum.
+    static NX_FORCEINLINE constexpr T Saturated(bool upwards) {
+      return (upwards ? Maximum() : Minimum());
+    }
+#if (defined(NX_TC_GCC) && NX_TC_GCC >= 50000) || defined(NX_TC_CLANG)
+    static NX_FORCEINLINE bool CheckedAdd(T lhs, T rhs, T* result) {
+      return __builtin_add_overflow(lhs, rhs, result);
+    }
+    static NX_FORCEINLINE bool CheckedSubtract(T lhs, T rhs, T* result) {
+      return __builtin_sub_overflow(lhs, rhs, result);
+    }
+    static NX_FORCEINLINE bool CheckedMultiply(
+        T lhs, T rhs, T* result) {
+      return __builtin_mul_overflow(lhs, rhs, result);
+    }
+#else
+    static NX_FORCEINLINE bool CheckedAdd(T lhs, T rhs, T* result) {
+      *result = static_cast<T>(Widen(lhs) + Widen(rhs));
+      return (IsSigned<T>::value ?
+          ((lhs ^ *result) & (rhs ^ *result)) < 0 :
+          *result < lhs);
+    }
+    static NX_FORCEINLINE bool CheckedSubtract(T lhs, T rhs, T* result) {
+      *result = static_cast<T>(Widen(lhs) - Widen(rhs));
+      return (IsSigned<T>::value ?
+          ((lhs ^ rhs) & (lhs ^ *result)) < 0 :
+          lhs < rhs);
+    }
+    static NX_FORCEINLINE bool CheckedMultiply(
+        T lhs, T rhs, T* result) {
+      *result = static_cast<T>(Widen(lhs) * Widen(rhs));
+      if (Bits<T>::Size() * 2u <= Bits<wide_type>::Size()) {
+        // the exact product fits in the widest type
+        typedef Conditional<IsSigned<T>,
+            long long, wide_type> exact_type;  // NOLINT(runtime/int)
+        const exact_type exact =
+            static_cast<exact_type>(lhs) * static_cast<exact_type>(rhs);
+        return (exact < static_cast<exact_type>(Minimum()) ||
+            exact > static_cast<exact_type>(Maximum()));
+      }
+      // the wrapped product, divided by one operand, recovers the other
+      // unless it overflowed; Minimum() / -1 itself overflows.
+      return (lhs != 0 && ((IsSigned<T>::value &&
+          ((lhs == static_cast<T>(-1) && rhs == Minimum()) ||
+           (rhs == static_cast<T>(-1) && lhs == Minimum()))) ||
+          *result / lhs != rhs));
+    }
+#endif
+    // Square-and-multiply.  The base is only squared when a later exponent
+    // bit uses it, so any overflow along the way implies that the result
+    // overflows; the wrapped result is exact modulo 2^Size() regardless.
+    static NX_FORCEINLINE bool CheckedPower(
+        T base, unsigned int exponent, T* result) {
+      T power = static_cast<T>(1);
+      bool overflow = false;
+      for (;;) {
+        if (exponent & 1u) {
+          overflow |= CheckedMultiply(power, base, &power);
+        }
+        exponent >>= 1u;
+        if (!exponent) {
+          break;
+        }
+        overflow |= CheckedMultiply(base, base, &base);
+      }
+      *result = power;
+      return overflow;
+    }
+    // Extract gathers the bits of a value selected by a mask into the low
+    // bits of the result; Deposit scatters the low bits of a value into the
+    // positions selected by a mask.  In software, each contiguous run of set
+    // bits in the mask costs one shift and mask.
+    static NX_FORCEINLINE constexpr wide_type LowestRun(wide_type mask) {
+      // adding the lowest set bit carries through the run, clearing it
+      return mask & ~(mask + (mask & (~mask + 1u)));
+    }
+    static NX_FORCEINLINE constexpr unsigned int RunLength(wide_type run) {
+      return ScanReverseFallback(run) + 1u - ScanForwardFallback(run);
+    }
+    template <T mask_, unsigned int shift_>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+          mask_ == static_cast<T>(0)>,
+        wide_type> Extract(wide_type /* value */) {
+      return 0;
+    }
+    template <T mask_, unsigned int shift_>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+          mask_ != static_cast<T>(0)>,
+        wide_type> Extract(wide_type value) {
+      typedef std::integral_constant<wide_type, LowestRun(Widen(mask_))> run;
+      return (((value & run::value) >> ScanForwardFallback(run::value))
+          << shift_) | Extract<static_cast<T>(Widen(mask_) ^ run::value),
+              shift_ + RunLength(run::value)>(value);
+    }
+    template <T mask_, unsigned int shift_>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+          mask_ == static_cast<T>(0)>,
+        wide_type> Deposit(wide_type /* value */) {
+      return 0;
+    }
+    template <T mask_, unsigned int shift_>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+          mask_ != static_cast<T>(0)>,
+        wide_type> Deposit(wide_type value) {
+      typedef std::integral_constant<wide_type, LowestRun(Widen(mask_))> run;
+      return (((value >> shift_) << ScanForwardFallback(run::value)) &
+          run::value) | Deposit<static_cast<T>(Widen(mask_) ^ run::value),
+              shift_ + RunLength(run::value)>(value);
+    }
+    static NX_FORCEINLINE wide_type ExtractSoftware(
+        wide_type value, wide_type mask) {
+      wide_type result = 0;
+      for (unsigned int shift = 0; mask; ) {
+        const wide_type run = LowestRun(mask);
+        const unsigned int low = ScanForwardWide(run);
+        result |= ((value & run) >> low) << shift;
+        shift += ScanReverseWide(run) + 1u - low;
+        mask ^= run;
+      }
+      return result;
+    }
+    static NX_FORCEINLINE wide_type DepositSoftware(
+        wide_type value, wide_type mask) {
+      wide_type result = 0;
+      for (unsigned int shift = 0; mask; ) {
+        const wide_type run = LowestRun(mask);
+        const unsigned int low = ScanForwardWide(run);
+        result |= ((value >> shift) << low) & run;
+        shift += ScanReverseWide(run) + 1u - low;
+        mask ^= run;
+      }
+      return result;
+    }
+#if defined(NX_CPU_X86)
+    // Not forcibly inlined; only callers also targeting BMI2 may inline them.
+#if defined(NX_TC_VS)
+    static word_type ExtractBmi2(word_type value, word_type mask) {
+#if defined(NX_ARCH_X86_64)
+      return _pext_u64(value, mask);
+#else
+      return _pext_u32(static_cast<unsigned int>(value),
+              static_cast<unsigned int>(mask)) |
+          (static_cast<word_type>(_pext_u32(
+              static_cast<unsigned int>(value >> 32u),
+              static_cast<unsigned int>(mask >> 32u))) <<
+              PopCountFallback(static_cast<unsigned int>(mask)));
+#endif
+    }
+    static word_type DepositBmi2(word_type value, word_type mask) {
+#if defined(NX_ARCH_X86_64)
+      return _pdep_u64(value, mask);
+#else
+      return _pdep_u32(static_cast<unsigned int>(value),
+              static_cast<unsigned int>(mask)) |
+          (static_cast<word_type>(_pdep_u32(static_cast<unsigned int>(
+              value >> PopCountFallback(static_cast<unsigned int>(mask))),
+              static_cast<unsigned int>(mask >> 32u))) << 32u);
+#endif
+    }
+#else
+    NX_FUNCTION_TARGET("bmi2")
+    static word_type ExtractBmi2(word_type value, word_type mask) {
+#if defined(NX_ARCH_X86_64)
+      return __builtin_ia32_pext_di(value, mask);
+#else
+      return __builtin_ia32_pext_si(static_cast<unsigned int>(value),
+              static_cast<unsigned int>(mask)) |
+          (static_cast<word_type>(__builtin_ia32_pext_si(
+              static_cast<unsigned int>(value >> 32u),
+              static_cast<unsigned int>(mask >> 32u))) <<
+              __builtin_popcount(static_cast<unsigned int>(mask)));
+#endif
+    }
+    NX_FUNCTION_TARGET("bmi2")
+    static word_type DepositBmi2(word_type value, word_type mask) {
+#if defined(NX_ARCH_X86_64)
+      return __builtin_ia32_pdep_di(value, mask);
+#else
+      return __builtin_ia32_pdep_si(static_cast<unsigned int>(value),
+              static_cast<unsigned int>(mask)) |
+          (static_cast<word_type>(__builtin_ia32_pdep_si(
+              static_cast<unsigned int>(value >> __builtin_popcount(
+                  static_cast<unsigned int>(mask))),
+              static_cast<unsigned int>(mask >> 32u))) << 32u);
+#endif
+    }
+#endif
+    // A wide_type a half at a time; the high half of the value continues
+    // where the low half of the mask left off.
+    static NX_FORCEINLINE wide_type ExtractBmi2Wide(
+        wide_type value, wide_type mask) {
+      return (Split() ?
+          static_cast<wide_type>(ExtractBmi2(Low(value), Low(mask))) |
+              (static_cast<wide_type>(ExtractBmi2(High(value), High(mask))) <<
+                  PopCountIntrinsic(Low(mask))) :
+          ExtractBmi2(Low(value), Low(mask)));
+    }
+    static NX_FORCEINLINE wide_type DepositBmi2Wide(
+        wide_type value, wide_type mask) {
+      return (Split() ?
+          static_cast<wide_type>(DepositBmi2(Low(value), Low(mask))) |
+              (static_cast<wide_type>(DepositBmi2(
+                  Low(value >> PopCountIntrinsic(Low(mask))), High(mask))) <<
+                  (sizeof(wide_type) - sizeof(word_type)) * CHAR_BIT) :
+          DepositBmi2(Low(value), Low(mask)));
+    }
+#if defined(__BMI2__) || (defined(NX_TC_VS) && defined(__AVX2__))
+    static NX_FORCEINLINE wide_type ExtractRuntime(
+        wide_type value, wide_type mask) {
+      return ExtractBmi2Wide(value, mask);
+    }
+    static NX_FORCEINLINE wide_type DepositRuntime(
+        wide_type value, wide_type mask) {
+      return DepositBmi2Wide(value, mask);
+    }
+#else
+    static NX_FORCEINLINE wide_type ExtractRuntime(
+        wide_type value, wide_type mask) {
+      return (Cpu::Supports(Cpu::kBmi2) ?
+          ExtractBmi2Wide(value, mask) :
+          ExtractSoftware(value, mask));
+    }
+    static NX_FORCEINLINE wide_type DepositRuntime(
+        wide_type value, wide_type mask) {
+      return (Cpu::Supports(Cpu::kBmi2) ?
+          DepositBmi2Wide(value, mask) :
+          DepositSoftware(value, mask));
+    }
+#endif
+#else
+    static NX_FORCEINLINE wide_type ExtractRuntime(
+        wide_type value, wide_type mask) {
+      return ExtractSoftware(value, mask);
+    }
+    static NX_FORCEINLINE wide_type DepositRuntime(
+        wide_type value, wide_type mask) {
+      return DepositSoftware(value, mask);
+    }
+#endif
     template <T mask_, T value_, class PointerType>
     static NX_FORCEINLINE EnableIf<Bool<
             mask_ == static_cast<T>(0)>,  // empty
@@ -282,6 +735,51 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
       // bit mask - merge bits
       assign(mask_, value, data);
     }
+    // The union of the masks of the fields in a Write().
+    template <class ... Fields>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+            sizeof...(Fields) == 0u>,
+        T> FieldMask() {
+      return static_cast<T>(0);
+    }
+    template <class Field, class ... Fields>
+    static NX_FORCEINLINE constexpr T FieldMask() {
+      static_assert(std::is_same<typename Field::type, T>::value,
+          "Field is of another type.");
+      static_assert(!(Field::Mask() & FieldMask<Fields...>()),
+          "Fields overlap.");
+      return static_cast<T>(Field::Mask() | FieldMask<Fields...>());
+    }
+    // Determines if every field's value is a constant.
+    template <class ... Fields>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+            sizeof...(Fields) == 0u>,
+        bool> FieldsConstant() {
+      return true;
+    }
+    template <class Field, class ... Fields>
+    static NX_FORCEINLINE constexpr bool FieldsConstant() {
+      return Field::Constant() && FieldsConstant<Fields...>();
+    }
+    // The union of the fields' values, each shifted into place.
+    static NX_FORCEINLINE constexpr T FieldValue() {
+      return static_cast<T>(0);
+    }
+    template <class Field, class ... Fields>
+    static NX_FORCEINLINE constexpr T FieldValue(
+        Field field, Fields ... fields) {
+      return static_cast<T>(field.Shifted() | FieldValue(fields...));
+    }
+    template <class ... Fields>
+    static NX_FORCEINLINE constexpr EnableIf<Bool<
+            sizeof...(Fields) == 0u>,
+        T> FieldConstant() {
+      return static_cast<T>(0);
+    }
+    template <class Field, class ... Fields>
+    static NX_FORCEINLINE constexpr T FieldConstant() {
+      return static_cast<T>(Field::Shifted() | FieldConstant<Fields...>());
+    }
   };
 
  public:
@@ -295,7 +793,59 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
     return Detail::template Mask<indexes_...>();
   }
 
-  // NOTE: intentionally omitting dynamic power
+  /// @brief Stores lhs + rhs in result, wrapped as for unsigned arithmetic,
+  /// and determines if the exact sum is not representable by T.
+  static NX_FORCEINLINE bool AdditionOverflow(T lhs, T rhs, T* result) {
+    return Detail::CheckedAdd(lhs, rhs, result);
+  }
+  /// @brief Stores lhs - rhs in result, wrapped as for unsigned arithmetic,
+  /// and determines if the exact difference is not representable by T.
+  static NX_FORCEINLINE bool SubtractionOverflow(T lhs, T rhs, T* result) {
+    return Detail::CheckedSubtract(lhs, rhs, result);
+  }
+  /// @brief Stores lhs * rhs in result, wrapped as for unsigned arithmetic,
+  /// and determines if the exact product is not representable by T.  Unlike
+  /// the constant expression form, this never divides where the compiler
+  /// provides overflow builtins.
+  static NX_FORCEINLINE bool MultiplicationOverflow(T lhs, T rhs, T* result) {
+    return Detail::CheckedMultiply(lhs, rhs, result);
+  }
+  /// @brief Provides lhs + rhs, clamped to the range of T.
+  static NX_FORCEINLINE T SaturatingAdd(T lhs, T rhs) {
+    T result;
+    // overflow can only be towards the sign of rhs
+    return (Detail::CheckedAdd(lhs, rhs, &result) ?
+        Detail::Saturated(!(rhs < 0)) : result);
+  }
+  /// @brief Provides lhs - rhs, clamped to the range of T.
+  static NX_FORCEINLINE T SaturatingSubtract(T lhs, T rhs) {
+    T result;
+    // overflow can only be away from the sign of rhs
+    return (Detail::CheckedSubtract(lhs, rhs, &result) ?
+        Detail::Saturated(rhs < 0) : result);
+  }
+  /// @brief Provides lhs * rhs, clamped to the range of T.
+  static NX_FORCEINLINE T SaturatingMultiply(T lhs, T rhs) {
+    T result;
+    return (Detail::CheckedMultiply(lhs, rhs, &result) ?
+        Detail::Saturated((lhs < 0) == (rhs < 0)) : result);
+  }
+
+  /// @brief Provides base raised to exponent, wrapped as for unsigned
+  /// arithmetic, using O(log(exponent)) multiplications.
+  static NX_FORCEINLINE T Power(T base, unsigned int exponent) {
+    T result;
+    Detail::CheckedPower(base, exponent, &result);
+    return result;
+  }
+  /// @brief Stores base raised to exponent in result, wrapped as for unsigned
+  /// arithmetic, and determines if the exact power is not representable by T.
+  static NX_FORCEINLINE bool PowerOverflow(
+      T base, unsigned int exponent, T* result) {
+    return Detail::CheckedPower(base, exponent, result);
+  }
+  /// @brief Provides value_ raised to power_, failing to compile if the
+  /// result is not representable by T.
   template <T value_, unsigned int power_>
   static NX_FORCEINLINE constexpr T Power() {
     return Detail::template Power<value_, power_>();
@@ -314,6 +864,55 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
     return Detail::template PopCount<value_>();
   }
 
+  /// @brief Provides the index of the least significant set bit in value, or
+  /// 0 if no bits are set.  Lowers to a single instruction where available,
+  /// and is evaluated at compile time when value is a constant expression.
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanForward(
+      T value) {
+    return Detail::ScanForward(value);
+  }
+  /// @brief Provides the index of the most significant set bit in value, or
+  /// 0 if no bits are set.  Lowers to a single instruction where available,
+  /// and is evaluated at compile time when value is a constant expression.
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int ScanReverse(
+      T value) {
+    return Detail::ScanReverse(value);
+  }
+  /// @brief Provides the number of set bits in value.  Lowers to a single
+  /// instruction where available, and is evaluated at compile time when value
+  /// is a constant expression.
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR unsigned int PopCount(
+      T value) {
+    return Detail::PopCount(value);
+  }
+
+  /// @brief Gathers the bits of value selected by mask into the low bits of
+  /// the result (PEXT).  Uses BMI2 when targeted or detected at runtime.
+  static NX_FORCEINLINE T Extract(T value, T mask) {
+    return static_cast<T>(Detail::ExtractRuntime(
+        Detail::Widen(value), Detail::Widen(mask)));
+  }
+  /// @brief Gathers the bits of value selected by mask_ into the low bits of
+  /// the result, using one shift and mask per contiguous run in mask_.
+  template <T mask_>
+  static NX_FORCEINLINE constexpr T Extract(T value) {
+    return static_cast<T>(
+        Detail::template Extract<mask_, 0>(Detail::Widen(value)));
+  }
+  /// @brief Scatters the low bits of value into the positions selected by
+  /// mask (PDEP).  Uses BMI2 when targeted or detected at runtime.
+  static NX_FORCEINLINE T Deposit(T value, T mask) {
+    return static_cast<T>(Detail::DepositRuntime(
+        Detail::Widen(value), Detail::Widen(mask)));
+  }
+  /// @brief Scatters the low bits of value into the positions selected by
+  /// mask_, using one shift and mask per contiguous run in mask_.
+  template <T mask_>
+  static NX_FORCEINLINE constexpr T Deposit(T value) {
+    return static_cast<T>(
+        Detail::template Deposit<mask_, 0>(Detail::Widen(value)));
+  }
+
   template <class PointerType>
   static NX_FORCEINLINE void assign(T mask, T value, PointerType* data) {
     return Detail::template assign<PointerType>(mask, value, data);
@@ -351,16 +950,140 @@ class Bits<T, EnableIf<std::is_integral<T>>> : public GenericBits<T> {
   static NX_FORCEINLINE void clear(PointerType* data) {
     Detail::template clear<mask_, PointerType>(data);
   }
+  /// @brief Writes every one of fields to *data at once; each is a value
+  /// assigned to a BitField, as in Write(&data, Field() = value, ...).
+  ///
+  /// The fields' masks are combined at compile time, so this is a single
+  /// read-modify-write of *data, or a single store if the fields cover all of
+  /// T.  If every value is a BitField constant, the values are combined at
+  /// compile time as well, and the write reduces to an or or an and where
+  /// the bits written are all set or all clear.
+  template <class PointerType, class ... Fields>
+  static NX_FORCEINLINE EnableIf<Bool<
+          Detail::template FieldsConstant<Fields...>()>,
+      void> Write(PointerType* data, Fields ...) {
+    Detail::template assign<Detail::template FieldMask<Fields...>(),
+        Detail::template FieldConstant<Fields...>(), PointerType>(data);
+  }
+  template <class PointerType, class ... Fields>
+  static NX_FORCEINLINE DisableIf<Bool<
+          Detail::template FieldsConstant<Fields...>()>,
+      void> Write(PointerType* data, Fields ... fields) {
+    Detail::template assign<Detail::template FieldMask<Fields...>(),
+        PointerType>(Detail::FieldValue(fields...), data);
+  }
 
  private:
   NX_UNINSTANTIABLE(Bits);
 };
 
+template <class Field>
+class BitFieldValue;
+template <class Field, typename Field::type value_>
+class BitFieldConstant;
+
+/// @brief Describes the kWidth bits of a T beginning at bit kOffset, such as
+/// one field of a device register or packed header.
+///
+/// Instances are empty, and exist so that assigning to one describes a write,
+/// as in Bits<T>::Write(&data, Field() = value).
+template <typename T, unsigned int kOffset, unsigned int kWidth>
+class BitField {
+  static_assert(kWidth != 0u, "A field must have at least one bit.");
+  static_assert(kOffset + kWidth <= Bits<T>::Size(),
+      "A field must lie within its type.");
+  typedef MakeUnsigned<T> unsigned_T;
+
+ public:
+  typedef T type;
+
+  /// @brief The lowest bit of the field.
+  static NX_FORCEINLINE constexpr unsigned int Offset() {
+    return kOffset;
+  }
+  /// @brief The number of bits in the field.
+  static NX_FORCEINLINE constexpr unsigned int Width() {
+    return kWidth;
+  }
+  /// @brief The bits of the field, in place.
+  static NX_FORCEINLINE constexpr T Mask() {
+    // shifted right rather than built with LowMask, which cannot provide
+    // every bit of T
+    return static_cast<T>(static_cast<unsigned_T>(
+        static_cast<unsigned_T>(~static_cast<unsigned_T>(0)) >>
+            (Bits<T>::Size() - kWidth)) << kOffset);
+  }
+  /// @brief value, which is truncated to the width of the field, moved into
+  /// place.
+  static NX_FORCEINLINE constexpr T Shift(T value) {
+    return static_cast<T>(static_cast<unsigned_T>(
+        static_cast<unsigned_T>(value) << kOffset) & Mask());
+  }
+  /// @brief The value of the field within word.
+  static NX_FORCEINLINE constexpr T Get(T word) {
+    return static_cast<T>((static_cast<unsigned_T>(word) &
+        static_cast<unsigned_T>(Mask())) >> kOffset);
+  }
+  /// @brief A value to be written to the field.
+  NX_FORCEINLINE constexpr BitFieldValue<BitField> operator=(T value) const {
+    return BitFieldValue<BitField>(value);
+  }
+  /// @brief A value to be written to the field, known at compile time.
+  template <T value_>
+  static NX_FORCEINLINE constexpr BitFieldConstant<BitField, value_>
+      Constant() {
+    return BitFieldConstant<BitField, value_>();
+  }
+};
+
+/// @brief A value to be written to a Field.
+template <class Field>
+class BitFieldValue {
+ public:
+  typedef typename Field::type type;
+
+  explicit constexpr BitFieldValue(type value) : value_(value) {
+  }
+  static NX_FORCEINLINE constexpr bool Constant() {
+    return false;
+  }
+  static NX_FORCEINLINE constexpr type Mask() {
+    return Field::Mask();
+  }
+  /// @brief The value, moved into place.
+  NX_FORCEINLINE constexpr type Shifted() const {
+    return Field::Shift(value_);
+  }
+
+ private:
+  type value_;
+};
+
+/// @brief A value known at compile time to be written to a Field.
+template <class Field, typename Field::type value_>
+class BitFieldConstant {
+ public:
+  typedef typename Field::type type;
+
+  static NX_FORCEINLINE constexpr bool Constant() {
+    return true;
+  }
+  static NX_FORCEINLINE constexpr type Mask() {
+    return Field::Mask();
+  }
+  /// @brief The value, moved into place.
+  static NX_FORCEINLINE constexpr type Shifted() {
+    return Field::Shift(value_);
+  }
+};
+
 }  // namespace detail
 /// @endcond
 
 template <class T>
 using Bits = detail::Bits<T>;
+template <typename T, unsigned int kOffset, unsigned int kWidth>
+using BitField = detail::BitField<T, kOffset, kWidth>;
 
 }  // namespace nx
 
@@ -0,0 +1,295 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file blocked_bloom_filter.h
+/// @brief A Bloom filter whose probes for a key all fall within one cache
+/// line.
+
+#ifndef INCLUDE_NX_CORE_BLOCKED_BLOOM_FILTER_H_
+#define INCLUDE_NX_CORE_BLOCKED_BLOOM_FILTER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// The kernels of BlockedBloomFilter, for each instruction set, operating on
+// a count of 512-bit blocks aligned to 64 bytes.
+class BlockedBloomFilterKernels {
+ public:
+  enum {
+    kBlockWords = 8,
+    kBlockBits = kBlockWords * 64,
+    // how many keys ahead of the current one to prefetch
+    kPrefetchDistance = 8
+  };
+
+  // The first word of the block for hash; the high half of the hash scaled
+  // into [0, count).
+  static NX_FORCEINLINE const uint64_t* Block(
+      const uint64_t* blocks, size_t count, uint64_t hash) {
+    return blocks + static_cast<size_t>(((hash >> 32u) * count) >> 32u) *
+        kBlockWords;
+  }
+  static NX_FORCEINLINE uint64_t* Block(
+      uint64_t* blocks, size_t count, uint64_t hash) {
+    return const_cast<uint64_t*>(
+        Block(static_cast<const uint64_t*>(blocks), count, hash));
+  }
+  static NX_FORCEINLINE void Insert(
+      uint64_t* blocks, size_t count, uint64_t hash) {
+    uint64_t* block = Block(blocks, count, hash);
+    for (unsigned int i = 0; i < kBlockWords; ++i) {
+      Bits<uint64_t>::set(Mask(hash, i), block + i);
+    }
+  }
+  static NX_FORCEINLINE bool Contains(
+      const uint64_t* blocks, size_t count, uint64_t hash) {
+    const uint64_t* block = Block(blocks, count, hash);
+    uint64_t missing = 0;
+    for (unsigned int i = 0; i < kBlockWords; ++i) {
+      missing |= Mask(hash, i) & ~block[i];
+    }
+    return !missing;
+  }
+
+  static void InsertScalar(uint64_t* blocks, size_t count,
+      const uint64_t* hashes, size_t hash_count) {
+    for (size_t i = 0; i < hash_count; ++i) {
+      if (i + kPrefetchDistance < hash_count) {
+        Prefetch(Block(blocks, count, hashes[i + kPrefetchDistance]));
+      }
+      Insert(blocks, count, hashes[i]);
+    }
+  }
+  static void ContainsScalar(const uint64_t* blocks, size_t count,
+      const uint64_t* hashes, size_t hash_count, bool* results) {
+    for (size_t i = 0; i < hash_count; ++i) {
+      if (i + kPrefetchDistance < hash_count) {
+        Prefetch(Block(blocks, count, hashes[i + kPrefetchDistance]));
+      }
+      results[i] = Contains(blocks, count, hashes[i]);
+    }
+  }
+#if defined(NX_SIMD_X86)
+  NX_FUNCTION_TARGET("avx2")
+  static void InsertAvx2(uint64_t* blocks, size_t count,
+      const uint64_t* hashes, size_t hash_count) {
+    for (size_t i = 0; i < hash_count; ++i) {
+      if (i + kPrefetchDistance < hash_count) {
+        Prefetch(Block(blocks, count, hashes[i + kPrefetchDistance]));
+      }
+      __m256i* block = reinterpret_cast<__m256i*>(
+          Block(blocks, count, hashes[i]));
+      __m256i low, high;
+      Masks256(hashes[i], &low, &high);
+      _mm256_store_si256(block, _mm256_or_si256(
+          _mm256_load_si256(block), low));
+      _mm256_store_si256(block + 1, _mm256_or_si256(
+          _mm256_load_si256(block + 1), high));
+    }
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static void ContainsAvx2(const uint64_t* blocks, size_t count,
+      const uint64_t* hashes, size_t hash_count, bool* results) {
+    for (size_t i = 0; i < hash_count; ++i) {
+      if (i + kPrefetchDistance < hash_count) {
+        Prefetch(Block(blocks, count, hashes[i + kPrefetchDistance]));
+      }
+      const __m256i* block = reinterpret_cast<const __m256i*>(
+          Block(blocks, count, hashes[i]));
+      __m256i low, high;
+      Masks256(hashes[i], &low, &high);
+      // the mask bits that are clear in the block
+      const __m256i missing = _mm256_or_si256(
+          _mm256_andnot_si256(_mm256_load_si256(block), low),
+          _mm256_andnot_si256(_mm256_load_si256(block + 1), high));
+      results[i] = _mm256_testz_si256(missing, missing) != 0;
+    }
+  }
+#endif
+
+ private:
+  // Odd multipliers, one per word of a block.
+  static NX_FORCEINLINE uint32_t Salt(unsigned int word) {
+    static const uint32_t kSalts[kBlockWords] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+    return kSalts[word];
+  }
+  // The bit set for hash in the given word of its block; the top six bits of
+  // a 32-bit product.
+  static NX_FORCEINLINE uint64_t Mask(uint64_t hash, unsigned int word) {
+    return static_cast<uint64_t>(1) << (static_cast<uint32_t>(
+        static_cast<uint32_t>(hash) * Salt(word)) >> 26u);
+  }
+  static NX_FORCEINLINE void Prefetch(const void* address) {
+#if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    __builtin_prefetch(address);
+#elif defined(NX_SIMD_X86)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    static_cast<void>(address);
+#endif
+  }
+#if defined(NX_SIMD_X86)
+  // The masks for the low and high four words of a block.
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE void Masks256(
+      uint64_t hash, __m256i* low, __m256i* high) {
+    const __m256i key = _mm256_set1_epi64x(
+        static_cast<int64_t>(hash & Bits<uint64_t>::LowMask<32>()));
+    const __m256i six_bits = _mm256_set1_epi64x(63);
+    const __m256i one = _mm256_set1_epi64x(1);
+    // bits 26 to 31 of each 32-bit product, as in Mask()
+    const __m256i low_products = _mm256_mul_epu32(key, _mm256_setr_epi64x(
+        Salt(0), Salt(1), Salt(2), Salt(3)));
+    const __m256i high_products = _mm256_mul_epu32(key, _mm256_setr_epi64x(
+        Salt(4), Salt(5), Salt(6), Salt(7)));
+    *low = _mm256_sllv_epi64(one, _mm256_and_si256(
+        _mm256_srli_epi64(low_products, 26), six_bits));
+    *high = _mm256_sllv_epi64(one, _mm256_and_si256(
+        _mm256_srli_epi64(high_products, 26), six_bits));
+  }
+#endif
+
+  NX_UNINSTANTIABLE(BlockedBloomFilterKernels);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief A probabilistic set of 64-bit key hashes, which may report false
+/// positives but never false negatives.
+///
+/// Each hash selects one 64-byte block, and sets or tests one bit in each of
+/// the block's eight words, so that a lookup costs a single cache miss.  The
+/// bit within each word comes from multiplying the low half of the hash by a
+/// per-word odd constant.  With AVX2, all eight masks are computed at once,
+/// and a lookup is one test of the block against them.  The hashes must be
+/// well mixed; the high half selects the block and the low half the bits.
+class BlockedBloomFilter {
+ public:
+  /// @brief Constructs an empty filter of at least bits bits, rounded up to
+  /// a whole number of 512-bit blocks; at most 2^32 blocks are used, and on
+  /// 32-bit targets, at most as many bits as a size_t can count.
+  explicit BlockedBloomFilter(size_t bits)
+      : blocks_(Blocks(bits)),
+        words_(blocks_ * kBlockWords + (kBlockWords - 1), 0) {
+  }
+
+  /// @brief The number of bits in the filter.
+  NX_FORCEINLINE size_t size() const {
+    return blocks_ * kBlockBits;
+  }
+  /// @brief Removes every key.
+  void Clear() {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i] = 0;
+    }
+  }
+
+  /// @brief Adds a key hash.
+  NX_FORCEINLINE void Insert(uint64_t hash) {
+    Detail::Insert(Base(), blocks_, hash);
+  }
+  /// @brief Determines if a key hash may have been added.
+  NX_FORCEINLINE bool Contains(uint64_t hash) const {
+    return Detail::Contains(Base(), blocks_, hash);
+  }
+  /// @brief Adds count key hashes, prefetching blocks ahead of use.
+  void Insert(const uint64_t* hashes, size_t count) {
+    static const InsertKernel kernel = SelectInsert();
+    kernel(Base(), blocks_, hashes, count);
+  }
+  /// @brief Stores whether each of count key hashes may have been added to
+  /// results, prefetching blocks ahead of use.
+  void Contains(const uint64_t* hashes, size_t count, bool* results) const {
+    static const ContainsKernel kernel = SelectContains();
+    kernel(Base(), blocks_, hashes, count, results);
+  }
+
+ private:
+  typedef detail::BlockedBloomFilterKernels Detail;
+  typedef Function<void, uint64_t*, size_t, const uint64_t*, size_t>
+      InsertKernel;
+  typedef Function<void, const uint64_t*, size_t, const uint64_t*, size_t,
+      bool*> ContainsKernel;
+
+  enum {
+    kBlockWords = Detail::kBlockWords,
+    kBlockBits = Detail::kBlockBits
+  };
+
+  // Between 1 and 2^32 blocks, as the block index is scaled from 32 bits,
+  // and no more than leave size() and the word count within a size_t, as
+  // on 32-bit targets.
+  static NX_FORCEINLINE size_t Blocks(size_t bits) {
+    const uint64_t limit = std::min(static_cast<uint64_t>(1) << 32u,
+        static_cast<uint64_t>(~static_cast<size_t>(0) / kBlockBits));
+    // rounded up without overflowing for bits near the maximum
+    const uint64_t blocks = static_cast<uint64_t>(bits / kBlockBits) +
+        (bits % kBlockBits != 0);
+    return static_cast<size_t>(blocks < 1u ? 1u :
+        blocks > limit ? limit : blocks);
+  }
+  // The first block, within storage aligned to 64 bytes.
+  NX_FORCEINLINE const uint64_t* Base() const {
+    const uint64_t* base = words_.data();
+    const size_t misalignment = static_cast<size_t>(
+        (reinterpret_cast<uintptr_t>(base) / sizeof(uint64_t)) % kBlockWords);
+    return base + (kBlockWords - misalignment) % kBlockWords;
+  }
+  NX_FORCEINLINE uint64_t* Base() {
+    return const_cast<uint64_t*>(
+        static_cast<const BlockedBloomFilter*>(this)->Base());
+  }
+  static InsertKernel SelectInsert() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &Detail::InsertAvx2;
+    }
+#endif
+    return &Detail::InsertScalar;
+  }
+  static ContainsKernel SelectContains() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &Detail::ContainsAvx2;
+    }
+#endif
+    return &Detail::ContainsScalar;
+  }
+
+  size_t blocks_;
+  // blocks_ blocks, plus enough words to align the first to 64 bytes
+  std::vector<uint64_t> words_;
+
+  NX_NONCOPYABLE(BlockedBloomFilter);
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_BLOCKED_BLOOM_FILTER_H_
@@ -0,0 +1,430 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file char_conv.h
+/// @brief Conversion of integers to and from decimal text, many digits at a
+/// time.
+
+#ifndef INCLUDE_NX_CORE_CHAR_CONV_H_
+#define INCLUDE_NX_CORE_CHAR_CONV_H_
+
+#include <string.h>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/endian.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// Decimal text, eight digits at a time within a 64-bit word, or sixteen
+// within an SSE register where the build enables SSE4.1.
+class DecimalText {
+ public:
+  // The most digits an unsigned 64-bit value is parsed or formatted with.
+  enum { kMaxDigits = 19 };
+
+  // An optionally signed decimal literal with an optional fraction.
+  struct Literal {
+    bool negative;
+    uint64_t integer;
+    // the first fraction_digits digits after the point
+    uint64_t fraction;
+    unsigned int fraction_digits;
+    // set if the first digit not kept in fraction is 5 or more
+    bool round;
+  };
+
+  static NX_FORCEINLINE uint64_t Power10(unsigned int exponent) {
+    static const uint64_t kPowers[kMaxDigits + 1] = {
+      1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+      10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+      100000000000ull, 1000000000000ull, 10000000000000ull,
+      100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+      100000000000000000ull, 1000000000000000000ull,
+      10000000000000000000ull
+    };
+    return kPowers[exponent];
+  }
+  // The number of digits in value, one for zero, without branching on its
+  // magnitude: an estimate from its bit length, corrected by a single
+  // comparison.  Setting the low bit changes no comparison with a power of
+  // ten but that with 1.
+  static NX_FORCEINLINE unsigned int DigitCount(uint64_t value) {
+    value |= 1u;
+    const unsigned int estimate =
+        ((Bits<uint64_t>::ScanReverse(value) + 1u) * 1233u) >> 12u;
+    return estimate + (value >= Power10(estimate) ? 1u : 0u);
+  }
+
+  // Writes value, which has fewer than count digits, as exactly count
+  // digits with leading zeros.  Groups of eight are formatted within a word;
+  // fewer come two at a time from a table.
+  static void FormatPadded(uint64_t value, unsigned int count, char* text) {
+    for (; count > 8u; count -= 8u) {
+      Store<uint64_t, kLittleEndian>(text + count - 8u,
+          Format8(static_cast<uint32_t>(value % 100000000u)));
+      value /= 100000000u;
+    }
+    if (count == 8u) {
+      Store<uint64_t, kLittleEndian>(text,
+          Format8(static_cast<uint32_t>(value)));
+      return;
+    }
+    for (; count >= 2u; count -= 2u) {
+      memcpy(text + count - 2u, Pairs() + (value % 100u) * 2u, 2u);
+      value /= 100u;
+    }
+    if (count) {
+      text[0] = static_cast<char>('0' + value);
+    }
+  }
+  // Writes value without leading zeros, and provides the number of digits.
+  static NX_FORCEINLINE unsigned int Format(uint64_t value, char* text) {
+    const unsigned int count = DigitCount(value);
+    FormatPadded(value, count, text);
+    return count;
+  }
+
+  // The number of digits at the start of the size characters at text.
+  static size_t DigitRun(const char* text, size_t size) {
+    size_t count = 0;
+#if defined(NX_SIMD_X86) && (defined(__SSE4_1__) || defined(__AVX__))
+    for (; count + 16u <= size; count += 16u) {
+      if (const unsigned int mask = NonDigits16(text + count)) {
+        return count + Bits<unsigned int>::ScanForward(mask);
+      }
+    }
+#endif
+    for (; count + 8u <= size; count += 8u) {
+      const uint64_t word = Load<uint64_t, kLittleEndian>(text + count);
+      if (const uint64_t mask = NonDigits(word)) {
+        return count + Bits<uint64_t>::ScanForward(mask) / 8u;
+      }
+    }
+    while (count < size && IsDigit(text[count])) {
+      ++count;
+    }
+    return count;
+  }
+  // The value of the count digits at text, for count of at most kMaxDigits,
+  // given that size characters, at least count, may be read there.
+  static uint64_t Parse(const char* text, size_t count, size_t size) {
+    uint64_t value = 0;
+#if defined(NX_SIMD_X86) && (defined(__SSE4_1__) || defined(__AVX__))
+    if (size >= 16u) {
+      if (count <= 16u) {
+        return Parse16(text, static_cast<unsigned int>(count));
+      }
+      for (; count > 16u; --count, ++text) {
+        value = value * 10u + static_cast<uint64_t>(*text - '0');
+      }
+      return value * 10000000000000000u + Parse16(text, 16u);
+    }
+#else
+    static_cast<void>(size);
+#endif
+    for (; count >= 8u; count -= 8u, text += 8u) {
+      value = value * 100000000u + Parse8(Load<uint64_t, kLittleEndian>(text));
+    }
+    for (; count; --count, ++text) {
+      value = value * 10u + static_cast<uint64_t>(*text - '0');
+    }
+    return value;
+  }
+  // Reads a literal of the form [+-]digits[.digits], with at least one
+  // digit, from the size characters at text, keeping at most max_fraction
+  // fraction digits.  Provides the number of characters read, or 0 if there
+  // is no literal or its integer part has more than kMaxDigits digits.
+  static size_t Scan(const char* text, size_t size, unsigned int max_fraction,
+      Literal* literal) {
+    size_t position = 0;
+    literal->negative = false;
+    if (position < size && (text[0] == '-' || text[0] == '+')) {
+      literal->negative = (text[0] == '-');
+      ++position;
+    }
+    const size_t start = position;
+    while (position < size && text[position] == '0') {
+      ++position;
+    }
+    size_t run = DigitRun(text + position, size - position);
+    if (run > kMaxDigits) {
+      return 0;
+    }
+    literal->integer = Parse(text + position, run, size - position);
+    position += run;
+    bool any = (position != start);
+    literal->fraction = 0;
+    literal->fraction_digits = 0;
+    literal->round = false;
+    if (position < size && text[position] == '.') {
+      ++position;
+      run = DigitRun(text + position, size - position);
+      const size_t kept = (run < max_fraction ? run : max_fraction);
+      literal->fraction = Parse(text + position, kept, size - position);
+      literal->fraction_digits = static_cast<unsigned int>(kept);
+      literal->round = (run > kept && text[position + kept] >= '5');
+      position += run;
+      any = any || run;
+    }
+    return (any ? position : 0);
+  }
+
+ private:
+  static NX_FORCEINLINE bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+  }
+  // "00" through "99", for writing two digits at once.
+  static NX_FORCEINLINE const char* Pairs() {
+    return
+        "00010203040506070809101112131415161718192021222324252627282930313233"
+        "34353637383940414243444546474849505152535455565758596061626364656667"
+        "6869707172737475767778798081828384858687888990919293949596979899";
+  }
+  // Nonzero in each byte of word that is not a digit.  A digit has a high
+  // nibble of 3 both before and after adding 6; only bytes above a non-digit
+  // are disturbed by the carry out of one, so the lowest is always exact.
+  static NX_FORCEINLINE uint64_t NonDigits(uint64_t word) {
+    const uint64_t kHigh = 0xF0F0F0F0F0F0F0F0ull;
+    const uint64_t kThrees = 0x3030303030303030ull;
+    return ((word & kHigh) ^ kThrees) |
+        (((word + 0x0606060606060606ull) & kHigh) ^ kThrees);
+  }
+  // The eight digits in word, the first in its lowest byte.  Adjacent digits
+  // are combined into pairs, pairs into fours, and fours into the result,
+  // each step with a single multiplication.
+  static NX_FORCEINLINE uint32_t Parse8(uint64_t word) {
+    word -= 0x3030303030303030ull;
+    word = word * 10u + (word >> 8u);
+    return static_cast<uint32_t>(
+        (((word & 0x000000FF000000FFull) * (100u + (1000000ull << 32u))) +
+         (((word >> 16u) & 0x000000FF000000FFull) *
+          (1u + (10000ull << 32u)))) >> 32u);
+  }
+  // The eight digits of value, which is less than 10^8, with leading zeros
+  // and the first in the lowest byte.  Each step splits every lane in two
+  // with a reciprocal multiplication, from halves of four digits down to
+  // single digits.
+  static NX_FORCEINLINE uint64_t Format8(uint32_t value) {
+    uint64_t word = (value / 10000u) |
+        (static_cast<uint64_t>(value % 10000u) << 32u);
+    uint64_t high = ((word * 10486u) >> 20u) & 0x0000007F0000007Full;
+    word = high | ((word - high * 100u) << 16u);
+    high = ((word * 103u) >> 10u) & 0x000F000F000F000Full;
+    word = high | ((word - high * 10u) << 8u);
+    return word + 0x3030303030303030ull;
+  }
+#if defined(NX_SIMD_X86) && (defined(__SSE4_1__) || defined(__AVX__))
+  // A bit for each of the 16 characters at text that is not a digit.
+  static NX_FORCEINLINE unsigned int NonDigits16(const char* text) {
+    const __m128i values = _mm_sub_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text)),
+        _mm_set1_epi8('0'));
+    const __m128i digits = _mm_cmpeq_epi8(
+        _mm_min_epu8(values, _mm_set1_epi8(9)), values);
+    return static_cast<unsigned int>(~_mm_movemask_epi8(digits)) & 0xFFFFu;
+  }
+  // The value of the first count of the 16 digits at text, for count of at
+  // most 16.  They are shuffled to the end of the register behind zeros,
+  // then combined as pairs, fours and eights with multiply-adds.
+  static NX_FORCEINLINE uint64_t Parse16(const char* text, unsigned int count) {
+    // at offset count, moves the first count bytes to the end
+    static const int8_t kAlign[32] = {
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+    };
+    __m128i values = _mm_shuffle_epi8(
+        _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text)),
+            _mm_set1_epi8('0')),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(kAlign + count)));
+    values = _mm_maddubs_epi16(values, _mm_setr_epi8(
+        10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    values = _mm_madd_epi16(values, _mm_setr_epi16(
+        100, 1, 100, 1, 100, 1, 100, 1));
+    values = _mm_packus_epi32(values, values);
+    values = _mm_madd_epi16(values, _mm_setr_epi16(
+        10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    return static_cast<uint64_t>(
+        static_cast<uint32_t>(_mm_cvtsi128_si32(values))) * 100000000u +
+        static_cast<uint32_t>(_mm_extract_epi32(values, 1));
+  }
+#endif
+
+  NX_UNINSTANTIABLE(DecimalText);
+};
+
+// The builtin integers other than bool.
+template <typename T>
+class IsCharConvInteger : public Bool<
+    IsIntegral<T>::value && !std::is_same<T, bool>::value> {
+};
+
+template <typename T, class Enable = void>
+class CharConv {
+ private:
+  NX_UNINSTANTIABLE(CharConv);
+};
+template <typename T>
+class CharConv<T, EnableIf<IsCharConvInteger<T>>> {
+ private:
+  // holds the magnitude of any T
+  typedef uint_t<(sizeof(T) > 8u ? 128u : 64u)> unsigned_type;
+  enum : unsigned int {
+    kSigned = (static_cast<T>(-1) < static_cast<T>(0)),
+    kBits = sizeof(T) * CHAR_BIT,
+    kUnsignedBits = sizeof(unsigned_type) * CHAR_BIT,
+    // digits that never overflow unsigned_type
+    kSafeDigits = kUnsignedBits * 30103u / 100000u
+  };
+
+ public:
+  static NX_FORCEINLINE constexpr size_t MaxChars() {
+    return kSigned + (kBits - kSigned) * 30103u / 100000u + 1u;
+  }
+  static size_t ToChars(T value, char* text) {
+    unsigned_type magnitude = static_cast<unsigned_type>(value);
+    size_t count = 0;
+    if (kSigned && (magnitude >> (kUnsignedBits - 1u)) != 0) {
+      text[count++] = '-';
+      magnitude = static_cast<unsigned_type>(0u - magnitude);
+    }
+    return count + Format(magnitude, text + count,
+        Bool<(kUnsignedBits > 64u)>());
+  }
+  static size_t FromChars(const char* text, size_t size, T* value) {
+    size_t position = 0;
+    const bool negative = (kSigned && size && text[0] == '-');
+    if (negative) {
+      ++position;
+    }
+    const size_t start = position;
+    while (position < size && text[position] == '0') {
+      ++position;
+    }
+    const size_t run = DecimalText::DigitRun(text + position, size - position);
+    if ((!run && position == start) || run > kSafeDigits + 1u) {
+      return 0;
+    }
+    // only the last of kSafeDigits + 1 digits can overflow
+    const size_t safe = (run > kSafeDigits ?
+        static_cast<size_t>(kSafeDigits) : run);
+    unsigned_type magnitude = Parse(text + position, safe, size - position);
+    if (safe != run) {
+      const unsigned int digit =
+          static_cast<unsigned int>(text[position + safe] - '0');
+      if (magnitude > (~static_cast<unsigned_type>(0) - digit) / 10u) {
+        return 0;
+      }
+      magnitude = static_cast<unsigned_type>(magnitude * 10u + digit);
+    }
+    // the largest magnitude of T, that of its minimum if negative
+    const unsigned_type limit = static_cast<unsigned_type>(
+        (~static_cast<unsigned_type>(0) >>
+            (kUnsignedBits - kBits + kSigned)) + (negative ? 1u : 0u));
+    if (magnitude > limit) {
+      return 0;
+    }
+    *value = static_cast<T>(negative ?
+        static_cast<unsigned_type>(0u - magnitude) : magnitude);
+    return position + run;
+  }
+
+ private:
+  static NX_FORCEINLINE size_t Format(uint64_t magnitude, char* text,
+      Bool<false>) {
+    return DecimalText::Format(magnitude, text);
+  }
+  // Splits off groups of 19 digits until what is left fits in 64 bits.
+  template <typename U>
+  static size_t Format(U magnitude, char* text, Bool<true>) {
+    const uint64_t kMax = ~static_cast<uint64_t>(0);
+    const uint64_t kGroup = DecimalText::Power10(DecimalText::kMaxDigits);
+    if (magnitude <= kMax) {
+      return DecimalText::Format(static_cast<uint64_t>(magnitude), text);
+    }
+    const uint64_t low = static_cast<uint64_t>(magnitude % kGroup);
+    magnitude /= kGroup;
+    size_t count;
+    if (magnitude <= kMax) {
+      count = DecimalText::Format(static_cast<uint64_t>(magnitude), text);
+    } else {
+      count = DecimalText::Format(
+          static_cast<uint64_t>(magnitude / kGroup), text);
+      DecimalText::FormatPadded(static_cast<uint64_t>(magnitude % kGroup),
+          DecimalText::kMaxDigits, text + count);
+      count += DecimalText::kMaxDigits;
+    }
+    DecimalText::FormatPadded(low, DecimalText::kMaxDigits, text + count);
+    return count + DecimalText::kMaxDigits;
+  }
+  // The value of count digits, for count of at most kSafeDigits, in groups
+  // of up to 19.
+  static NX_FORCEINLINE unsigned_type Parse(const char* text, size_t count,
+      size_t size) {
+    const size_t head = count % DecimalText::kMaxDigits;
+    unsigned_type magnitude = DecimalText::Parse(text, head, size);
+    for (size_t i = head; i < count; i += DecimalText::kMaxDigits) {
+      magnitude = static_cast<unsigned_type>(
+          magnitude * DecimalText::Power10(DecimalText::kMaxDigits) +
+          DecimalText::Parse(text + i, DecimalText::kMaxDigits, size - i));
+    }
+    return magnitude;
+  }
+
+  NX_UNINSTANTIABLE(CharConv);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief The most characters ToChars() writes for a T.
+template <typename T>
+NX_FORCEINLINE constexpr size_t MaxChars() {
+  return detail::CharConv<T>::MaxChars();
+}
+/// @brief Writes value in decimal, without a terminator, to text, which must
+/// have room for MaxChars<T>() characters.  Provides the number written.
+///
+/// T is any builtin integer other than bool, including 128-bit ones where
+/// the toolchain has them.  The digits are counted up front from the bit
+/// length, then written from the last: eight at a time within a 64-bit
+/// word, and any fewer two at a time from a table.
+template <typename T>
+NX_FORCEINLINE size_t ToChars(T value, char* text) {
+  return detail::CharConv<T>::ToChars(value, text);
+}
+/// @brief Reads a decimal integer, with a leading '-' if T is signed, from
+/// the size characters at text into value.  Provides the number of
+/// characters read, or 0 if there are no digits or the number does not fit
+/// in T, in which case value is unchanged.
+///
+/// Characters are validated and converted eight at a time within a 64-bit
+/// word, or sixteen at a time in an SSE register in builds that enable
+/// SSE4.1.
+template <typename T>
+NX_FORCEINLINE size_t FromChars(const char* text, size_t size, T* value) {
+  return detail::CharConv<T>::FromChars(text, size, value);
+}
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_CHAR_CONV_H_
@@ -0,0 +1,172 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file concurrent_id_allocator.h
+/// @brief A lock-free allocator of integer identifiers, for sharing a pool of
+/// slots between threads.
+
+#ifndef INCLUDE_NX_CORE_CONCURRENT_ID_ALLOCATOR_H_
+#define INCLUDE_NX_CORE_CONCURRENT_ID_ALLOCATOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/atomic_bits.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief Hands out free indexes in [0, capacity()) to any number of threads
+/// without locking, and takes them back in any order.
+///
+/// Each index is a bit in an array of 64-bit words, set while allocated.  A
+/// thread claims bits with a single fetch_or on a word, retrying only the
+/// bits another thread claimed first.  Each thread begins searching at the
+/// word it last allocated from, and threads begin a cache line apart, so
+/// that they rarely contend for a word.  Unlike IdAllocator, the index
+/// provided is not necessarily the lowest free one.
+///
+/// Allocation acquires, and freeing releases, so writes made by the previous
+/// holder of an index are visible to the next.
+template <unsigned int kIndexBits = 32>
+class ConcurrentIdAllocator {
+ public:
+  /// @brief The type of an index.
+  typedef uint_least_t<kIndexBits> index_type;
+
+  /// @brief Constructs an allocator with every index in [0, capacity) free.
+  /// The capacity itself must be representable by index_type.
+  explicit ConcurrentIdAllocator(size_t capacity)
+      : capacity_(capacity),
+        words_((capacity + (kWordBits - 1)) / kWordBits) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i].store(0, std::memory_order_relaxed);
+    }
+    if (capacity % kWordBits) {
+      // the bits beyond capacity are permanently allocated
+      words_.back().store(~Bits<uint64_t>::LowMask(static_cast<unsigned int>(
+          capacity % kWordBits)), std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief The number of indexes managed.
+  NX_FORCEINLINE size_t capacity() const {
+    return capacity_;
+  }
+  /// @brief Determines if index is free at the time of the call.
+  NX_FORCEINLINE bool IsFree(index_type index) const {
+    return !AtomicBits<uint64_t>::get(Bit(index), &words_[index / kWordBits],
+        std::memory_order_relaxed);
+  }
+
+  /// @brief Allocates a free index, or provides capacity() if none are free.
+  index_type Allocate() {
+    index_type index;
+    return (Allocate(1, &index) ? index : static_cast<index_type>(capacity_));
+  }
+  /// @brief Allocates up to count free indexes, storing them to indexes, and
+  /// provides how many were allocated; fewer than count only if the rest are
+  /// not free.  Bits are claimed from each word with a single fetch_or.
+  size_t Allocate(size_t count, index_type* indexes) {
+    const size_t words = words_.size();
+    if (!count || !words) {
+      return 0;
+    }
+    size_t& hint = Hint();
+    const size_t start = hint % words;
+    size_t allocated = 0;
+    for (size_t i = 0; i < words; ++i) {
+      const size_t word = (start + i < words ? start + i : start + i - words);
+      allocated += Claim(word, count - allocated, indexes + allocated);
+      if (allocated == count) {
+        hint = word;
+        break;
+      }
+    }
+    return allocated;
+  }
+  /// @brief Frees index, which must be allocated.
+  void Free(index_type index) {
+    AtomicBits<uint64_t>::clear(Bit(index), &words_[index / kWordBits],
+        std::memory_order_release);
+  }
+  /// @brief Frees the count indexes in indexes, which must be allocated.
+  /// Consecutive indexes within the same word are freed together.
+  void Free(size_t count, const index_type* indexes) {
+    for (size_t i = 0; i < count; ) {
+      const size_t word = indexes[i] / kWordBits;
+      uint64_t mask = 0;
+      for (; i < count && indexes[i] / kWordBits == word; ++i) {
+        mask |= Bit(indexes[i]);
+      }
+      AtomicBits<uint64_t>::clear(mask, &words_[word],
+          std::memory_order_release);
+    }
+  }
+
+ private:
+  enum {
+    kWordBits = 64,
+    // words per 64-byte cache line; the spacing between threads' hints
+    kLineWords = 8
+  };
+
+  static NX_FORCEINLINE uint64_t Bit(size_t index) {
+    return static_cast<uint64_t>(1) << (index % kWordBits);
+  }
+  // The word at which this thread begins searching, shared by every
+  // allocator.  Each thread starts on its own cache line.
+  static NX_FORCEINLINE size_t& Hint() {
+    static std::atomic<size_t> threads(0);
+    static thread_local size_t hint =
+        threads.fetch_add(1, std::memory_order_relaxed) * kLineWords;
+    return hint;
+  }
+  // Claims up to count of the free bits in a word, storing their indexes.
+  size_t Claim(size_t word, size_t count, index_type* indexes) {
+    std::atomic<uint64_t>* data = &words_[word];
+    size_t claimed = 0;
+    uint64_t available = ~data->load(std::memory_order_relaxed);
+    while (available && claimed < count) {
+      // the lowest count - claimed free bits
+      const uint64_t wanted = (
+          Bits<uint64_t>::PopCount(available) <= count - claimed ?
+            available :
+            Bits<uint64_t>::Deposit(Bits<uint64_t>::LowMask(
+                static_cast<unsigned int>(count - claimed)), available));
+      const uint64_t previous = AtomicBits<uint64_t>::set(wanted, data,
+          std::memory_order_acquire);
+      // bits another thread claimed first are not ours
+      for (uint64_t won = wanted & ~previous; won;
+          won = Bits<uint64_t>::ClearLowest(won)) {
+        indexes[claimed++] = static_cast<index_type>(
+            word * kWordBits + Bits<uint64_t>::ScanForward(won));
+      }
+      available = ~(previous | wanted);
+    }
+    return claimed;
+  }
+
+  size_t capacity_;
+  std::vector<std::atomic<uint64_t>> words_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_CONCURRENT_ID_ALLOCATOR_H_
@@ -0,0 +1,184 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file cpu.h
+/// @brief Runtime detection of processor features, for selecting between
+/// kernels compiled for different instruction set extensions.
+
+#ifndef INCLUDE_NX_CORE_CPU_H_
+#define INCLUDE_NX_CORE_CPU_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/os.h"
+#include "nx/core/types.h"
+
+#if defined(NX_ARCH_X86) && !defined(NX_EMBEDDED) && ( \
+    defined(NX_TC_GCC) || defined(NX_TC_CLANG) || defined(NX_TC_VS))
+  /// @brief Defined if processor features can be detected at runtime.
+  #define NX_CPU_X86 1
+  #if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    #include <cpuid.h>
+  #endif
+#endif
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief Reports which optional instruction set extensions the executing
+/// processor, and operating system, support.  Detection happens once.
+class Cpu {
+ public:
+  /// @brief Optional instruction set extensions.
+  enum Feature {
+    kSse2,
+    kPopCnt,
+    kSsse3,
+    kSse41,
+    kMovbe,
+    kAvx2,
+    kBmi1,
+    kBmi2,
+    kAdx,
+    kAvx512F,
+    kAvx512Bw,
+    kAvx512VPopCntDq
+  };
+
+  /// @brief Determines if the processor supports the specified feature.
+  static NX_FORCEINLINE bool Supports(Feature feature) {
+    return ((Features() >> static_cast<unsigned int>(feature)) & 1u) != 0;
+  }
+
+ private:
+  // This sits beneath bits.h, so it cannot use Bits<T> or the integer.h
+  // types; unsigned int is at least 32 bits on every x86 toolchain.
+  static NX_FORCEINLINE unsigned int Bit(unsigned int index) {
+    return 1u << index;
+  }
+  static NX_FORCEINLINE unsigned int Features() {
+    static const unsigned int features = Detect();
+    return features;
+  }
+
+#if defined(NX_CPU_X86)
+  static NX_FORCEINLINE void CpuId(
+      unsigned int leaf, unsigned int subleaf, unsigned int* registers) {
+#if defined(NX_TC_VS)
+    int values[4];
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (unsigned int i = 0; i < 4u; ++i) {
+      registers[i] = static_cast<unsigned int>(values[i]);
+    }
+#else
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+    registers[0] = eax;
+    registers[1] = ebx;
+    registers[2] = ecx;
+    registers[3] = edx;
+#endif
+  }
+  // Provides the low half of XCR0; the register state the operating system
+  // saves.
+  static NX_FORCEINLINE unsigned int ExtendedControlRegister() {
+#if defined(NX_TC_VS)
+    return static_cast<unsigned int>(_xgetbv(0));
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+  }
+  static unsigned int Detect() {
+    enum { kEax, kEbx, kEcx, kEdx };
+    unsigned int features = 0;
+    unsigned int registers[4];
+    CpuId(0, 0, registers);
+    const unsigned int max_leaf = registers[kEax];
+    if (max_leaf < 1u) {
+      return features;
+    }
+    CpuId(1, 0, registers);
+    const unsigned int leaf1_ecx = registers[kEcx];
+    if (registers[kEdx] & Bit(26)) {
+      features |= Bit(kSse2);
+    }
+    if (leaf1_ecx & Bit(9)) {
+      features |= Bit(kSsse3);
+    }
+    if (leaf1_ecx & Bit(19)) {
+      features |= Bit(kSse41);
+    }
+    if (leaf1_ecx & Bit(22)) {
+      features |= Bit(kMovbe);
+    }
+    if (leaf1_ecx & Bit(23)) {
+      features |= Bit(kPopCnt);
+    }
+    if (max_leaf < 7u) {
+      return features;
+    }
+    // The wide registers are only usable with OSXSAVE and AVX, and once the
+    // operating system saves their state; the scalar extensions need neither.
+    const bool xsave = (leaf1_ecx & (Bit(27) | Bit(28))) ==
+        (Bit(27) | Bit(28));
+    const unsigned int xcr0 = (xsave ? ExtendedControlRegister() : 0u);
+    // XMM and YMM state
+    const bool avx_state = (xcr0 & (Bit(1) | Bit(2))) ==
+        (Bit(1) | Bit(2));
+    // ...plus opmask and both halves of the ZMM state
+    const bool avx512_state = avx_state &&
+        (xcr0 & (Bit(5) | Bit(6) | Bit(7))) ==
+            (Bit(5) | Bit(6) | Bit(7));
+    CpuId(7, 0, registers);
+    const unsigned int leaf7_ebx = registers[kEbx];
+    const unsigned int leaf7_ecx = registers[kEcx];
+    if (leaf7_ebx & Bit(3)) {
+      features |= Bit(kBmi1);
+    }
+    if (leaf7_ebx & Bit(8)) {
+      features |= Bit(kBmi2);
+    }
+    if (leaf7_ebx & Bit(19)) {
+      features |= Bit(kAdx);
+    }
+    if (avx_state && (leaf7_ebx & Bit(5))) {
+      features |= Bit(kAvx2);
+    }
+    if (avx512_state && (leaf7_ebx & Bit(16))) {
+      features |= Bit(kAvx512F);
+      if (leaf7_ebx & Bit(30)) {
+        features |= Bit(kAvx512Bw);
+      }
+      if (leaf7_ecx & Bit(14)) {
+        features |= Bit(kAvx512VPopCntDq);
+      }
+    }
+    return features;
+  }
+#else
+  static NX_FORCEINLINE unsigned int Detect() {
+    // No optional features are detected on this platform.
+    return 0;
+  }
+#endif
+
+  NX_UNINSTANTIABLE(Cpu);
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_CPU_H_
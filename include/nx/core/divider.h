@@ -0,0 +1,387 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file divider.h
+/// @brief Division by a divisor known only at runtime, replaced by
+/// multiplication with a precomputed reciprocal.
+
+#ifndef INCLUDE_NX_CORE_DIVIDER_H_
+#define INCLUDE_NX_CORE_DIVIDER_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/multiword.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+template <typename T, class Enable = void>
+class Divider {
+ private:
+  NX_UNINSTANTIABLE(Divider);
+};
+template <typename T>
+class Divider<T, EnableIf<IsIntegral<T>>> {
+ private:
+  typedef MakeUnsigned<T> unsigned_type;
+  // holds the full product of two values of T
+  typedef integral_least_range_t<IsSigned<T>::value,
+      2u * Bits<T>::Size()> wide_type;
+
+  class Detail {
+   public:
+    typedef Function<void, const Divider*, const T*, size_t, T*> Kernel;
+
+    // The high half of the full product of lhs and rhs.
+    static NX_FORCEINLINE T MultiplyHigh(T lhs, T rhs) {
+      return static_cast<T>((static_cast<wide_type>(lhs) *
+          static_cast<wide_type>(rhs)) >> Bits<T>::Size());
+    }
+    // Provides (high * 2^N) / divisor, for N the bits in T and high less
+    // than divisor, storing the remainder in remainder.  Only used when
+    // constructing, so it shifts and subtracts a bit at a time rather than
+    // need a division of the wide type.
+    static unsigned_type DivideWide(unsigned_type high,
+        unsigned_type divisor, unsigned_type* remainder) {
+      unsigned_type quotient = 0;
+      for (unsigned int i = 0; i < Bits<T>::Size(); ++i) {
+        const bool carry = (high >> (Bits<T>::Size() - 1u)) != 0;
+        high = static_cast<unsigned_type>(high << 1u);
+        quotient = static_cast<unsigned_type>(quotient << 1u);
+        if (carry || high >= divisor) {
+          high = static_cast<unsigned_type>(high - divisor);
+          quotient |= 1u;
+        }
+      }
+      *remainder = high;
+      return quotient;
+    }
+
+    template <bool kModulo>
+    static void DivideScalar(
+        const Divider* divider, const T* values, size_t count, T* results) {
+      for (size_t i = 0; i < count; ++i) {
+        results[i] = (kModulo ? divider->Modulo(values[i]) :
+            divider->Divide(values[i]));
+      }
+    }
+#if defined(NX_SIMD_X86)
+    // Lane-width generic operations, as for ArithmeticSpan; only 16 and
+    // 32-bit lanes have a multiply-high.
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Broadcast(T value) {
+      return (sizeof(T) == 2u ?
+          _mm256_set1_epi16(static_cast<int16_t>(value)) :
+          _mm256_set1_epi32(static_cast<int32_t>(value)));
+    }
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Add(__m256i lhs, __m256i rhs) {
+      return (sizeof(T) == 2u ? _mm256_add_epi16(lhs, rhs) :
+          _mm256_add_epi32(lhs, rhs));
+    }
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Subtract(__m256i lhs, __m256i rhs) {
+      return (sizeof(T) == 2u ? _mm256_sub_epi16(lhs, rhs) :
+          _mm256_sub_epi32(lhs, rhs));
+    }
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i MultiplyLow(__m256i lhs, __m256i rhs) {
+      return (sizeof(T) == 2u ? _mm256_mullo_epi16(lhs, rhs) :
+          _mm256_mullo_epi32(lhs, rhs));
+    }
+    // 32-bit lanes multiply their even lanes into 64-bit products, so the
+    // odd lanes are shifted down for a second multiplication, and the high
+    // halves of both blended together.
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i MultiplyHigh(__m256i lhs, __m256i rhs) {
+      if (sizeof(T) == 2u) {
+        return (IsSigned<T>::value ? _mm256_mulhi_epi16(lhs, rhs) :
+            _mm256_mulhi_epu16(lhs, rhs));
+      }
+      const __m256i odd_lhs = _mm256_srli_epi64(lhs, 32);
+      const __m256i odd_rhs = _mm256_srli_epi64(rhs, 32);
+      const __m256i even = (IsSigned<T>::value ?
+          _mm256_mul_epi32(lhs, rhs) : _mm256_mul_epu32(lhs, rhs));
+      const __m256i odd = (IsSigned<T>::value ?
+          _mm256_mul_epi32(odd_lhs, odd_rhs) :
+          _mm256_mul_epu32(odd_lhs, odd_rhs));
+      return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+    }
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i ShiftRightLogical(
+        __m256i value, __m128i shift) {
+      return (sizeof(T) == 2u ? _mm256_srl_epi16(value, shift) :
+          _mm256_srl_epi32(value, shift));
+    }
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i ShiftRightArithmetic(
+        __m256i value, __m128i shift) {
+      return (sizeof(T) == 2u ? _mm256_sra_epi16(value, shift) :
+          _mm256_sra_epi32(value, shift));
+    }
+    // Each lane as 1 if negative, and otherwise 0.
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i SignBit(__m256i value) {
+      return (sizeof(T) == 2u ? _mm256_srli_epi16(value, 15) :
+          _mm256_srli_epi32(value, 31));
+    }
+    // Each lane as all ones if negative, and otherwise 0.
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i SignMask(__m256i value) {
+      return (sizeof(T) == 2u ? _mm256_srai_epi16(value, 15) :
+          _mm256_srai_epi32(value, 31));
+    }
+    // The quotients of the lanes of value, as Divider::Divide() computes
+    // them.
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE __m256i Divide256(const Divider* divider,
+        __m256i value, __m256i magic, __m128i shift, __m256i sign) {
+      if (!IsSigned<T>::value) {
+        if (!divider->magic_) {
+          return ShiftRightLogical(value, shift);
+        }
+        const __m256i high = MultiplyHigh(value, magic);
+        if (!divider->add_) {
+          return ShiftRightLogical(high, shift);
+        }
+        return ShiftRightLogical(Add(ShiftRightLogical(
+            Subtract(value, high), _mm_cvtsi32_si128(1)), high), shift);
+      }
+      if (!divider->magic_) {
+        const __m256i rounding = _mm256_and_si256(SignMask(value),
+            Broadcast(Bits<unsigned_type>::LowMask(divider->shift_)));
+        const __m256i quotient = ShiftRightArithmetic(
+            Add(value, rounding), shift);
+        return Subtract(_mm256_xor_si256(quotient, sign), sign);
+      }
+      __m256i quotient = MultiplyHigh(value, magic);
+      if (divider->add_) {
+        quotient = Add(quotient,
+            Subtract(_mm256_xor_si256(value, sign), sign));
+      }
+      quotient = ShiftRightArithmetic(quotient, shift);
+      return Add(quotient, SignBit(quotient));
+    }
+    template <bool kModulo>
+    NX_FUNCTION_TARGET("avx2")
+    static void DivideAvx2(
+        const Divider* divider, const T* values, size_t count, T* results) {
+      const size_t step = sizeof(__m256i) / sizeof(T);
+      const __m256i magic = Broadcast(divider->magic_);
+      const __m128i shift = _mm_cvtsi32_si128(
+          static_cast<int>(divider->shift_));
+      const __m256i sign = Broadcast(static_cast<T>(
+          divider->negative_ ? ~static_cast<unsigned_type>(0) : 0u));
+      const __m256i divisor = Broadcast(divider->divisor_);
+      size_t i = 0;
+      for (; i + step <= count; i += step) {
+        const __m256i value = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(values + i));
+        __m256i result = Divide256(divider, value, magic, shift, sign);
+        if (kModulo) {
+          result = Subtract(value, MultiplyLow(result, divisor));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i), result);
+      }
+      DivideScalar<kModulo>(divider, values + i, count - i, results + i);
+    }
+#endif
+    template <bool kModulo>
+    static Kernel Select() {
+#if defined(NX_SIMD_X86)
+      if ((sizeof(T) == 2u || sizeof(T) == 4u) &&
+          Cpu::Supports(Cpu::kAvx2)) {
+        return &DivideAvx2<kModulo>;
+      }
+#endif
+      return &DivideScalar<kModulo>;
+    }
+  };
+
+ public:
+  /// @brief Prepares division by divisor, which must not be zero.
+  explicit Divider(T divisor)
+      : divisor_(divisor),
+        magic_(0),
+        shift_(0),
+        add_(false),
+        negative_(false) {
+    Generate(Bool<IsSigned<T>::value>());
+  }
+
+  /// @brief The divisor.
+  NX_FORCEINLINE T divisor() const {
+    return divisor_;
+  }
+
+  /// @brief Provides value / divisor(), rounded toward zero.  The minimum
+  /// value divided by -1 wraps to the minimum value, where the native
+  /// division would overflow.
+  NX_FORCEINLINE T Divide(T value) const {
+    return Divide(value, Bool<IsSigned<T>::value>());
+  }
+  /// @brief Provides value % divisor(), with the sign of value.
+  NX_FORCEINLINE T Modulo(T value) const {
+    // unsigned, and no narrower than unsigned int so as not to promote to
+    // int; the product overflows for the minimum value divided by -1.
+    typedef Conditional<Bool<(sizeof(T) < sizeof(unsigned int))>,
+        unsigned int, unsigned_type> product_type;
+    return static_cast<T>(static_cast<product_type>(value) -
+        static_cast<product_type>(Divide(value)) *
+            static_cast<product_type>(divisor_));
+  }
+  /// @brief Stores values[i] / divisor() in quotients[i] for each of count
+  /// values.  quotients may be values.
+  void Divide(const T* values, size_t count, T* quotients) const {
+    static const typename Detail::Kernel kernel =
+        Detail::template Select<false>();
+    kernel(this, values, count, quotients);
+  }
+  /// @brief Stores values[i] % divisor() in remainders[i] for each of count
+  /// values.  remainders may be values.
+  void Modulo(const T* values, size_t count, T* remainders) const {
+    static const typename Detail::Kernel kernel =
+        Detail::template Select<true>();
+    kernel(this, values, count, remainders);
+  }
+
+  friend NX_FORCEINLINE T operator/(T value, const Divider& divider) {
+    return divider.Divide(value);
+  }
+  friend NX_FORCEINLINE T operator%(T value, const Divider& divider) {
+    return divider.Modulo(value);
+  }
+
+ private:
+  // The quotient is the high half of value * (2^N + magic_) for unsigned
+  // divisors needing add_, and of value * magic_ otherwise, shifted right by
+  // shift_; N being the bits in T.  A zero magic_ marks a power of two, for
+  // which the shift alone suffices.  This follows libdivide, after Granlund
+  // and Montgomery, "Division by Invariant Integers using Multiplication".
+  void Generate(Bool<false>) {
+    const unsigned int log = Bits<T>::ScanReverse(divisor_);
+    if (Bits<T>::PowerOfTwo(divisor_)) {
+      shift_ = log;
+      return;
+    }
+    unsigned_type remainder;
+    unsigned_type magic = Detail::DivideWide(
+        static_cast<unsigned_type>(static_cast<unsigned_type>(1u) << log),
+        divisor_, &remainder);
+    // magic + 1 is close enough to 2^(N + log) / divisor for every value of
+    // T, unless the rounding error reaches 2^log; then one more bit is kept,
+    // in the carry of add_.
+    if (static_cast<unsigned_type>(divisor_ - remainder) >=
+        static_cast<unsigned_type>(static_cast<unsigned_type>(1u) << log)) {
+      const unsigned_type twice = static_cast<unsigned_type>(remainder * 2u);
+      magic = static_cast<unsigned_type>(magic * 2u +
+          (twice >= divisor_ || twice < remainder ? 1u : 0u));
+      add_ = true;
+    }
+    magic_ = static_cast<T>(magic + 1u);
+    shift_ = log;
+  }
+  void Generate(Bool<true>) {
+    negative_ = divisor_ < 0;
+    const unsigned_type absolute = static_cast<unsigned_type>(negative_ ?
+        0u - static_cast<unsigned_type>(divisor_) :
+        static_cast<unsigned_type>(divisor_));
+    const unsigned int log = Bits<unsigned_type>::ScanReverse(absolute);
+    if (Bits<unsigned_type>::PowerOfTwo(absolute)) {
+      shift_ = log;
+      return;
+    }
+    unsigned_type remainder;
+    unsigned_type magic = Detail::DivideWide(
+        static_cast<unsigned_type>(static_cast<unsigned_type>(1u) <<
+            (log - 1u)),
+        absolute, &remainder);
+    shift_ = log - 1u;
+    if (static_cast<unsigned_type>(absolute - remainder) >=
+        static_cast<unsigned_type>(static_cast<unsigned_type>(1u) << log)) {
+      const unsigned_type twice = static_cast<unsigned_type>(remainder * 2u);
+      magic = static_cast<unsigned_type>(magic * 2u +
+          (twice >= absolute || twice < remainder ? 1u : 0u));
+      add_ = true;
+      shift_ = log;
+    }
+    magic = static_cast<unsigned_type>(magic + 1u);
+    magic_ = static_cast<T>(negative_ ?
+        static_cast<unsigned_type>(0u - magic) : magic);
+  }
+
+  NX_FORCEINLINE T Divide(T value, Bool<false>) const {
+    if (!magic_) {
+      return static_cast<T>(value >> shift_);
+    }
+    const T high = Detail::MultiplyHigh(magic_, value);
+    if (!add_) {
+      return static_cast<T>(high >> shift_);
+    }
+    return static_cast<T>(static_cast<T>(
+        (static_cast<T>(value - high) >> 1u) + high) >> shift_);
+  }
+  NX_FORCEINLINE T Divide(T value, Bool<true>) const {
+    const unsigned_type bits = static_cast<unsigned_type>(value);
+    if (!magic_) {
+      // round toward zero by adding divisor - 1 to negative values
+      const unsigned_type rounding = static_cast<unsigned_type>(
+          (value < 0 ? Bits<unsigned_type>::LowMask(shift_) : 0u));
+      const T quotient = static_cast<T>(static_cast<T>(
+          bits + rounding) >> shift_);
+      return static_cast<T>(negative_ ?
+          0u - static_cast<unsigned_type>(quotient) :
+          static_cast<unsigned_type>(quotient));
+    }
+    unsigned_type quotient = static_cast<unsigned_type>(
+        Detail::MultiplyHigh(magic_, value));
+    if (add_) {
+      quotient = static_cast<unsigned_type>(quotient +
+          (negative_ ? 0u - bits : bits));
+    }
+    const T shifted = static_cast<T>(static_cast<T>(quotient) >> shift_);
+    // negative quotients round toward zero
+    return static_cast<T>(shifted + (shifted < 0 ? 1 : 0));
+  }
+
+  T divisor_;
+  T magic_;
+  unsigned int shift_;
+  bool add_;
+  // whether a signed divisor is negative
+  bool negative_;
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Division and modulo of integers of type T by a divisor fixed at
+/// runtime, each costing a multiplication, a shift and a few additions
+/// rather than a hardware division.  Construction costs about as much as a
+/// few dozen divisions, so a Divider should be kept for as long as its
+/// divisor is in use.  Batches of 16 and 32-bit values are divided with AVX2
+/// where available.
+template <class T>
+using Divider = detail::Divider<T>;
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_DIVIDER_H_
@@ -0,0 +1,375 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file endian.h
+/// @brief Byte swapping, and loads and stores of integers in a given byte
+/// order at any alignment.
+
+#ifndef INCLUDE_NX_CORE_ENDIAN_H_
+#define INCLUDE_NX_CORE_ENDIAN_H_
+
+#include <string.h>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief Byte orders.
+enum Endian {
+  /// Least significant byte first.
+  kLittleEndian,
+  /// Most significant byte first, as in network protocols.
+  kBigEndian
+};
+
+/// @cond nx_detail
+namespace detail {
+
+template <size_t kSize>
+class ByteSwapper {
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+template <>
+class ByteSwapper<1> {
+ public:
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR uint8_t Swap(uint8_t value) {
+    return value;
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+template <>
+class ByteSwapper<2> {
+ public:
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR uint16_t Swap(uint16_t value) {
+#if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    return __builtin_bswap16(value);
+#elif defined(NX_TC_VS)
+    return _byteswap_ushort(value);
+#else
+    return static_cast<uint16_t>((value << 8u) | (value >> 8u));
+#endif
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+template <>
+class ByteSwapper<4> {
+ public:
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR uint32_t Swap(uint32_t value) {
+#if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    return __builtin_bswap32(value);
+#elif defined(NX_TC_VS)
+    return _byteswap_ulong(value);
+#else
+    return (static_cast<uint32_t>(
+        ByteSwapper<2>::Swap(static_cast<uint16_t>(value))) << 16u) |
+        ByteSwapper<2>::Swap(static_cast<uint16_t>(value >> 16u));
+#endif
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+template <>
+class ByteSwapper<8> {
+ public:
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR uint64_t Swap(uint64_t value) {
+#if defined(NX_TC_GCC) || defined(NX_TC_CLANG)
+    return __builtin_bswap64(value);
+#elif defined(NX_TC_VS)
+    return _byteswap_uint64(value);
+#else
+    return (static_cast<uint64_t>(
+        ByteSwapper<4>::Swap(static_cast<uint32_t>(value))) << 32u) |
+        ByteSwapper<4>::Swap(static_cast<uint32_t>(value >> 32u));
+#endif
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+#if defined(__SIZEOF_INT128__)
+template <>
+class ByteSwapper<16> {
+ public:
+  static NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR uint128_t Swap(
+      uint128_t value) {
+    return (static_cast<uint128_t>(
+        ByteSwapper<8>::Swap(static_cast<uint64_t>(value))) << 64u) |
+        ByteSwapper<8>::Swap(static_cast<uint64_t>(value >> 64u));
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapper);
+};
+#endif
+
+// Reverses the bytes of each of count values of kSize bytes, at any
+// alignment, with a byte shuffle of as many as a register holds at once.
+template <size_t kSize>
+class ByteSwapArray {
+ public:
+  typedef Function<void, const uint8_t*, size_t, uint8_t*> Kernel;
+
+  static void Scalar(const uint8_t* values, size_t count, uint8_t* results) {
+    typedef uint_t<kSize * 8u> value_type;
+    for (size_t i = 0; i < count; ++i) {
+      value_type value;
+      memcpy(&value, values + i * kSize, kSize);
+      value = ByteSwapper<kSize>::Swap(value);
+      memcpy(results + i * kSize, &value, kSize);
+    }
+  }
+#if defined(NX_SIMD_X86)
+  NX_FUNCTION_TARGET("ssse3")
+  static void Ssse3(const uint8_t* values, size_t count, uint8_t* results) {
+    const __m128i mask = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(Mask()));
+    const size_t step = sizeof(__m128i) / kSize;
+    size_t i = 0;
+    for (; i + step <= count; i += step) {
+      const __m128i value = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(values + i * kSize));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i * kSize),
+          _mm_shuffle_epi8(value, mask));
+    }
+    Scalar(values + i * kSize, count - i, results + i * kSize);
+  }
+  // Two registers per iteration, since a lone shuffle does not keep the
+  // loads and stores busy.
+  NX_FUNCTION_TARGET("avx2")
+  static void Avx2(const uint8_t* values, size_t count, uint8_t* results) {
+    const __m256i mask = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(Mask()));
+    const size_t step = sizeof(__m256i) / kSize;
+    size_t i = 0;
+    for (; i + 2u * step <= count; i += 2u * step) {
+      const __m256i low = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i * kSize));
+      const __m256i high = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + (i + step) * kSize));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i * kSize),
+          _mm256_shuffle_epi8(low, mask));
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(results + (i + step) * kSize),
+          _mm256_shuffle_epi8(high, mask));
+    }
+    for (; i + step <= count; i += step) {
+      const __m256i value = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i * kSize));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i * kSize),
+          _mm256_shuffle_epi8(value, mask));
+    }
+    Scalar(values + i * kSize, count - i, results + i * kSize);
+  }
+#endif
+  static Kernel Select() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &Avx2;
+    }
+    if (Cpu::Supports(Cpu::kSsse3)) {
+      return &Ssse3;
+    }
+#endif
+    return &Scalar;
+  }
+
+ private:
+  // The source of each byte of a 32-byte register; the AVX2 shuffle only
+  // moves bytes within 16-byte halves, so both halves are the same.
+  static const uint8_t* Mask() {
+    static const struct Table {
+      Table() {
+        for (unsigned int i = 0; i < 32u; ++i) {
+          bytes[i] = static_cast<uint8_t>(
+              (i & 15u) / kSize * kSize + (kSize - 1u - i % kSize));
+        }
+      }
+      uint8_t bytes[32];
+    } table;
+    return table.bytes;
+  }
+
+  NX_UNINSTANTIABLE(ByteSwapArray);
+};
+template <>
+class ByteSwapArray<1> {
+ public:
+  static void Swap(const uint8_t* values, size_t count, uint8_t* results) {
+    if (values != results && count) {
+      memmove(results, values, count);
+    }
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapArray);
+};
+
+template <size_t kSize>
+class ByteSwapArrayDispatch {
+ public:
+  static void Swap(const uint8_t* values, size_t count, uint8_t* results) {
+    static const typename ByteSwapArray<kSize>::Kernel kernel =
+        ByteSwapArray<kSize>::Select();
+    kernel(values, count, results);
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ByteSwapArrayDispatch);
+};
+template <>
+class ByteSwapArrayDispatch<1> : public ByteSwapArray<1> {
+};
+
+// Whether values of the given byte order must be swapped to or from that of
+// the target.
+template <Endian kEndian>
+class ForeignEndian : public Bool<
+#if defined(NX_LITTLE_ENDIAN)
+    kEndian != kLittleEndian
+#elif defined(NX_BIG_ENDIAN)
+    kEndian != kBigEndian
+#else
+    true
+#endif
+    > {
+};
+
+// Unknown byte orders are read and written a byte at a time; compilers
+// recognize the pattern as a single load or store where they can.
+template <typename T, Endian kEndian>
+class EndianBytes {
+ public:
+  static NX_FORCEINLINE T Load(const uint8_t* bytes) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      value = static_cast<T>(value | (static_cast<T>(bytes[i]) << Shift(i)));
+    }
+    return value;
+  }
+  static NX_FORCEINLINE void Store(uint8_t* bytes, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<uint8_t>(value >> Shift(i));
+    }
+  }
+
+ private:
+  static NX_FORCEINLINE unsigned int Shift(size_t i) {
+    return static_cast<unsigned int>(
+        (kEndian == kLittleEndian ? i : sizeof(T) - 1u - i) * 8u);
+  }
+
+  NX_UNINSTANTIABLE(EndianBytes);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Reverses the order of the bytes of value, an unsigned integer of 1,
+/// 2, 4, 8 or (where the toolchain has one) 16 bytes.
+template <typename T>
+NX_FORCEINLINE NX_INTRINSIC_CONSTEXPR T ByteSwap(T value) {
+  return static_cast<T>(detail::ByteSwapper<sizeof(T)>::Swap(value));
+}
+/// @brief Stores each of count values in results with its bytes reversed.
+/// results may be values.  Uses SSSE3 or AVX2 byte shuffles where
+/// supported.
+template <typename T>
+void ByteSwap(const T* values, size_t count, T* results) {
+  detail::ByteSwapArrayDispatch<sizeof(T)>::Swap(
+      reinterpret_cast<const uint8_t*>(values), count,
+      reinterpret_cast<uint8_t*>(results));
+}
+
+/// @brief Reads an unsigned integer of type T stored in kEndian byte order
+/// at bytes, which need not be aligned.
+///
+/// This is a single load, followed by a byte swap if kEndian is not the
+/// target's; compilers fuse the two into movbe where it is enabled.
+template <typename T, Endian kEndian>
+NX_FORCEINLINE T Load(const void* bytes) {
+#if defined(NX_LITTLE_ENDIAN) || defined(NX_BIG_ENDIAN)
+  T value;
+  memcpy(&value, bytes, sizeof(value));
+  return (detail::ForeignEndian<kEndian>::value ? ByteSwap(value) : value);
+#else
+  return detail::EndianBytes<T, kEndian>::Load(
+      static_cast<const uint8_t*>(bytes));
+#endif
+}
+/// @brief Writes value, an unsigned integer, to bytes in kEndian byte order.
+/// bytes need not be aligned.
+template <typename T, Endian kEndian>
+NX_FORCEINLINE void Store(void* bytes, T value) {
+#if defined(NX_LITTLE_ENDIAN) || defined(NX_BIG_ENDIAN)
+  if (detail::ForeignEndian<kEndian>::value) {
+    value = ByteSwap(value);
+  }
+  memcpy(bytes, &value, sizeof(value));
+#else
+  detail::EndianBytes<T, kEndian>::Store(static_cast<uint8_t*>(bytes), value);
+#endif
+}
+/// @brief Reads count unsigned integers of type T stored consecutively in
+/// kEndian byte order at bytes, which need not be aligned, into values.
+template <typename T, Endian kEndian>
+void Load(const void* bytes, size_t count, T* values) {
+#if defined(NX_LITTLE_ENDIAN) || defined(NX_BIG_ENDIAN)
+  if (detail::ForeignEndian<kEndian>::value) {
+    detail::ByteSwapArrayDispatch<sizeof(T)>::Swap(
+        static_cast<const uint8_t*>(bytes), count,
+        reinterpret_cast<uint8_t*>(values));
+  } else if (count) {
+    memmove(values, bytes, count * sizeof(T));
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = Load<T, kEndian>(static_cast<const uint8_t*>(bytes) +
+        i * sizeof(T));
+  }
+#endif
+}
+/// @brief Writes each of count unsigned integers to bytes in kEndian byte
+/// order, consecutively.  bytes need not be aligned.
+template <typename T, Endian kEndian>
+void Store(void* bytes, const T* values, size_t count) {
+#if defined(NX_LITTLE_ENDIAN) || defined(NX_BIG_ENDIAN)
+  if (detail::ForeignEndian<kEndian>::value) {
+    detail::ByteSwapArrayDispatch<sizeof(T)>::Swap(
+        reinterpret_cast<const uint8_t*>(values), count,
+        static_cast<uint8_t*>(bytes));
+  } else if (count) {
+    memmove(bytes, values, count * sizeof(T));
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    Store<T, kEndian>(static_cast<uint8_t*>(bytes) + i * sizeof(T),
+        values[i]);
+  }
+#endif
+}
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_ENDIAN_H_
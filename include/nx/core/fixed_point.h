@@ -0,0 +1,470 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file fixed_point.h
+/// @brief Binary and decimal fixed-point numbers, with exact conversion to
+/// and from text.
+
+#ifndef INCLUDE_NX_CORE_FIXED_POINT_H_
+#define INCLUDE_NX_CORE_FIXED_POINT_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/multiword.h"
+#include "nx/core/bits.h"
+#include "nx/core/char_conv.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// Rounding of the wide intermediate results of multiplication and division.
+class FixedRounding {
+ public:
+  // lhs / rhs rounded to nearest, with ties away from zero.  The remainder
+  // comes from a multiplication, so wide types only divide once.
+  template <typename T>
+  static T DivideRounded(const T& lhs, const T& rhs) {
+    const T quotient = lhs / rhs;
+    const T remainder = static_cast<T>(lhs - quotient * rhs);
+    if (Absolute(static_cast<T>(remainder + remainder)) < Absolute(rhs)) {
+      return quotient;
+    }
+    const bool negative = ((lhs < 0) != (rhs < 0));
+    return static_cast<T>(negative ? quotient - 1 : quotient + 1);
+  }
+  // value / 2^shift rounded to nearest, with ties away from zero.
+  template <typename T>
+  static T ShiftRounded(const T& value, unsigned int shift) {
+    const T half = static_cast<T>(static_cast<T>(1) << shift) >> 1u;
+    return (value < 0 ? static_cast<T>(-((-value + half) >> shift)) :
+        static_cast<T>((value + half) >> shift));
+  }
+
+ private:
+  template <typename T>
+  static NX_FORCEINLINE T Absolute(const T& value) {
+    return (value < 0 ? static_cast<T>(-value) : value);
+  }
+
+  NX_UNINSTANTIABLE(FixedRounding);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief A signed binary fixed-point number with kFracBits fraction bits
+/// and at least kIntBits integer bits, sign included.
+///
+/// The raw value is held in int_least_t<kIntBits + kFracBits>, and any bits
+/// it has beyond those requested are used for the integer part.  Addition
+/// and subtraction wrap, as for the raw integers.  Multiplication and
+/// division are carried out in an integer twice as wide, so the full product
+/// or shifted dividend is available, and round to nearest with ties away
+/// from zero; results that do not fit wrap.
+///
+/// Text is converted without floating point.  Parse() rounds correctly for
+/// up to 19 fraction digits, ignoring any beyond, and Format() writes the
+/// fewest fraction digits that Parse() reads back as the same value.
+template <unsigned int kIntBits, unsigned int kFracBits>
+class Fixed {
+  static_assert(kIntBits >= 1u && kIntBits + kFracBits <= 64u,
+      "Fixed-point numbers must have a sign bit and at most 64 bits.");
+
+ public:
+  /// @brief The type holding the raw value, scaled by 2^kFracBits.
+  typedef int_least_t<kIntBits + kFracBits> value_type;
+
+  /// @brief Constructs zero.
+  Fixed() : raw_(0) {
+  }
+
+  /// @brief The number with the given raw value.
+  static NX_FORCEINLINE Fixed FromRaw(value_type raw) {
+    Fixed result;
+    result.raw_ = raw;
+    return result;
+  }
+  /// @brief The number with the given integer value, which wraps if it has
+  /// too many bits.
+  static NX_FORCEINLINE Fixed FromInteger(value_type value) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(value) << kFracBits));
+  }
+  /// @brief The raw value, scaled by 2^kFracBits.
+  NX_FORCEINLINE value_type raw() const {
+    return raw_;
+  }
+  /// @brief The integer part, rounded toward negative infinity.
+  NX_FORCEINLINE value_type Integer() const {
+    return static_cast<value_type>(raw_ < 0 ?
+        ~(static_cast<value_type>(~raw_) >> kFracBits) : raw_ >> kFracBits);
+  }
+
+  /// @brief The most characters Format() writes.
+  static NX_FORCEINLINE constexpr size_t MaxChars() {
+    return 1u + (kIntegerBits * 30103u) / 100000u + 1u +
+        (kFracBits ? 1u + (kFracBits < 19u ? kFracBits : 19u) : 0u);
+  }
+  /// @brief Reads a number of the form [+-]digits[.digits] from the size
+  /// characters at text into value.  Provides the number of characters
+  /// read, or 0 if there is no number or it is out of range.
+  static size_t Parse(const char* text, size_t size, Fixed* value) {
+    detail::DecimalText::Literal literal;
+    const size_t read = detail::DecimalText::Scan(text, size,
+        detail::DecimalText::kMaxDigits, &literal);
+    if (!read) {
+      return 0;
+    }
+    // the magnitude of the most negative value
+    const uint64_t limit = (static_cast<uint64_t>(1) << (kBits - 1u)) -
+        (literal.negative ? 0u : 1u);
+    if (literal.integer > (limit >> kFracBits)) {
+      return 0;
+    }
+    // long division of the fraction by its power of ten, a bit at a time,
+    // then rounding on the remainder
+    const uint64_t divisor =
+        detail::DecimalText::Power10(literal.fraction_digits);
+    uint64_t remainder = literal.fraction;
+    uint64_t bits = 0;
+    for (unsigned int i = 0; i <= kFracBits; ++i) {
+      const bool carry = (remainder >> 63u) != 0;
+      remainder <<= 1u;
+      bits <<= 1u;
+      if (carry || remainder >= divisor) {
+        remainder -= divisor;
+        bits |= 1u;
+      }
+    }
+    const uint64_t magnitude =
+        (literal.integer << kFracBits) + (bits >> 1u) + (bits & 1u);
+    if (magnitude > limit) {
+      return 0;
+    }
+    value->raw_ = static_cast<value_type>(
+        literal.negative ? 0u - magnitude : magnitude);
+    return read;
+  }
+  /// @brief Writes the number, without a terminator, to text, which must
+  /// have room for MaxChars() characters.  Provides the number written.
+  size_t Format(char* text) const {
+    size_t count = 0;
+    uint64_t magnitude = static_cast<uint64_t>(raw_);
+    if (raw_ < 0) {
+      text[count++] = '-';
+      magnitude = 0u - magnitude;
+    }
+    count += detail::DecimalText::Format(magnitude >> kFracBits, text + count);
+    return count + FormatFraction(
+        magnitude & Bits<uint64_t>::LowMask(kFracBits), text + count);
+  }
+
+  /// @brief Negation, which wraps for the most negative value.
+  friend NX_FORCEINLINE Fixed operator-(const Fixed& value) {
+    return FromRaw(static_cast<value_type>(
+        0u - static_cast<unsigned_type>(value.raw_)));
+  }
+  friend NX_FORCEINLINE Fixed operator+(const Fixed& lhs, const Fixed& rhs) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(lhs.raw_) +
+        static_cast<unsigned_type>(rhs.raw_)));
+  }
+  friend NX_FORCEINLINE Fixed operator-(const Fixed& lhs, const Fixed& rhs) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(lhs.raw_) -
+        static_cast<unsigned_type>(rhs.raw_)));
+  }
+  friend NX_FORCEINLINE Fixed operator*(const Fixed& lhs, const Fixed& rhs) {
+    return FromRaw(static_cast<value_type>(
+        detail::FixedRounding::ShiftRounded(static_cast<wide_type>(
+            static_cast<wide_type>(lhs.raw_) *
+            static_cast<wide_type>(rhs.raw_)), kFracBits)));
+  }
+  /// @brief Division, for rhs other than zero.
+  friend NX_FORCEINLINE Fixed operator/(const Fixed& lhs, const Fixed& rhs) {
+    return FromRaw(static_cast<value_type>(
+        detail::FixedRounding::DivideRounded(static_cast<wide_type>(
+            static_cast<wide_type>(lhs.raw_) *
+            static_cast<wide_type>(static_cast<wide_type>(1) << kFracBits)),
+            static_cast<wide_type>(rhs.raw_))));
+  }
+  Fixed& operator+=(const Fixed& rhs) {
+    return *this = *this + rhs;
+  }
+  Fixed& operator-=(const Fixed& rhs) {
+    return *this = *this - rhs;
+  }
+  Fixed& operator*=(const Fixed& rhs) {
+    return *this = *this * rhs;
+  }
+  Fixed& operator/=(const Fixed& rhs) {
+    return *this = *this / rhs;
+  }
+
+  friend NX_FORCEINLINE bool operator==(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ == rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator!=(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ != rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator<(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ < rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator>(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ > rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator<=(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ <= rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator>=(const Fixed& lhs, const Fixed& rhs) {
+    return lhs.raw_ >= rhs.raw_;
+  }
+
+ private:
+  typedef MakeUnsigned<value_type> unsigned_type;
+  // holds the full product of two raw values
+  typedef int_least_t<2u * Bits<value_type>::Size()> wide_type;
+  enum : unsigned int {
+    kBits = Bits<value_type>::Size(),
+    // bits in the magnitude of the most negative integer part
+    kIntegerBits = kBits - 1u - kFracBits
+  };
+
+  // Writes the fraction, of kFracBits bits, as the fewest digits that lie
+  // within half a unit of it, preceded by a point; nothing if it is zero.
+  // Digits come from the fraction as a 0.64 fixed-point number, each from
+  // the high word of a multiplication by ten, until what remains is within
+  // the half unit, also scaled by ten each digit, of either the digits so
+  // far or those with the last one increased.  The latter never carries, as
+  // the digits before would then have sufficed.
+  static size_t FormatFraction(uint64_t fraction, char* text) {
+    if (!fraction) {
+      return 0;
+    }
+    const uint64_t kMax = ~static_cast<uint64_t>(0);
+    uint64_t rest = (fraction << (63u - kFracBits)) << 1u;
+    uint64_t margin = static_cast<uint64_t>(1) << (63u - kFracBits);
+    size_t count = 0;
+    text[count++] = '.';
+    for (;;) {
+      uint64_t digit;
+      rest = detail::MultiwordWord::Multiply(rest, 10u, &digit);
+      margin = (margin > kMax / 10u ? kMax : margin * 10u);
+      text[count++] = static_cast<char>('0' + digit);
+      // a value exactly half a unit below rounds up to this one when parsed
+      const bool down = (rest <= margin);
+      const bool up = (rest && 0u - rest < margin);
+      if (down || up) {
+        if (up && (!down || 0u - rest < rest)) {
+          ++text[count - 1u];
+        }
+        return count;
+      }
+    }
+  }
+
+  value_type raw_;
+};
+
+/// @brief A signed decimal fixed-point number of up to kDigits significant
+/// digits, kScale of which follow the point, for kDigits of at most 18.
+///
+/// The raw value, scaled by 10^kScale, is held in the smallest int_least_t
+/// that holds 10^kDigits - 1 and its negation.  Addition and subtraction are
+/// those of the raw integers.  Multiplication and division are carried out
+/// in an integer twice as wide, and round to nearest with ties away from
+/// zero.  Only Parse() enforces the digit limit; arithmetic may exceed it,
+/// up to the range of the raw type, and otherwise wraps.
+///
+/// Parse() rounds to kScale fraction digits in the same way, and Format()
+/// writes exactly kScale fraction digits.
+template <unsigned int kDigits, unsigned int kScale>
+class Decimal {
+  static_assert(kDigits >= 1u && kDigits <= 18u && kScale <= kDigits,
+      "Decimal numbers must have between 1 and 18 digits, and no more "
+      "fraction digits than digits.");
+
+ public:
+  /// @brief The type holding the raw value, scaled by 10^kScale.
+  typedef int_least_t<(kDigits * 3322u + 999u) / 1000u + 1u> value_type;
+
+  /// @brief Constructs zero.
+  Decimal() : raw_(0) {
+  }
+
+  /// @brief The number with the given raw value.
+  static NX_FORCEINLINE Decimal FromRaw(value_type raw) {
+    Decimal result;
+    result.raw_ = raw;
+    return result;
+  }
+  /// @brief The number with the given integer value, which wraps if it is
+  /// too large.
+  static NX_FORCEINLINE Decimal FromInteger(value_type value) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(value) * Scale()));
+  }
+  /// @brief The raw value, scaled by 10^kScale.
+  NX_FORCEINLINE value_type raw() const {
+    return raw_;
+  }
+  /// @brief The integer part, rounded toward zero.
+  NX_FORCEINLINE value_type Integer() const {
+    return static_cast<value_type>(raw_ / static_cast<value_type>(Scale()));
+  }
+
+  /// @brief The most characters Format() writes.
+  static NX_FORCEINLINE constexpr size_t MaxChars() {
+    return 1u + (kRawDigits > kScale ? kRawDigits - kScale : 1u) +
+        (kScale ? 1u + kScale : 0u);
+  }
+  /// @brief Reads a number of the form [+-]digits[.digits] from the size
+  /// characters at text into value, rounding to kScale fraction digits.
+  /// Provides the number of characters read, or 0 if there is no number or
+  /// it has more than kDigits digits once rounded.
+  static size_t Parse(const char* text, size_t size, Decimal* value) {
+    detail::DecimalText::Literal literal;
+    const size_t read = detail::DecimalText::Scan(text, size, kScale,
+        &literal);
+    if (!read || literal.integer >= Limit() / Scale()) {
+      return 0;
+    }
+    const uint64_t magnitude = literal.integer * Scale() +
+        literal.fraction * detail::DecimalText::Power10(
+            kScale - literal.fraction_digits) + (literal.round ? 1u : 0u);
+    if (magnitude >= Limit()) {
+      return 0;
+    }
+    value->raw_ = static_cast<value_type>(
+        literal.negative ? 0u - magnitude : magnitude);
+    return read;
+  }
+  /// @brief Writes the number, without a terminator, to text, which must
+  /// have room for MaxChars() characters.  Provides the number written.
+  size_t Format(char* text) const {
+    size_t count = 0;
+    uint64_t magnitude = static_cast<uint64_t>(raw_);
+    if (raw_ < 0) {
+      text[count++] = '-';
+      magnitude = 0u - magnitude;
+    }
+    count += detail::DecimalText::Format(magnitude / Scale(), text + count);
+    if (kScale) {
+      text[count++] = '.';
+      detail::DecimalText::FormatPadded(magnitude % Scale(), kScale,
+          text + count);
+      count += kScale;
+    }
+    return count;
+  }
+
+  /// @brief Negation.
+  friend NX_FORCEINLINE Decimal operator-(const Decimal& value) {
+    return FromRaw(static_cast<value_type>(
+        0u - static_cast<unsigned_type>(value.raw_)));
+  }
+  friend NX_FORCEINLINE Decimal operator+(const Decimal& lhs,
+      const Decimal& rhs) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(lhs.raw_) +
+        static_cast<unsigned_type>(rhs.raw_)));
+  }
+  friend NX_FORCEINLINE Decimal operator-(const Decimal& lhs,
+      const Decimal& rhs) {
+    return FromRaw(static_cast<value_type>(
+        static_cast<unsigned_type>(lhs.raw_) -
+        static_cast<unsigned_type>(rhs.raw_)));
+  }
+  friend NX_FORCEINLINE Decimal operator*(const Decimal& lhs,
+      const Decimal& rhs) {
+    return FromRaw(static_cast<value_type>(
+        detail::FixedRounding::DivideRounded(static_cast<wide_type>(
+            static_cast<wide_type>(lhs.raw_) *
+            static_cast<wide_type>(rhs.raw_)),
+            static_cast<wide_type>(Scale()))));
+  }
+  /// @brief Division, for rhs other than zero.
+  friend NX_FORCEINLINE Decimal operator/(const Decimal& lhs,
+      const Decimal& rhs) {
+    return FromRaw(static_cast<value_type>(
+        detail::FixedRounding::DivideRounded(static_cast<wide_type>(
+            static_cast<wide_type>(lhs.raw_) *
+            static_cast<wide_type>(Scale())),
+            static_cast<wide_type>(rhs.raw_))));
+  }
+  Decimal& operator+=(const Decimal& rhs) {
+    return *this = *this + rhs;
+  }
+  Decimal& operator-=(const Decimal& rhs) {
+    return *this = *this - rhs;
+  }
+  Decimal& operator*=(const Decimal& rhs) {
+    return *this = *this * rhs;
+  }
+  Decimal& operator/=(const Decimal& rhs) {
+    return *this = *this / rhs;
+  }
+
+  friend NX_FORCEINLINE bool operator==(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ == rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator!=(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ != rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator<(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ < rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator>(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ > rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator<=(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ <= rhs.raw_;
+  }
+  friend NX_FORCEINLINE bool operator>=(const Decimal& lhs,
+      const Decimal& rhs) {
+    return lhs.raw_ >= rhs.raw_;
+  }
+
+ private:
+  typedef MakeUnsigned<value_type> unsigned_type;
+  // holds the full product of two raw values
+  typedef int_least_t<2u * Bits<value_type>::Size()> wide_type;
+  enum : unsigned int {
+    // digits in the magnitude of the most negative raw value
+    kRawDigits = ((Bits<value_type>::Size() - 1u) * 30103u) / 100000u + 1u
+  };
+
+  static NX_FORCEINLINE constexpr uint64_t Scale() {
+    return Bits<uint64_t>::Power<10u, kScale>();
+  }
+  static NX_FORCEINLINE constexpr uint64_t Limit() {
+    return Bits<uint64_t>::Power<10u, kDigits>();
+  }
+
+  value_type raw_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_FIXED_POINT_H_
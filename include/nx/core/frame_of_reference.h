@@ -0,0 +1,478 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file frame_of_reference.h
+/// @brief Compression of 32-bit integers in fixed-size blocks, each packed at
+/// the width of its largest offset from a reference value.
+
+#ifndef INCLUDE_NX_CORE_FRAME_OF_REFERENCE_H_
+#define INCLUDE_NX_CORE_FRAME_OF_REFERENCE_H_
+
+#include <string.h>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/endian.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// The packing and unpacking kernels of FrameOfReference<kBlockSize>, for
+// each instruction set.
+template <unsigned int kBlockSize>
+class FrameOfReferenceKernels {
+ public:
+  enum {
+    kLanes = kBlockSize / 32u,
+    // values per lane
+    kRows = 32
+  };
+
+  // Processes a lane at a time.
+  class Scalar {
+   public:
+    static void Pack(
+        const uint32_t* offsets, unsigned int width, uint8_t* packed) {
+      for (unsigned int lane = 0; lane < kLanes; ++lane) {
+        uint8_t* word = packed + lane * sizeof(uint32_t);
+        uint64_t accumulator = 0;
+        unsigned int bits = 0;
+        for (unsigned int row = 0; row < kRows; ++row) {
+          accumulator |= static_cast<uint64_t>(
+              offsets[row * kLanes + lane]) << bits;
+          bits += width;
+          if (bits >= 32u) {
+            Store<uint32_t, kLittleEndian>(
+                word, static_cast<uint32_t>(accumulator));
+            word += kLanes * sizeof(uint32_t);
+            accumulator >>= 32u;
+            bits -= 32u;
+          }
+        }
+      }
+    }
+    template <unsigned int kWidth, bool kDelta>
+    static void Unpack(
+        const uint8_t* packed, uint32_t reference, uint32_t* values) {
+      for (unsigned int lane = 0; lane < kLanes; ++lane) {
+        const uint8_t* words = packed + lane * sizeof(uint32_t);
+        Row<kWidth, kDelta, 0>(words,
+            (kWidth ? Load<uint32_t, kLittleEndian>(words) : 0u),
+            reference, values + lane, Bool<true>());
+      }
+    }
+
+   private:
+    // Unpacks row kRow given the lane word in which it begins, and continues
+    // with the next.
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    static NX_FORCEINLINE void Row(const uint8_t* words, uint32_t word,
+        uint32_t reference, uint32_t* values, Bool<true>) {
+      enum {
+        kBit = kRow * kWidth % 32u,
+        kWord = kRow * kWidth / 32u,
+        kEnd = kBit + kWidth
+      };
+      uint32_t value = word >> kBit;
+      if (kEnd >= 32u && kRow + 1u < kRows) {
+        word = Load<uint32_t, kLittleEndian>(
+            words + (kWord + 1u) * kLanes * sizeof(uint32_t));
+        if (kEnd > 32u) {
+          value |= word << ((32u - kBit) % 32u);
+        }
+      }
+      if (kWidth < 32u) {
+        value &= Bits<uint32_t>::LowMask(kWidth % 32u);
+      }
+      value += reference;
+      values[kRow * kLanes] = value;
+      Row<kWidth, kDelta, kRow + 1u>(words, word, (kDelta ? value : reference),
+          values, Bool<(kRow + 1u < kRows)>());
+    }
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    static NX_FORCEINLINE void Row(
+        const uint8_t*, uint32_t, uint32_t, uint32_t*, Bool<false>) {
+    }
+
+    NX_UNINSTANTIABLE(Scalar);
+  };
+
+#if defined(NX_SIMD_X86)
+  // Processes four lanes at a time, in groups of four.
+  class Sse2 {
+   public:
+    NX_FUNCTION_TARGET("sse2")
+    static void Pack(
+        const uint32_t* offsets, unsigned int width, uint8_t* packed) {
+      if (!width) {
+        return;
+      }
+      for (unsigned int group = 0; group < kLanes / 4u; ++group) {
+        __m128i* word = reinterpret_cast<__m128i*>(packed) + group;
+        __m128i accumulator = _mm_setzero_si128();
+        unsigned int bits = 0;
+        for (unsigned int row = 0; row < kRows; ++row) {
+          const __m128i offset = _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(
+                  offsets + row * kLanes + group * 4u));
+          accumulator = _mm_or_si128(accumulator, _mm_sll_epi32(
+              offset, _mm_cvtsi32_si128(static_cast<int>(bits))));
+          bits += width;
+          if (bits >= 32u) {
+            _mm_storeu_si128(word, accumulator);
+            word += kLanes / 4u;
+            bits -= 32u;
+            // the bits of offset that did not fit; none if bits is 0, as
+            // offset has no bits at or above width
+            accumulator = _mm_srl_epi32(
+                offset, _mm_cvtsi32_si128(static_cast<int>(width - bits)));
+          }
+        }
+      }
+    }
+    template <unsigned int kWidth, bool kDelta>
+    NX_FUNCTION_TARGET("sse2")
+    static void Unpack(
+        const uint8_t* packed, uint32_t reference, uint32_t* values) {
+      const __m128i base = _mm_set1_epi32(static_cast<int>(reference));
+      for (unsigned int group = 0; group < kLanes / 4u; ++group) {
+        const __m128i* words = reinterpret_cast<const __m128i*>(packed) +
+            group;
+        Row<kWidth, kDelta, 0>(words,
+            (kWidth ? _mm_loadu_si128(words) : _mm_setzero_si128()),
+            base, values + group * 4u, Bool<true>());
+      }
+    }
+
+   private:
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    NX_FUNCTION_TARGET("sse2")
+    static NX_FORCEINLINE void Row(const __m128i* words, __m128i word,
+        __m128i reference, uint32_t* values, Bool<true>) {
+      enum {
+        kBit = kRow * kWidth % 32u,
+        kWord = kRow * kWidth / 32u,
+        kEnd = kBit + kWidth
+      };
+      __m128i value = _mm_srli_epi32(word, kBit);
+      if (kEnd >= 32u && kRow + 1u < kRows) {
+        word = _mm_loadu_si128(words + (kWord + 1u) * (kLanes / 4u));
+        if (kEnd > 32u) {
+          value = _mm_or_si128(value, _mm_slli_epi32(word, 32u - kBit));
+        }
+      }
+      if (kWidth < 32u) {
+        value = _mm_and_si128(value, _mm_set1_epi32(static_cast<int>(
+            Bits<uint32_t>::LowMask(kWidth % 32u))));
+      }
+      value = _mm_add_epi32(value, reference);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(values + kRow * kLanes),
+          value);
+      Row<kWidth, kDelta, kRow + 1u>(words, word, (kDelta ? value : reference),
+          values, Bool<(kRow + 1u < kRows)>());
+    }
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    NX_FUNCTION_TARGET("sse2")
+    static NX_FORCEINLINE void Row(
+        const __m128i*, __m128i, __m128i, uint32_t*, Bool<false>) {
+    }
+
+    NX_UNINSTANTIABLE(Sse2);
+  };
+
+  // Processes eight lanes at a time; only selected for 256-value blocks.
+  class Avx2 {
+   public:
+    NX_FUNCTION_TARGET("avx2")
+    static void Pack(
+        const uint32_t* offsets, unsigned int width, uint8_t* packed) {
+      if (!width) {
+        return;
+      }
+      for (unsigned int group = 0; group < kLanes / 8u; ++group) {
+        __m256i* word = reinterpret_cast<__m256i*>(packed) + group;
+        __m256i accumulator = _mm256_setzero_si256();
+        unsigned int bits = 0;
+        for (unsigned int row = 0; row < kRows; ++row) {
+          const __m256i offset = _mm256_loadu_si256(
+              reinterpret_cast<const __m256i*>(
+                  offsets + row * kLanes + group * 8u));
+          accumulator = _mm256_or_si256(accumulator, _mm256_sll_epi32(
+              offset, _mm_cvtsi32_si128(static_cast<int>(bits))));
+          bits += width;
+          if (bits >= 32u) {
+            _mm256_storeu_si256(word, accumulator);
+            word += kLanes / 8u;
+            bits -= 32u;
+            accumulator = _mm256_srl_epi32(
+                offset, _mm_cvtsi32_si128(static_cast<int>(width - bits)));
+          }
+        }
+      }
+    }
+    template <unsigned int kWidth, bool kDelta>
+    NX_FUNCTION_TARGET("avx2")
+    static void Unpack(
+        const uint8_t* packed, uint32_t reference, uint32_t* values) {
+      const __m256i base = _mm256_set1_epi32(static_cast<int>(reference));
+      for (unsigned int group = 0; group < kLanes / 8u; ++group) {
+        const __m256i* words = reinterpret_cast<const __m256i*>(packed) +
+            group;
+        Row<kWidth, kDelta, 0>(words,
+            (kWidth ? _mm256_loadu_si256(words) : _mm256_setzero_si256()),
+            base, values + group * 8u, Bool<true>());
+      }
+    }
+
+   private:
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE void Row(const __m256i* words, __m256i word,
+        __m256i reference, uint32_t* values, Bool<true>) {
+      enum {
+        kBit = kRow * kWidth % 32u,
+        kWord = kRow * kWidth / 32u,
+        kEnd = kBit + kWidth
+      };
+      __m256i value = _mm256_srli_epi32(word, kBit);
+      if (kEnd >= 32u && kRow + 1u < kRows) {
+        word = _mm256_loadu_si256(words + (kWord + 1u) * (kLanes / 8u));
+        if (kEnd > 32u) {
+          value = _mm256_or_si256(value, _mm256_slli_epi32(word, 32u - kBit));
+        }
+      }
+      if (kWidth < 32u) {
+        value = _mm256_and_si256(value, _mm256_set1_epi32(static_cast<int>(
+            Bits<uint32_t>::LowMask(kWidth % 32u))));
+      }
+      value = _mm256_add_epi32(value, reference);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + kRow * kLanes),
+          value);
+      Row<kWidth, kDelta, kRow + 1u>(words, word, (kDelta ? value : reference),
+          values, Bool<(kRow + 1u < kRows)>());
+    }
+    template <unsigned int kWidth, bool kDelta, unsigned int kRow>
+    NX_FUNCTION_TARGET("avx2")
+    static NX_FORCEINLINE void Row(
+        const __m256i*, __m256i, __m256i, uint32_t*, Bool<false>) {
+    }
+
+    NX_UNINSTANTIABLE(Avx2);
+  };
+#endif
+
+ private:
+  NX_UNINSTANTIABLE(FrameOfReferenceKernels);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Encodes 32-bit integers in blocks of kBlockSize, which is 128 or
+/// 256, storing each value as its offset from a per-block reference in only
+/// as many bits as the block's largest offset needs.
+///
+/// In kMinimum mode, the reference is the block's minimum.  In kDelta mode,
+/// each offset is instead the difference from the value one row earlier, and
+/// the reference is the minimum of the first row; this suits non-decreasing
+/// sequences, such as timestamps.  Offsets wrap, so any values round-trip in
+/// either mode.
+///
+/// The layout is vertical: a block is kBlockSize / 32 lanes, value i
+/// belonging to lane i % lanes, and each lane's 32 offsets are packed into
+/// width 32-bit words that are interleaved with those of the other lanes.
+/// A SIMD register loads the same word of several lanes at once, so unpacking
+/// is shifts and masks without any shuffling, and delta decoding is a single
+/// addition per row.  Each width has its own fully unrolled decoding kernel,
+/// selected per block.
+template <unsigned int kBlockSize = 128>
+class FrameOfReference {
+  static_assert(kBlockSize == 128u || kBlockSize == 256u,
+      "Blocks must hold 128 or 256 values.");
+
+ public:
+  /// @brief How offsets are taken within a block.
+  enum Mode {
+    /// Offsets from the block's minimum.
+    kMinimum,
+    /// Differences from the value one row, of kBlockSize / 32 values, earlier.
+    kDelta
+  };
+
+  /// @brief The number of values per block.
+  static NX_FORCEINLINE constexpr size_t BlockSize() {
+    return kBlockSize;
+  }
+  /// @brief The most bytes Encode() writes for count values.
+  static NX_FORCEINLINE constexpr size_t MaxSize(size_t count) {
+    return (count + (kBlockSize - 1u)) / kBlockSize *
+        (kHeaderSize + kBlockSize * sizeof(uint32_t));
+  }
+
+  /// @brief Encodes count values into bytes, which must have room for
+  /// MaxSize(count), and provides the number of bytes written.  A final
+  /// partial block is padded with its last value.
+  static size_t Encode(
+      const uint32_t* values, size_t count, Mode mode, uint8_t* bytes) {
+    const Kernels& kernels = SelectedKernels();
+    uint32_t block[kBlockSize];
+    uint32_t offsets[kBlockSize];
+    size_t position = 0;
+    for (size_t i = 0; i < count; i += kBlockSize) {
+      const uint32_t* source = values + i;
+      if (count - i < kBlockSize) {
+        const size_t length = count - i;
+        memcpy(block, source, length * sizeof(uint32_t));
+        for (size_t j = length; j < kBlockSize; ++j) {
+          block[j] = source[length - 1u];
+        }
+        source = block;
+      }
+      uint32_t reference;
+      if (mode == kDelta) {
+        reference = Minimum(source, kLanes);
+        for (unsigned int j = 0; j < kLanes; ++j) {
+          offsets[j] = source[j] - reference;
+        }
+        for (unsigned int j = kLanes; j < kBlockSize; ++j) {
+          offsets[j] = source[j] - source[j - kLanes];
+        }
+      } else {
+        reference = Minimum(source, kBlockSize);
+        for (unsigned int j = 0; j < kBlockSize; ++j) {
+          offsets[j] = source[j] - reference;
+        }
+      }
+      uint32_t any = 0;
+      for (unsigned int j = 0; j < kBlockSize; ++j) {
+        any |= offsets[j];
+      }
+      const unsigned int width = (any ?
+          Bits<uint32_t>::ScanReverse(any) + 1u : 0u);
+      bytes[position] = static_cast<uint8_t>(width |
+          (mode == kDelta ? static_cast<unsigned int>(kDeltaFlag) : 0u));
+      Store<uint32_t, kLittleEndian>(bytes + position + 1u, reference);
+      kernels.pack(offsets, width, bytes + position + kHeaderSize);
+      position += kHeaderSize + PackedSize(width);
+    }
+    return position;
+  }
+
+  /// @brief Decodes count values from the size bytes at bytes, and provides
+  /// the number of bytes read, or 0 if they are truncated or malformed.
+  static size_t Decode(
+      const uint8_t* bytes, size_t size, size_t count, uint32_t* values) {
+    const Kernels& kernels = SelectedKernels();
+    uint32_t block[kBlockSize];
+    size_t position = 0;
+    for (size_t i = 0; i < count; i += kBlockSize) {
+      if (size - position < kHeaderSize) {
+        return 0;
+      }
+      const unsigned int header = bytes[position];
+      const unsigned int width = header & ~kDeltaFlag;
+      if (width > 32u ||
+          size - position - kHeaderSize < PackedSize(width)) {
+        return 0;
+      }
+      const uint32_t reference = Load<uint32_t, kLittleEndian>(
+          bytes + position + 1u);
+      uint32_t* target = (count - i < kBlockSize ? block : values + i);
+      kernels.unpack[(header & kDeltaFlag) ? 1 : 0][width](
+          bytes + position + kHeaderSize, reference, target);
+      if (target == block) {
+        memcpy(values + i, block, (count - i) * sizeof(uint32_t));
+      }
+      position += kHeaderSize + PackedSize(width);
+    }
+    return position;
+  }
+
+ private:
+  typedef Function<void, const uint32_t*, unsigned int, uint8_t*> PackKernel;
+  typedef Function<void, const uint8_t*, uint32_t, uint32_t*> UnpackKernel;
+  typedef detail::FrameOfReferenceKernels<kBlockSize> Isas;
+
+  enum {
+    kLanes = kBlockSize / 32u,
+    // the width, with kDeltaFlag, then the reference
+    kHeaderSize = 5,
+    kDeltaFlag = 0x80
+  };
+
+  // The packing kernel, and an unpacking kernel per mode (kMinimum, kDelta)
+  // and width.
+  struct Kernels {
+    PackKernel pack;
+    UnpackKernel unpack[2][33];
+  };
+
+  static NX_FORCEINLINE constexpr size_t PackedSize(unsigned int width) {
+    return static_cast<size_t>(width) * (kBlockSize / 8u);
+  }
+  static NX_FORCEINLINE uint32_t Minimum(
+      const uint32_t* values, unsigned int count) {
+    uint32_t minimum = values[0];
+    for (unsigned int i = 1; i < count; ++i) {
+      minimum = (values[i] < minimum ? values[i] : minimum);
+    }
+    return minimum;
+  }
+
+  // Fills in the unpacking kernels of Isa for kWidth and every wider width.
+  template <class Isa, unsigned int kWidth>
+  static void Fill(Kernels* kernels, Bool<true>) {
+    kernels->unpack[0][kWidth] = &Isa::template Unpack<kWidth, false>;
+    kernels->unpack[1][kWidth] = &Isa::template Unpack<kWidth, true>;
+    Fill<Isa, kWidth + 1u>(kernels, Bool<(kWidth < 32u)>());
+  }
+  template <class Isa, unsigned int kWidth>
+  static void Fill(Kernels*, Bool<false>) {
+  }
+  template <class Isa>
+  static Kernels Make() {
+    Kernels kernels;
+    kernels.pack = &Isa::Pack;
+    Fill<Isa, 0>(&kernels, Bool<true>());
+    return kernels;
+  }
+  static Kernels Select() {
+#if defined(NX_SIMD_X86)
+    if (kLanes % 8u == 0 && Cpu::Supports(Cpu::kAvx2)) {
+      return Make<typename Isas::Avx2>();
+    }
+    if (Cpu::Supports(Cpu::kSse2)) {
+      return Make<typename Isas::Sse2>();
+    }
+#endif
+    return Make<typename Isas::Scalar>();
+  }
+  static NX_FORCEINLINE const Kernels& SelectedKernels() {
+    static const Kernels kernels = Select();
+    return kernels;
+  }
+
+  NX_UNINSTANTIABLE(FrameOfReference);
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_FRAME_OF_REFERENCE_H_
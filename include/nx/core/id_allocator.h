@@ -0,0 +1,166 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file id_allocator.h
+/// @brief An allocator of integer identifiers that always provides the lowest
+/// free one, backed by a hierarchy of summary bitmaps.
+
+#ifndef INCLUDE_NX_CORE_ID_ALLOCATOR_H_
+#define INCLUDE_NX_CORE_ID_ALLOCATOR_H_
+
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief Hands out the lowest free index in [0, capacity()), and takes
+/// indexes back in any order.
+///
+/// The leaf level has a set bit for every free index.  Each level above has a
+/// set bit for every word beneath it that is not zero, up to a single word at
+/// the top.  Allocation descends from the top with one bit scan per level,
+/// and both allocation and freeing touch one word per level at most; four
+/// levels cover 16M indexes.  Indexes are of the smallest unsigned type
+/// holding kIndexBits bits.
+template <unsigned int kIndexBits = 32>
+class IdAllocator {
+ public:
+  /// @brief The type of an index.
+  typedef uint_least_t<kIndexBits> index_type;
+
+  /// @brief Constructs an allocator with every index in [0, capacity) free.
+  /// The capacity itself must be representable by index_type.
+  explicit IdAllocator(size_t capacity)
+      : capacity_(capacity),
+        size_(0),
+        levels_(0) {
+    Build();
+  }
+
+  /// @brief The number of indexes managed.
+  NX_FORCEINLINE size_t capacity() const {
+    return capacity_;
+  }
+  /// @brief The number of indexes allocated.
+  NX_FORCEINLINE size_t size() const {
+    return size_;
+  }
+  /// @brief Determines if every index is allocated.
+  NX_FORCEINLINE bool full() const {
+    return size_ == capacity_;
+  }
+  /// @brief Determines if index is free.
+  NX_FORCEINLINE bool IsFree(index_type index) const {
+    return Bits<uint64_t>::get(Bit(index), &words_[Word(0, index)]) != 0;
+  }
+
+  /// @brief Allocates the lowest free index, or provides capacity() if none
+  /// are free.
+  index_type Allocate() {
+    size_t index = 0;
+    for (unsigned int level = levels_; level-- != 0; ) {
+      const uint64_t word = words_[offsets_[level] + index];
+      if (!word) {
+        // only possible at the top
+        return static_cast<index_type>(capacity_);
+      }
+      index = index * kWordBits + Bits<uint64_t>::ScanForward(word);
+    }
+    Take(index);
+    return static_cast<index_type>(index);
+  }
+  /// @brief Allocates index, which must be free.
+  void Allocate(index_type index) {
+    Take(index);
+  }
+  /// @brief Frees index, which must be allocated.
+  void Free(index_type index) {
+    size_t bit = index;
+    for (unsigned int level = 0; level < levels_; ++level) {
+      uint64_t* word = &words_[Word(level, bit)];
+      const bool was_empty = !*word;
+      Bits<uint64_t>::set(Bit(bit), word);
+      if (!was_empty) {
+        // the levels above already mark this word as not full
+        break;
+      }
+      bit /= kWordBits;
+    }
+    --size_;
+  }
+
+ private:
+  enum {
+    kWordBits = 64,
+    // enough levels of 64-way fan-out for any size_t capacity
+    kMaxLevels = 11
+  };
+
+  static NX_FORCEINLINE uint64_t Bit(size_t bit) {
+    return static_cast<uint64_t>(1) << (bit % kWordBits);
+  }
+  NX_FORCEINLINE size_t Word(unsigned int level, size_t bit) const {
+    return offsets_[level] + bit / kWordBits;
+  }
+  // Clears the bit for index, and the bits of any words above it that this
+  // empties.
+  void Take(size_t index) {
+    size_t bit = index;
+    for (unsigned int level = 0; level < levels_; ++level) {
+      uint64_t* word = &words_[Word(level, bit)];
+      Bits<uint64_t>::clear(Bit(bit), word);
+      if (*word) {
+        break;
+      }
+      bit /= kWordBits;
+    }
+    ++size_;
+  }
+  void Build() {
+    // the number of set bits in each level; one per non-empty word below
+    size_t bits = capacity_;
+    size_t offset = 0;
+    do {
+      const size_t words = (bits + (kWordBits - 1)) / kWordBits;
+      offsets_[levels_++] = offset;
+      words_.resize(offset + (words ? words : 1u), 0);
+      for (size_t i = 0; i < bits / kWordBits; ++i) {
+        words_[offset + i] = ~static_cast<uint64_t>(0);
+      }
+      if (bits % kWordBits) {
+        words_[offset + bits / kWordBits] = Bits<uint64_t>::LowMask(
+            static_cast<unsigned int>(bits % kWordBits));
+      }
+      offset = words_.size();
+      bits = words;
+    } while (bits > 1u);
+  }
+
+  size_t capacity_;
+  size_t size_;
+  unsigned int levels_;
+  // where each level's words begin, from the leaves upwards
+  size_t offsets_[kMaxLevels];
+  std::vector<uint64_t> words_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_ID_ALLOCATOR_H_
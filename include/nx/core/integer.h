@@ -29,6 +29,12 @@
 /// @brief Library namespace.
 namespace nx {
 
+/// @brief An integer of kWords 64-bit words, as selected for widths beyond
+/// the builtin types; defined in multiword.h, which is included below once
+/// the word types it is built from are declared.
+template <unsigned int kWords, bool kSigned>
+class Multiword;
+
 /// @cond nx_detail
 namespace detail {
 
@@ -65,6 +71,38 @@ class PreferIntegralSignInternal<
   NX_UNINSTANTIABLE(PreferIntegralSignInternal);
 };
 
+// The smallest Multiword in the specified bit range, or InvalidType.
+template <bool kSigned, unsigned int kBitMin, unsigned int kBitMax>
+class MultiwordLeastRange : public Identity<Conditional<
+    Bool<(kBitMin <= ~0u - 63u && (kBitMin + 63u) / 64u >= 1u &&
+        (kBitMin + 63u) / 64u * 64u <= kBitMax)>,
+    Multiword<(kBitMin + 63u) / 64u, kSigned>,
+    InvalidType>> {
+ private:
+  NX_UNINSTANTIABLE(MultiwordLeastRange);
+};
+
+// Types wider than long long; the compiler's 128-bit integers where it has
+// them, and then Multiword.  Their sign is chosen here, as std::make_signed
+// does not accept 128-bit integers in strict standard modes.
+#if defined(__SIZEOF_INT128__)
+template <bool kSigned, unsigned int kBitMin, unsigned int kBitMax>
+class WideLeastRange : public Identity<Conditional<
+    Bool<(kBitMin <= 128u && 128u <= kBitMax)>,
+    Conditional<Bool<kSigned>, int128_t, uint128_t>,
+    Invoke<MultiwordLeastRange<kSigned, kBitMin, kBitMax>>>> {
+ private:
+  NX_UNINSTANTIABLE(WideLeastRange);
+};
+#else
+template <bool kSigned, unsigned int kBitMin, unsigned int kBitMax>
+class WideLeastRange
+    : public MultiwordLeastRange<kSigned, kBitMin, kBitMax> {
+ private:
+  NX_UNINSTANTIABLE(WideLeastRange);
+};
+#endif
+
 }  // namespace detail
 /// @endcond
 
@@ -87,7 +125,9 @@ class PreferIntegralSign
 };
 
 /// @brief Searches for the smallest signed integral type within the specified
-/// bit range.  Provides InvalidType if no such type exists.
+/// bit range.  Beyond long long, this is the compiler's 128-bit integer where
+/// it has one, and otherwise a Multiword of as many 64-bit words as needed.
+/// Provides InvalidType if no such type exists.
 template <
     bool kSigned,
     unsigned int kBitMin,
@@ -115,7 +155,8 @@ class IntegralLeastRangeSearch
                       Bool<Bits<long long>::InRange<  // NOLINT(runtime/int)
                           kBitMin, kBitMax>()>,
                       long long,  // NOLINT(runtime/int)
-                      InvalidType>
+                      Invoke<detail::WideLeastRange<
+                          kSigned, kBitMin, kBitMax>>>
                   >
                 >
               >
@@ -292,4 +333,8 @@ typedef int_least_t<Bits<pid_t>::Size()> intpid_t;
 
 }  // namespace nx
 
+// Completes Multiword, so that every type selected above may be used with
+// this header alone.
+#include "nx/core/multiword.h"
+
 #endif  // INCLUDE_NX_CORE_INTEGER_H_
@@ -0,0 +1,178 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file montgomery.h
+/// @brief Modular multiplication and exponentiation over 64-bit moduli, using
+/// Montgomery reduction to avoid division.
+
+#ifndef INCLUDE_NX_CORE_MONTGOMERY_H_
+#define INCLUDE_NX_CORE_MONTGOMERY_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/multiword.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// Remainders of 128-bit values, such as the products of
+// MultiwordWord::Multiply.
+class WideDivide {
+ public:
+  // Provides (high * 2^64 + low) % modulus, where high < modulus.
+  static NX_FORCEINLINE uint64_t Modulo(
+      uint64_t high, uint64_t low, uint64_t modulus) {
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>(((static_cast<uint128_t>(high) <<
+        64u) | low) % modulus);
+#else
+    // shift in one bit at a time, keeping the remainder below modulus
+    for (unsigned int i = 0; i < 64u; ++i) {
+      const bool carry = (high >> 63u) != 0;
+      high = (high << 1u) | (low >> 63u);
+      low <<= 1u;
+      if (carry || high >= modulus) {
+        high -= modulus;
+      }
+    }
+    return high;
+#endif
+  }
+
+ private:
+  NX_UNINSTANTIABLE(WideDivide);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Arithmetic modulo an odd 64-bit modulus in Montgomery form, where a
+/// value x is represented as x * 2^64 % modulus.  Multiplication then reduces
+/// with two multiplications and a subtraction rather than a division.
+///
+/// Construction costs about as much as a few dozen multiplications, so an
+/// instance should be kept for as long as its modulus is in use.
+class Montgomery {
+ public:
+  /// @brief Prepares arithmetic modulo modulus, which must be odd.
+  explicit Montgomery(uint64_t modulus)
+      : modulus_(modulus),
+        inverse_(Inverse(modulus)),
+        one_(0),
+        square_(0) {
+    // 2^64 % modulus, then doubled 64 more times for 2^128 % modulus
+    one_ = (0u - modulus) % modulus;
+    square_ = one_;
+    for (unsigned int i = 0; i < 64u; ++i) {
+      square_ = AddModulo(square_, square_);
+    }
+  }
+
+  /// @brief The modulus.
+  NX_FORCEINLINE uint64_t modulus() const {
+    return modulus_;
+  }
+  /// @brief Converts value, which need not be reduced, into Montgomery form.
+  NX_FORCEINLINE uint64_t ToForm(uint64_t value) const {
+    return Multiply(value % modulus_, square_);
+  }
+  /// @brief Converts a value in Montgomery form back into a reduced value.
+  NX_FORCEINLINE uint64_t FromForm(uint64_t value) const {
+    return Reduce(0, value);
+  }
+  /// @brief Multiplies two values in Montgomery form, giving a value in
+  /// Montgomery form.
+  NX_FORCEINLINE uint64_t Multiply(uint64_t lhs, uint64_t rhs) const {
+    uint64_t high;
+    const uint64_t low = detail::MultiwordWord::Multiply(lhs, rhs, &high);
+    return Reduce(high, low);
+  }
+  /// @brief Provides base raised to exponent, modulo modulus(), where
+  /// neither base nor the result are in Montgomery form.
+  uint64_t Power(uint64_t base, uint64_t exponent) const {
+    uint64_t factor = ToForm(base);
+    uint64_t power = one_;
+    for (; exponent; exponent >>= 1u) {
+      if (exponent & 1u) {
+        power = Multiply(power, factor);
+      }
+      factor = Multiply(factor, factor);
+    }
+    return FromForm(power);
+  }
+
+ private:
+  // Newton's iteration doubles the number of correct low bits each step; an
+  // odd value is its own inverse modulo 8, giving 3 bits to begin with.
+  static NX_FORCEINLINE uint64_t Inverse(uint64_t modulus) {
+    uint64_t inverse = modulus;
+    for (unsigned int i = 0; i < 5u; ++i) {
+      inverse *= 2u - modulus * inverse;
+    }
+    return inverse;
+  }
+  // Provides (high * 2^64 + low) / 2^64 % modulus, for high < modulus.  The
+  // multiple of modulus that clears the low word is subtracted, leaving just
+  // the high words to subtract.
+  NX_FORCEINLINE uint64_t Reduce(uint64_t high, uint64_t low) const {
+    uint64_t product_high;
+    detail::MultiwordWord::Multiply(low * inverse_, modulus_, &product_high);
+    return (high >= product_high ?
+        high - product_high :
+        high - product_high + modulus_);
+  }
+  NX_FORCEINLINE uint64_t AddModulo(uint64_t lhs, uint64_t rhs) const {
+    // lhs + rhs may wrap, so compare against the distance to modulus
+    return (lhs >= modulus_ - rhs ? lhs - (modulus_ - rhs) : lhs + rhs);
+  }
+
+  uint64_t modulus_;
+  // modulus^-1 modulo 2^64
+  uint64_t inverse_;
+  // 1 and 2^64 in Montgomery form
+  uint64_t one_;
+  uint64_t square_;
+};
+
+/// @brief Provides base raised to exponent, modulo modulus, which must not be
+/// zero.  Odd moduli use Montgomery multiplication; when raising many values
+/// to powers with one modulus, prefer keeping a Montgomery instance.
+inline uint64_t PowMod(uint64_t base, uint64_t exponent, uint64_t modulus) {
+  if (modulus & 1u) {
+    return Montgomery(modulus).Power(base, exponent);
+  }
+  // even moduli fall back to reducing each 128-bit product by division
+  uint64_t factor = base % modulus;
+  uint64_t power = 1u % modulus;
+  for (; exponent; exponent >>= 1u) {
+    uint64_t high, low;
+    if (exponent & 1u) {
+      low = detail::MultiwordWord::Multiply(power, factor, &high);
+      power = detail::WideDivide::Modulo(high, low, modulus);
+    }
+    low = detail::MultiwordWord::Multiply(factor, factor, &high);
+    factor = detail::WideDivide::Modulo(high, low, modulus);
+  }
+  return power;
+}
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_MONTGOMERY_H_
@@ -0,0 +1,413 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file morton.h
+/// @brief Morton (Z-order) encoding and decoding of 2D and 3D coordinates,
+/// interleaving the bits of each axis into a single key.
+
+#ifndef INCLUDE_NX_CORE_MORTON_H_
+#define INCLUDE_NX_CORE_MORTON_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// Spreads the low bits of a value so that kDimensions - 1 zero bits follow
+// each, and compacts them back, using shifts and "magic" masks.
+template <unsigned int kDimensions>
+class MortonMagic {
+ private:
+  NX_UNINSTANTIABLE(MortonMagic);
+};
+template <>
+class MortonMagic<2> {
+ public:
+  static NX_FORCEINLINE constexpr uint64_t Mask() {
+    return 0x5555555555555555ull;
+  }
+  static NX_FORCEINLINE uint64_t Spread(uint64_t value) {
+    value &= 0x00000000ffffffffull;
+    value = (value | (value << 16u)) & 0x0000ffff0000ffffull;
+    value = (value | (value << 8u)) & 0x00ff00ff00ff00ffull;
+    value = (value | (value << 4u)) & 0x0f0f0f0f0f0f0f0full;
+    value = (value | (value << 2u)) & 0x3333333333333333ull;
+    value = (value | (value << 1u)) & 0x5555555555555555ull;
+    return value;
+  }
+  static NX_FORCEINLINE uint64_t Compact(uint64_t value) {
+    value &= 0x5555555555555555ull;
+    value = (value | (value >> 1u)) & 0x3333333333333333ull;
+    value = (value | (value >> 2u)) & 0x0f0f0f0f0f0f0f0full;
+    value = (value | (value >> 4u)) & 0x00ff00ff00ff00ffull;
+    value = (value | (value >> 8u)) & 0x0000ffff0000ffffull;
+    value = (value | (value >> 16u)) & 0x00000000ffffffffull;
+    return value;
+  }
+#if defined(NX_SIMD_X86)
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Spread(__m256i value) {
+    value = _mm256_and_si256(value, Set(0x00000000ffffffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 16)), Set(0x0000ffff0000ffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 8)), Set(0x00ff00ff00ff00ffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 4)), Set(0x0f0f0f0f0f0f0f0full));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 2)), Set(0x3333333333333333ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 1)), Set(0x5555555555555555ull));
+    return value;
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Compact(__m256i value) {
+    value = _mm256_and_si256(value, Set(0x5555555555555555ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 1)), Set(0x3333333333333333ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 2)), Set(0x0f0f0f0f0f0f0f0full));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 4)), Set(0x00ff00ff00ff00ffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 8)), Set(0x0000ffff0000ffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 16)), Set(0x00000000ffffffffull));
+    return value;
+  }
+
+ private:
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Set(uint64_t value) {
+    return _mm256_set1_epi64x(static_cast<long long>(value));  // NOLINT
+  }
+#endif
+  NX_UNINSTANTIABLE(MortonMagic);
+};
+template <>
+class MortonMagic<3> {
+ public:
+  static NX_FORCEINLINE constexpr uint64_t Mask() {
+    return 0x9249249249249249ull;
+  }
+  static NX_FORCEINLINE uint64_t Spread(uint64_t value) {
+    value &= 0x00000000001fffffull;
+    value = (value | (value << 32u)) & 0x001f00000000ffffull;
+    value = (value | (value << 16u)) & 0x001f0000ff0000ffull;
+    value = (value | (value << 8u)) & 0x100f00f00f00f00full;
+    value = (value | (value << 4u)) & 0x10c30c30c30c30c3ull;
+    value = (value | (value << 2u)) & 0x1249249249249249ull;
+    return value;
+  }
+  static NX_FORCEINLINE uint64_t Compact(uint64_t value) {
+    value &= 0x1249249249249249ull;
+    value = (value | (value >> 2u)) & 0x10c30c30c30c30c3ull;
+    value = (value | (value >> 4u)) & 0x100f00f00f00f00full;
+    value = (value | (value >> 8u)) & 0x001f0000ff0000ffull;
+    value = (value | (value >> 16u)) & 0x001f00000000ffffull;
+    value = (value | (value >> 32u)) & 0x00000000001fffffull;
+    return value;
+  }
+#if defined(NX_SIMD_X86)
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Spread(__m256i value) {
+    value = _mm256_and_si256(value, Set(0x00000000001fffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 32)), Set(0x001f00000000ffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 16)), Set(0x001f0000ff0000ffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 8)), Set(0x100f00f00f00f00full));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 4)), Set(0x10c30c30c30c30c3ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_slli_epi64(value, 2)), Set(0x1249249249249249ull));
+    return value;
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Compact(__m256i value) {
+    value = _mm256_and_si256(value, Set(0x1249249249249249ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 2)), Set(0x10c30c30c30c30c3ull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 4)), Set(0x100f00f00f00f00full));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 8)), Set(0x001f0000ff0000ffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 16)), Set(0x001f00000000ffffull));
+    value = _mm256_and_si256(_mm256_or_si256(value,
+        _mm256_srli_epi64(value, 32)), Set(0x00000000001fffffull));
+    return value;
+  }
+
+ private:
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Set(uint64_t value) {
+    return _mm256_set1_epi64x(static_cast<long long>(value));  // NOLINT
+  }
+#endif
+  NX_UNINSTANTIABLE(MortonMagic);
+};
+
+// The batch conversion kernels of Morton<kDimensions, kBits>, for each
+// instruction set.
+template <unsigned int kDimensions, unsigned int kBits>
+class MortonKernels {
+ public:
+  typedef uint_least_t<kBits> coordinate_type;
+  typedef uint_least_t<kDimensions * kBits> key_type;
+
+  // The mask of the bits making up a coordinate.
+  static NX_FORCEINLINE constexpr uint64_t Mask() {
+    return (kBits == 64u ?
+        ~static_cast<uint64_t>(0) :
+        Bits<uint64_t>::LowMask(kBits));
+  }
+
+  static void EncodeScalar(const coordinate_type* const* axes, size_t count,
+      key_type* keys) {
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t key = 0;
+      for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+        key |= Magic::Spread(axes[axis][i] & Mask()) << axis;
+      }
+      keys[i] = static_cast<key_type>(key);
+    }
+  }
+  static void DecodeScalar(const key_type* keys, size_t count,
+      coordinate_type* const* axes) {
+    for (size_t i = 0; i < count; ++i) {
+      for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+        axes[axis][i] = static_cast<coordinate_type>(
+            Magic::Compact(keys[i] >> axis) & Mask());
+      }
+    }
+  }
+#if defined(NX_SIMD_X86)
+  // Four points per step, each in a 64-bit lane; coordinates and keys are
+  // of 2, 4 or 8 bytes.
+  template <typename U>
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE __m256i Load4(const U* values) {
+    return (sizeof(U) == 2u ?
+        _mm256_cvtepu16_epi64(_mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(values))) :
+        sizeof(U) == 4u ?
+          _mm256_cvtepu32_epi64(_mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(values))) :
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)));
+  }
+  template <typename U>
+  NX_FUNCTION_TARGET("avx2")
+  static NX_FORCEINLINE void Store4(U* values, __m256i lanes) {
+    if (sizeof(U) == 8u) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), lanes);
+      return;
+    }
+    // gather the low dword of each lane into the low half
+    const __m128i dwords = _mm256_castsi256_si128(
+        _mm256_permutevar8x32_epi32(lanes,
+            _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+    if (sizeof(U) == 4u) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(values), dwords);
+    } else {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(values),
+          _mm_packus_epi32(dwords, dwords));
+    }
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static void EncodeAvx2(const coordinate_type* const* axes, size_t count,
+      key_type* keys) {
+    const __m256i mask = _mm256_set1_epi64x(
+        static_cast<long long>(Mask()));  // NOLINT(runtime/int)
+    size_t i = 0;
+    for (; i + 4u <= count; i += 4u) {
+      __m256i key = Magic::Spread(_mm256_and_si256(Load4(axes[0] + i), mask));
+      key = _mm256_or_si256(key, _mm256_slli_epi64(Magic::Spread(
+          _mm256_and_si256(Load4(axes[1] + i), mask)), 1));
+      if (kDimensions == 3u) {
+        key = _mm256_or_si256(key, _mm256_slli_epi64(Magic::Spread(
+            _mm256_and_si256(Load4(axes[2] + i), mask)), 2));
+      }
+      Store4(keys + i, key);
+    }
+    const coordinate_type* tail[kDimensions];
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      tail[axis] = axes[axis] + i;
+    }
+    EncodeScalar(tail, count - i, keys + i);
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static void DecodeAvx2(const key_type* keys, size_t count,
+      coordinate_type* const* axes) {
+    const __m256i mask = _mm256_set1_epi64x(
+        static_cast<long long>(Mask()));  // NOLINT(runtime/int)
+    size_t i = 0;
+    for (; i + 4u <= count; i += 4u) {
+      const __m256i key = Load4(keys + i);
+      Store4(axes[0] + i, _mm256_and_si256(Magic::Compact(key), mask));
+      Store4(axes[1] + i, _mm256_and_si256(
+          Magic::Compact(_mm256_srli_epi64(key, 1)), mask));
+      if (kDimensions == 3u) {
+        Store4(axes[2] + i, _mm256_and_si256(
+            Magic::Compact(_mm256_srli_epi64(key, 2)), mask));
+      }
+    }
+    coordinate_type* tail[kDimensions];
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      tail[axis] = axes[axis] + i;
+    }
+    DecodeScalar(keys + i, count - i, tail);
+  }
+#endif
+
+ private:
+  typedef MortonMagic<kDimensions> Magic;
+
+  NX_UNINSTANTIABLE(MortonKernels);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Morton (Z-order) keys for kDimensions axes of kBits bits each.  Bit
+/// i of axis a becomes bit (i * kDimensions + a) of the key.  Keys are of the
+/// smallest unsigned type holding kDimensions * kBits bits.
+///
+/// Scalar conversions use PDEP/PEXT when BMI2 is targeted, and shifts with
+/// magic masks otherwise.  Batch conversions select a kernel at runtime.
+template <unsigned int kDimensions, unsigned int kBits>
+class Morton {
+  static_assert(kDimensions == 2u || kDimensions == 3u,
+      "Morton keys are provided for 2 or 3 dimensions.");
+  static_assert(kBits >= 1u && kDimensions * kBits <= 64u,
+      "Morton keys must fit within 64 bits.");
+
+ public:
+  /// @brief The type of each coordinate.
+  typedef uint_least_t<kBits> coordinate_type;
+  /// @brief The type of a key.
+  typedef uint_least_t<kDimensions * kBits> key_type;
+
+  /// @brief The key bits holding the bits of the first axis.
+  static NX_FORCEINLINE constexpr uint64_t AxisMask() {
+    return detail::MortonMagic<kDimensions>::Mask() & (
+        kDimensions * kBits == 64u ?
+          ~static_cast<uint64_t>(0) :
+          Bits<uint64_t>::LowMask(kDimensions * kBits));
+  }
+
+  /// @brief Interleaves the bits of x and y.
+  template <unsigned int kDimensions_ = kDimensions>
+  static NX_FORCEINLINE EnableIf<Bool<kDimensions_ == 2u>,
+      key_type> Encode(coordinate_type x, coordinate_type y) {
+    return static_cast<key_type>(Spread(x, 0) | Spread(y, 1));
+  }
+  /// @brief Interleaves the bits of x, y and z.
+  template <unsigned int kDimensions_ = kDimensions>
+  static NX_FORCEINLINE EnableIf<Bool<kDimensions_ == 3u>,
+      key_type> Encode(coordinate_type x, coordinate_type y,
+          coordinate_type z) {
+    return static_cast<key_type>(Spread(x, 0) | Spread(y, 1) |
+        Spread(z, 2));
+  }
+  /// @brief Separates the bits of key into x and y.
+  template <unsigned int kDimensions_ = kDimensions>
+  static NX_FORCEINLINE EnableIf<Bool<kDimensions_ == 2u>,
+      void> Decode(key_type key, coordinate_type* x, coordinate_type* y) {
+    *x = Compact(key, 0);
+    *y = Compact(key, 1);
+  }
+  /// @brief Separates the bits of key into x, y and z.
+  template <unsigned int kDimensions_ = kDimensions>
+  static NX_FORCEINLINE EnableIf<Bool<kDimensions_ == 3u>,
+      void> Decode(key_type key, coordinate_type* x, coordinate_type* y,
+          coordinate_type* z) {
+    *x = Compact(key, 0);
+    *y = Compact(key, 1);
+    *z = Compact(key, 2);
+  }
+
+  /// @brief Encodes count points, whose coordinates along axis a are in
+  /// axes[a][0, count), into keys.
+  static void Encode(const coordinate_type* const* axes, size_t count,
+      key_type* keys) {
+    static const EncodeKernel kernel = SelectEncode();
+    kernel(axes, count, keys);
+  }
+  /// @brief Decodes count keys into points, whose coordinates along axis a
+  /// are written to axes[a][0, count).
+  static void Decode(const key_type* keys, size_t count,
+      coordinate_type* const* axes) {
+    static const DecodeKernel kernel = SelectDecode();
+    kernel(keys, count, axes);
+  }
+
+ private:
+  typedef detail::MortonMagic<kDimensions> Magic;
+  typedef detail::MortonKernels<kDimensions, kBits> Detail;
+  typedef Function<void, const coordinate_type* const*, size_t, key_type*>
+      EncodeKernel;
+  typedef Function<void, const key_type*, size_t, coordinate_type* const*>
+      DecodeKernel;
+
+  static NX_FORCEINLINE uint64_t Spread(
+      coordinate_type coordinate, unsigned int axis) {
+#if defined(__BMI2__)
+    return Bits<uint64_t>::Deposit(coordinate, AxisMask() << axis);
+#else
+    return Magic::Spread(coordinate & Detail::Mask()) << axis;
+#endif
+  }
+  static NX_FORCEINLINE coordinate_type Compact(
+      uint64_t key, unsigned int axis) {
+#if defined(__BMI2__)
+    return static_cast<coordinate_type>(
+        Bits<uint64_t>::Extract(key, AxisMask() << axis));
+#else
+    return static_cast<coordinate_type>(
+        Magic::Compact(key >> axis) & Detail::Mask());
+#endif
+  }
+  static EncodeKernel SelectEncode() {
+#if defined(NX_SIMD_X86)
+    if (sizeof(coordinate_type) > 1u && Cpu::Supports(Cpu::kAvx2)) {
+      return &Detail::EncodeAvx2;
+    }
+#endif
+    return &Detail::EncodeScalar;
+  }
+  static DecodeKernel SelectDecode() {
+#if defined(NX_SIMD_X86)
+    if (sizeof(coordinate_type) > 1u && Cpu::Supports(Cpu::kAvx2)) {
+      return &Detail::DecodeAvx2;
+    }
+#endif
+    return &Detail::DecodeScalar;
+  }
+
+  NX_UNINSTANTIABLE(Morton);
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_MORTON_H_
@@ -244,6 +244,47 @@ class SetSigned : public std::conditional<
   NX_UNINSTANTIABLE(SetSigned);
 };
 
+#if defined(__SIZEOF_INT128__)
+/// @brief Specialization for the 128-bit integers, which std::make_signed
+/// does not accept in strict standard modes.
+template <bool kSigned>
+class SetSigned<kSigned, int128_t>
+    : public std::conditional<kSigned, int128_t, uint128_t> {
+ private:
+  NX_UNINSTANTIABLE(SetSigned);
+};
+
+/// @brief Specialization for the 128-bit integers, which std::make_unsigned
+/// does not accept in strict standard modes.
+template <bool kSigned>
+class SetSigned<kSigned, uint128_t>
+    : public std::conditional<kSigned, int128_t, uint128_t> {
+ private:
+  NX_UNINSTANTIABLE(SetSigned);
+};
+#endif
+
+/// @brief Checks if T is an integral type, including the 128-bit integers
+/// that std::is_integral leaves out in strict standard modes.
+template <typename T>
+class IsIntegral : public Bool<std::is_integral<T>::value
+#if defined(__SIZEOF_INT128__)
+    || std::is_same<T, int128_t>::value ||
+    std::is_same<T, uint128_t>::value
+#endif
+    > {
+};
+
+/// @brief Checks if T is a signed arithmetic type, including the signed
+/// 128-bit integer that std::is_signed leaves out in strict standard modes.
+template <typename T>
+class IsSigned : public Bool<std::is_signed<T>::value
+#if defined(__SIZEOF_INT128__)
+    || std::is_same<T, int128_t>::value
+#endif
+    > {
+};
+
 /// @brief Makes an integral type unsigned.
 template <typename T>
 using MakeUnsigned = Invoke<SetSigned<false, T>>;
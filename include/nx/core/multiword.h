@@ -0,0 +1,403 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file multiword.h
+/// @brief Fixed-width integers wider than any builtin type, as provided by
+/// integer.h beyond the builtin widths.
+
+#ifndef INCLUDE_NX_CORE_MULTIWORD_H_
+#define INCLUDE_NX_CORE_MULTIWORD_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+#if defined(NX_TC_VS)
+#include <intrin.h>
+#endif
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// Carrying addition, borrowing subtraction and 64x64 to 128-bit products of
+// single words.  Where compiled for them, ADX and BMI2 provide adcx and mulx,
+// which leave the flags of an enclosing carry chain undisturbed.
+class MultiwordWord {
+ public:
+  // Provides lhs + rhs + *carry, storing the carry out in carry.
+  static NX_FORCEINLINE uint64_t Add(
+      uint64_t lhs, uint64_t rhs, unsigned char* carry) {
+#if defined(NX_SIMD_X86) && defined(NX_ARCH_X86_64)
+    unsigned long long sum;  // NOLINT(runtime/int)
+#if defined(__ADX__)
+    *carry = _addcarryx_u64(*carry, lhs, rhs, &sum);
+#else
+    *carry = _addcarry_u64(*carry, lhs, rhs, &sum);
+#endif
+    return sum;
+#else
+    const uint64_t partial = lhs + *carry;
+    const uint64_t sum = partial + rhs;
+    *carry = static_cast<unsigned char>((partial < lhs) | (sum < partial));
+    return sum;
+#endif
+  }
+  // Provides lhs - rhs - *borrow, storing the borrow out in borrow.
+  static NX_FORCEINLINE uint64_t Subtract(
+      uint64_t lhs, uint64_t rhs, unsigned char* borrow) {
+#if defined(NX_SIMD_X86) && defined(NX_ARCH_X86_64)
+    unsigned long long difference;  // NOLINT(runtime/int)
+    *borrow = _subborrow_u64(*borrow, lhs, rhs, &difference);
+    return difference;
+#else
+    const uint64_t partial = lhs - rhs;
+    const uint64_t difference = partial - *borrow;
+    *borrow = static_cast<unsigned char>(
+        (lhs < rhs) | (partial < difference));
+    return difference;
+#endif
+  }
+  // Provides the low half of lhs * rhs, storing the high half in high.
+  // Montgomery and Fixed take their wide products from here as well.
+  static NX_FORCEINLINE uint64_t Multiply(
+      uint64_t lhs, uint64_t rhs, uint64_t* high) {
+#if defined(NX_SIMD_X86) && defined(NX_ARCH_X86_64) && \
+    (defined(__BMI2__) || (defined(NX_TC_VS) && defined(__AVX2__)))
+    unsigned long long upper;  // NOLINT(runtime/int)
+    const uint64_t low = _mulx_u64(lhs, rhs, &upper);
+    *high = upper;
+    return low;
+#elif defined(__SIZEOF_INT128__)
+    const uint128_t product =
+        static_cast<uint128_t>(lhs) * rhs;
+    *high = static_cast<uint64_t>(product >> 64u);
+    return static_cast<uint64_t>(product);
+#elif defined(NX_TC_VS) && defined(NX_ARCH_X86_64)
+    return _umul128(lhs, rhs, high);
+#else
+    // schoolbook multiplication of 32-bit halves
+    const uint64_t low_mask = Bits<uint64_t>::LowMask<32>();
+    const uint64_t low_low = (lhs & low_mask) * (rhs & low_mask);
+    const uint64_t high_low = (lhs >> 32u) * (rhs & low_mask);
+    const uint64_t low_high = (lhs & low_mask) * (rhs >> 32u);
+    const uint64_t middle = (low_low >> 32u) + (high_low & low_mask) +
+        (low_high & low_mask);
+    *high = (lhs >> 32u) * (rhs >> 32u) + (high_low >> 32u) +
+        (low_high >> 32u) + (middle >> 32u);
+    return (middle << 32u) | (low_low & low_mask);
+#endif
+  }
+
+ private:
+  NX_UNINSTANTIABLE(MultiwordWord);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief An integer of kWords 64-bit words, least significant first, signed
+/// in two's complement if kSigned.
+///
+/// Arithmetic wraps modulo 2^(64 * kWords), as for builtin unsigned types;
+/// multiplication keeps the low kWords words of the product.  Shifts by the
+/// full width or more produce zero, or all ones for a negative value shifted
+/// right.  Division works a bit at a time, so it is far slower than
+/// multiplication.  Builtin integers convert implicitly, with sign extension
+/// if signed, and conversions back truncate.
+template <unsigned int kWords, bool kSigned>
+class Multiword {
+  static_assert(kWords >= 1u, "A multiword integer needs at least one word.");
+
+ public:
+  /// @brief Leaves the value uninitialized, as for builtin integers;
+  /// value-initialization provides zero.
+  Multiword() = default;
+  /// @brief Converts a builtin integer, extending its sign if it is signed.
+  template <typename T, typename = EnableIf<IsIntegral<T>>>
+  Multiword(T value) {  // NOLINT(runtime/explicit)
+    const uint64_t fill = (IsSigned<T>::value && value < 0 ?
+        ~static_cast<uint64_t>(0) : 0u);
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] = (i * 64u < Bits<T>::Size() ?
+          static_cast<uint64_t>(value >> (i * 64u)) : fill);
+    }
+  }
+
+  /// @brief Provides the low bits of the value as a builtin integer.
+  template <typename T, typename = EnableIf<IsIntegral<T>>>
+  explicit operator T() const {
+    typedef MakeUnsigned<T> unsigned_type;
+    unsigned_type value = 0;
+    for (unsigned int i = 0; i < kWords && i * 64u < Bits<T>::Size(); ++i) {
+      value = static_cast<unsigned_type>(value |
+          (static_cast<unsigned_type>(words_[i]) << (i * 64u)));
+    }
+    return static_cast<T>(value);
+  }
+  /// @brief Determines if the value is nonzero.
+  explicit operator bool() const {
+    uint64_t any = 0;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      any |= words_[i];
+    }
+    return any != 0;
+  }
+
+  /// @brief The words of the value, least significant first.
+  NX_FORCEINLINE const uint64_t* words() const {
+    return words_;
+  }
+  /// @brief The words of the value, least significant first.
+  NX_FORCEINLINE uint64_t* words() {
+    return words_;
+  }
+
+  Multiword& operator+=(const Multiword& rhs) {
+    unsigned char carry = 0;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] = detail::MultiwordWord::Add(words_[i], rhs.words_[i], &carry);
+    }
+    return *this;
+  }
+  Multiword& operator-=(const Multiword& rhs) {
+    unsigned char borrow = 0;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] = detail::MultiwordWord::Subtract(
+          words_[i], rhs.words_[i], &borrow);
+    }
+    return *this;
+  }
+  Multiword& operator*=(const Multiword& rhs) {
+    *this = *this * rhs;
+    return *this;
+  }
+  Multiword& operator/=(const Multiword& rhs) {
+    *this = *this / rhs;
+    return *this;
+  }
+  Multiword& operator%=(const Multiword& rhs) {
+    *this = *this % rhs;
+    return *this;
+  }
+  Multiword& operator&=(const Multiword& rhs) {
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] &= rhs.words_[i];
+    }
+    return *this;
+  }
+  Multiword& operator|=(const Multiword& rhs) {
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] |= rhs.words_[i];
+    }
+    return *this;
+  }
+  Multiword& operator^=(const Multiword& rhs) {
+    for (unsigned int i = 0; i < kWords; ++i) {
+      words_[i] ^= rhs.words_[i];
+    }
+    return *this;
+  }
+  Multiword& operator<<=(unsigned int shift) {
+    *this = *this << shift;
+    return *this;
+  }
+  Multiword& operator>>=(unsigned int shift) {
+    *this = *this >> shift;
+    return *this;
+  }
+  Multiword& operator++() {
+    return *this += Multiword(1);
+  }
+  Multiword& operator--() {
+    return *this -= Multiword(1);
+  }
+  Multiword operator++(int) {
+    const Multiword value = *this;
+    ++*this;
+    return value;
+  }
+  Multiword operator--(int) {
+    const Multiword value = *this;
+    --*this;
+    return value;
+  }
+
+  friend Multiword operator+(Multiword lhs, const Multiword& rhs) {
+    return lhs += rhs;
+  }
+  friend Multiword operator-(Multiword lhs, const Multiword& rhs) {
+    return lhs -= rhs;
+  }
+  /// @brief The low kWords words of the product, by schoolbook
+  /// multiplication that skips the partial products above them.
+  friend Multiword operator*(const Multiword& lhs, const Multiword& rhs) {
+    Multiword product = Multiword();
+    for (unsigned int i = 0; i < kWords; ++i) {
+      uint64_t carry = 0;
+      for (unsigned int j = 0; i + j < kWords; ++j) {
+        uint64_t high;
+        const uint64_t low = detail::MultiwordWord::Multiply(
+            lhs.words_[i], rhs.words_[j], &high);
+        // high cannot overflow; the product is at most (2^64 - 1)^2
+        unsigned char overflow = 0;
+        uint64_t sum = detail::MultiwordWord::Add(
+            low, product.words_[i + j], &overflow);
+        high += overflow;
+        overflow = 0;
+        sum = detail::MultiwordWord::Add(sum, carry, &overflow);
+        high += overflow;
+        product.words_[i + j] = sum;
+        carry = high;
+      }
+    }
+    return product;
+  }
+  /// @brief Rounds toward zero, as for builtin integers; rhs must not be
+  /// zero.
+  friend Multiword operator/(const Multiword& lhs, const Multiword& rhs) {
+    Multiword remainder;
+    return Divide(lhs, rhs, &remainder);
+  }
+  /// @brief The remainder of lhs / rhs, which has the sign of lhs.
+  friend Multiword operator%(const Multiword& lhs, const Multiword& rhs) {
+    Multiword remainder;
+    Divide(lhs, rhs, &remainder);
+    return remainder;
+  }
+  friend Multiword operator&(Multiword lhs, const Multiword& rhs) {
+    return lhs &= rhs;
+  }
+  friend Multiword operator|(Multiword lhs, const Multiword& rhs) {
+    return lhs |= rhs;
+  }
+  friend Multiword operator^(Multiword lhs, const Multiword& rhs) {
+    return lhs ^= rhs;
+  }
+  friend Multiword operator~(Multiword value) {
+    for (unsigned int i = 0; i < kWords; ++i) {
+      value.words_[i] = ~value.words_[i];
+    }
+    return value;
+  }
+  friend Multiword operator-(const Multiword& value) {
+    return Multiword(0) - value;
+  }
+  friend Multiword operator<<(const Multiword& value, unsigned int shift) {
+    const unsigned int words = shift / 64u;
+    const unsigned int bits = shift % 64u;
+    Multiword result;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      uint64_t word = 0;
+      if (i >= words) {
+        word = value.words_[i - words] << bits;
+        if (bits && i > words) {
+          word |= value.words_[i - words - 1u] >> (64u - bits);
+        }
+      }
+      result.words_[i] = word;
+    }
+    return result;
+  }
+  /// @brief Shifts right, arithmetically if signed.
+  friend Multiword operator>>(const Multiword& value, unsigned int shift) {
+    const unsigned int words = shift / 64u;
+    const unsigned int bits = shift % 64u;
+    const uint64_t fill = (value.negative() ? ~static_cast<uint64_t>(0) : 0u);
+    Multiword result;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      // shift is unsigned, so i + words only wraps for absurd shifts, which
+      // are limited to the width
+      const unsigned int source = (words < kWords ? i + words : kWords);
+      const uint64_t word = (source < kWords ? value.words_[source] : fill);
+      const uint64_t next = (source + 1u < kWords ?
+          value.words_[source + 1u] : fill);
+      result.words_[i] = (bits ?
+          (word >> bits) | (next << (64u - bits)) : word);
+    }
+    return result;
+  }
+
+  friend bool operator==(const Multiword& lhs, const Multiword& rhs) {
+    uint64_t difference = 0;
+    for (unsigned int i = 0; i < kWords; ++i) {
+      difference |= lhs.words_[i] ^ rhs.words_[i];
+    }
+    return !difference;
+  }
+  friend bool operator!=(const Multiword& lhs, const Multiword& rhs) {
+    return !(lhs == rhs);
+  }
+  /// @brief Compares as signed if signed; the borrow out of lhs - rhs, with
+  /// the top words' sign bits flipped.
+  friend bool operator<(const Multiword& lhs, const Multiword& rhs) {
+    return Less(lhs, rhs, kSigned);
+  }
+  friend bool operator>(const Multiword& lhs, const Multiword& rhs) {
+    return rhs < lhs;
+  }
+  friend bool operator<=(const Multiword& lhs, const Multiword& rhs) {
+    return !(rhs < lhs);
+  }
+  friend bool operator>=(const Multiword& lhs, const Multiword& rhs) {
+    return !(lhs < rhs);
+  }
+
+ private:
+  NX_FORCEINLINE bool negative() const {
+    return kSigned && (words_[kWords - 1u] >> 63u) != 0;
+  }
+  static bool Less(const Multiword& lhs, const Multiword& rhs, bool sign) {
+    const uint64_t flip = (sign ? static_cast<uint64_t>(1) << 63u : 0u);
+    unsigned char borrow = 0;
+    for (unsigned int i = 0; i + 1u < kWords; ++i) {
+      detail::MultiwordWord::Subtract(lhs.words_[i], rhs.words_[i], &borrow);
+    }
+    detail::MultiwordWord::Subtract(lhs.words_[kWords - 1u] ^ flip,
+        rhs.words_[kWords - 1u] ^ flip, &borrow);
+    return borrow != 0;
+  }
+  // Long division of the magnitudes, a bit at a time, then signed to match
+  // builtin division.
+  static Multiword Divide(const Multiword& lhs, const Multiword& rhs,
+      Multiword* remainder) {
+    const Multiword dividend = (lhs.negative() ? -lhs : lhs);
+    const Multiword divisor = (rhs.negative() ? -rhs : rhs);
+    Multiword quotient = Multiword();
+    Multiword rest = Multiword();
+    for (unsigned int i = kWords * 64u; i-- > 0u; ) {
+      // rest is below divisor, but doubling it may carry out of the top
+      const bool carry = (rest.words_[kWords - 1u] >> 63u) != 0;
+      rest = rest << 1u;
+      rest.words_[0] |= (dividend.words_[i / 64u] >> (i % 64u)) & 1u;
+      if (carry || !Less(rest, divisor, false)) {
+        rest -= divisor;
+        quotient.words_[i / 64u] |= static_cast<uint64_t>(1) << (i % 64u);
+      }
+    }
+    *remainder = (lhs.negative() ? -rest : rest);
+    return (lhs.negative() != rhs.negative() ? -quotient : quotient);
+  }
+
+  uint64_t words_[kWords];
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_MULTIWORD_H_
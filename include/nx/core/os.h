@@ -51,6 +51,30 @@
   #define NX_TARGET_OTHER 1
 #endif
 
+// Architecture detection
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+  /// @brief Defined if build target is an x86 processor
+  #define NX_ARCH_X86 1
+  /// @brief Defined if build target is a 64-bit x86 processor
+  #define NX_ARCH_X86_64 1
+#elif defined(__i386__) || defined(_M_IX86)
+  /// @brief Defined if build target is an x86 processor
+  #define NX_ARCH_X86 1
+#endif
+
+// Byte order detection
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  /// @brief Defined if build target stores the most significant byte first
+  #define NX_BIG_ENDIAN 1
+#elif (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || \
+    defined(NX_ARCH_X86) || defined(NX_TARGET_WINDOWS) || \
+    defined(NX_TARGET_AVR)
+  /// @brief Defined if build target stores the least significant byte first
+  #define NX_LITTLE_ENDIAN 1
+#endif
+
 // Toolchain detection
 #if defined(__clang__)
   /// @brief Set if the toolchain in use is Clang
@@ -128,6 +152,13 @@
     /// is NOT IMPLEMENTED on this platform.
     #define NX_DEPRECATED(decl, msg) decl
   #endif
+  /// @brief Marks a function built upon compiler intrinsics as constexpr, if
+  /// the toolchain is able to evaluate those intrinsics at compile time.
+  #define NX_INTRINSIC_CONSTEXPR constexpr
+  /// @brief Compiles a function for the specified instruction set extensions
+  /// (e.g. "avx2"), regardless of the flags used for the rest of the build.
+  /// Callers must ensure the processor supports them before calling.
+  #define NX_FUNCTION_TARGET(isa) __attribute__((target(isa)))
 #else
   /// @brief Makes a best-effort to force the compiler to inline a function.
   #define NX_FORCEINLINE inline
@@ -146,6 +177,23 @@
     /// is NOT IMPLEMENTED on this platform.
     #define NX_DEPRECATED(decl, msg) decl
   #endif
+
+  #if defined(NX_TC_VS)
+    /// @brief Marks a function built upon compiler intrinsics as constexpr, if
+    /// the toolchain is able to evaluate those intrinsics at compile time.
+    /// Visual Studio intrinsics are not usable in constant expressions.
+    #define NX_INTRINSIC_CONSTEXPR
+  #else
+    /// @brief Marks a function built upon compiler intrinsics as constexpr, if
+    /// the toolchain is able to evaluate those intrinsics at compile time.
+    /// Unknown toolchains use portable fallbacks, which are constexpr.
+    #define NX_INTRINSIC_CONSTEXPR constexpr
+  #endif
+  /// @brief Compiles a function for the specified instruction set extensions
+  /// (e.g. "avx2"), regardless of the flags used for the rest of the build.
+  /// Toolchains without such an attribute (e.g. Visual Studio) permit any
+  /// intrinsic in any function, so this expands to nothing.
+  #define NX_FUNCTION_TARGET(isa)
 #endif
 
 // OS initialization/ensuring important system defines are set
@@ -0,0 +1,235 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file packed_int_array.h
+/// @brief An array of unsigned integers of an arbitrary fixed bit width,
+/// stored back-to-back without padding.
+
+#ifndef INCLUDE_NX_CORE_PACKED_INT_ARRAY_H_
+#define INCLUDE_NX_CORE_PACKED_INT_ARRAY_H_
+
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+// The unpacking kernels of PackedIntArray<kBits>, for each instruction set.
+template <unsigned int kBits>
+class PackedIntArrayKernels {
+ public:
+  typedef uint_least_t<kBits> value_type;
+
+  // Trailing words, so that a value may always be read as spanning two
+  // words, and so the SIMD kernel may load 36 bytes from any value's dword.
+  enum { kPaddingWords = 5 };
+
+  static NX_FORCEINLINE constexpr uint64_t Mask() {
+    return (kBits == 64u ?
+        ~static_cast<uint64_t>(0) :
+        Bits<uint64_t>::LowMask<kBits>());
+  }
+  static NX_FORCEINLINE value_type Get(const uint64_t* words, size_t index) {
+    const uint64_t bit = static_cast<uint64_t>(index) * kBits;
+    const uint64_t* word = words + static_cast<size_t>(bit / 64u);
+    const unsigned int offset = static_cast<unsigned int>(bit % 64u);
+    // split shift; the next word contributes nothing when offset is 0
+    return static_cast<value_type>(((word[0] >> offset) |
+        ((word[1] << 1u) << (63u - offset))) & Mask());
+  }
+  static void UnpackScalar(
+      const uint64_t* words, size_t first, size_t count, value_type* values) {
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = Get(words, first + i);
+    }
+  }
+#if defined(NX_SIMD_X86)
+  // For values of 17 to 32 bits, held in 32-bit lanes.  Eight values per
+  // step; each lane gathers the dword its value starts in and the one after
+  // it, then shifts the two together.
+  NX_FUNCTION_TARGET("avx2")
+  static void UnpackAvx2(
+      const uint64_t* words, size_t first, size_t count, value_type* values) {
+    const char* bytes = reinterpret_cast<const char*>(words);
+    const __m256i lanes = _mm256_setr_epi32(0, kBits, 2 * kBits, 3 * kBits,
+        4 * kBits, 5 * kBits, 6 * kBits, 7 * kBits);
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>(Mask()));
+    const __m256i low_five = _mm256_set1_epi32(31);
+    const __m256i thirty_two = _mm256_set1_epi32(32);
+    size_t i = 0;
+    for (; i + 8u <= count; i += 8u) {
+      const uint64_t bit = static_cast<uint64_t>(first + i) * kBits;
+      const char* dword = bytes + static_cast<size_t>(bit / 32u) * 4u;
+      const __m256i starts = _mm256_add_epi32(lanes,
+          _mm256_set1_epi32(static_cast<int>(bit % 32u)));
+      const __m256i index = _mm256_srli_epi32(starts, 5);
+      const __m256i shift = _mm256_and_si256(starts, low_five);
+      const __m256i low = _mm256_srlv_epi32(_mm256_permutevar8x32_epi32(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dword)),
+          index), shift);
+      // shifting left by 32 produces zero, as desired when shift is 0
+      const __m256i high = _mm256_sllv_epi32(_mm256_permutevar8x32_epi32(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dword + 4)),
+          index), _mm256_sub_epi32(thirty_two, shift));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i),
+          _mm256_and_si256(_mm256_or_si256(low, high), mask));
+    }
+    UnpackScalar(words, first + i, count - i, values + i);
+  }
+#endif
+
+ private:
+  NX_UNINSTANTIABLE(PackedIntArrayKernels);
+};
+
+}  // namespace detail
+/// @endcond
+
+/// @brief Stores values of exactly kBits bits back-to-back in 64-bit words, so
+/// that values may span two words.  Values are provided as the smallest
+/// unsigned type able to hold them.
+template <unsigned int kBits>
+class PackedIntArray {
+  static_assert(kBits >= 1u && kBits <= 64u,
+      "PackedIntArray values must be between 1 and 64 bits wide.");
+
+ public:
+  /// @brief The type through which values are read and written.
+  typedef uint_least_t<kBits> value_type;
+
+  /// @brief Constructs an array of size zero-valued elements.
+  explicit PackedIntArray(size_t size = 0)
+      : size_(0) {
+    resize(size);
+  }
+
+  /// @brief The mask of the bits making up a value.
+  static NX_FORCEINLINE constexpr uint64_t Mask() {
+    return Detail::Mask();
+  }
+  /// @brief The number of elements.
+  NX_FORCEINLINE size_t size() const {
+    return size_;
+  }
+  /// @brief The words in which values are stored.
+  NX_FORCEINLINE const uint64_t* data() const {
+    return words_.data();
+  }
+
+  /// @brief Changes the number of elements; any new elements are zero.
+  void resize(size_t size) {
+    const uint64_t bits = static_cast<uint64_t>(size) * kBits;
+    const size_t used = static_cast<size_t>(bits / 64u);
+    words_.resize(used + 1u + kPaddingWords, 0);
+    // clear anything left behind by previously larger sizes
+    Bits<uint64_t>::clear(~Bits<uint64_t>::LowMask(
+        static_cast<unsigned int>(bits % 64u)), &words_[used]);
+    for (size_t i = used + 1u; i < words_.size(); ++i) {
+      words_[i] = 0;
+    }
+    size_ = size;
+  }
+
+  /// @brief Provides the value at index.
+  NX_FORCEINLINE value_type get(size_t index) const {
+    return Detail::Get(words_.data(), index);
+  }
+  /// @brief Replaces the value at index with the low kBits bits of value.
+  NX_FORCEINLINE void set(size_t index, value_type value) {
+    const uint64_t bit = static_cast<uint64_t>(index) * kBits;
+    uint64_t* word = &words_[static_cast<size_t>(bit / 64u)];
+    const unsigned int offset = static_cast<unsigned int>(bit % 64u);
+    const uint64_t masked = static_cast<uint64_t>(value) & Mask();
+    Bits<uint64_t>::assign(Mask() << offset, masked << offset, word);
+    // the portion spilling into the next word; empty if nothing spills, in
+    // which case the padding guarantees the word exists and is unchanged.
+    Bits<uint64_t>::assign(
+        (Mask() >> 1u) >> (63u - offset),
+        (masked >> 1u) >> (63u - offset),
+        word + 1);
+  }
+
+  /// @brief Reads count values starting at first into values, using SIMD
+  /// where the processor supports it (for values of 17 to 32 bits).
+  void Unpack(size_t first, size_t count, value_type* values) const {
+    static const UnpackKernel kernel = SelectUnpack();
+    kernel(words_.data(), first, count, values);
+  }
+  /// @brief Writes count values to the elements starting at first.  Whole
+  /// words are assembled in a 64-bit accumulator and stored once each.
+  void Pack(size_t first, size_t count, const value_type* values) {
+    if (!count) {
+      return;
+    }
+    const uint64_t bit = static_cast<uint64_t>(first) * kBits;
+    uint64_t* word = &words_[static_cast<size_t>(bit / 64u)];
+    unsigned int fill = static_cast<unsigned int>(bit % 64u);
+    uint64_t accumulator = Bits<uint64_t>::get(
+        Bits<uint64_t>::LowMask(fill), word);
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t value = static_cast<uint64_t>(values[i]) & Mask();
+      accumulator |= value << fill;
+      fill += kBits;
+      if (fill >= 64u) {
+        *word++ = accumulator;
+        fill -= 64u;
+        accumulator = (fill ? value >> (kBits - fill) : 0);
+      }
+    }
+    if (fill) {
+      Bits<uint64_t>::assign(Bits<uint64_t>::LowMask(fill), accumulator,
+          word);
+    }
+  }
+
+ private:
+  typedef Function<void, const uint64_t*, size_t, size_t, value_type*>
+      UnpackKernel;
+
+  typedef detail::PackedIntArrayKernels<kBits> Detail;
+
+  enum { kPaddingWords = Detail::kPaddingWords };
+
+  template <typename V = value_type>
+  static EnableIf<Bool<sizeof(V) == 4u && kBits <= 32u>,
+      UnpackKernel> SelectUnpack() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &Detail::UnpackAvx2;
+    }
+#endif
+    return &Detail::UnpackScalar;
+  }
+  template <typename V = value_type>
+  static DisableIf<Bool<sizeof(V) == 4u && kBits <= 32u>,
+      UnpackKernel> SelectUnpack() {
+    return &Detail::UnpackScalar;
+  }
+
+  std::vector<uint64_t> words_;
+  size_t size_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_PACKED_INT_ARRAY_H_
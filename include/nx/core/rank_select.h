@@ -0,0 +1,230 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file rank_select.h
+/// @brief A succinct index answering rank and select queries over an array of
+/// 64-bit words.
+
+#ifndef INCLUDE_NX_CORE_RANK_SELECT_H_
+#define INCLUDE_NX_CORE_RANK_SELECT_H_
+
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief An index over a bit array that answers rank (the number of set bits
+/// before a position) in constant time, and select (the position of the n-th
+/// set bit) in near-constant time.
+///
+/// The bits are not copied; the array must outlive the index and must not be
+/// modified while it is in use.  Every 2048 bits share a single 64-bit entry
+/// holding a cumulative count and the counts of three of its four 512-bit
+/// sub-blocks, for an overhead of about 3%.  The cumulative counts are
+/// relative to an absolute count stored every 2^32 bits.  Additionally, the
+/// block holding every 8192nd set bit is sampled to narrow select's search.
+class RankSelect {
+ public:
+  /// @brief Constructs an index over the first size bits of words.
+  RankSelect(const uint64_t* words, size_t size)
+      : words_(words),
+        size_(size),
+        count_(0) {
+    Build();
+  }
+
+  /// @brief The number of bits indexed.
+  NX_FORCEINLINE size_t size() const {
+    return size_;
+  }
+  /// @brief The number of set bits.
+  NX_FORCEINLINE uint64_t Count() const {
+    return count_;
+  }
+
+  /// @brief Provides the number of set bits preceding index, which must not
+  /// exceed size().
+  uint64_t Rank(size_t index) const {
+    const size_t block = index / kBlockBits;
+    const uint64_t entry = directory_[block];
+    uint64_t rank = BlockRank(block, entry);
+    const unsigned int sub_block = static_cast<unsigned int>(
+        (index % kBlockBits) / kSubBlockBits);
+    for (unsigned int i = 0; i < sub_block; ++i) {
+      rank += SubBlockCount(entry, i);
+    }
+    const size_t last = index / kWordBits;
+    for (size_t word = (block * kBlockBits + sub_block * kSubBlockBits) /
+        kWordBits; word < last; ++word) {
+      rank += Bits<uint64_t>::PopCount(words_[word]);
+    }
+    if (index % kWordBits) {
+      rank += Bits<uint64_t>::PopCount(words_[last] &
+          Bits<uint64_t>::LowMask(static_cast<unsigned int>(
+              index % kWordBits)));
+    }
+    return rank;
+  }
+
+  /// @brief Provides the position of the set bit preceded by rank other set
+  /// bits, or size() if fewer than rank + 1 bits are set.
+  size_t Select(uint64_t rank) const {
+    if (rank >= count_) {
+      return size_;
+    }
+    // the sampled blocks bound the search
+    const size_t sample = static_cast<size_t>(rank / kSelectSample);
+    size_t low = samples_[sample];
+    size_t high = (sample + 1 < samples_.size() ?
+        samples_[sample + 1] : directory_.size() - 1);
+    // find the last block whose cumulative count does not exceed rank
+    while (low < high) {
+      const size_t middle = low + (high - low + 1) / 2;
+      if (BlockRank(middle, directory_[middle]) <= rank) {
+        low = middle;
+      } else {
+        high = middle - 1;
+      }
+    }
+    const uint64_t entry = directory_[low];
+    rank -= BlockRank(low, entry);
+    unsigned int sub_block = 0;
+    for (; sub_block < kSubBlocks - 1; ++sub_block) {
+      const unsigned int count = SubBlockCount(entry, sub_block);
+      if (rank < count) {
+        break;
+      }
+      rank -= count;
+    }
+    size_t word = (low * kBlockBits + sub_block * kSubBlockBits) / kWordBits;
+    for (;; ++word) {
+      const unsigned int count = Bits<uint64_t>::PopCount(words_[word]);
+      if (rank < count) {
+        break;
+      }
+      rank -= count;
+    }
+    return word * kWordBits + SelectInWord(
+        words_[word], static_cast<unsigned int>(rank));
+  }
+
+ private:
+  enum {
+    kWordBits = 64,
+    kSubBlockBits = 512,
+    kSubBlocks = 4,
+    kBlockBits = kSubBlockBits * kSubBlocks,
+    kSubBlockCountBits = 10,
+    kSelectSample = 8192
+  };
+
+  // Provides the position of the set bit in value preceded by rank others.
+  static NX_FORCEINLINE unsigned int SelectInWord(
+      uint64_t value, unsigned int rank) {
+#if defined(__BMI2__)
+    // deposit a single bit into the rank-th set position
+    return Bits<uint64_t>::ScanForward(
+        Bits<uint64_t>::Deposit(static_cast<uint64_t>(1) << rank, value));
+#else
+    // Broadword: per-byte counts, then their inclusive prefix sums.
+    const uint64_t kOnes = ~static_cast<uint64_t>(0) / 255u;
+    const uint64_t kHighs = kOnes << 7u;
+    uint64_t sums = value - ((value >> 1u) & (kOnes * 0x55u));
+    sums = (sums & (kOnes * 0x33u)) + ((sums >> 2u) & (kOnes * 0x33u));
+    sums = ((sums + (sums >> 4u)) & (kOnes * 0x0fu)) * kOnes;
+    // the number of bytes whose prefix sum is at most rank is the byte
+    // holding the bit; no byte borrows as both operands are below 128.
+    const unsigned int byte = Bits<uint64_t>::PopCount(
+        ((kOnes * rank | kHighs) - sums) & kHighs);
+    const unsigned int shift = byte * 8u;
+    rank -= static_cast<unsigned int>(((sums << 8u) >> shift) & 0xffu);
+    unsigned int bits = static_cast<unsigned int>((value >> shift) & 0xffu);
+    for (; rank; --rank) {
+      // clear the lowest set bit
+      bits &= bits - 1u;
+    }
+    return shift + Bits<unsigned int>::ScanForward(bits);
+#endif
+  }
+  static NX_FORCEINLINE unsigned int SubBlockCount(
+      uint64_t entry, unsigned int sub_block) {
+    return static_cast<unsigned int>(
+        (entry >> (32u + kSubBlockCountBits * sub_block)) &
+        Bits<uint64_t>::LowMask<kSubBlockCountBits>());
+  }
+  NX_FORCEINLINE uint64_t BlockRank(size_t block, uint64_t entry) const {
+    return upper_[static_cast<uint64_t>(block) * kBlockBits >> 32u] +
+        (entry & Bits<uint64_t>::LowMask<32>());
+  }
+  // Provides a word with any bits beyond size() cleared.
+  NX_FORCEINLINE uint64_t MaskedWord(size_t word) const {
+    const size_t remaining = size_ - word * kWordBits;
+    return (remaining >= static_cast<size_t>(kWordBits) ?
+        words_[word] :
+        words_[word] & Bits<uint64_t>::LowMask(
+            static_cast<unsigned int>(remaining)));
+  }
+  void Build() {
+    // one entry past the final full block, so that Rank(size()) is valid
+    const size_t blocks = size_ / kBlockBits + 1;
+    const size_t words = (size_ + (kWordBits - 1)) / kWordBits;
+    directory_.reserve(blocks);
+    uint64_t next_sample = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+      if (((static_cast<uint64_t>(block) * kBlockBits) &
+          Bits<uint64_t>::LowMask<32>()) == 0) {
+        upper_.push_back(count_);
+      }
+      uint64_t entry = count_ - upper_.back();
+      for (unsigned int sub_block = 0; sub_block < kSubBlocks; ++sub_block) {
+        unsigned int count = 0;
+        const size_t begin = (block * kBlockBits + sub_block * kSubBlockBits) /
+            kWordBits;
+        for (size_t word = begin;
+            word < begin + kSubBlockBits / kWordBits && word < words; ++word) {
+          count += Bits<uint64_t>::PopCount(MaskedWord(word));
+        }
+        if (sub_block < kSubBlocks - 1) {
+          entry |= static_cast<uint64_t>(count) <<
+              (32u + kSubBlockCountBits * sub_block);
+        }
+        count_ += count;
+      }
+      directory_.push_back(entry);
+      for (; next_sample < count_; next_sample += kSelectSample) {
+        samples_.push_back(block);
+      }
+    }
+  }
+
+  const uint64_t* words_;
+  size_t size_;
+  uint64_t count_;
+  // absolute counts preceding every 2^32 bits
+  std::vector<uint64_t> upper_;
+  // per block; a 32-bit count relative to upper_, then sub-block counts
+  std::vector<uint64_t> directory_;
+  // the block holding every kSelectSample-th set bit
+  std::vector<size_t> samples_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_RANK_SELECT_H_
@@ -0,0 +1,958 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file roaring_bitmap.h
+/// @brief A compressed set of 32-bit integers, in the manner of Roaring
+/// bitmaps, that stays compact whether sparse or dense.
+
+#ifndef INCLUDE_NX_CORE_ROARING_BITMAP_H_
+#define INCLUDE_NX_CORE_ROARING_BITMAP_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/bit_span.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief A set of 32-bit integers, split by their high 16 bits into chunks
+/// of 2^16 values.  Each chunk is stored as whichever is appropriate of a
+/// sorted array of its low 16 bits, a 1024-word bitmap, or a list of runs.
+///
+/// Chunks hold arrays while they have at most 4096 values, and bitmaps
+/// otherwise.  Runs are only introduced by Optimize(), which picks the
+/// smallest of the three for each chunk; a run chunk is converted back
+/// before being modified or combined, but is counted against other chunks as
+/// it is.  Bitmap chunks are combined and counted in one pass with BitSpan.
+/// Array chunks are intersected, counted and subtracted with SSSE3, and
+/// merged with SSE4.1, when the processor supports it.
+class RoaringBitmap {
+ public:
+  /// @brief Constructs an empty set.
+  RoaringBitmap() : count_(0) {
+  }
+
+  /// @brief The number of values in the set.
+  NX_FORCEINLINE uint64_t Count() const {
+    return count_;
+  }
+  /// @brief Determines if the set contains no values.
+  NX_FORCEINLINE bool empty() const {
+    return count_ == 0;
+  }
+  /// @brief Determines if value is in the set.
+  bool Contains(uint32_t value) const {
+    const size_t chunk = Find(High(value));
+    return (chunk != keys_.size() && ChunkContains(chunks_[chunk],
+        Low(value)));
+  }
+  /// @brief Adds value to the set.
+  void Add(uint32_t value) {
+    const uint16_t low = Low(value);
+    size_t chunk = Find(High(value));
+    if (chunk == keys_.size()) {
+      chunk = static_cast<size_t>(std::lower_bound(keys_.begin(),
+          keys_.end(), High(value)) - keys_.begin());
+      keys_.insert(keys_.begin() + chunk, High(value));
+      chunks_.insert(chunks_.begin() + chunk, Chunk());
+    } else if (ChunkContains(chunks_[chunk], low)) {
+      // unchanged, so a run chunk need not be expanded
+      return;
+    }
+    Chunk* target = &chunks_[chunk];
+    Expand(target);
+    if (target->kind == kArray) {
+      target->values.insert(std::lower_bound(target->values.begin(),
+          target->values.end(), low), low);
+    } else {
+      Bits<uint64_t>::set(Bit(low), &target->words[low / 64u]);
+    }
+    ++target->count;
+    ++count_;
+    Normalize(target);
+  }
+  /// @brief Removes value from the set.
+  void Remove(uint32_t value) {
+    const uint16_t low = Low(value);
+    const size_t chunk = Find(High(value));
+    // unchanged if absent, so a run chunk need not be expanded
+    if (chunk == keys_.size() || !ChunkContains(chunks_[chunk], low)) {
+      return;
+    }
+    Chunk* target = &chunks_[chunk];
+    Expand(target);
+    if (target->kind == kArray) {
+      target->values.erase(std::lower_bound(target->values.begin(),
+          target->values.end(), low));
+    } else {
+      Bits<uint64_t>::clear(Bit(low), &target->words[low / 64u]);
+    }
+    --target->count;
+    --count_;
+    if (!target->count) {
+      keys_.erase(keys_.begin() + chunk);
+      chunks_.erase(chunks_.begin() + chunk);
+    } else {
+      Normalize(target);
+    }
+  }
+
+  /// @brief Stores each chunk in whichever form is smallest, including runs.
+  void Optimize() {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      Chunk* chunk = &chunks_[i];
+      Expand(chunk);
+      const size_t runs = RunCount(*chunk);
+      const size_t run_bytes = runs * 2u * sizeof(uint16_t);
+      const size_t array_bytes = chunk->count * sizeof(uint16_t);
+      const size_t bitmap_bytes = kChunkWords * sizeof(uint64_t);
+      if (run_bytes < array_bytes && run_bytes < bitmap_bytes) {
+        ToRuns(chunk);
+      }
+    }
+  }
+
+  /// @brief Adds every value in other to the set.
+  RoaringBitmap& operator|=(const RoaringBitmap& other) {
+    RoaringBitmap result;
+    size_t i = 0, j = 0;
+    while (i < keys_.size() || j < other.keys_.size()) {
+      if (j == other.keys_.size() ||
+          (i < keys_.size() && keys_[i] < other.keys_[j])) {
+        result.Append(keys_[i], chunks_[i]);
+        ++i;
+      } else if (i == keys_.size() || other.keys_[j] < keys_[i]) {
+        result.Append(other.keys_[j], other.chunks_[j]);
+        ++j;
+      } else {
+        result.Append(keys_[i], Or(chunks_[i], other.chunks_[j]));
+        ++i;
+        ++j;
+      }
+    }
+    Swap(&result);
+    return *this;
+  }
+  /// @brief Removes every value not in other from the set.
+  RoaringBitmap& operator&=(const RoaringBitmap& other) {
+    RoaringBitmap result;
+    for (size_t i = 0, j = 0; i < keys_.size() && j < other.keys_.size(); ) {
+      if (keys_[i] < other.keys_[j]) {
+        ++i;
+      } else if (other.keys_[j] < keys_[i]) {
+        ++j;
+      } else {
+        result.Append(keys_[i], And(chunks_[i], other.chunks_[j]));
+        ++i;
+        ++j;
+      }
+    }
+    Swap(&result);
+    return *this;
+  }
+  /// @brief Removes every value in other from the set.
+  RoaringBitmap& AndNot(const RoaringBitmap& other) {
+    RoaringBitmap result;
+    for (size_t i = 0, j = 0; i < keys_.size(); ++i) {
+      while (j < other.keys_.size() && other.keys_[j] < keys_[i]) {
+        ++j;
+      }
+      if (j < other.keys_.size() && other.keys_[j] == keys_[i]) {
+        result.Append(keys_[i], AndNot(chunks_[i], other.chunks_[j]));
+      } else {
+        result.Append(keys_[i], chunks_[i]);
+      }
+    }
+    Swap(&result);
+    return *this;
+  }
+  /// @brief Provides the number of values in both the set and other, without
+  /// forming their intersection or expanding run chunks.
+  uint64_t AndCount(const RoaringBitmap& other) const {
+    uint64_t count = 0;
+    for (size_t i = 0, j = 0; i < keys_.size() && j < other.keys_.size(); ) {
+      if (keys_[i] < other.keys_[j]) {
+        ++i;
+      } else if (other.keys_[j] < keys_[i]) {
+        ++j;
+      } else {
+        count += AndCount(chunks_[i], other.chunks_[j]);
+        ++i;
+        ++j;
+      }
+    }
+    return count;
+  }
+
+  /// @brief Calls visitor with each value in the set, in ascending order.
+  template <class Visitor>
+  void ForEach(Visitor visitor) const {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      const uint32_t high = static_cast<uint32_t>(keys_[i]) << 16u;
+      const Chunk& chunk = chunks_[i];
+      if (chunk.kind == kArray) {
+        for (size_t j = 0; j < chunk.values.size(); ++j) {
+          visitor(high | chunk.values[j]);
+        }
+      } else if (chunk.kind == kBitmap) {
+        for (size_t word = 0; word < kChunkWords; ++word) {
+          for (uint64_t bits = chunk.words[word]; bits;
+              bits = Bits<uint64_t>::ClearLowest(bits)) {
+            visitor(high | static_cast<uint32_t>(
+                word * 64u + Bits<uint64_t>::ScanForward(bits)));
+          }
+        }
+      } else {
+        for (size_t j = 0; j < chunk.values.size(); j += 2u) {
+          for (uint32_t value = chunk.values[j];
+              value <= chunk.values[j + 1u]; ++value) {
+            visitor(high | value);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  enum Kind {
+    kArray,
+    kBitmap,
+    kRun
+  };
+  enum {
+    kChunkWords = 1024,
+    // the most values an array chunk holds; beyond this a bitmap is smaller
+    kArrayMax = 4096
+  };
+
+  // One chunk of 2^16 values.  Arrays keep sorted values; runs keep the
+  // first and last value of each run, in pairs; bitmaps keep words.
+  struct Chunk {
+    Chunk() : kind(kArray), count(0) {
+    }
+    Kind kind;
+    uint32_t count;
+    std::vector<uint16_t> values;
+    std::vector<uint64_t> words;
+  };
+  typedef Function<size_t, const uint16_t*, size_t, const uint16_t*, size_t,
+      uint16_t*> ArrayKernel;
+  typedef Function<size_t, const uint16_t*, size_t, const uint16_t*, size_t>
+      ArrayCountKernel;
+
+  static NX_FORCEINLINE uint16_t High(uint32_t value) {
+    return static_cast<uint16_t>(value >> 16u);
+  }
+  static NX_FORCEINLINE uint16_t Low(uint32_t value) {
+    return static_cast<uint16_t>(value);
+  }
+  static NX_FORCEINLINE uint64_t Bit(uint16_t low) {
+    return static_cast<uint64_t>(1) << (low % 64u);
+  }
+  // The index of the chunk with key high, or keys_.size() if there is none.
+  size_t Find(uint16_t high) const {
+    std::vector<uint16_t>::const_iterator position = std::lower_bound(
+        keys_.begin(), keys_.end(), high);
+    return (position != keys_.end() && *position == high ?
+        static_cast<size_t>(position - keys_.begin()) : keys_.size());
+  }
+  static bool ChunkContains(const Chunk& chunk, uint16_t low) {
+    if (chunk.kind == kArray) {
+      return std::binary_search(chunk.values.begin(), chunk.values.end(),
+          low);
+    }
+    if (chunk.kind == kBitmap) {
+      return Bits<uint64_t>::get(Bit(low), &chunk.words[low / 64u]) != 0;
+    }
+    // the last run starting at or before low
+    size_t first = 0, last = chunk.values.size() / 2u;
+    while (first < last) {
+      const size_t middle = first + (last - first) / 2u;
+      if (chunk.values[middle * 2u] <= low) {
+        first = middle + 1u;
+      } else {
+        last = middle;
+      }
+    }
+    return first && low <= chunk.values[first * 2u - 1u];
+  }
+  void Append(uint16_t key, const Chunk& chunk) {
+    if (chunk.count) {
+      keys_.push_back(key);
+      chunks_.push_back(chunk);
+      count_ += chunk.count;
+    }
+  }
+  void Swap(RoaringBitmap* other) {
+    keys_.swap(other->keys_);
+    chunks_.swap(other->chunks_);
+    std::swap(count_, other->count_);
+  }
+
+  // Sets the bits first through last inclusive.
+  static void SetRange(uint64_t* words, uint32_t first, uint32_t last) {
+    const uint32_t first_word = first / 64u, last_word = last / 64u;
+    const uint64_t first_mask = ~static_cast<uint64_t>(0) << (first % 64u);
+    const uint64_t last_mask = ~static_cast<uint64_t>(0) >> (63u - last % 64u);
+    if (first_word == last_word) {
+      Bits<uint64_t>::set(first_mask & last_mask, words + first_word);
+      return;
+    }
+    Bits<uint64_t>::set(first_mask, words + first_word);
+    for (uint32_t word = first_word + 1u; word < last_word; ++word) {
+      words[word] = ~static_cast<uint64_t>(0);
+    }
+    Bits<uint64_t>::set(last_mask, words + last_word);
+  }
+  // The number of set bits first through last inclusive.
+  static uint64_t CountRange(const uint64_t* words, uint32_t first,
+      uint32_t last) {
+    const uint32_t first_word = first / 64u, last_word = last / 64u;
+    const uint64_t first_mask = ~static_cast<uint64_t>(0) << (first % 64u);
+    const uint64_t last_mask = ~static_cast<uint64_t>(0) >> (63u - last % 64u);
+    if (first_word == last_word) {
+      return Bits<uint64_t>::PopCount(words[first_word] & first_mask &
+          last_mask);
+    }
+    return Bits<uint64_t>::PopCount(words[first_word] & first_mask) +
+        BitSpan<uint64_t>::PopCount(words + first_word + 1u,
+            last_word - first_word - 1u) +
+        Bits<uint64_t>::PopCount(words[last_word] & last_mask);
+  }
+  static void ToBitmap(Chunk* chunk) {
+    std::vector<uint64_t> words(kChunkWords, 0);
+    if (chunk->kind == kArray) {
+      for (size_t i = 0; i < chunk->values.size(); ++i) {
+        Bits<uint64_t>::set(Bit(chunk->values[i]),
+            &words[chunk->values[i] / 64u]);
+      }
+    } else {
+      for (size_t i = 0; i < chunk->values.size(); i += 2u) {
+        SetRange(words.data(), chunk->values[i], chunk->values[i + 1u]);
+      }
+    }
+    chunk->kind = kBitmap;
+    chunk->words.swap(words);
+    std::vector<uint16_t>().swap(chunk->values);
+  }
+  static void ToArray(Chunk* chunk) {
+    std::vector<uint16_t> values;
+    values.reserve(chunk->count);
+    if (chunk->kind == kBitmap) {
+      for (size_t word = 0; word < kChunkWords; ++word) {
+        for (uint64_t bits = chunk->words[word]; bits;
+            bits = Bits<uint64_t>::ClearLowest(bits)) {
+          values.push_back(static_cast<uint16_t>(
+              word * 64u + Bits<uint64_t>::ScanForward(bits)));
+        }
+      }
+    } else {
+      for (size_t i = 0; i < chunk->values.size(); i += 2u) {
+        for (uint32_t value = chunk->values[i];
+            value <= chunk->values[i + 1u]; ++value) {
+          values.push_back(static_cast<uint16_t>(value));
+        }
+      }
+    }
+    chunk->kind = kArray;
+    chunk->values.swap(values);
+    std::vector<uint64_t>().swap(chunk->words);
+  }
+  // The number of runs of consecutive values in an array or bitmap chunk.
+  static size_t RunCount(const Chunk& chunk) {
+    size_t runs = 0;
+    if (chunk.kind == kArray) {
+      for (size_t i = 0; i < chunk.values.size(); ++i) {
+        runs += (!i || chunk.values[i] != chunk.values[i - 1u] + 1u);
+      }
+      return runs;
+    }
+    // count the set bits whose lower neighbor is clear
+    uint64_t carry = 0;
+    for (size_t word = 0; word < kChunkWords; ++word) {
+      const uint64_t bits = chunk.words[word];
+      runs += Bits<uint64_t>::PopCount(bits & ~((bits << 1u) | carry));
+      carry = bits >> 63u;
+    }
+    return runs;
+  }
+  static void ToRuns(Chunk* chunk) {
+    std::vector<uint16_t> runs;
+    if (chunk->kind == kArray) {
+      for (size_t i = 0; i < chunk->values.size(); ++i) {
+        if (!i || chunk->values[i] != chunk->values[i - 1u] + 1u) {
+          runs.push_back(chunk->values[i]);
+          runs.push_back(chunk->values[i]);
+        } else {
+          runs.back() = chunk->values[i];
+        }
+      }
+    } else {
+      // alternate between finding the next set and the next clear bit
+      uint32_t position = 0;
+      for (;;) {
+        const uint32_t first = NextBit(chunk->words, position, false);
+        if (first == kChunkWords * 64u) {
+          break;
+        }
+        position = NextBit(chunk->words, first, true);
+        runs.push_back(static_cast<uint16_t>(first));
+        runs.push_back(static_cast<uint16_t>(position - 1u));
+      }
+    }
+    chunk->kind = kRun;
+    chunk->values.swap(runs);
+    std::vector<uint64_t>().swap(chunk->words);
+  }
+  // The position of the first bit at or after position that is set, or if
+  // clear is true, clear; the chunk size if there is none.
+  static uint32_t NextBit(const std::vector<uint64_t>& words,
+      uint32_t position, bool clear) {
+    const uint64_t flip = (clear ? ~static_cast<uint64_t>(0) : 0);
+    uint32_t word = position / 64u;
+    if (word == kChunkWords) {
+      return position;
+    }
+    uint64_t bits = (words[word] ^ flip) &
+        (~static_cast<uint64_t>(0) << (position % 64u));
+    while (!bits) {
+      if (++word == kChunkWords) {
+        return kChunkWords * 64u;
+      }
+      bits = words[word] ^ flip;
+    }
+    return word * 64u + Bits<uint64_t>::ScanForward(bits);
+  }
+  // Converts a run chunk back to an array or bitmap, so it may be modified.
+  static NX_FORCEINLINE void Expand(Chunk* chunk) {
+    if (chunk->kind == kRun) {
+      if (chunk->count > kArrayMax) {
+        ToBitmap(chunk);
+      } else {
+        ToArray(chunk);
+      }
+    }
+  }
+  // Switches between array and bitmap as the count crosses kArrayMax.
+  static NX_FORCEINLINE void Normalize(Chunk* chunk) {
+    if (chunk->kind == kArray && chunk->count > kArrayMax) {
+      ToBitmap(chunk);
+    } else if (chunk->kind == kBitmap && chunk->count <= kArrayMax) {
+      ToArray(chunk);
+    }
+  }
+  // An expanded copy of chunk, if it is of runs.
+  static NX_FORCEINLINE const Chunk& Expanded(
+      const Chunk& chunk, Chunk* storage) {
+    if (chunk.kind != kRun) {
+      return chunk;
+    }
+    *storage = chunk;
+    Expand(storage);
+    return *storage;
+  }
+
+  static Chunk Or(const Chunk& lhs_chunk, const Chunk& rhs_chunk) {
+    Chunk lhs_storage, rhs_storage;
+    const Chunk& lhs = Expanded(lhs_chunk, &lhs_storage);
+    const Chunk& rhs = Expanded(rhs_chunk, &rhs_storage);
+    Chunk result;
+    if (lhs.kind == kArray && rhs.kind == kArray) {
+      result.values.resize(lhs.values.size() + rhs.values.size() +
+          kArraySlack);
+      result.values.resize(Union(lhs.values, rhs.values,
+          result.values.data()));
+      result.count = static_cast<uint32_t>(result.values.size());
+    } else if (lhs.kind == kBitmap && rhs.kind == kBitmap) {
+      result.kind = kBitmap;
+      result.words.resize(kChunkWords);
+      result.count = static_cast<uint32_t>(BitSpan<uint64_t>::OrPopCount(
+          lhs.words.data(), rhs.words.data(), kChunkWords,
+          result.words.data()));
+    } else {
+      const Chunk& bitmap = (lhs.kind == kBitmap ? lhs : rhs);
+      const Chunk& array = (lhs.kind == kBitmap ? rhs : lhs);
+      result = bitmap;
+      for (size_t i = 0; i < array.values.size(); ++i) {
+        uint64_t* word = &result.words[array.values[i] / 64u];
+        result.count += !Bits<uint64_t>::get(Bit(array.values[i]), word);
+        Bits<uint64_t>::set(Bit(array.values[i]), word);
+      }
+    }
+    Normalize(&result);
+    return result;
+  }
+  static Chunk And(const Chunk& lhs_chunk, const Chunk& rhs_chunk) {
+    Chunk lhs_storage, rhs_storage;
+    const Chunk& lhs = Expanded(lhs_chunk, &lhs_storage);
+    const Chunk& rhs = Expanded(rhs_chunk, &rhs_storage);
+    Chunk result;
+    if (lhs.kind == kArray && rhs.kind == kArray) {
+      result.values.resize(std::min(lhs.values.size(), rhs.values.size()) +
+          kArraySlack);
+      result.values.resize(Intersect(lhs.values, rhs.values,
+          result.values.data()));
+      result.count = static_cast<uint32_t>(result.values.size());
+    } else if (lhs.kind == kBitmap && rhs.kind == kBitmap) {
+      result.kind = kBitmap;
+      result.words.resize(kChunkWords);
+      result.count = static_cast<uint32_t>(BitSpan<uint64_t>::AndPopCount(
+          lhs.words.data(), rhs.words.data(), kChunkWords,
+          result.words.data()));
+    } else {
+      const Chunk& bitmap = (lhs.kind == kBitmap ? lhs : rhs);
+      const Chunk& array = (lhs.kind == kBitmap ? rhs : lhs);
+      for (size_t i = 0; i < array.values.size(); ++i) {
+        if (Bits<uint64_t>::get(Bit(array.values[i]),
+            &bitmap.words[array.values[i] / 64u])) {
+          result.values.push_back(array.values[i]);
+        }
+      }
+      result.count = static_cast<uint32_t>(result.values.size());
+    }
+    Normalize(&result);
+    return result;
+  }
+  static Chunk AndNot(const Chunk& lhs_chunk, const Chunk& rhs_chunk) {
+    Chunk lhs_storage, rhs_storage;
+    const Chunk& lhs = Expanded(lhs_chunk, &lhs_storage);
+    const Chunk& rhs = Expanded(rhs_chunk, &rhs_storage);
+    Chunk result;
+    if (lhs.kind == kArray && rhs.kind == kArray) {
+      result.values.resize(lhs.values.size() + kArraySlack);
+      result.values.resize(Difference(lhs.values, rhs.values,
+          result.values.data()));
+      result.count = static_cast<uint32_t>(result.values.size());
+    } else if (lhs.kind == kBitmap && rhs.kind == kBitmap) {
+      result.kind = kBitmap;
+      result.words.resize(kChunkWords);
+      result.count = static_cast<uint32_t>(BitSpan<uint64_t>::AndNotPopCount(
+          lhs.words.data(), rhs.words.data(), kChunkWords,
+          result.words.data()));
+    } else if (lhs.kind == kArray) {
+      for (size_t i = 0; i < lhs.values.size(); ++i) {
+        if (!Bits<uint64_t>::get(Bit(lhs.values[i]),
+            &rhs.words[lhs.values[i] / 64u])) {
+          result.values.push_back(lhs.values[i]);
+        }
+      }
+      result.count = static_cast<uint32_t>(result.values.size());
+    } else {
+      result = lhs;
+      for (size_t i = 0; i < rhs.values.size(); ++i) {
+        uint64_t* word = &result.words[rhs.values[i] / 64u];
+        result.count -= !!Bits<uint64_t>::get(Bit(rhs.values[i]), word);
+        Bits<uint64_t>::clear(Bit(rhs.values[i]), word);
+      }
+    }
+    Normalize(&result);
+    return result;
+  }
+  static uint64_t AndCount(const Chunk& lhs, const Chunk& rhs) {
+    if (lhs.kind == kRun || rhs.kind == kRun) {
+      return RunAndCount((lhs.kind == kRun ? lhs : rhs),
+          (lhs.kind == kRun ? rhs : lhs));
+    }
+    if (lhs.kind == kBitmap && rhs.kind == kBitmap) {
+      return BitSpan<uint64_t>::AndPopCount(lhs.words.data(),
+          rhs.words.data(), kChunkWords);
+    }
+    if (lhs.kind == kArray && rhs.kind == kArray) {
+      return IntersectCount(lhs.values, rhs.values);
+    }
+    const Chunk& bitmap = (lhs.kind == kBitmap ? lhs : rhs);
+    const Chunk& array = (lhs.kind == kBitmap ? rhs : lhs);
+    uint64_t count = 0;
+    for (size_t i = 0; i < array.values.size(); ++i) {
+      count += !!Bits<uint64_t>::get(Bit(array.values[i]),
+          &bitmap.words[array.values[i] / 64u]);
+    }
+    return count;
+  }
+  // The number of values of the run chunk runs also in other, run by run:
+  // overlapping runs, array values within each, or bits set within each.
+  static uint64_t RunAndCount(const Chunk& runs, const Chunk& other) {
+    const std::vector<uint16_t>& bounds = runs.values;
+    uint64_t count = 0;
+    if (other.kind == kRun) {
+      const std::vector<uint16_t>& other_bounds = other.values;
+      for (size_t i = 0, j = 0; i < bounds.size() && j < other_bounds.size();
+          ) {
+        const uint32_t first = std::max(bounds[i], other_bounds[j]);
+        const uint32_t last = std::min(bounds[i + 1u], other_bounds[j + 1u]);
+        if (first <= last) {
+          count += last - first + 1u;
+        }
+        // advance whichever run ends first; both if they end together
+        const uint16_t left_last = bounds[i + 1u];
+        const uint16_t right_last = other_bounds[j + 1u];
+        if (left_last <= right_last) {
+          i += 2u;
+        }
+        if (right_last <= left_last) {
+          j += 2u;
+        }
+      }
+    } else if (other.kind == kArray) {
+      std::vector<uint16_t>::const_iterator position = other.values.begin();
+      for (size_t i = 0; i < bounds.size() &&
+          position != other.values.end(); i += 2u) {
+        const std::vector<uint16_t>::const_iterator first = std::lower_bound(
+            position, other.values.end(), bounds[i]);
+        position = std::upper_bound(first, other.values.end(),
+            bounds[i + 1u]);
+        count += static_cast<uint64_t>(position - first);
+      }
+    } else {
+      for (size_t i = 0; i < bounds.size(); i += 2u) {
+        count += CountRange(other.words.data(), bounds[i], bounds[i + 1u]);
+      }
+    }
+    return count;
+  }
+
+  // Array kernels may write this many values past those they keep.
+  enum { kArraySlack = 8 };
+  // Stores the values in both lhs and rhs to result, providing how many.
+  static NX_FORCEINLINE size_t Intersect(const std::vector<uint16_t>& lhs,
+      const std::vector<uint16_t>& rhs, uint16_t* result) {
+    static const ArrayKernel kernel = SelectIntersect();
+    const std::vector<uint16_t>& small = (lhs.size() <= rhs.size() ? lhs : rhs);
+    const std::vector<uint16_t>& large = (lhs.size() <= rhs.size() ? rhs : lhs);
+    if (small.size() * 64u < large.size()) {
+      // very different sizes; search for each of the few in the many
+      size_t count = 0;
+      for (size_t i = 0; i < small.size(); ++i) {
+        if (std::binary_search(large.begin(), large.end(), small[i])) {
+          result[count++] = small[i];
+        }
+      }
+      return count;
+    }
+    return kernel(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result);
+  }
+  // Provides the number of values in both lhs and rhs.
+  static NX_FORCEINLINE size_t IntersectCount(
+      const std::vector<uint16_t>& lhs, const std::vector<uint16_t>& rhs) {
+    static const ArrayCountKernel kernel = SelectIntersectCount();
+    const std::vector<uint16_t>& small = (lhs.size() <= rhs.size() ? lhs : rhs);
+    const std::vector<uint16_t>& large = (lhs.size() <= rhs.size() ? rhs : lhs);
+    if (small.size() * 64u < large.size()) {
+      size_t count = 0;
+      for (size_t i = 0; i < small.size(); ++i) {
+        count += std::binary_search(large.begin(), large.end(), small[i]);
+      }
+      return count;
+    }
+    return kernel(lhs.data(), lhs.size(), rhs.data(), rhs.size());
+  }
+  // Stores the values in either lhs or rhs to result, providing how many.
+  static NX_FORCEINLINE size_t Union(const std::vector<uint16_t>& lhs,
+      const std::vector<uint16_t>& rhs, uint16_t* result) {
+    static const ArrayKernel kernel = SelectUnion();
+    return kernel(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result);
+  }
+  // Stores the values in lhs but not rhs to result, providing how many.
+  static NX_FORCEINLINE size_t Difference(const std::vector<uint16_t>& lhs,
+      const std::vector<uint16_t>& rhs, uint16_t* result) {
+    static const ArrayKernel kernel = SelectDifference();
+    return kernel(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result);
+  }
+  static size_t IntersectScalar(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    return static_cast<size_t>(std::set_intersection(lhs, lhs + lhs_size,
+        rhs, rhs + rhs_size, result) - result);
+  }
+  static size_t IntersectCountScalar(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size) {
+    size_t i = 0, j = 0, count = 0;
+    while (i < lhs_size && j < rhs_size) {
+      const uint16_t left = lhs[i];
+      const uint16_t right = rhs[j];
+      count += (left == right);
+      i += (left <= right);
+      j += (right <= left);
+    }
+    return count;
+  }
+  static size_t UnionScalar(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    return static_cast<size_t>(std::set_union(lhs, lhs + lhs_size,
+        rhs, rhs + rhs_size, result) - result);
+  }
+  static size_t DifferenceScalar(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    return static_cast<size_t>(std::set_difference(lhs, lhs + lhs_size,
+        rhs, rhs + rhs_size, result) - result);
+  }
+#if defined(NX_SIMD_X86)
+  // For each 8-bit mask, a shuffle gathering the 16-bit lanes it selects.
+  struct ShuffleTable {
+    ShuffleTable() {
+      for (unsigned int mask = 0; mask < 256u; ++mask) {
+        unsigned int byte = 0;
+        for (unsigned int lane = 0; lane < 8u; ++lane) {
+          if (mask & (1u << lane)) {
+            shuffles[mask][byte++] = static_cast<char>(lane * 2u);
+            shuffles[mask][byte++] = static_cast<char>(lane * 2u + 1u);
+          }
+        }
+        for (; byte < 16u; ++byte) {
+          shuffles[mask][byte] = static_cast<char>(0x80);
+        }
+      }
+    }
+    char shuffles[256][16];
+  };
+  // Stores the lanes of values that mask selects to result, providing how
+  // many.  All eight lanes are written.
+  NX_FUNCTION_TARGET("ssse3")
+  static NX_FORCEINLINE size_t Gather(__m128i values, unsigned int mask,
+      uint16_t* result) {
+    static const ShuffleTable table;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(result),
+        _mm_shuffle_epi8(values, _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(table.shuffles[mask]))));
+    return Bits<unsigned int>::PopCount(mask);
+  }
+  // Compares eight values from each side all-against-all, by comparing one
+  // side against every rotation of the other, and provides a mask of the
+  // lanes of left that are in right.
+  NX_FUNCTION_TARGET("ssse3")
+  static NX_FORCEINLINE unsigned int Matches(__m128i left, __m128i right) {
+    __m128i matches = _mm_cmpeq_epi16(left, right);
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 2)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 4)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 6)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 8)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 10)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 12)));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(left,
+        _mm_alignr_epi8(right, right, 14)));
+    return static_cast<unsigned int>(_mm_movemask_epi8(
+        _mm_packs_epi16(matches, _mm_setzero_si128())));
+  }
+  NX_FUNCTION_TARGET("ssse3")
+  static size_t IntersectSsse3(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    size_t i = 0, j = 0, count = 0;
+    while (i + 8u <= lhs_size && j + 8u <= rhs_size) {
+      const __m128i left = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(lhs + i));
+      const __m128i right = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(rhs + j));
+      count += Gather(left, Matches(left, right), result + count);
+      // advance whichever block ends first; both if they end together
+      const uint16_t left_last = lhs[i + 7u];
+      const uint16_t right_last = rhs[j + 7u];
+      if (left_last <= right_last) {
+        i += 8u;
+      }
+      if (right_last <= left_last) {
+        j += 8u;
+      }
+    }
+    return count + IntersectScalar(lhs + i, lhs_size - i, rhs + j,
+        rhs_size - j, result + count);
+  }
+  // As IntersectSsse3, but only counts the matches.
+  NX_FUNCTION_TARGET("ssse3")
+  static size_t IntersectCountSsse3(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size) {
+    size_t i = 0, j = 0, count = 0;
+    while (i + 8u <= lhs_size && j + 8u <= rhs_size) {
+      count += Bits<unsigned int>::PopCount(Matches(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + j))));
+      const uint16_t left_last = lhs[i + 7u];
+      const uint16_t right_last = rhs[j + 7u];
+      if (left_last <= right_last) {
+        i += 8u;
+      }
+      if (right_last <= left_last) {
+        j += 8u;
+      }
+    }
+    return count + IntersectCountScalar(lhs + i, lhs_size - i, rhs + j,
+        rhs_size - j);
+  }
+  // As IntersectSsse3, but gathers the lanes of each block of lhs that no
+  // block of rhs matched, once the block of lhs is done with.
+  NX_FUNCTION_TARGET("ssse3")
+  static size_t DifferenceSsse3(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    size_t i = 0, j = 0, count = 0;
+    unsigned int matched = 0;
+    while (i + 8u <= lhs_size && j + 8u <= rhs_size) {
+      const __m128i left = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(lhs + i));
+      const __m128i right = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(rhs + j));
+      matched |= Matches(left, right);
+      const uint16_t left_last = lhs[i + 7u];
+      const uint16_t right_last = rhs[j + 7u];
+      if (left_last <= right_last) {
+        count += Gather(left, ~matched & 0xffu, result + count);
+        matched = 0;
+        i += 8u;
+      }
+      if (right_last <= left_last) {
+        j += 8u;
+      }
+    }
+    if (matched) {
+      // the block of lhs that rhs ran out during; its unmatched values
+      // still have the rest of rhs to be compared against
+      uint16_t unmatched[8];
+      const size_t size = Gather(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(lhs + i)), ~matched & 0xffu,
+          unmatched);
+      count += DifferenceScalar(unmatched, size, rhs + j, rhs_size - j,
+          result + count);
+      i += 8u;
+    }
+    return count + DifferenceScalar(lhs + i, lhs_size - i, rhs + j,
+        rhs_size - j, result + count);
+  }
+  // Sorts a bitonic block of eight.
+  NX_FUNCTION_TARGET("sse4.1")
+  static NX_FORCEINLINE __m128i Sort(__m128i values) {
+    __m128i swapped = _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2));
+    values = _mm_blend_epi16(_mm_min_epu16(values, swapped),
+        _mm_max_epu16(values, swapped), 0xf0);
+    swapped = _mm_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1));
+    values = _mm_blend_epi16(_mm_min_epu16(values, swapped),
+        _mm_max_epu16(values, swapped), 0xcc);
+    swapped = _mm_shuffle_epi8(values,
+        _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+    return _mm_blend_epi16(_mm_min_epu16(values, swapped),
+        _mm_max_epu16(values, swapped), 0xaa);
+  }
+  // Merges two sorted blocks of eight into the lowest eight, sorted, in
+  // *low and the highest eight, sorted, in *high: a bitonic merge of lhs
+  // against rhs reversed, then of each half in steps of four, two and one.
+  NX_FUNCTION_TARGET("sse4.1")
+  static NX_FORCEINLINE void Merge(__m128i lhs, __m128i rhs, __m128i* low,
+      __m128i* high) {
+    const __m128i reversed = _mm_shuffle_epi8(rhs,
+        _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1));
+    *low = Sort(_mm_min_epu16(lhs, reversed));
+    *high = Sort(_mm_max_epu16(lhs, reversed));
+  }
+  // Merges a block of eight at a time into the eight pending values, taking
+  // the block from whichever side's next value is lower; the lowest eight
+  // are then final.  Values in both sides come out adjacent, and the second
+  // is dropped as each block is stored.
+  NX_FUNCTION_TARGET("sse4.1")
+  static size_t UnionSse41(const uint16_t* lhs, size_t lhs_size,
+      const uint16_t* rhs, size_t rhs_size, uint16_t* result) {
+    if (lhs_size < 8u || rhs_size < 8u) {
+      return UnionScalar(lhs, lhs_size, rhs, rhs_size, result);
+    }
+    __m128i low, high;
+    Merge(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs)), &low, &high);
+    // each value is in at most two of the first sixteen, so the lowest of
+    // them is never taken for a duplicate of this
+    __m128i previous = _mm_set1_epi16(-1);
+    size_t i = 8u, j = 8u, count = 0;
+    for (;;) {
+      const unsigned int duplicates = static_cast<unsigned int>(
+          _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(low,
+              _mm_alignr_epi8(low, previous, 14)), _mm_setzero_si128())));
+      count += Gather(low, ~duplicates & 0xffu, result + count);
+      previous = low;
+      if (i + 8u > lhs_size || j + 8u > rhs_size) {
+        break;
+      }
+      // without a branch, which would mispredict about half of the time
+      const size_t take_lhs = (lhs[i] <= rhs[j]);
+      const uint16_t* next = (take_lhs ? lhs + i : rhs + j);
+      i += take_lhs * 8u;
+      j += (take_lhs ^ 1u) * 8u;
+      Merge(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next)), high,
+          &low, &high);
+    }
+    // the pending eight and the few left of one side are merged with the
+    // rest of the other, and duplicates, including of the last value
+    // stored, dropped
+    const bool lhs_few = (i + 8u > lhs_size);
+    const uint16_t* few = (lhs_few ? lhs + i : rhs + j);
+    const uint16_t* few_end = (lhs_few ? lhs + lhs_size : rhs + rhs_size);
+    const uint16_t* rest = (lhs_few ? rhs + j : lhs + i);
+    const uint16_t* rest_end = (lhs_few ? rhs + rhs_size : lhs + lhs_size);
+    uint16_t pending[8], buffer[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pending), high);
+    uint16_t* const end = std::merge(buffer,
+        std::merge(pending, pending + 8, few, few_end, buffer), rest,
+        rest_end, result + count);
+    return static_cast<size_t>(std::unique(result + count - 1u, end) -
+        result);
+  }
+#endif
+  static ArrayKernel SelectIntersect() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kSsse3)) {
+      return &IntersectSsse3;
+    }
+#endif
+    return &IntersectScalar;
+  }
+  static ArrayCountKernel SelectIntersectCount() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kSsse3)) {
+      return &IntersectCountSsse3;
+    }
+#endif
+    return &IntersectCountScalar;
+  }
+  static ArrayKernel SelectUnion() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kSse41)) {
+      return &UnionSse41;
+    }
+#endif
+    return &UnionScalar;
+  }
+  static ArrayKernel SelectDifference() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kSsse3)) {
+      return &DifferenceSsse3;
+    }
+#endif
+    return &DifferenceScalar;
+  }
+
+  uint64_t count_;
+  // the high 16 bits of each chunk's values, ascending
+  std::vector<uint16_t> keys_;
+  std::vector<Chunk> chunks_;
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_ROARING_BITMAP_H_
@@ -0,0 +1,183 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file set_bits.h
+/// @brief Ranges over the indexes of the set bits in an integer or an array
+/// of words, for use with range-based for loops.  Each step costs a bit scan
+/// and the clearing of the lowest set bit, regardless of how many clear bits
+/// are skipped.
+
+#ifndef INCLUDE_NX_CORE_SET_BITS_H_
+#define INCLUDE_NX_CORE_SET_BITS_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/bits.h"
+
+#ifndef NX_EMBEDDED
+#include <iterator>
+#endif
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @brief The indexes of the set bits in a single integer, in ascending order.
+template <typename T>
+class SetBitRange {
+ public:
+  /// @brief Yields the index of each set bit.
+  class iterator {
+   public:
+#ifndef NX_EMBEDDED
+    typedef std::forward_iterator_tag iterator_category;
+#endif
+    typedef unsigned int value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const unsigned int* pointer;
+    typedef unsigned int reference;
+
+    explicit iterator(T bits = 0) : bits_(bits) {
+    }
+    NX_FORCEINLINE unsigned int operator*() const {
+      return Bits<T>::ScanForward(bits_);
+    }
+    NX_FORCEINLINE iterator& operator++() {
+      bits_ = Bits<T>::ClearLowest(bits_);
+      return *this;
+    }
+    NX_FORCEINLINE iterator operator++(int) {
+      iterator previous(*this);
+      ++*this;
+      return previous;
+    }
+    NX_FORCEINLINE bool operator==(const iterator& other) const {
+      return bits_ == other.bits_;
+    }
+    NX_FORCEINLINE bool operator!=(const iterator& other) const {
+      return bits_ != other.bits_;
+    }
+
+   private:
+    // the bits not yet visited
+    T bits_;
+  };
+
+  explicit SetBitRange(T value) : value_(value) {
+  }
+  NX_FORCEINLINE iterator begin() const {
+    return iterator(value_);
+  }
+  NX_FORCEINLINE iterator end() const {
+    return iterator();
+  }
+
+ private:
+  T value_;
+};
+
+/// @brief The indexes of the set bits in an array of words, in ascending
+/// order.  Bit i of word w has index w * Bits<Word>::Size() + i.
+template <typename Word>
+class SetBitArrayRange {
+ public:
+  /// @brief Yields the index of each set bit.
+  class iterator {
+   public:
+#ifndef NX_EMBEDDED
+    typedef std::forward_iterator_tag iterator_category;
+#endif
+    typedef size_t value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const size_t* pointer;
+    typedef size_t reference;
+
+    iterator(const Word* first, const Word* word, const Word* last)
+        : first_(first),
+          word_(word),
+          last_(last),
+          bits_(word != last ? *word : 0) {
+      SkipEmpty();
+    }
+    NX_FORCEINLINE size_t operator*() const {
+      return static_cast<size_t>(word_ - first_) * Bits<Word>::Size() +
+          Bits<Word>::ScanForward(bits_);
+    }
+    NX_FORCEINLINE iterator& operator++() {
+      bits_ = Bits<Word>::ClearLowest(bits_);
+      SkipEmpty();
+      return *this;
+    }
+    NX_FORCEINLINE iterator operator++(int) {
+      iterator previous(*this);
+      ++*this;
+      return previous;
+    }
+    NX_FORCEINLINE bool operator==(const iterator& other) const {
+      return word_ == other.word_ && bits_ == other.bits_;
+    }
+    NX_FORCEINLINE bool operator!=(const iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    // Advances to the next word with bits remaining, or to the end.
+    NX_FORCEINLINE void SkipEmpty() {
+      while (!bits_ && word_ != last_) {
+        if (++word_ != last_) {
+          bits_ = *word_;
+        }
+      }
+    }
+
+    const Word* first_;
+    const Word* word_;
+    const Word* last_;
+    // the bits of *word_ not yet visited
+    Word bits_;
+  };
+
+  SetBitArrayRange(const Word* words, size_t count)
+      : first_(words),
+        last_(words + count) {
+  }
+  NX_FORCEINLINE iterator begin() const {
+    return iterator(first_, first_, last_);
+  }
+  NX_FORCEINLINE iterator end() const {
+    return iterator(first_, last_, last_);
+  }
+
+ private:
+  const Word* first_;
+  const Word* last_;
+};
+
+/// @brief Provides a range over the indexes of the set bits in value.
+template <typename T>
+NX_FORCEINLINE SetBitRange<T> SetBits(T value) {
+  return SetBitRange<T>(value);
+}
+
+/// @brief Provides a range over the indexes of the set bits in the count
+/// words starting at words.
+template <typename Word>
+NX_FORCEINLINE SetBitArrayRange<Word> SetBits(
+    const Word* words, size_t count) {
+  return SetBitArrayRange<Word>(words, count);
+}
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_SET_BITS_H_
@@ -0,0 +1,42 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file simd.h
+/// @brief Determines which SIMD kernels can be compiled, and provides the
+/// intrinsics needed to write them.  Kernels must be compiled with
+/// NX_FUNCTION_TARGET and selected at runtime using nx::Cpu.
+
+#ifndef INCLUDE_NX_CORE_SIMD_H_
+#define INCLUDE_NX_CORE_SIMD_H_
+
+#include "nx/core/os.h"
+#include "nx/core/cpu.h"
+
+#if defined(NX_CPU_X86) && ( \
+    defined(NX_TC_CLANG) || defined(NX_TC_VS) || NX_TC_GCC >= 40900)
+  /// @brief Defined if x86 SIMD kernels can be compiled alongside portable
+  /// ones and selected at runtime.
+  #define NX_SIMD_X86 1
+  #include <immintrin.h>
+  #if (defined(NX_TC_GCC) && NX_TC_GCC >= 70000) || \
+      (defined(NX_TC_CLANG) && __clang_major__ >= 5) || \
+      (defined(NX_TC_VS) && _MSC_VER >= 1912)
+    /// @brief Defined if AVX-512 kernels (including VPOPCNTDQ) can be compiled.
+    #define NX_SIMD_AVX512 1
+  #endif
+#endif
+
+#endif  // INCLUDE_NX_CORE_SIMD_H_
@@ -65,6 +65,17 @@ typedef std::size_t size_t;
 /// @brief A signed integer type the same size as size_t.
 typedef std::make_signed<size_t>::type ssize_t;
 
+#if defined(__SIZEOF_INT128__)
+/// @brief The compiler's signed 128-bit integer, named through __extension__
+/// so that headers using it still compile in pedantic standard modes.
+__extension__ typedef __int128 int128_t;
+
+/// @brief The compiler's unsigned 128-bit integer, named through
+/// __extension__ so that headers using it still compile in pedantic
+/// standard modes.
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
 }  // namespace nx
 
 #endif  // INCLUDE_NX_CORE_TYPES_H_
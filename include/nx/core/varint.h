@@ -0,0 +1,572 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file varint.h
+/// @brief Variable-length integer encodings: LEB128 varints, zigzag mapping
+/// of signed values, and Stream VByte for blocks of 32-bit values.
+
+#ifndef INCLUDE_NX_CORE_VARINT_H_
+#define INCLUDE_NX_CORE_VARINT_H_
+
+#include "nx/core/mpl.h"
+#include "nx/core/integer.h"
+#include "nx/core/bits.h"
+#include "nx/core/endian.h"
+#include "nx/core/simd.h"
+
+/// @brief Library namespace.
+namespace nx {
+
+/// @cond nx_detail
+namespace detail {
+
+template <typename T, class Enable = void>
+class ZigZag {
+ private:
+  NX_UNINSTANTIABLE(ZigZag);
+};
+template <typename T>
+class ZigZag<T, EnableIf<IsIntegral<T>>> {
+ public:
+  typedef MakeUnsigned<T> unsigned_type;
+
+  /// @brief Maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ..., so that values of
+  /// small magnitude have few significant bits regardless of sign.
+  static NX_FORCEINLINE constexpr unsigned_type Encode(T value) {
+    return static_cast<unsigned_type>(
+        static_cast<unsigned_type>(static_cast<unsigned_type>(value) << 1u) ^
+        static_cast<unsigned_type>(0u - (static_cast<unsigned_type>(value) >>
+            (Bits<T>::Size() - 1u))));
+  }
+  /// @brief Reverses Encode().
+  static NX_FORCEINLINE constexpr T Decode(unsigned_type value) {
+    return static_cast<T>(static_cast<unsigned_type>(value >> 1u) ^
+        static_cast<unsigned_type>(0u - (value & 1u)));
+  }
+
+ private:
+  NX_UNINSTANTIABLE(ZigZag);
+};
+
+// Partial little-endian loads for the decoders.
+class VarintWord {
+ public:
+  // The low length bytes of a little-endian value, for length of at most 4.
+  static NX_FORCEINLINE uint32_t Load(
+      const uint8_t* bytes, unsigned int length) {
+    uint32_t value = 0;
+    for (unsigned int i = 0; i < length; ++i) {
+      value |= static_cast<uint32_t>(bytes[i]) << (i * 8u);
+    }
+    return value;
+  }
+
+ private:
+  NX_UNINSTANTIABLE(VarintWord);
+};
+
+}  // namespace detail
+/// @endcond
+
+template <class T>
+using ZigZag = detail::ZigZag<T>;
+
+/// @brief LEB128 varints of values of kBits bits, seven bits to a byte with
+/// the high bit set on all but the last.  Signed values are zigzag mapped
+/// first, as in protocol buffers' sint types.
+///
+/// Values are of the smallest type holding kBits bits with the requested
+/// sign.  Decoding finds the last byte of a varint with one scan of a 64-bit
+/// load and gathers its bits with shifts, or PEXT where targeted, rather than
+/// a loop, falling back to a byte loop only within eight bytes of the end of
+/// the input, or for varints of more than eight bytes.  Decoding many values
+/// loads words at a fixed stride and decodes every varint ending in each;
+/// once a word's varints are all of one length, it decodes all varints of
+/// that length in a word at once, and loads the next word at a stride fixed
+/// by the length, so that repeated lengths decode at least as fast as with a
+/// byte loop.
+template <unsigned int kBits, bool kSigned = false>
+class Varint {
+  static_assert(kBits >= 1u && kBits <= 64u,
+      "Varint values must be between 1 and 64 bits wide.");
+
+ public:
+  /// @brief The type of a value.
+  typedef integral_least_range_t<kSigned, kBits> value_type;
+
+  /// @brief The most bytes a value's encoding occupies.
+  static NX_FORCEINLINE constexpr size_t MaxSize() {
+    return (kBits + 6u) / 7u;
+  }
+  /// @brief The number of bytes value's encoding occupies.
+  static NX_FORCEINLINE size_t Size(value_type value) {
+    return Bits<uint64_t>::ScanReverse(Unsigned(value) | 1u) / 7u + 1u;
+  }
+  /// @brief Writes value to bytes, which must have room for MaxSize(), and
+  /// provides the number of bytes written.  value_type may be wider than
+  /// kBits; only the low kBits bits of a value (once zigzag mapped, if
+  /// signed) are encoded, so a value out of range does not round-trip.
+  static NX_FORCEINLINE size_t Encode(value_type value, uint8_t* bytes) {
+    uint64_t remaining = Unsigned(value);
+    size_t length = 0;
+    for (; remaining >= 0x80u; remaining >>= 7u) {
+      bytes[length++] = static_cast<uint8_t>(remaining | 0x80u);
+    }
+    bytes[length++] = static_cast<uint8_t>(remaining);
+    return length;
+  }
+  /// @brief Reads a value from the size bytes at bytes, and provides the
+  /// number of bytes read.  Provides 0 if the input ends within the varint,
+  /// if it is longer than MaxSize() or does not fit in kBits bits, or if it
+  /// is overlong: padded with a final zero byte, so not the shortest
+  /// encoding of its value.
+  static NX_FORCEINLINE size_t Decode(
+      const uint8_t* bytes, size_t size, value_type* value) {
+    uint64_t result;
+    size_t length;
+    uint64_t word = 0;
+    uint64_t ends = 0;
+    if (size >= 8u) {
+      word = Load<uint64_t, kLittleEndian>(bytes);
+      ends = ~word & HighBits();
+    }
+    if (NX_LIKELY(ends)) {
+      // the bytes up to and including the first without its high bit
+      result = Compact(word & (ends ^ (ends - 1u)));
+      length = Bits<uint64_t>::ScanForward(ends) / 8u + 1u;
+    } else {
+      length = DecodeSlow(bytes, size, &result);
+    }
+    if (!length || !Valid(result, length)) {
+      return 0;
+    }
+    *value = Signed(result);
+    return length;
+  }
+  /// @brief Writes count values to bytes, which must have room for count *
+  /// MaxSize(), and provides the number of bytes written.
+  static size_t Encode(const value_type* values, size_t count,
+      uint8_t* bytes) {
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i) {
+      length += Encode(values[i], bytes + length);
+    }
+    return length;
+  }
+  /// @brief Reads count values from the size bytes at bytes, and provides the
+  /// number of bytes read, or 0 if any value could not be decoded.
+  static size_t Decode(const uint8_t* bytes, size_t size, size_t count,
+      value_type* values) {
+    size_t i = 0;
+    size_t offset = 0;
+    // the length of the varints ending in the last word decoded, if the same
+    unsigned int length = 0;
+    while (i < count && size - offset >= 8u) {
+      const size_t first = i;
+      if (length && length <= 8u) {
+        if (!DecodeRun(bytes, size, count, values, length, &i, &offset)) {
+          return 0;
+        }
+        if (i - first >= kRunValues) {
+          // a varint of another length interrupts a long run; decode it
+          // alone, and expect the run to resume after it
+          if (i < count && size - offset >= 8u) {
+            const size_t read = Decode(bytes + offset, size - offset,
+                values + i);
+            if (!read) {
+              return 0;
+            }
+            ++i;
+            offset += read;
+          }
+          continue;
+        }
+      }
+      if (!DecodeWords(bytes, size, count, values, &i, &offset, &length)) {
+        return 0;
+      }
+      if (i == first) {
+        // a varint continues past the last whole word
+        break;
+      }
+    }
+    // the rest one at a time
+    for (; i < count; ++i) {
+      const size_t read = Decode(bytes + offset, size - offset, values + i);
+      if (!read) {
+        return 0;
+      }
+      offset += read;
+    }
+    return offset;
+  }
+
+ private:
+  static NX_FORCEINLINE constexpr uint64_t Maximum() {
+    return ~static_cast<uint64_t>(0) >> (64u - kBits);
+  }
+  // the high bit of every byte; clear in the last byte of a varint
+  static NX_FORCEINLINE constexpr uint64_t HighBits() {
+    return 0x8080808080808080u;
+  }
+  // Truncated to kBits bits, keeping encodings within MaxSize().
+  static NX_FORCEINLINE uint64_t Unsigned(value_type value) {
+    return static_cast<uint64_t>(kSigned ?
+        ZigZag<value_type>::Encode(value) :
+        static_cast<MakeUnsigned<value_type>>(value)) & Maximum();
+  }
+  static NX_FORCEINLINE value_type Signed(uint64_t value) {
+    return (kSigned ?
+        ZigZag<value_type>::Decode(
+            static_cast<MakeUnsigned<value_type>>(value)) :
+        static_cast<value_type>(value));
+  }
+  // Whether result, read from a varint of length bytes, is in range and was
+  // encoded in as few bytes as possible.  An overlong varint's last seven
+  // bits are 0, so its value is below the least needing length bytes; that
+  // is 1 << 7 * (length - 1), or 0 for a single byte.  The tests are combined
+  // without branches, as lengths vary unpredictably, so the shift is kept in
+  // range even for lengths beyond MaxSize().
+  static NX_FORCEINLINE bool Valid(uint64_t result, size_t length) {
+    return ((length <= MaxSize()) & (result <= Maximum()) &
+        (result >= ((static_cast<uint64_t>(1u) <<
+            (((length - 1u) * 7u) & 63u)) & ~static_cast<uint64_t>(1u))));
+  }
+  // Gathers the low seven bits of each byte of word; without PEXT, pairs of
+  // bytes at a time, then pairs of those, and so on.
+  static NX_FORCEINLINE uint64_t Compact(uint64_t word) {
+#if defined(__BMI2__) || (defined(NX_TC_VS) && defined(__AVX2__))
+    return Bits<uint64_t>::Extract(word, ~HighBits());
+#else
+    word &= ~HighBits();
+    word = (word & 0x00ff00ff00ff00ffu) | ((word & 0xff00ff00ff00ff00u) >> 1u);
+    word = (word & 0x0000ffff0000ffffu) | ((word & 0xffff0000ffff0000u) >> 2u);
+    return (word & 0x00000000ffffffffu) | ((word >> 32u) << 28u);
+#endif
+  }
+  static size_t DecodeSlow(const uint8_t* bytes, size_t size,
+      uint64_t* result) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size && i < MaxSize(); ++i) {
+      const uint64_t bits = bytes[i] & 0x7fu;
+      if (i == MaxSize() - 1u && (bits >> (kBits - i * 7u))) {
+        // bits beyond the widest value
+        return 0;
+      }
+      value |= bits << (i * 7u);
+      if (!(bytes[i] & 0x80u)) {
+        *result = value;
+        return i + 1u;
+      }
+    }
+    return 0;
+  }
+  // Decodes values from *index at *offset for as long as each is kLength
+  // bytes, advancing both past them.  Each word holds 8 / kLength such
+  // varints, whose groups one Compact() gathers, and the next load's address
+  // does not wait on the bytes of the last; so like a byte loop over
+  // predictable lengths, loads run ahead of the decoding.
+  template <unsigned int kLength>
+  static bool DecodeRun(const uint8_t* bytes, size_t size, size_t count,
+      value_type* values, size_t* index, size_t* offset) {
+    const unsigned int per_word = 8u / kLength;
+    const unsigned int span = per_word * kLength;
+    const uint64_t mask = ~static_cast<uint64_t>(0) >> (64u - span * 8u);
+    const uint64_t group = ~static_cast<uint64_t>(0) >> (64u - kLength * 7u);
+    const uint64_t least = (static_cast<uint64_t>(1u) <<
+        ((kLength - 1u) * 7u)) & ~static_cast<uint64_t>(1u);
+    // the high bits of the bytes of such varints: all but each last set
+    uint64_t continued = HighBits() & mask;
+    for (unsigned int j = 1; j <= per_word; ++j) {
+      continued ^= static_cast<uint64_t>(0x80u) << (j * kLength * 8u - 8u);
+    }
+    size_t i = *index;
+    size_t position = *offset;
+    bool valid = true;
+    for (; count - i >= per_word && size - position >= 8u;
+        position += span) {
+      const uint64_t word =
+          Load<uint64_t, kLittleEndian>(bytes + position) & mask;
+      if ((word & HighBits()) != continued) {
+        break;
+      }
+      uint64_t groups = Compact(word);
+      for (unsigned int j = 0; j < per_word; ++j) {
+        const uint64_t result = groups & group;
+        groups >>= kLength * 7u;
+        valid &= (result <= Maximum()) & (result >= least);
+        values[i++] = Signed(result);
+      }
+    }
+    *index = i;
+    *offset = position;
+    return valid;
+  }
+  static bool DecodeRun(const uint8_t* bytes, size_t size, size_t count,
+      value_type* values, unsigned int length, size_t* index,
+      size_t* offset) {
+    switch (length) {
+      case 1u: return DecodeRun<1u>(bytes, size, count, values, index, offset);
+      case 2u: return DecodeRun<2u>(bytes, size, count, values, index, offset);
+      case 3u: return DecodeRun<3u>(bytes, size, count, values, index, offset);
+      case 4u: return DecodeRun<4u>(bytes, size, count, values, index, offset);
+      case 5u: return DecodeRun<5u>(bytes, size, count, values, index, offset);
+      case 6u: return DecodeRun<6u>(bytes, size, count, values, index, offset);
+      case 7u: return DecodeRun<7u>(bytes, size, count, values, index, offset);
+      default:
+        return DecodeRun<8u>(bytes, size, count, values, index, offset);
+    }
+  }
+  // Decodes values from *index at *offset over at most kWordsPerPass words,
+  // loaded at a fixed stride so that each load does not wait on the lengths
+  // of the varints before it; every varint ending within a word is decoded
+  // from it.  Leaves *offset at the start of the next varint, and *length
+  // the length of every varint ending in the last word, or 0 if they
+  // differed.
+  static bool DecodeWords(const uint8_t* bytes, size_t size, size_t count,
+      value_type* values, size_t* index, size_t* offset,
+      unsigned int* length) {
+    size_t i = *index;
+    size_t position = *offset;
+    const size_t stop = position + kWordsPerPass * 8u;
+    // the bits and length so far of a varint continuing into the next word
+    uint64_t pending = 0;
+    unsigned int pending_size = 0;
+    // the length of the last varint, and whether any other ending in the
+    // same word differed
+    unsigned int last = 0;
+    bool mixed = false;
+    for (; i < count && size - position >= 8u && position != stop;
+        position += 8u) {
+      const uint64_t word = Load<uint64_t, kLittleEndian>(bytes + position);
+      uint64_t ends = ~word & HighBits();
+      if (NX_UNLIKELY(!ends)) {
+        if (pending_size + 8u >= MaxSize()) {
+          return false;
+        }
+        pending |= Compact(word) << (pending_size * 7u);
+        pending_size += 8u;
+        continue;
+      }
+      // the first varint completes any pending one; its bits beyond 64 are
+      // lost in the shift, so are checked for separately
+      unsigned int start = Bits<uint64_t>::ScanForward(ends) + 1u;
+      const uint64_t high = Compact(word & (ends ^ (ends - 1u)));
+      uint64_t result = pending | (high << (pending_size * 7u));
+      unsigned int varint_size = pending_size + start / 8u;
+      last = varint_size;
+      mixed = false;
+      bool valid = Valid(result, varint_size) &
+          !(kBits > 56u && ((high >> (63u - pending_size * 7u)) >> 1u));
+      values[i++] = Signed(result);
+      // validity is accumulated rather than branched upon for each value
+      for (ends &= ends - 1u; ends && i < count; ends &= ends - 1u) {
+        const unsigned int end = Bits<uint64_t>::ScanForward(ends) + 1u;
+        result = Compact((word & (ends ^ (ends - 1u))) >> start);
+        varint_size = (end - start) / 8u;
+        mixed |= (last != varint_size);
+        last = varint_size;
+        valid &= Valid(result, varint_size);
+        values[i++] = Signed(result);
+        start = end;
+      }
+      if (!valid) {
+        return false;
+      }
+      if (i == count) {
+        *index = i;
+        *offset = position + start / 8u;
+        *length = (mixed ? 0 : last);
+        return true;
+      }
+      // start is a multiple of 8 from 8 to 64
+      pending = Compact((word >> (start - 8u)) >> 8u);
+      pending_size = (64u - start) / 8u;
+    }
+    *index = i;
+    *offset = position - pending_size;
+    *length = (mixed ? 0 : last);
+    return true;
+  }
+
+  // Decoding many values runs over words for this many at a time, then over
+  // varints of the length last seen for as long as they repeat.  A run this
+  // long is taken to go on past a single varint of another length.
+  static const size_t kWordsPerPass = 4u;
+  static const size_t kRunValues = 8u;
+};
+
+/// @brief Stream VByte: blocks of 32-bit values stored as one to four bytes
+/// each, with the lengths kept apart from the values as two bits each in a
+/// run of control bytes at the front.
+///
+/// Since a control byte alone determines where the next four values lie,
+/// decoding gathers them with one shuffle per control byte (SSSE3), or eight
+/// with one shuffle per two (AVX2), and needs no branches per value.
+class StreamVByte {
+ public:
+  /// @brief The number of control bytes for count values.
+  static NX_FORCEINLINE constexpr size_t ControlSize(size_t count) {
+    return (count + 3u) / 4u;
+  }
+  /// @brief The most bytes count values' encoding occupies.
+  static NX_FORCEINLINE constexpr size_t MaxSize(size_t count) {
+    return ControlSize(count) + count * 4u;
+  }
+  /// @brief Writes count values to bytes, which must have room for
+  /// MaxSize(count), and provides the number of bytes written.
+  static size_t Encode(const uint32_t* values, size_t count, uint8_t* bytes) {
+    uint8_t* data = bytes + ControlSize(count);
+    for (size_t i = 0; i < count; i += 4u) {
+      unsigned int control = 0;
+      for (size_t j = 0; j < 4u && i + j < count; ++j) {
+        const uint32_t value = values[i + j];
+        const unsigned int length =
+            Bits<uint32_t>::ScanReverse(value | 1u) / 8u + 1u;
+        for (unsigned int k = 0; k < length; ++k) {
+          *data++ = static_cast<uint8_t>(value >> (k * 8u));
+        }
+        control |= (length - 1u) << (j * 2u);
+      }
+      bytes[i / 4u] = static_cast<uint8_t>(control);
+    }
+    return static_cast<size_t>(data - bytes);
+  }
+  /// @brief Reads count values from the size bytes at bytes, and provides the
+  /// number of bytes read, or 0 if the input ends before the last value.
+  static size_t Decode(const uint8_t* bytes, size_t size, size_t count,
+      uint32_t* values) {
+    if (size < ControlSize(count)) {
+      return 0;
+    }
+    static const DecodeKernel kernel = SelectDecode();
+    return kernel(bytes, size, count, values);
+  }
+
+ private:
+  typedef Function<size_t, const uint8_t*, size_t, size_t, uint32_t*>
+      DecodeKernel;
+
+  static NX_FORCEINLINE unsigned int Length(
+      const uint8_t* controls, size_t index) {
+    return ((controls[index / 4u] >> ((index % 4u) * 2u)) & 3u) + 1u;
+  }
+  // Decodes the values from first onwards, with data at the bytes of the
+  // first value; provides the total bytes read, or 0 if they run out.
+  static NX_FORCEINLINE size_t DecodeTail(const uint8_t* bytes, size_t size,
+      size_t count, uint32_t* values, size_t first, const uint8_t* data) {
+    const uint8_t* end = bytes + size;
+    for (size_t i = first; i < count; ++i) {
+      const unsigned int length = Length(bytes, i);
+      if (static_cast<size_t>(end - data) < length) {
+        return 0;
+      }
+      values[i] = detail::VarintWord::Load(data, length);
+      data += length;
+    }
+    return static_cast<size_t>(data - bytes);
+  }
+  static size_t DecodeScalar(const uint8_t* bytes, size_t size, size_t count,
+      uint32_t* values) {
+    return DecodeTail(bytes, size, count, values, 0,
+        bytes + ControlSize(count));
+  }
+#if defined(NX_SIMD_X86)
+  // For each control byte, a shuffle placing each value's bytes in the low
+  // bytes of its lane, and the number of data bytes it covers.
+  struct Table {
+    Table() {
+      for (unsigned int control = 0; control < 256u; ++control) {
+        unsigned int byte = 0;
+        for (unsigned int lane = 0; lane < 4u; ++lane) {
+          const unsigned int length = ((control >> (lane * 2u)) & 3u) + 1u;
+          for (unsigned int k = 0; k < 4u; ++k) {
+            shuffles[control][lane * 4u + k] = static_cast<char>(
+                k < length ? byte + k : 0x80u);
+          }
+          byte += length;
+        }
+        lengths[control] = static_cast<uint8_t>(byte);
+      }
+    }
+    char shuffles[256][16];
+    uint8_t lengths[256];
+  };
+  NX_FUNCTION_TARGET("ssse3")
+  static size_t DecodeSsse3(const uint8_t* bytes, size_t size, size_t count,
+      uint32_t* values) {
+    static const Table table;
+    const uint8_t* data = bytes + ControlSize(count);
+    const uint8_t* end = bytes + size;
+    size_t i = 0;
+    // each step loads sixteen bytes, whatever the values' lengths
+    for (; i + 4u <= count && end - data >= 16; i += 4u) {
+      const unsigned int control = bytes[i / 4u];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i),
+          _mm_shuffle_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                  table.shuffles[control]))));
+      data += table.lengths[control];
+    }
+    return DecodeTail(bytes, size, count, values, i, data);
+  }
+  NX_FUNCTION_TARGET("avx2")
+  static size_t DecodeAvx2(const uint8_t* bytes, size_t size, size_t count,
+      uint32_t* values) {
+    static const Table table;
+    const uint8_t* data = bytes + ControlSize(count);
+    const uint8_t* end = bytes + size;
+    size_t i = 0;
+    // two blocks of four per step, one in each half; the second block's
+    // sixteen bytes begin at most sixteen bytes in
+    for (; i + 8u <= count && end - data >= 32; i += 8u) {
+      const unsigned int low = bytes[i / 4u];
+      const unsigned int high = bytes[i / 4u + 1u];
+      const uint8_t* next = data + table.lengths[low];
+      const __m256i source = _mm256_inserti128_si256(_mm256_castsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(next)), 1);
+      const __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+              table.shuffles[low]))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+              table.shuffles[high])), 1);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i),
+          _mm256_shuffle_epi8(source, shuffle));
+      data = next + table.lengths[high];
+    }
+    return DecodeTail(bytes, size, count, values, i, data);
+  }
+#endif
+  static DecodeKernel SelectDecode() {
+#if defined(NX_SIMD_X86)
+    if (Cpu::Supports(Cpu::kAvx2)) {
+      return &DecodeAvx2;
+    }
+    if (Cpu::Supports(Cpu::kSsse3)) {
+      return &DecodeSsse3;
+    }
+#endif
+    return &DecodeScalar;
+  }
+
+  NX_UNINSTANTIABLE(StreamVByte);
+};
+
+}  // namespace nx
+
+#endif  // INCLUDE_NX_CORE_VARINT_H_
@@ -0,0 +1,261 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file arithmetic_span_test.cc
+/// @brief Checks the overflow-checked and saturating operations of Bits
+/// against the compiler's overflow builtins, and that the ArithmeticSpan
+/// kernels of every instruction set the processor supports agree with them
+/// element by element, for every width and signedness, at and around the
+/// minimum and maximum.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/arithmetic_span.h"
+#include "nx/core/bits.h"
+#include "nx/core/integer.h"
+#include "nx/core/mpl.h"
+
+#include "test.h"
+
+namespace {
+
+template <typename T>
+T Maximum() {
+  typedef nx::MakeUnsigned<T> U;
+  return static_cast<T>(nx::IsSigned<T>::value ?
+      static_cast<U>(~static_cast<U>(0)) >> 1u : ~static_cast<U>(0));
+}
+
+template <typename T>
+T Minimum() {
+  return static_cast<T>(~Maximum<T>());
+}
+
+// The extremes and their neighbours, zero and its neighbours, or any value.
+template <typename T>
+T RandomValue() {
+  switch (test::Random() % 4u) {
+    case 0: {
+      const T edges[] = {Minimum<T>(), static_cast<T>(Minimum<T>() + 1),
+          Maximum<T>(), static_cast<T>(Maximum<T>() - 1), 0, 1,
+          static_cast<T>(-1), static_cast<T>(Maximum<T>() / 2),
+          static_cast<T>(Maximum<T>() / 2 + 1)};
+      return edges[test::Random() % (sizeof(edges) / sizeof(edges[0]))];
+    }
+    case 1:
+      return static_cast<T>(test::Random() % 5u);
+    default: {
+      typedef nx::MakeUnsigned<T> U;
+      U value = static_cast<U>(test::Random());
+      // the shift is only ever made for types wider than 64 bits
+      for (size_t i = sizeof(nx::uint64_t); i < sizeof(T);
+          i += sizeof(nx::uint64_t)) {
+        value = static_cast<U>((value << (sizeof(T) > 8u ? 64u : 0u)) |
+            static_cast<U>(test::Random()));
+      }
+      return static_cast<T>(value);
+    }
+  }
+}
+
+// Small values of either sign, whose sums cannot overflow.
+template <typename T>
+T SmallValue() {
+  return static_cast<T>(nx::IsSigned<T>::value ?
+      static_cast<T>(test::Random() % 7u) - 3 : test::Random() % 4u);
+}
+
+// The wrapped power, and whether any step overflowed; as the magnitude of
+// each step is no less than that of the last, once any step overflows, so
+// does the exact power.
+template <typename T>
+bool PowerReference(T base, unsigned int exponent, T* result) {
+  bool overflow = false;
+  *result = 1;
+  for (unsigned int i = 0; i < exponent; ++i) {
+    overflow |= __builtin_mul_overflow(*result, base, result);
+  }
+  return overflow;
+}
+
+template <typename T>
+void CheckBits() {
+  typedef nx::Bits<T> Bits;
+  bool exact = true;
+  for (unsigned int trial = 0; trial < 100000u; ++trial) {
+    const T lhs = RandomValue<T>();
+    const T rhs = RandomValue<T>();
+    T result;
+    T expected;
+
+    bool overflow = __builtin_add_overflow(lhs, rhs, &expected);
+    exact = exact && Bits::AdditionOverflow(lhs, rhs, &result) == overflow &&
+        result == expected;
+    // overflow is towards the sign of rhs
+    exact = exact && Bits::SaturatingAdd(lhs, rhs) == (!overflow ?
+        expected : rhs < 0 ? Minimum<T>() : Maximum<T>());
+
+    overflow = __builtin_sub_overflow(lhs, rhs, &expected);
+    exact = exact &&
+        Bits::SubtractionOverflow(lhs, rhs, &result) == overflow &&
+        result == expected;
+    // overflow is away from the sign of rhs, and unsigned only downwards
+    exact = exact && Bits::SaturatingSubtract(lhs, rhs) == (!overflow ?
+        expected : rhs < 0 ? Maximum<T>() : Minimum<T>());
+
+    overflow = __builtin_mul_overflow(lhs, rhs, &expected);
+    exact = exact &&
+        Bits::MultiplicationOverflow(lhs, rhs, &result) == overflow &&
+        result == expected;
+    exact = exact && Bits::SaturatingMultiply(lhs, rhs) == (!overflow ?
+        expected : (lhs < 0) == (rhs < 0) ? Maximum<T>() : Minimum<T>());
+
+    // mostly exponents near the width, where powers begin to overflow
+    const unsigned int exponent = static_cast<unsigned int>(
+        test::Random() % (trial % 8u ? 8u : nx::Bits<T>::Size() + 3u));
+    const T base = (trial % 2u ? lhs : SmallValue<T>());
+    overflow = PowerReference(base, exponent, &expected);
+    exact = exact && Bits::PowerOverflow(base, exponent, &result) ==
+        overflow && result == expected;
+    exact = exact && Bits::Power(base, exponent) == expected;
+  }
+  CHECK(exact);
+  // powers that only just fit, and only just overflow
+  T result;
+  CHECK(!Bits::PowerOverflow(2, nx::Bits<T>::Size() - 1u -
+      nx::IsSigned<T>::value, &result));
+  CHECK(Bits::PowerOverflow(2, nx::Bits<T>::Size() - nx::IsSigned<T>::value,
+      &result));
+  CHECK(Bits::Power(static_cast<T>(-1), 0x7fffffffu) == static_cast<T>(-1));
+  CHECK(!Bits::PowerOverflow(0, ~0u, &result) && result == 0);
+  CHECK(!Bits::PowerOverflow(0, 0, &result) && result == 1);
+}
+
+// Checks a saturating kernel against op, element by element, for every
+// length up to several vectors, and in place over either operand.  The
+// buffers are exactly as long as needed, so that sanitizers see any access
+// beyond.
+template <typename T>
+void CheckSaturating(
+    typename nx::detail::ArithmeticSpanKernels<T>::SaturatingKernel kernel,
+    T (*op)(T, T)) {
+  for (size_t length = 0; length <= 96u / sizeof(T) + 1u; ++length) {
+    std::vector<T> lhs(length);
+    std::vector<T> rhs(length);
+    std::vector<T> expected(length);
+    for (size_t i = 0; i < length; ++i) {
+      lhs[i] = RandomValue<T>();
+      rhs[i] = RandomValue<T>();
+      expected[i] = op(lhs[i], rhs[i]);
+    }
+    std::vector<T> result(length);
+    kernel(lhs.data(), rhs.data(), length, result.data());
+    CHECK(result == expected);
+    result = lhs;
+    kernel(result.data(), rhs.data(), length, result.data());
+    CHECK(result == expected);
+    result = rhs;
+    kernel(lhs.data(), result.data(), length, result.data());
+    CHECK(result == expected);
+  }
+}
+
+// As above, for an overflow-checked kernel, with sums that overflow
+// somewhere, anywhere including the tail, and nowhere.
+template <typename T>
+void CheckChecked(
+    typename nx::detail::ArithmeticSpanKernels<T>::CheckedKernel kernel) {
+  for (size_t length = 0; length <= 96u / sizeof(T) + 1u; ++length) {
+    for (unsigned int mode = 0; mode < 3u; ++mode) {
+      std::vector<T> lhs(length);
+      std::vector<T> rhs(length);
+      for (size_t i = 0; i < length; ++i) {
+        lhs[i] = (mode ? SmallValue<T>() : RandomValue<T>());
+        rhs[i] = (mode ? SmallValue<T>() : RandomValue<T>());
+      }
+      if (mode == 2u && length) {
+        // a single overflow, at any position
+        const size_t position = test::Random() % length;
+        lhs[position] = Maximum<T>();
+        rhs[position] = 1;
+      }
+      std::vector<T> expected(length);
+      bool overflow = false;
+      for (size_t i = 0; i < length; ++i) {
+        overflow |= nx::Bits<T>::AdditionOverflow(lhs[i], rhs[i],
+            &expected[i]);
+      }
+      std::vector<T> result(length);
+      CHECK(kernel(lhs.data(), rhs.data(), length, result.data()) ==
+          overflow);
+      CHECK(result == expected);
+      result = lhs;
+      CHECK(kernel(result.data(), rhs.data(), length, result.data()) ==
+          overflow);
+      CHECK(result == expected);
+    }
+  }
+}
+
+template <typename T>
+void CheckKernels() {
+  typedef nx::detail::ArithmeticSpanKernels<T> Kernels;
+  CheckSaturating<T>(&Kernels::SaturatingAddScalar,
+      &nx::Bits<T>::SaturatingAdd);
+  CheckSaturating<T>(&Kernels::SaturatingSubtractScalar,
+      &nx::Bits<T>::SaturatingSubtract);
+  CheckChecked<T>(&Kernels::AdditionOverflowScalar);
+#if defined(NX_SIMD_X86)
+  if (Kernels::Vectorizable() && nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckSaturating<T>(&Kernels::SaturatingAddAvx2,
+        &nx::Bits<T>::SaturatingAdd);
+    CheckSaturating<T>(&Kernels::SaturatingSubtractAvx2,
+        &nx::Bits<T>::SaturatingSubtract);
+    CheckChecked<T>(&Kernels::AdditionOverflowAvx2);
+  }
+#endif
+  // and whichever the span dispatches to
+  CheckSaturating<T>(&nx::ArithmeticSpan<T>::SaturatingAdd,
+      &nx::Bits<T>::SaturatingAdd);
+  CheckSaturating<T>(&nx::ArithmeticSpan<T>::SaturatingSubtract,
+      &nx::Bits<T>::SaturatingSubtract);
+  CheckChecked<T>(&nx::ArithmeticSpan<T>::AdditionOverflow);
+}
+
+template <typename T>
+void CheckType() {
+  CheckBits<T>();
+  CheckKernels<T>();
+}
+
+}  // namespace
+
+int main() {
+  CheckType<nx::int8_t>();
+  CheckType<nx::uint8_t>();
+  CheckType<nx::int16_t>();
+  CheckType<nx::uint16_t>();
+  CheckType<nx::int32_t>();
+  CheckType<nx::uint32_t>();
+  CheckType<nx::int64_t>();
+  CheckType<nx::uint64_t>();
+#if defined(__SIZEOF_INT128__)
+  CheckType<nx::int_t<128>>();
+  CheckType<nx::uint_t<128>>();
+#endif
+
+  return test::Finish();
+}
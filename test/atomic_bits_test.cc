@@ -0,0 +1,253 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file atomic_bits_test.cc
+/// @brief Checks each AtomicBits operation, with runtime masks and with
+/// every compile-time specialization of empty, full, all-set, all-clear and
+/// mixed masks, against the plain bitwise result and for the value returned,
+/// for words of every width and signedness and bits at either end of them;
+/// then that threads updating their own bits of a shared word, at once,
+/// never lose or disturb one another's.  Build with -pthread.  Exits nonzero
+/// on failure.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "nx/core/atomic_bits.h"
+#include "nx/core/bits.h"
+#include "nx/core/integer.h"
+#include "nx/core/mpl.h"
+
+#include "test.h"
+
+namespace {
+
+template <typename T>
+T RandomValue() {
+  return static_cast<T>(test::Random());
+}
+
+// The bit at index, which for the last is the sign bit of signed types.
+template <typename T>
+constexpr T Bit(unsigned int index) {
+  return static_cast<T>(static_cast<nx::MakeUnsigned<T>>(1) << index);
+}
+
+template <typename T>
+T Merge(T mask, T value, T data) {
+  return static_cast<T>((value & mask) | (data & ~mask));
+}
+
+// Each order valid for a read-modify-write.
+const std::memory_order kOrders[] = {std::memory_order_relaxed,
+    std::memory_order_consume, std::memory_order_acquire,
+    std::memory_order_release, std::memory_order_acq_rel,
+    std::memory_order_seq_cst};
+
+std::memory_order RandomOrder() {
+  return kOrders[test::Random() % (sizeof(kOrders) / sizeof(kOrders[0]))];
+}
+
+// Checks the operations with runtime masks of no bits, every bit, each
+// single bit, and random bits.
+template <typename T>
+void CheckRuntime() {
+  typedef nx::AtomicBits<T> Bits;
+  std::vector<T> masks;
+  masks.push_back(0);
+  masks.push_back(static_cast<T>(~static_cast<T>(0)));
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    masks.push_back(Bit<T>(i));
+  }
+  for (unsigned int i = 0; i < 20u; ++i) {
+    masks.push_back(RandomValue<T>());
+  }
+  bool exact = true;
+  for (size_t m = 0; m < masks.size(); ++m) {
+    const T mask = masks[m];
+    for (unsigned int trial = 0; trial < 20u; ++trial) {
+      const T initial = RandomValue<T>();
+      const T value = RandomValue<T>();
+      std::atomic<T> data(initial);
+      exact = exact && Bits::assign(mask, value, &data, RandomOrder()) ==
+          initial && data.load() == Merge(mask, value, initial);
+      data.store(initial);
+      exact = exact && Bits::set(mask, &data, RandomOrder()) == initial &&
+          data.load() == static_cast<T>(initial | mask);
+      data.store(initial);
+      exact = exact && Bits::clear(mask, &data, RandomOrder()) == initial &&
+          data.load() == static_cast<T>(initial & ~mask);
+      exact = exact && Bits::get(mask, &data, std::memory_order_acquire) ==
+          0;
+      data.store(initial);
+      exact = exact && Bits::get(mask, &data) ==
+          static_cast<T>(initial & mask);
+    }
+  }
+  CHECK(exact);
+}
+
+// Checks the operations specialized on mask_, and on value_ as well.
+template <typename T, T mask_, T value_>
+void CheckConstant() {
+  typedef nx::AtomicBits<T> Bits;
+  bool exact = true;
+  for (unsigned int trial = 0; trial < 20u; ++trial) {
+    const T initial = RandomValue<T>();
+    std::atomic<T> data(initial);
+    exact = exact && Bits::template assign<mask_, value_>(&data,
+        RandomOrder()) == initial &&
+        data.load() == Merge(mask_, value_, initial);
+    data.store(initial);
+    exact = exact && Bits::template assign<mask_>(value_, &data,
+        RandomOrder()) == initial &&
+        data.load() == Merge(mask_, value_, initial);
+    data.store(initial);
+    exact = exact && Bits::template set<mask_>(&data, RandomOrder()) ==
+        initial && data.load() == static_cast<T>(initial | mask_);
+    data.store(initial);
+    exact = exact && Bits::template clear<mask_>(&data, RandomOrder()) ==
+        initial && data.load() == static_cast<T>(initial & ~mask_);
+    data.store(initial);
+    exact = exact && Bits::template get<mask_>(&data) ==
+        static_cast<T>(initial & mask_);
+  }
+  CHECK(exact);
+}
+
+// Values setting every bit of mask_, none, and some.
+template <typename T, T mask_>
+void CheckMask() {
+  CheckConstant<T, mask_, static_cast<T>(0)>();
+  CheckConstant<T, mask_, static_cast<T>(~static_cast<T>(0))>();
+  CheckConstant<T, mask_, mask_>();
+  CheckConstant<T, mask_, static_cast<T>(~mask_)>();
+  CheckConstant<T, mask_, static_cast<T>(0x3333333333333333ull)>();
+}
+
+template <typename T>
+void CheckConstants() {
+  CheckMask<T, static_cast<T>(0)>();
+  CheckMask<T, static_cast<T>(~static_cast<T>(0))>();
+  CheckMask<T, Bit<T>(0)>();
+  CheckMask<T, Bit<T>(nx::Bits<T>::Size() - 1u)>();
+  CheckMask<T, static_cast<T>(0x5555555555555555ull)>();
+  CheckMask<T, static_cast<T>(~Bit<T>(nx::Bits<T>::Size() - 1u))>();
+}
+
+// xorshift64 of each thread's own, as test::Random() is not thread safe.
+nx::uint64_t NextRandom(nx::uint64_t* state) {
+  *state ^= *state << 13u;
+  *state ^= *state >> 7u;
+  *state ^= *state << 17u;
+  return *state;
+}
+
+// Threads own every threads-th bit of one word, and set, clear and assign
+// only their own, through fetch_or, fetch_and and compare-exchange.  Each
+// expects its bits, in the value each operation returns, exactly as it
+// left them; an update lost to another thread's, or one that disturbs
+// another thread's bits, is seen.
+template <typename T>
+void CheckThreads(unsigned int threads, unsigned int rounds) {
+  typedef nx::AtomicBits<T> Bits;
+  std::atomic<T> data(0);
+  std::atomic<unsigned int> mismatches(0);
+  std::atomic<bool> start(false);
+  std::vector<T> finals(threads, 0);
+
+  const auto work = [&](unsigned int thread) {
+    nx::uint64_t state = 0x9e3779b97f4a7c15ull * (thread + 1u);
+    T own = 0;
+    for (unsigned int i = thread; i < nx::Bits<T>::Size(); i += threads) {
+      own = static_cast<T>(own | Bit<T>(i));
+    }
+    T expected = 0;
+    T previous = 0;
+    unsigned int wrong = 0;
+    // begin together, so that the threads overlap
+    while (!start.load(std::memory_order_acquire)) {
+    }
+    for (unsigned int round = 0; round < rounds; ++round) {
+      const T bits = static_cast<T>(NextRandom(&state) & own);
+      T prior;
+      switch (NextRandom(&state) % 3u) {
+        case 0:
+          prior = Bits::set(bits, &data, std::memory_order_acq_rel);
+          expected = static_cast<T>(expected | bits);
+          break;
+        case 1:
+          prior = Bits::clear(bits, &data, std::memory_order_acq_rel);
+          expected = static_cast<T>(expected & ~bits);
+          break;
+        default: {
+          const T value = static_cast<T>(NextRandom(&state));
+          prior = Bits::assign(own, value, &data, std::memory_order_acq_rel);
+          expected = Merge(own, value, expected);
+          break;
+        }
+      }
+      // the bits of this thread before, as this thread left them
+      wrong += (static_cast<T>(prior & own) != previous ? 1u : 0u);
+      previous = expected;
+    }
+    finals[thread] = expected;
+    mismatches.fetch_add(wrong, std::memory_order_relaxed);
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int thread = 0; thread < threads; ++thread) {
+    workers.push_back(std::thread(work, thread));
+  }
+  start.store(true, std::memory_order_release);
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+  CHECK(mismatches.load() == 0);
+  T expected = 0;
+  for (unsigned int thread = 0; thread < threads; ++thread) {
+    expected = static_cast<T>(expected | finals[thread]);
+  }
+  CHECK(data.load() == expected);
+}
+
+template <typename T>
+void Check() {
+  CheckRuntime<T>();
+  CheckConstants<T>();
+}
+
+}  // namespace
+
+int main() {
+  Check<nx::int8_t>();
+  Check<nx::uint8_t>();
+  Check<nx::int16_t>();
+  Check<nx::uint16_t>();
+  Check<nx::int32_t>();
+  Check<nx::uint32_t>();
+  Check<nx::int64_t>();
+  Check<nx::uint64_t>();
+
+  // long enough that, even on one processor, threads are preempted within
+  // compare-exchange loops
+  CheckThreads<nx::uint64_t>(4u, 20000000u);
+  CheckThreads<nx::uint8_t>(3u, 10000000u);
+  CheckThreads<nx::int32_t>(8u, 2000000u);
+
+  return test::Finish();
+}
@@ -0,0 +1,133 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_field_test.cc
+/// @brief Checks that Bits<T>::Write of BitFields touches a register once: a
+/// single read and write per call, or a single write when the fields cover
+/// the whole register.  Exits nonzero on failure.
+
+#include "nx/core/bits.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// A stand-in for a device register that counts every access made to it.
+template <typename T>
+class Register {
+ public:
+  explicit Register(T value) : value_(value), reads_(0), writes_(0) {
+  }
+  operator T() {
+    ++reads_;
+    return value_;
+  }
+  Register& operator=(T value) {
+    ++writes_;
+    value_ = value;
+    return *this;
+  }
+  Register& operator|=(T value) {
+    ++reads_;
+    ++writes_;
+    value_ |= value;
+    return *this;
+  }
+  Register& operator&=(T value) {
+    ++reads_;
+    ++writes_;
+    value_ &= value;
+    return *this;
+  }
+  T value() const {
+    return value_;
+  }
+  // Whether exactly reads reads and writes writes were made since the last
+  // call, which then starts counting anew.
+  bool Accessed(unsigned int reads, unsigned int writes) {
+    const bool result = (reads_ == reads && writes_ == writes);
+    reads_ = 0;
+    writes_ = 0;
+    return result;
+  }
+
+ private:
+  T value_;
+  unsigned int reads_;
+  unsigned int writes_;
+};
+
+typedef nx::BitField<nx::uint32_t, 0, 4> Mode;
+typedef nx::BitField<nx::uint32_t, 4, 1> Enable;
+typedef nx::BitField<nx::uint32_t, 5, 3> Pins;
+typedef nx::BitField<nx::uint32_t, 8, 8> Prescaler;
+typedef nx::BitField<nx::uint32_t, 16, 16> Count;
+
+typedef nx::BitField<nx::uint64_t, 0, 64> Whole;
+typedef nx::BitField<nx::int8_t, 1, 7> Signed;
+
+}  // namespace
+
+int main() {
+  typedef nx::Bits<nx::uint32_t> Bits;
+  Register<nx::uint32_t> reg(0xffffffffu);
+
+  // runtime values; the prescaler is truncated to its width
+  Bits::Write(&reg, Mode() = 5u, Enable() = 0u, Prescaler() = 0x1234u);
+  CHECK(reg.value() == 0xffff34e5u);
+  CHECK(reg.Accessed(1u, 1u));
+
+  Bits::Write(&reg, Pins() = 2u);
+  CHECK(reg.value() == 0xffff3445u);
+  CHECK(reg.Accessed(1u, 1u));
+
+  // every bit is written, so the old value is never read
+  Bits::Write(&reg, Mode() = 1u, Enable() = 1u, Pins() = 7u,
+      Prescaler() = 2u, Count() = 0xabcdu);
+  CHECK(reg.value() == 0xabcd02f1u);
+  CHECK(reg.Accessed(0u, 1u));
+
+  // constants that set, clear, and merge bits
+  Bits::Write(&reg, Mode::Constant<15u>(), Enable::Constant<1u>());
+  CHECK(reg.value() == 0xabcd02ffu);
+  CHECK(reg.Accessed(1u, 1u));
+
+  Bits::Write(&reg, Mode::Constant<0u>(), Prescaler::Constant<0u>());
+  CHECK(reg.value() == 0xabcd00f0u);
+  CHECK(reg.Accessed(1u, 1u));
+
+  Bits::Write(&reg, Mode::Constant<3u>(), Prescaler::Constant<0x80u>());
+  CHECK(reg.value() == 0xabcd80f3u);
+  CHECK(reg.Accessed(1u, 1u));
+
+  Bits::Write(&reg, Mode::Constant<1u>(), Enable::Constant<0u>(),
+      Pins::Constant<0u>(), Prescaler::Constant<0u>(), Count::Constant<0u>());
+  CHECK(reg.value() == 1u);
+  CHECK(reg.Accessed(0u, 1u));
+
+  Register<nx::uint64_t> wide(0u);
+  nx::Bits<nx::uint64_t>::Write(&wide, Whole() = 42u);
+  CHECK(wide.value() == 42u);
+  CHECK(wide.Accessed(0u, 1u));
+
+  Register<nx::int8_t> narrow(1);
+  nx::Bits<nx::int8_t>::Write(&narrow, Signed() = -1);
+  CHECK(narrow.value() == -1);
+  CHECK(narrow.Accessed(1u, 1u));
+
+  return test::Finish();
+}
@@ -0,0 +1,330 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_span_test.cc
+/// @brief Checks every BitSpan kernel the processor supports, not only the
+/// one dispatched to, against an element-at-a-time reference, for lengths
+/// about each kernel's block sizes and for results stored over an operand;
+/// then each BitSpan operation, for elements of every width and signedness,
+/// and single bits either side of each element boundary.  Exits nonzero on
+/// failure.
+
+#include <vector>
+
+#include "nx/core/bit_span.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// The set bits of value, counted one at a time.
+template <typename T>
+nx::uint64_t PopCountReference(T value) {
+  nx::MakeUnsigned<T> bits = static_cast<nx::MakeUnsigned<T>>(value);
+  nx::uint64_t count = 0;
+  for (; bits; bits = static_cast<nx::MakeUnsigned<T>>(bits & (bits - 1u))) {
+    ++count;
+  }
+  return count;
+}
+
+template <typename T>
+T RandomElement() {
+  typedef nx::MakeUnsigned<T> unsigned_type;
+  unsigned_type value = static_cast<unsigned_type>(test::Random());
+  for (size_t i = sizeof(nx::uint64_t); i < sizeof(T);
+      i += sizeof(nx::uint64_t)) {
+    value = static_cast<unsigned_type>(
+        (value << (sizeof(T) > sizeof(nx::uint64_t) ? 64u : 0u)) |
+        test::Random());
+  }
+  return static_cast<T>(value);
+}
+
+// length elements, all clear, all set, or random, and in the last case
+// sometimes sparse.
+template <typename T>
+std::vector<T> RandomSpan(size_t length) {
+  std::vector<T> span(length);
+  const unsigned int fill = static_cast<unsigned int>(test::Random() % 4u);
+  for (size_t i = 0; i < length; ++i) {
+    span[i] = (fill == 0 ? static_cast<T>(0) : fill == 1 ?
+        static_cast<T>(~static_cast<T>(0)) : fill == 2 ?
+        RandomElement<T>() : static_cast<T>(RandomElement<T>() &
+            RandomElement<T>() & RandomElement<T>()));
+  }
+  return span;
+}
+
+// Lengths of 0 and 1, and one either side of each multiple of the kernels'
+// blocks: a 32-byte vector, a pair of 64-byte vectors, and the sixteen
+// vectors of a Harley-Seal step.
+template <typename T>
+std::vector<size_t> Lengths() {
+  static const size_t kBlocks[] = {32u, 64u, 128u, 512u};
+  std::vector<size_t> lengths;
+  lengths.push_back(0u);
+  lengths.push_back(1u);
+  for (size_t b = 0; b < sizeof(kBlocks) / sizeof(kBlocks[0]); ++b) {
+    for (size_t multiple = 1; multiple <= 3u; ++multiple) {
+      const size_t length = multiple * kBlocks[b] / sizeof(T);
+      for (size_t i = length - 1u; i <= length + 1u; ++i) {
+        lengths.push_back(i);
+      }
+    }
+  }
+  return lengths;
+}
+
+struct And {
+  template <typename T>
+  static T Apply(T lhs, T rhs) {
+    return static_cast<T>(lhs & rhs);
+  }
+};
+struct Or {
+  template <typename T>
+  static T Apply(T lhs, T rhs) {
+    return static_cast<T>(lhs | rhs);
+  }
+};
+struct Xor {
+  template <typename T>
+  static T Apply(T lhs, T rhs) {
+    return static_cast<T>(lhs ^ rhs);
+  }
+};
+struct AndNot {
+  template <typename T>
+  static T Apply(T lhs, T rhs) {
+    return static_cast<T>(lhs & ~rhs);
+  }
+};
+
+template <typename T>
+void CheckPopCount(
+    typename nx::detail::BitSpanKernels<T>::PopCountKernel kernel) {
+  const std::vector<size_t> lengths = Lengths<T>();
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    const std::vector<T> span = RandomSpan<T>(lengths[l]);
+    nx::uint64_t expected = 0;
+    for (size_t i = 0; i < span.size(); ++i) {
+      expected += PopCountReference(span[i]);
+    }
+    CHECK(kernel(span.data(), span.size()) == expected);
+  }
+}
+
+// Checks a combining kernel against Reference, storing to a separate span
+// and over each operand if kStore, and counting if kCount.  The spans are
+// exactly as long as needed, so that sanitizers see any access beyond.
+template <typename T, class Reference, bool kStore, bool kCount>
+void CheckCombine(
+    typename nx::detail::BitSpanKernels<T>::CombineKernel kernel) {
+  const std::vector<size_t> lengths = Lengths<T>();
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    const std::vector<T> lhs = RandomSpan<T>(lengths[l]);
+    const std::vector<T> rhs = RandomSpan<T>(lengths[l]);
+    std::vector<T> expected(lhs.size());
+    nx::uint64_t count = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      expected[i] = Reference::Apply(lhs[i], rhs[i]);
+      count += PopCountReference(expected[i]);
+    }
+    if (!kStore) {
+      CHECK(kernel(lhs.data(), rhs.data(), lhs.size(), nullptr) == count);
+      continue;
+    }
+    std::vector<T> result(lhs.size());
+    const nx::uint64_t counted =
+        kernel(lhs.data(), rhs.data(), lhs.size(), result.data());
+    CHECK(result == expected);
+    CHECK(!kCount || counted == count);
+    // the result stored over either operand
+    std::vector<T> left(lhs);
+    CHECK(kernel(left.data(), rhs.data(), left.size(), left.data()) ==
+        counted);
+    CHECK(left == expected);
+    std::vector<T> right(rhs);
+    CHECK(kernel(lhs.data(), right.data(), right.size(), right.data()) ==
+        counted);
+    CHECK(right == expected);
+  }
+}
+
+// Checks each of the kernels for Operation that the processor supports.
+template <typename T, class Operation, class Reference, bool kStore,
+    bool kCount>
+void CheckCombineKernels() {
+  typedef nx::detail::BitSpanKernels<T> Kernels;
+  CheckCombine<T, Reference, kStore, kCount>(
+      &Kernels::template CombineScalar<Operation, kStore, kCount>);
+#if defined(NX_SIMD_X86)
+  if (nx::Cpu::Supports(nx::Cpu::kPopCnt)) {
+    CheckCombine<T, Reference, kStore, kCount>(
+        &Kernels::template CombinePopCnt<Operation, kStore, kCount>);
+  }
+  if (nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckCombine<T, Reference, kStore, kCount>(
+        &Kernels::template CombineAvx2<Operation, kStore, kCount>);
+  }
+#if defined(NX_SIMD_AVX512)
+  const typename Kernels::CombineKernel avx512 =
+      Kernels::template SelectAvx512<Operation, kStore>(
+          nx::Bool<kCount>());
+  if (avx512) {
+    CheckCombine<T, Reference, kStore, kCount>(avx512);
+  }
+#endif
+#endif
+}
+
+template <typename T, class Operation, class Reference>
+void CheckOperation() {
+  CheckCombineKernels<T, Operation, Reference, true, false>();
+  CheckCombineKernels<T, Operation, Reference, true, true>();
+  CheckCombineKernels<T, Operation, Reference, false, true>();
+}
+
+template <typename T>
+void CheckKernels() {
+  typedef nx::detail::BitSpanKernels<T> Kernels;
+  CheckPopCount<T>(&Kernels::PopCountScalar);
+#if defined(NX_SIMD_X86)
+  if (nx::Cpu::Supports(nx::Cpu::kPopCnt)) {
+    CheckPopCount<T>(&Kernels::PopCountPopCnt);
+  }
+  if (nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckPopCount<T>(&Kernels::PopCountAvx2);
+  }
+#if defined(NX_SIMD_AVX512)
+  if (nx::Cpu::Supports(nx::Cpu::kAvx512VPopCntDq)) {
+    CheckPopCount<T>(&Kernels::PopCountAvx512);
+  }
+#endif
+#endif
+  CheckOperation<T, typename Kernels::AndOperation, And>();
+  CheckOperation<T, typename Kernels::OrOperation, Or>();
+  CheckOperation<T, typename Kernels::XorOperation, Xor>();
+  CheckOperation<T, typename Kernels::AndNotOperation, AndNot>();
+}
+
+// Checks the dispatched operations of BitSpan<T> against the reference,
+// for T of either signedness, through every overload.
+template <typename T>
+void CheckSpan() {
+  typedef nx::BitSpan<T> Span;
+  const std::vector<size_t> lengths = Lengths<T>();
+  for (size_t l = 0; l < lengths.size(); ++l) {
+    const std::vector<T> lhs = RandomSpan<T>(lengths[l]);
+    const std::vector<T> rhs = RandomSpan<T>(lengths[l]);
+    const size_t length = lhs.size();
+    std::vector<T> expected[4];
+    nx::uint64_t counts[4] = {0, 0, 0, 0};
+    nx::uint64_t count = 0;
+    for (size_t i = 0; i < length; ++i) {
+      count += PopCountReference(lhs[i]);
+      expected[0].push_back(And::Apply(lhs[i], rhs[i]));
+      expected[1].push_back(Or::Apply(lhs[i], rhs[i]));
+      expected[2].push_back(Xor::Apply(lhs[i], rhs[i]));
+      expected[3].push_back(AndNot::Apply(lhs[i], rhs[i]));
+      for (size_t o = 0; o < 4u; ++o) {
+        counts[o] += PopCountReference(expected[o][i]);
+      }
+    }
+    CHECK(Span::PopCount(lhs.data(), length) == count);
+
+    std::vector<T> result(length);
+    Span::And(lhs.data(), rhs.data(), length, result.data());
+    CHECK(result == expected[0]);
+    Span::Or(lhs.data(), rhs.data(), length, result.data());
+    CHECK(result == expected[1]);
+    Span::Xor(lhs.data(), rhs.data(), length, result.data());
+    CHECK(result == expected[2]);
+    Span::AndNot(lhs.data(), rhs.data(), length, result.data());
+    CHECK(result == expected[3]);
+
+    CHECK(Span::AndPopCount(lhs.data(), rhs.data(), length) == counts[0]);
+    CHECK(Span::OrPopCount(lhs.data(), rhs.data(), length) == counts[1]);
+    CHECK(Span::XorPopCount(lhs.data(), rhs.data(), length) == counts[2]);
+    CHECK(Span::AndNotPopCount(lhs.data(), rhs.data(), length) ==
+        counts[3]);
+
+    std::vector<T> left(lhs);
+    CHECK(Span::AndPopCount(left.data(), rhs.data(), length, left.data()) ==
+        counts[0]);
+    CHECK(left == expected[0]);
+    left = lhs;
+    CHECK(Span::OrPopCount(left.data(), rhs.data(), length, left.data()) ==
+        counts[1]);
+    CHECK(left == expected[1]);
+    std::vector<T> right(rhs);
+    CHECK(Span::XorPopCount(lhs.data(), right.data(), length,
+        right.data()) == counts[2]);
+    CHECK(right == expected[2]);
+    right = rhs;
+    CHECK(Span::AndNotPopCount(lhs.data(), right.data(), length,
+        right.data()) == counts[3]);
+    CHECK(right == expected[3]);
+  }
+
+  // a single bit at each position of the first elements, so on each side
+  // of every element boundary, the sign bit included
+  const size_t kLength = 3u;
+  const unsigned int bits = nx::Bits<T>::Size();
+  for (unsigned int bit = 0; bit < kLength * bits; ++bit) {
+    std::vector<T> span(kLength, static_cast<T>(0));
+    span[bit / bits] = static_cast<T>(
+        static_cast<nx::MakeUnsigned<T>>(1u) << (bit % bits));
+    std::vector<T> all(kLength, static_cast<T>(~static_cast<T>(0)));
+    CHECK(Span::PopCount(span.data(), kLength) == 1u);
+    CHECK(Span::AndPopCount(span.data(), all.data(), kLength) == 1u);
+    CHECK(Span::AndNotPopCount(all.data(), span.data(), kLength) ==
+        kLength * bits - 1u);
+    Span::Xor(all.data(), span.data(), kLength, all.data());
+    CHECK(Span::OrPopCount(all.data(), span.data(), kLength) ==
+        kLength * bits);
+    CHECK(((all[bit / bits] >> (bit % bits)) & 1u) == 0);
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckKernels<nx::uint8_t>();
+  CheckKernels<nx::uint16_t>();
+  CheckKernels<nx::uint32_t>();
+  CheckKernels<nx::uint64_t>();
+#if defined(__SIZEOF_INT128__)
+  CheckKernels<nx::uint_t<128>>();
+#endif
+
+  CheckSpan<nx::uint8_t>();
+  CheckSpan<nx::int8_t>();
+  CheckSpan<nx::uint16_t>();
+  CheckSpan<nx::int16_t>();
+  CheckSpan<nx::uint32_t>();
+  CheckSpan<nx::int32_t>();
+  CheckSpan<nx::uint64_t>();
+  CheckSpan<nx::int64_t>();
+#if defined(__SIZEOF_INT128__)
+  CheckSpan<nx::uint_t<128>>();
+  CheckSpan<nx::int_t<128>>();
+#endif
+
+  return test::Finish();
+}
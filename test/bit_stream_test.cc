@@ -0,0 +1,203 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_stream_test.cc
+/// @brief Checks that fields of random widths written by BitWriter read back
+/// from BitReader through Peek() and Consume(), Read(), and the bulk reads,
+/// for streams of every length near the end of the buffer, where refills
+/// must not read past it.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/bit_stream.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+nx::uint64_t Low(nx::uint64_t value, unsigned int bits) {
+  return (bits < 64u ? value & ((static_cast<nx::uint64_t>(1) << bits) - 1u) :
+      value);
+}
+
+// A run of fields of the same width.
+struct Run {
+  unsigned int bits;
+  std::vector<nx::uint64_t> values;
+};
+
+// Runs of random widths from 1 to 64 and random lengths, whose values have
+// their high bit set often enough to catch truncation.  Each is written
+// whole with the bulk Write(), or a field at a time.
+std::vector<Run> RandomRuns(size_t count, nx::BitWriter* writer) {
+  std::vector<Run> runs(count);
+  for (size_t r = 0; r < count; ++r) {
+    Run& run = runs[r];
+    run.bits = 1u + test::Random() % 64u;
+    run.values.resize(1u + test::Random() % 20u);
+    for (size_t i = 0; i < run.values.size(); ++i) {
+      nx::uint64_t value = test::Random();
+      if (test::Random() & 1u) {
+        value |= static_cast<nx::uint64_t>(1) << (run.bits - 1u);
+      }
+      run.values[i] = Low(value, run.bits);
+    }
+    if (test::Random() & 1u) {
+      writer->Write(run.values.data(), run.values.size(), run.bits);
+    } else {
+      for (size_t i = 0; i < run.values.size(); ++i) {
+        // bits above the width are ignored
+        writer->Write(run.values[i] |
+            (run.bits < 64u ? test::Random() << run.bits : 0u), run.bits);
+      }
+    }
+  }
+  return runs;
+}
+
+// The total number of bits in runs.
+nx::uint64_t Bits(const std::vector<Run>& runs) {
+  nx::uint64_t bits = 0;
+  for (size_t r = 0; r < runs.size(); ++r) {
+    bits += runs[r].bits * runs[r].values.size();
+  }
+  return bits;
+}
+
+// Reads runs from bytes, a field at a time with Peek() and Consume() where
+// the width allows it and Read() otherwise, or with Read() alone.
+void CheckFields(const std::vector<Run>& runs,
+    const std::vector<nx::uint8_t>& bytes, bool peek) {
+  nx::BitReader reader(bytes.data(), bytes.size());
+  bool exact = true;
+  for (size_t r = 0; r < runs.size(); ++r) {
+    const Run& run = runs[r];
+    for (size_t i = 0; i < run.values.size(); ++i) {
+      nx::uint64_t value;
+      if (peek && run.bits <= 56u) {
+        value = reader.Peek(run.bits);
+        // peeking again, at fewer bits, changes nothing
+        exact = exact && reader.Peek(run.bits / 2u) ==
+            Low(value, run.bits / 2u);
+        reader.Consume(run.bits);
+      } else {
+        value = reader.Read(run.bits);
+      }
+      exact = exact && value == run.values[i];
+    }
+  }
+  CHECK(exact);
+  CHECK(reader.consumed() == Bits(runs));
+  CHECK(!reader.exhausted());
+}
+
+// Reads runs from bytes with the bulk Read(), then reads past the end.
+void CheckBulk(const std::vector<Run>& runs,
+    const std::vector<nx::uint8_t>& bytes) {
+  nx::BitReader reader(bytes.data(), bytes.size());
+  bool exact = true;
+  for (size_t r = 0; r < runs.size(); ++r) {
+    const Run& run = runs[r];
+    std::vector<nx::uint64_t> values(run.values.size() + 1u, 0xabu);
+    reader.Read(run.values.size(), run.bits, values.data());
+    exact = exact && values.back() == 0xabu;
+    values.pop_back();
+    exact = exact && values == run.values;
+  }
+  CHECK(exact);
+  CHECK(!reader.exhausted());
+  // the padding, and then zeros beyond the end
+  const unsigned int padding =
+      static_cast<unsigned int>(bytes.size() * 8u - Bits(runs));
+  CHECK(reader.Read(padding) == 0);
+  CHECK(!reader.exhausted());
+  CHECK(reader.Read(64u) == 0);
+  CHECK(reader.exhausted());
+}
+
+void CheckStreams() {
+  for (unsigned int trial = 0; trial < 2000u; ++trial) {
+    nx::BitWriter writer;
+    // mostly short streams, so that most reads come near the end
+    const std::vector<Run> runs = RandomRuns(
+        1u + test::Random() % (trial % 4u ? 4u : 64u), &writer);
+    CHECK(writer.size() == Bits(runs));
+    const std::vector<nx::uint8_t> finished = writer.Finish();
+    CHECK(writer.size() == 0);
+    CHECK(finished.size() == (Bits(runs) + 7u) / 8u);
+    // exactly the written bytes, so that sanitizers see any reads beyond
+    const std::vector<nx::uint8_t> bytes(finished);
+    CheckFields(runs, bytes, true);
+    CheckFields(runs, bytes, false);
+    CheckBulk(runs, bytes);
+  }
+}
+
+// Writes and reads fields of kBits bits with the templated calls.
+template <unsigned int kBits>
+void CheckWidth() {
+  typedef nx::uint_least_t<kBits> value_type;
+  for (unsigned int trial = 0; trial < 200u; ++trial) {
+    std::vector<value_type> values(test::Random() % 100u);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<value_type>(Low(test::Random(), kBits));
+    }
+    nx::BitWriter writer;
+    // a leading field of another width, so that fields start anywhere
+    const unsigned int offset = static_cast<unsigned int>(test::Random() % 8u);
+    writer.Write(0, offset);
+    writer.Write<kBits>(values.data(), values.size());
+    const std::vector<nx::uint8_t> bytes(writer.Finish());
+    CHECK(bytes.size() == (offset + kBits * values.size() + 7u) / 8u);
+
+    nx::BitReader bulk(bytes.data(), bytes.size());
+    bulk.Read(offset);
+    std::vector<value_type> read(values.size());
+    bulk.Read<kBits>(read.size(), read.data());
+    CHECK(read == values);
+    CHECK(!bulk.exhausted());
+
+    nx::BitReader fields(bytes.data(), bytes.size());
+    fields.Read(offset);
+    bool exact = true;
+    for (size_t i = 0; i < values.size(); ++i) {
+      exact = exact && fields.Read<kBits>() == values[i];
+    }
+    CHECK(exact);
+    CHECK(fields.consumed() == bulk.consumed());
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckStreams();
+  CheckWidth<1>();
+  CheckWidth<3>();
+  CheckWidth<7>();
+  CheckWidth<8>();
+  CheckWidth<13>();
+  CheckWidth<28>();
+  CheckWidth<29>();
+  CheckWidth<32>();
+  CheckWidth<56>();
+  CheckWidth<57>();
+  CheckWidth<63>();
+  CheckWidth<64>();
+
+  return test::Finish();
+}
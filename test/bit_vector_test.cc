@@ -0,0 +1,206 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bit_vector_test.cc
+/// @brief Checks BitVector against a std::vector<bool>, over random
+/// sequences of resizes, single-bit and whole-vector updates and whole-word
+/// operations with vectors of other sizes, for words of every width, with
+/// bits and sizes either side of each word boundary; after each, every bit,
+/// the count, the set bits found in order, and that bits beyond size() stay
+/// clear.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/bit_vector.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+template <typename Word>
+class Model {
+ public:
+  typedef nx::BitVector<Word> Vector;
+
+  Model(size_t size, bool value)
+      : vector_(size, value),
+        bits_(size, value),
+        exact_(true) {
+  }
+
+  bool exact() const {
+    return exact_;
+  }
+  size_t size() const {
+    return bits_.size();
+  }
+
+  void Resize(size_t size, bool value) {
+    vector_.resize(size, value);
+    bits_.resize(size, value);
+  }
+  void Set(size_t index) {
+    vector_.set(index);
+    bits_[index] = true;
+  }
+  void Clear(size_t index) {
+    vector_.clear(index);
+    bits_[index] = false;
+  }
+  void Assign(size_t index, bool value) {
+    vector_.assign(index, value);
+    bits_[index] = value;
+  }
+  void SetAll() {
+    vector_.SetAll();
+    bits_.assign(bits_.size(), true);
+  }
+  void ClearAll() {
+    vector_.ClearAll();
+    bits_.assign(bits_.size(), false);
+  }
+  // Applies op, one of &, |, ^ and AndNot, with other, which is treated as
+  // zero-extended or truncated to this size.
+  void Combine(char op, const Model& other) {
+    switch (op) {
+      case '&':
+        vector_ &= other.vector_;
+        break;
+      case '|':
+        vector_ |= other.vector_;
+        break;
+      case '^':
+        vector_ ^= other.vector_;
+        break;
+      default:
+        vector_.AndNot(other.vector_);
+        break;
+    }
+    for (size_t i = 0; i < bits_.size(); ++i) {
+      const bool bit = (i < other.bits_.size() && other.bits_[i]);
+      bits_[i] = (op == '&' ? bits_[i] && bit : op == '|' ? bits_[i] || bit :
+          op == '^' ? bits_[i] != bit : bits_[i] && !bit);
+    }
+  }
+
+  // Compares every bit, the count, the set bits found in order, and the
+  // bits beyond size() in the final word.
+  void Verify() {
+    const size_t size = bits_.size();
+    const size_t word_size = Vector::WordSize();
+    Expect(vector_.size() == size && vector_.empty() == !size);
+    Expect(vector_.word_count() == (size + word_size - 1u) / word_size);
+    nx::uint64_t count = 0;
+    size_t found = vector_.FindFirst();
+    for (size_t i = 0; i < size; ++i) {
+      Expect(vector_.get(i) == bits_[i]);
+      if (bits_[i]) {
+        ++count;
+        Expect(found == i);
+        found = vector_.FindNext(found);
+      }
+    }
+    Expect(found == size);
+    Expect(vector_.FindNext(size) == size);
+    Expect(vector_.Count() == count);
+    if (size % word_size) {
+      Expect(!(vector_.data()[vector_.word_count() - 1u] >>
+          (size % word_size)));
+    }
+  }
+
+ private:
+  void Expect(bool condition) {
+    exact_ = exact_ && condition;
+  }
+
+  Vector vector_;
+  std::vector<bool> bits_;
+  bool exact_;
+};
+
+// A size or index below limit, mostly either side of a word boundary.
+template <typename Word>
+size_t RandomIndex(size_t limit) {
+  const size_t word_size = nx::BitVector<Word>::WordSize();
+  if (!limit) {
+    return 0;
+  }
+  if (test::Random() % 4u == 0) {
+    return static_cast<size_t>(test::Random() % limit);
+  }
+  const size_t boundary = static_cast<size_t>(
+      test::Random() % (limit / word_size + 1u)) * word_size;
+  const size_t offsets[] = {boundary - 1u, boundary, boundary + 1u};
+  const size_t index = offsets[test::Random() % 3u];
+  return (index < limit ? index : limit - 1u);
+}
+
+template <typename Word>
+void Check() {
+  const size_t kMaximumSize = 10u * nx::BitVector<Word>::WordSize() + 3u;
+  CHECK(nx::BitVector<Word>().empty());
+  for (unsigned int trial = 0; trial < 200u; ++trial) {
+    Model<Word> model(RandomIndex<Word>(kMaximumSize), test::Random() % 2u);
+    model.Verify();
+    for (unsigned int i = 0; i < 200u; ++i) {
+      const size_t size = model.size();
+      const unsigned int choice = static_cast<unsigned int>(
+          test::Random() % 10u);
+      if (choice == 0) {
+        model.Resize(RandomIndex<Word>(kMaximumSize + 1u),
+            test::Random() % 2u);
+      } else if (choice == 1) {
+        if (test::Random() % 2u) {
+          model.SetAll();
+        } else {
+          model.ClearAll();
+        }
+      } else if (choice == 2) {
+        const char kOps[] = {'&', '|', '^', '~'};
+        Model<Word> other(RandomIndex<Word>(kMaximumSize + 1u),
+            test::Random() % 2u);
+        for (size_t j = 0; j < other.size(); j += 1u + test::Random() % 5u) {
+          other.Assign(j, !(test::Random() % 2u));
+        }
+        model.Combine(kOps[test::Random() % 4u], other);
+      } else if (size) {
+        const size_t index = RandomIndex<Word>(size);
+        if (choice < 5u) {
+          model.Set(index);
+        } else if (choice < 8u) {
+          model.Clear(index);
+        } else {
+          model.Assign(index, test::Random() % 2u);
+        }
+      }
+      model.Verify();
+    }
+    CHECK(model.exact());
+  }
+}
+
+}  // namespace
+
+int main() {
+  Check<nx::uint8_t>();
+  Check<nx::uint16_t>();
+  Check<nx::uint32_t>();
+  Check<nx::uint64_t>();
+
+  return test::Finish();
+}
@@ -0,0 +1,135 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file bits_test.cc
+/// @brief Checks Bits over the widest integers integer.h selects, comparing
+/// the runtime operations against bit-at-a-time references.  Exits nonzero
+/// on failure.
+
+#include "nx/core/bits.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+template <typename T>
+T RandomValue() {
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); i += sizeof(nx::uint64_t)) {
+    value = static_cast<T>((value << 32u) << 32u) |
+        static_cast<T>(test::Random());
+  }
+  // sparse values exercise the scans across each half
+  return (test::Random() & 1u ? value : value & (value >> 5u) & (value << 3u));
+}
+
+template <typename T>
+unsigned int ScanForwardReference(T value) {
+  unsigned int index = 0;
+  for (; value && !((value >> index) & 1u); ++index) {
+  }
+  return index;
+}
+
+template <typename T>
+unsigned int ScanReverseReference(T value) {
+  unsigned int index = 0;
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    if ((value >> i) & 1u) {
+      index = i;
+    }
+  }
+  return index;
+}
+
+template <typename T>
+unsigned int PopCountReference(T value) {
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    count += static_cast<unsigned int>((value >> i) & 1u);
+  }
+  return count;
+}
+
+template <typename T>
+T ExtractReference(T value, T mask) {
+  T result = 0;
+  unsigned int shift = 0;
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    if ((mask >> i) & 1u) {
+      result |= static_cast<T>((value >> i) & 1u) << shift++;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+T DepositReference(T value, T mask) {
+  T result = 0;
+  unsigned int shift = 0;
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    if ((mask >> i) & 1u) {
+      result |= static_cast<T>((value >> shift++) & 1u) << i;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+void CheckRuntime() {
+  typedef nx::Bits<T> Bits;
+  for (unsigned int i = 0; i < 100000u; ++i) {
+    const T value = RandomValue<T>();
+    const T mask = RandomValue<T>();
+    CHECK(Bits::ScanForward(value) == ScanForwardReference(value));
+    CHECK(Bits::ScanReverse(value) == ScanReverseReference(value));
+    CHECK(Bits::PopCount(value) == PopCountReference(value));
+    CHECK(Bits::Extract(value, mask) == ExtractReference(value, mask));
+    CHECK(Bits::Deposit(value, mask) == DepositReference(value, mask));
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckRuntime<nx::uint64_t>();
+#if defined(__SIZEOF_INT128__)
+  // otherwise uint_least_t<128> is a Multiword, which Bits does not support
+  CheckRuntime<nx::uint_least_t<128>>();
+
+  typedef nx::uint_least_t<128> Wide;
+  typedef nx::Bits<Wide> Bits;
+  static_assert(Bits::Size() >= 128u, "uint_least_t<128> is too narrow.");
+  const Wide high = static_cast<Wide>(1u) << 100u;
+  CHECK(Bits::ScanForward(high) == 100u);
+  CHECK(Bits::ScanReverse(high | 8u) == 100u);
+  CHECK(Bits::PopCount(high | 1u) == 2u);
+  static_assert(Bits::ScanReverse<(static_cast<Wide>(1u) << 100u) | 8u>() ==
+      100u, "compile-time ScanReverse");
+  static_assert(nx::Bits<nx::int_least_t<128>>::PopCount<-1>() ==
+      Bits::Size(), "compile-time PopCount");
+#endif
+
+  // beyond the builtin widths, integer.h alone provides a complete type
+  typedef nx::uint_least_t<200> Multiword;
+  static_assert(sizeof(Multiword) == 32u, "uint_least_t<200> is 4 words.");
+  const Multiword product = Multiword(1u << 31u) * Multiword(6u);
+  CHECK(static_cast<nx::uint64_t>(product) == (1ull << 32u) * 3u);
+  CHECK(static_cast<nx::int32_t>(nx::int_least_t<200>(-3)) == -3);
+
+  return test::Finish();
+}
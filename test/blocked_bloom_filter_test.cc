@@ -0,0 +1,175 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file blocked_bloom_filter_test.cc
+/// @brief Checks that BlockedBloomFilter has no false negatives, single or
+/// in bulk, and a false positive rate near that expected, and that the bulk
+/// kernels of every instruction set the processor supports set and test
+/// exactly the bits of single-key insertion, for any count.  Exits nonzero
+/// on failure.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "nx/core/blocked_bloom_filter.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+typedef nx::detail::BlockedBloomFilterKernels Kernels;
+
+// count blocks aligned to 64 bytes.
+class Blocks {
+ public:
+  explicit Blocks(size_t count)
+      : count_(count),
+        words_(count * Kernels::kBlockWords + (Kernels::kBlockWords - 1u),
+            0) {
+  }
+
+  nx::uint64_t* data() {
+    const size_t misalignment = static_cast<size_t>(
+        (reinterpret_cast<nx::uintptr_t>(words_.data()) /
+            sizeof(nx::uint64_t)) % Kernels::kBlockWords);
+    return words_.data() +
+        (Kernels::kBlockWords - misalignment) % Kernels::kBlockWords;
+  }
+  bool operator==(Blocks& other) {
+    return count_ == other.count_ && std::equal(data(),
+        data() + count_ * Kernels::kBlockWords, other.data());
+  }
+
+ private:
+  size_t count_;
+  std::vector<nx::uint64_t> words_;
+};
+
+std::vector<nx::uint64_t> RandomHashes(size_t count) {
+  std::vector<nx::uint64_t> hashes(count);
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = test::Random();
+  }
+  return hashes;
+}
+
+typedef void (*InsertKernel)(nx::uint64_t*, size_t, const nx::uint64_t*,
+    size_t);
+typedef void (*ContainsKernel)(const nx::uint64_t*, size_t,
+    const nx::uint64_t*, size_t, bool*);
+
+// Checks the bulk kernels against single-key insertion and lookup, for
+// every count up to several prefetch distances and into filters of one or
+// many blocks.  The hashes and results are exactly count long, so that
+// sanitizers see any access beyond.
+void CheckKernels(InsertKernel insert, ContainsKernel contains) {
+  const size_t kBlockCounts[] = {1u, 2u, 3u, 64u, 1000u};
+  for (size_t b = 0; b < sizeof(kBlockCounts) / sizeof(kBlockCounts[0]);
+      ++b) {
+    const size_t block_count = kBlockCounts[b];
+    Blocks single(block_count);
+    Blocks bulk(block_count);
+    for (size_t count = 0; count <= 40u; ++count) {
+      const std::vector<nx::uint64_t> hashes = RandomHashes(count);
+      for (size_t i = 0; i < count; ++i) {
+        Kernels::Insert(single.data(), block_count, hashes[i]);
+      }
+      insert(bulk.data(), block_count, hashes.data(), count);
+      CHECK(bulk == single);
+
+      // inserted hashes interleaved with others, that may or may not be
+      // reported present
+      std::vector<nx::uint64_t> probes = RandomHashes(count);
+      for (size_t i = 0; i < count; i += 2u) {
+        probes[i] = hashes[i];
+      }
+      std::unique_ptr<bool[]> results(new bool[count]);
+      contains(bulk.data(), block_count, probes.data(), count,
+          results.get());
+      bool exact = true;
+      for (size_t i = 0; i < count; ++i) {
+        exact = exact && results[i] ==
+            Kernels::Contains(single.data(), block_count, probes[i]);
+        exact = exact && (i % 2u || results[i]);
+      }
+      CHECK(exact);
+    }
+  }
+}
+
+void CheckFilter() {
+  // rounded up to whole blocks
+  CHECK(nx::BlockedBloomFilter(0).size() == 512u);
+  CHECK(nx::BlockedBloomFilter(1u).size() == 512u);
+  CHECK(nx::BlockedBloomFilter(512u).size() == 512u);
+  CHECK(nx::BlockedBloomFilter(513u).size() == 1024u);
+
+  // ten bits per key
+  const size_t kKeys = 100000u;
+  nx::BlockedBloomFilter filter(kKeys * 10u);
+  const std::vector<nx::uint64_t> hashes = RandomHashes(kKeys);
+  // half singly, half in bulk
+  for (size_t i = 0; i < kKeys / 2u; ++i) {
+    filter.Insert(hashes[i]);
+  }
+  filter.Insert(hashes.data() + kKeys / 2u, kKeys - kKeys / 2u);
+
+  bool present = true;
+  for (size_t i = 0; i < kKeys; ++i) {
+    present = present && filter.Contains(hashes[i]);
+  }
+  CHECK(present);
+  std::unique_ptr<bool[]> results(new bool[kKeys]);
+  filter.Contains(hashes.data(), kKeys, results.get());
+  for (size_t i = 0; i < kKeys; ++i) {
+    present = present && results[i];
+  }
+  CHECK(present);
+
+  // About 1% with eight bits per key in 512-bit blocks; the bound allows
+  // for the variance of blocks' loads, but not for a weakened hash.
+  const std::vector<nx::uint64_t> others = RandomHashes(kKeys);
+  filter.Contains(others.data(), kKeys, results.get());
+  size_t positives = 0;
+  for (size_t i = 0; i < kKeys; ++i) {
+    positives += results[i];
+  }
+  CHECK(positives < kKeys * 3u / 100u);
+
+  filter.Clear();
+  filter.Contains(hashes.data(), kKeys, results.get());
+  bool absent = true;
+  for (size_t i = 0; i < kKeys; ++i) {
+    absent = absent && !results[i] && !filter.Contains(hashes[i]);
+  }
+  CHECK(absent);
+}
+
+}  // namespace
+
+int main() {
+  CheckKernels(&Kernels::InsertScalar, &Kernels::ContainsScalar);
+#if defined(NX_SIMD_X86)
+  if (nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckKernels(&Kernels::InsertAvx2, &Kernels::ContainsAvx2);
+  }
+#endif
+  CheckFilter();
+
+  return test::Finish();
+}
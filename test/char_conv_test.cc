@@ -0,0 +1,231 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file char_conv_test.cc
+/// @brief Checks ToChars and FromChars for every integer width, including
+/// 128-bit ones where the toolchain has them, against digit-at-a-time
+/// references, and the limits and malformed input FromChars must reject.
+/// The sixteen-digit parse is checked in builds that enable SSE4.1.  Exits
+/// nonzero on failure.
+
+#include <string>
+
+#include "nx/core/char_conv.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// Random bits filling all of T, then shifted down so that values of every
+// digit count occur.
+template <typename T>
+T RandomValue() {
+  typedef nx::MakeUnsigned<T> unsigned_type;
+  unsigned_type value = static_cast<unsigned_type>(test::Random());
+  for (unsigned int i = 64u; i < nx::Bits<T>::Size(); i += 64u) {
+    value = static_cast<unsigned_type>(
+        (value << (nx::Bits<T>::Size() > 64u ? 64u : 0u)) | test::Random());
+  }
+  if (test::Random() & 1u) {
+    value = static_cast<unsigned_type>(
+        value >> (test::Random() % nx::Bits<T>::Size()));
+  }
+  return static_cast<T>(value);
+}
+
+template <typename T>
+T Minimum() {
+  return static_cast<T>(nx::IsSigned<T>::value ?
+      static_cast<nx::MakeUnsigned<T>>(1u) << (nx::Bits<T>::Size() - 1u) :
+      0u);
+}
+
+template <typename T>
+T Maximum() {
+  return static_cast<T>(~Minimum<T>());
+}
+
+// value plus delta, wrapping.
+template <typename T>
+T Add(T value, unsigned int delta) {
+  return static_cast<T>(static_cast<nx::MakeUnsigned<T>>(value) + delta);
+}
+
+// The digits of value, one at a time.
+template <typename T>
+std::string Reference(T value) {
+  typedef nx::MakeUnsigned<T> unsigned_type;
+  const bool negative = (value < static_cast<T>(0));
+  unsigned_type magnitude = static_cast<unsigned_type>(value);
+  if (negative) {
+    magnitude = static_cast<unsigned_type>(0u - magnitude);
+  }
+  std::string text;
+  do {
+    text.insert(text.begin(), static_cast<char>('0' + magnitude % 10u));
+    magnitude = static_cast<unsigned_type>(magnitude / 10u);
+  } while (magnitude);
+  return (negative ? "-" : "") + text;
+}
+
+// The decimal digits in text, plus one.
+std::string Increment(std::string text) {
+  size_t i = text.size();
+  while (i && text[i - 1u] == '9') {
+    text[--i] = '0';
+  }
+  if (i && text[i - 1u] != '-') {
+    ++text[i - 1u];
+  } else {
+    text.insert(i, "1");
+  }
+  return text;
+}
+
+// Whether FromChars reads exactly text as expected.
+template <typename T>
+bool Reads(const std::string& text, T expected) {
+  T value = Add(expected, 1u);
+  return nx::FromChars(text.data(), text.size(), &value) == text.size() &&
+      value == expected;
+}
+
+// Whether FromChars rejects text, leaving the value unchanged.
+template <typename T>
+bool Rejects(const std::string& text) {
+  T value = static_cast<T>(42u);
+  return nx::FromChars(text.data(), text.size(), &value) == 0 &&
+      value == static_cast<T>(42u);
+}
+
+template <typename T>
+void CheckValue(T value) {
+  char text[nx::MaxChars<T>() + 1u];
+  text[nx::MaxChars<T>()] = '#';
+  const size_t size = nx::ToChars(value, text);
+  const std::string expected = Reference(value);
+  CHECK(std::string(text, size) == expected);
+  CHECK(text[nx::MaxChars<T>()] == '#');
+  CHECK(Reads(expected, value));
+  // leading zeros, after any sign
+  std::string padded = expected;
+  padded.insert(value < static_cast<T>(0) ? 1u : 0u,
+      std::string(1u + test::Random() % 40u, '0'));
+  CHECK(Reads(padded, value));
+  // reading stops at the first non-digit, whatever follows it
+  const std::string terminated = expected + (test::Random() & 1u ? "x9" : ".5");
+  T read = Add(value, 1u);
+  CHECK(nx::FromChars(terminated.data(), terminated.size(), &read) ==
+      expected.size());
+  CHECK(read == value);
+}
+
+template <typename T>
+void CheckType(unsigned int trials) {
+  const T edges[] = {static_cast<T>(0), static_cast<T>(1),
+      static_cast<T>(9), static_cast<T>(10), static_cast<T>(99),
+      static_cast<T>(100), Minimum<T>(), Maximum<T>(),
+      Add(Minimum<T>(), 1u), Add(Maximum<T>(), ~0u),
+      static_cast<T>(-1)};
+  for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i) {
+    CheckValue(edges[i]);
+  }
+  // every power of ten that fits, and its neighbours
+  for (T power = 1; ; power = static_cast<T>(power * 10u)) {
+    CheckValue(power);
+    CheckValue(Add(power, ~0u));
+    CheckValue(Add(power, 1u));
+    if (power > Maximum<T>() / static_cast<T>(10)) {
+      break;
+    }
+  }
+  for (unsigned int trial = 0; trial < trials; ++trial) {
+    CheckValue(RandomValue<T>());
+  }
+  CHECK(Reference(Maximum<T>()).size() + nx::IsSigned<T>::value <=
+      nx::MaxChars<T>());
+  CHECK(Reference(Minimum<T>()).size() <= nx::MaxChars<T>());
+
+  // one beyond either limit
+  CHECK(Rejects<T>(Increment(Reference(Maximum<T>()))));
+  CHECK(Rejects<T>(Increment(Reference(Maximum<T>())) + "0"));
+  if (nx::IsSigned<T>::value) {
+    CHECK(Rejects<T>(Increment(Reference(Minimum<T>()))));
+  }
+  // no digits
+  CHECK(Rejects<T>(""));
+  CHECK(Rejects<T>("-"));
+  CHECK(Rejects<T>("+1"));
+  CHECK(Rejects<T>(" 1"));
+  CHECK(Rejects<T>("x"));
+  // a negative zero is zero, but only where there is a sign
+  if (nx::IsSigned<T>::value) {
+    CHECK(Reads("-0", static_cast<T>(0)));
+    CHECK(Reads("-000", static_cast<T>(0)));
+  } else {
+    CHECK(Rejects<T>("-0"));
+    CHECK(Rejects<T>("-1"));
+  }
+  CHECK(Reads(std::string(100u, '0'), static_cast<T>(0)));
+}
+
+// Checks DecimalText::Parse of every count of digits against a loop, both
+// where 16 characters may be read, as the SSE4.1 parse requires, and where
+// only the digits may.
+void CheckParse() {
+  typedef nx::detail::DecimalText DecimalText;
+  for (unsigned int trial = 0; trial < 1000u; ++trial) {
+    char text[DecimalText::kMaxDigits + 16u];
+    for (size_t i = 0; i < sizeof(text); ++i) {
+      text[i] = static_cast<char>('0' + test::Random() % 10u);
+    }
+    for (unsigned int count = 0; count <= DecimalText::kMaxDigits;
+        ++count) {
+      nx::uint64_t expected = 0;
+      for (unsigned int i = 0; i < count; ++i) {
+        expected = expected * 10u + static_cast<nx::uint64_t>(text[i] - '0');
+      }
+      CHECK(DecimalText::Parse(text, count, sizeof(text)) == expected);
+      CHECK(DecimalText::Parse(text, count, count) == expected);
+      CHECK(DecimalText::DigitRun(text, count) == count);
+    }
+    // a non-digit anywhere in the first sixteen characters
+    const size_t stop = test::Random() % 16u;
+    text[stop] = static_cast<char>(test::Random() & 1u ? '/' : ':');
+    CHECK(DecimalText::DigitRun(text, sizeof(text)) == stop);
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckType<nx::uint8_t>(1000u);
+  CheckType<nx::int8_t>(1000u);
+  CheckType<nx::uint16_t>(10000u);
+  CheckType<nx::int16_t>(10000u);
+  CheckType<nx::uint32_t>(10000u);
+  CheckType<nx::int32_t>(10000u);
+  CheckType<nx::uint64_t>(10000u);
+  CheckType<nx::int64_t>(10000u);
+#if defined(__SIZEOF_INT128__)
+  CheckType<nx::uint_t<128>>(10000u);
+  CheckType<nx::int_t<128>>(10000u);
+#endif
+  CheckParse();
+
+  return test::Finish();
+}
@@ -0,0 +1,246 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file concurrent_id_allocator_test.cc
+/// @brief Checks that ConcurrentIdAllocator hands out each index below its
+/// capacity, and none beyond, to one holder at a time: alone, through single
+/// and batch calls, and with several threads allocating and freeing at once.
+/// Build with -pthread.  Exits nonzero on failure.
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "nx/core/concurrent_id_allocator.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+typedef nx::ConcurrentIdAllocator<> Allocator;
+typedef Allocator::index_type Index;
+
+// Whether every index of allocator is free, and none beyond its capacity
+// can be allocated.
+bool AllFree(Allocator* allocator) {
+  for (size_t i = 0; i < allocator->capacity(); ++i) {
+    if (!allocator->IsFree(static_cast<Index>(i))) {
+      return false;
+    }
+  }
+  std::vector<Index> indexes(allocator->capacity() + 64u);
+  const size_t allocated = allocator->Allocate(indexes.size(),
+      indexes.data());
+  allocator->Free(allocated, indexes.data());
+  return allocated == allocator->capacity();
+}
+
+// Allocates everything from one thread, through single and batch calls,
+// then frees it all in a random order through both.
+void CheckExhaustion(size_t capacity) {
+  Allocator allocator(capacity);
+  CHECK(allocator.capacity() == capacity);
+  CHECK(AllFree(&allocator));
+  std::vector<Index> held;
+  std::vector<bool> seen(capacity, false);
+  bool unique = true;
+  while (held.size() < capacity) {
+    // single indexes, batches within a word's free bits, and batches that
+    // span several words
+    std::vector<Index> batch(1u + test::Random() % (test::Random() & 1u ?
+        8u : 200u));
+    if (batch.size() == 1u) {
+      batch[0] = allocator.Allocate();
+    } else {
+      const size_t wanted = batch.size();
+      batch.resize(allocator.Allocate(wanted, batch.data()));
+      // fewer only once exhausted
+      unique = unique && (batch.size() == wanted ||
+          held.size() + batch.size() == capacity);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      unique = unique && batch[i] < capacity && !seen[batch[i]] &&
+          !allocator.IsFree(batch[i]);
+      if (batch[i] < capacity) {
+        seen[batch[i]] = true;
+      }
+      held.push_back(batch[i]);
+    }
+  }
+  CHECK(unique);
+  CHECK(held.size() == capacity);
+  // exhausted
+  CHECK(allocator.Allocate() == capacity);
+  Index index;
+  CHECK(allocator.Allocate(1u, &index) == 0);
+  CHECK(allocator.Allocate(0u, &index) == 0);
+
+  // one freed index is the only one allocated again
+  if (capacity) {
+    const Index freed = held[test::Random() % held.size()];
+    allocator.Free(freed);
+    CHECK(allocator.IsFree(freed));
+    Index again[2];
+    CHECK(allocator.Allocate(2u, again) == 1u);
+    CHECK(again[0] == freed);
+  }
+
+  for (size_t i = held.size(); i > 1u; --i) {
+    std::swap(held[i - 1u], held[test::Random() % i]);
+  }
+  for (size_t i = 0; i < held.size(); ) {
+    const size_t count = std::min<size_t>(held.size() - i,
+        test::Random() % 100u);
+    if (count == 0) {
+      allocator.Free(held[i++]);
+      continue;
+    }
+    // sorted batches free each word with a single fetch_and
+    if (test::Random() & 1u) {
+      std::sort(held.begin() + i, held.begin() + i + count);
+    }
+    allocator.Free(count, held.data() + i);
+    i += count;
+  }
+  CHECK(AllFree(&allocator));
+}
+
+// xorshift64 of each thread's own, as test::Random() is not thread safe.
+nx::uint64_t NextRandom(nx::uint64_t* state) {
+  *state ^= *state << 13u;
+  *state ^= *state >> 7u;
+  *state ^= *state << 17u;
+  return *state;
+}
+
+// Threads allocate and free concurrently, single and in batches, marking
+// each index they hold in holders, so that an index handed to two holders
+// at once, or one beyond capacity, is seen.
+void CheckThreads(size_t capacity, unsigned int threads,
+    unsigned int rounds) {
+  Allocator allocator(capacity);
+  std::vector<std::atomic<unsigned int>> holders(capacity);
+  for (size_t i = 0; i < capacity; ++i) {
+    holders[i].store(0, std::memory_order_relaxed);
+  }
+  std::atomic<unsigned int> duplicates(0);
+  std::atomic<unsigned int> out_of_range(0);
+  std::atomic<size_t> allocations(0);
+  std::atomic<bool> start(false);
+
+  const auto work = [&](unsigned int thread) {
+    nx::uint64_t state = 0x9e3779b97f4a7c15ull * (thread + 1u);
+    std::vector<Index> held;
+    // each thread holds about its share of the capacity, so that threads
+    // must take bits from words others are using
+    const size_t share = capacity / threads + 1u;
+    std::vector<Index> batch;
+    // begin together, so that the threads overlap
+    while (!start.load(std::memory_order_acquire)) {
+    }
+    for (unsigned int round = 0; round < rounds; ++round) {
+      if (held.size() < share && NextRandom(&state) % 3u) {
+        batch.resize(1u + NextRandom(&state) % 16u);
+        if (batch.size() == 1u) {
+          batch[0] = allocator.Allocate();
+          if (batch[0] == capacity) {
+            batch.clear();
+          }
+        } else {
+          batch.resize(allocator.Allocate(batch.size(), batch.data()));
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+          if (batch[i] >= capacity) {
+            out_of_range.fetch_add(1u, std::memory_order_relaxed);
+          } else if (holders[batch[i]].exchange(thread + 1u,
+              std::memory_order_relaxed)) {
+            duplicates.fetch_add(1u, std::memory_order_relaxed);
+          } else {
+            held.push_back(batch[i]);
+          }
+        }
+        allocations.fetch_add(batch.size(), std::memory_order_relaxed);
+      } else if (!held.empty()) {
+        // free a random number of the indexes held, from a random point
+        const size_t first = NextRandom(&state) % held.size();
+        const size_t count =
+            1u + NextRandom(&state) % std::min<size_t>(held.size() - first,
+                16u);
+        if (NextRandom(&state) & 1u) {
+          std::sort(held.begin() + first, held.begin() + first + count);
+        }
+        for (size_t i = first; i < first + count; ++i) {
+          if (holders[held[i]].exchange(0, std::memory_order_relaxed) !=
+              thread + 1u) {
+            duplicates.fetch_add(1u, std::memory_order_relaxed);
+          }
+        }
+        if (count == 1u) {
+          allocator.Free(held[first]);
+        } else {
+          allocator.Free(count, held.data() + first);
+        }
+        held.erase(held.begin() + first, held.begin() + first + count);
+      }
+    }
+    for (size_t i = 0; i < held.size(); ++i) {
+      holders[held[i]].store(0, std::memory_order_relaxed);
+    }
+    allocator.Free(held.size(), held.data());
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int thread = 0; thread < threads; ++thread) {
+    workers.push_back(std::thread(work, thread));
+  }
+  start.store(true, std::memory_order_release);
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+  CHECK(duplicates.load() == 0);
+  CHECK(out_of_range.load() == 0);
+  CHECK(allocations.load() >= capacity);
+  CHECK(AllFree(&allocator));
+}
+
+}  // namespace
+
+int main() {
+  // capacities that fill whole words, and those that leave bits of the
+  // last word past capacity, which must never be handed out
+  const size_t kCapacities[] = {0u, 1u, 2u, 63u, 64u, 65u, 127u, 128u, 130u,
+      1000u, 4097u};
+  for (size_t c = 0; c < sizeof(kCapacities) / sizeof(kCapacities[0]);
+      ++c) {
+    for (unsigned int trial = 0; trial < 4u; ++trial) {
+      CheckExhaustion(kCapacities[c]);
+    }
+  }
+  // the thread's hint, shared by every allocator, was left by the largest
+  // and lies beyond the words of a smaller one
+  CheckExhaustion(70u);
+
+  CheckThreads(1u, 4u, 20000u);
+  // long enough that, even on one processor, threads are preempted between
+  // reading a word and claiming its bits, and must retry those contested
+  CheckThreads(65u, 4u, 2000000u);
+  CheckThreads(130u, 8u, 20000u);
+  CheckThreads(1000u, 4u, 50000u);
+
+  return test::Finish();
+}
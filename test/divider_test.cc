@@ -0,0 +1,187 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file divider_test.cc
+/// @brief Checks that Divider's quotients and remainders, one at a time and
+/// in batches, match native division for every width and sign.  Exits
+/// nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/divider.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// Random bits filling all of T.
+template <typename T>
+T RandomValue() {
+  typedef nx::MakeUnsigned<T> unsigned_type;
+  unsigned_type value = static_cast<unsigned_type>(test::Random());
+  for (unsigned int i = 64u; i < nx::Bits<T>::Size(); i += 64u) {
+    value = static_cast<unsigned_type>(
+        (value << (nx::Bits<T>::Size() > 64u ? 64u : 0u)) | test::Random());
+  }
+  return static_cast<T>(value);
+}
+
+template <typename T>
+T Minimum() {
+  return static_cast<T>(nx::IsSigned<T>::value ?
+      static_cast<nx::MakeUnsigned<T>>(1u) << (nx::Bits<T>::Size() - 1u) :
+      0u);
+}
+
+template <typename T>
+T Maximum() {
+  return static_cast<T>(~Minimum<T>());
+}
+
+// Native division, except that Minimum() / -1, which overflows, wraps to
+// Minimum() with no remainder as Divider's does.
+template <typename T>
+bool Overflows(T value, T divisor) {
+  return nx::IsSigned<T>::value && value == Minimum<T>() &&
+      divisor == static_cast<T>(-1);
+}
+
+template <typename T>
+T Quotient(T value, T divisor) {
+  return (Overflows(value, divisor) ? value :
+      static_cast<T>(value / divisor));
+}
+
+template <typename T>
+T Remainder(T value, T divisor) {
+  return (Overflows(value, divisor) ? static_cast<T>(0) :
+      static_cast<T>(value % divisor));
+}
+
+// value + offset, wrapping rather than overflowing.
+template <typename T>
+T Offset(T value, int offset) {
+  return static_cast<T>(static_cast<nx::MakeUnsigned<T>>(value) +
+      static_cast<nx::MakeUnsigned<T>>(offset));
+}
+
+// Divisors and dividends at the edges of T: zero and one, powers of two and
+// their neighbours, the extremes, and their negations where signed.
+template <typename T>
+std::vector<T> EdgeValues() {
+  std::vector<T> values;
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    const T power = static_cast<T>(
+        static_cast<nx::MakeUnsigned<T>>(1u) << i);
+    values.push_back(power);
+    values.push_back(Offset(power, -1));
+    values.push_back(Offset(power, 1));
+  }
+  const size_t count = values.size();
+  for (size_t i = 0; i < count; ++i) {
+    values.push_back(static_cast<T>(0u -
+        static_cast<nx::MakeUnsigned<T>>(values[i])));
+  }
+  values.push_back(Minimum<T>());
+  values.push_back(Maximum<T>());
+  values.push_back(Offset(Maximum<T>(), -1));
+  values.push_back(Offset(Minimum<T>(), 1));
+  const T small[] = {3u, 5u, 6u, 7u, 10u, 25u, 100u, 641u, 1000u};
+  for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); ++i) {
+    values.push_back(small[i]);
+    values.push_back(static_cast<T>(0u - small[i]));
+  }
+  return values;
+}
+
+template <typename T>
+void CheckDivisor(T divisor, const std::vector<T>& values) {
+  const nx::Divider<T> divider(divisor);
+  const size_t count = values.size();
+  std::vector<T> quotients(count);
+  std::vector<T> remainders(count);
+  divider.Divide(values.data(), count, quotients.data());
+  divider.Modulo(values.data(), count, remainders.data());
+  for (size_t i = 0; i < count; ++i) {
+    const T value = values[i];
+    const T quotient = Quotient(value, divisor);
+    const T remainder = Remainder(value, divisor);
+    CHECK(value / divider == quotient);
+    CHECK(value % divider == remainder);
+    CHECK(quotients[i] == quotient);
+    CHECK(remainders[i] == remainder);
+  }
+  // in place, and of a count that leaves a partial vector
+  std::vector<T> in_place(values.begin(), values.end() - (count > 1u));
+  divider.Divide(in_place.data(), in_place.size(), in_place.data());
+  for (size_t i = 0; i < in_place.size(); ++i) {
+    CHECK(in_place[i] == quotients[i]);
+  }
+}
+
+template <typename T>
+void CheckType(unsigned int random_divisors) {
+  std::vector<T> values = EdgeValues<T>();
+  std::vector<T> divisors = values;
+  for (unsigned int i = 0; i < 1000u; ++i) {
+    values.push_back(RandomValue<T>());
+  }
+  for (unsigned int i = 0; i < random_divisors; ++i) {
+    // divisors of every magnitude
+    const nx::MakeUnsigned<T> random = RandomValue<nx::MakeUnsigned<T>>();
+    divisors.push_back(static_cast<T>(
+        random >> (test::Random() % nx::Bits<T>::Size())));
+  }
+  for (size_t i = 0; i < divisors.size(); ++i) {
+    if (divisors[i]) {
+      CheckDivisor(divisors[i], values);
+    }
+  }
+}
+
+// Every dividend by every divisor.
+template <typename T>
+void CheckExhaustive() {
+  std::vector<T> values;
+  for (unsigned int i = 0; i <= static_cast<nx::uint8_t>(~0u); ++i) {
+    values.push_back(static_cast<T>(i));
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i]) {
+      CheckDivisor(values[i], values);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckExhaustive<nx::uint8_t>();
+  CheckExhaustive<nx::int8_t>();
+  CheckType<nx::uint16_t>(1000u);
+  CheckType<nx::int16_t>(1000u);
+  CheckType<nx::uint32_t>(1000u);
+  CheckType<nx::int32_t>(1000u);
+  CheckType<nx::uint64_t>(1000u);
+  CheckType<nx::int64_t>(1000u);
+#if defined(__SIZEOF_INT128__)
+  CheckType<nx::uint128_t>(200u);
+  CheckType<nx::int128_t>(200u);
+#endif
+
+  return test::Finish();
+}
@@ -0,0 +1,173 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file endian_test.cc
+/// @brief Checks ByteSwap, Load and Store for every width and both byte
+/// orders, single and in bulk, against byte-at-a-time references, and that
+/// the byte swap kernels of every instruction set the processor supports
+/// agree for every count up to several registers' worth.  Exits nonzero on
+/// failure.
+
+#include <vector>
+
+#include "nx/core/endian.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+std::vector<nx::uint8_t> RandomBytes(size_t size) {
+  std::vector<nx::uint8_t> bytes(size);
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<nx::uint8_t>(test::Random());
+  }
+  return bytes;
+}
+
+// The T whose bytes in kEndian order are those at bytes, built a byte at a
+// time.
+template <typename T, nx::Endian kEndian>
+T LoadReference(const nx::uint8_t* bytes) {
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    const nx::uint8_t byte =
+        bytes[kEndian == nx::kLittleEndian ? sizeof(T) - 1u - i : i];
+    value = static_cast<T>(static_cast<T>(value << 8u) | byte);
+  }
+  return value;
+}
+
+// Checks single and bulk loads and stores of T in kEndian order, at any
+// alignment.
+template <typename T, nx::Endian kEndian>
+void CheckOrder() {
+  for (unsigned int trial = 0; trial < 1000u; ++trial) {
+    const size_t count = test::Random() % 40u;
+    const size_t offset = test::Random() % sizeof(T);
+    const std::vector<nx::uint8_t> bytes =
+        RandomBytes(offset + count * sizeof(T));
+    std::vector<T> expected(count);
+    bool exact = true;
+    for (size_t i = 0; i < count; ++i) {
+      const nx::uint8_t* source = bytes.data() + offset + i * sizeof(T);
+      expected[i] = LoadReference<T, kEndian>(source);
+      exact = exact && nx::Load<T, kEndian>(source) == expected[i];
+    }
+    CHECK(exact);
+
+    std::vector<T> values(count + 1u, 0);
+    nx::Load<T, kEndian>(bytes.data() + offset, count, values.data());
+    CHECK(values.back() == 0);
+    values.pop_back();
+    CHECK(values == expected);
+
+    // stores touch only their own bytes, so bytes before the offset stay
+    std::vector<nx::uint8_t> stored(bytes.size(), 0);
+    for (size_t i = 0; i < offset; ++i) {
+      stored[i] = bytes[i];
+    }
+    for (size_t i = 0; i < count; ++i) {
+      nx::Store<T, kEndian>(stored.data() + offset + i * sizeof(T),
+          expected[i]);
+    }
+    CHECK(stored == bytes);
+    std::vector<nx::uint8_t> bulk(bytes.size(), 0);
+    for (size_t i = 0; i < offset; ++i) {
+      bulk[i] = bytes[i];
+    }
+    nx::Store<T, kEndian>(bulk.data() + offset, expected.data(), count);
+    CHECK(bulk == bytes);
+  }
+}
+
+template <typename T>
+void CheckType() {
+  CheckOrder<T, nx::kLittleEndian>();
+  CheckOrder<T, nx::kBigEndian>();
+  bool exact = true;
+  std::vector<T> values(100u);
+  std::vector<T> swapped(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    const std::vector<nx::uint8_t> bytes = RandomBytes(sizeof(T));
+    values[i] = LoadReference<T, nx::kLittleEndian>(bytes.data());
+    swapped[i] = LoadReference<T, nx::kBigEndian>(bytes.data());
+    exact = exact && nx::ByteSwap(values[i]) == swapped[i];
+  }
+  CHECK(exact);
+  // in place
+  nx::ByteSwap(values.data(), values.size(), values.data());
+  CHECK(values == swapped);
+}
+
+// Checks kernel against a byte-at-a-time reversal for every count up to
+// several registers' worth, at any alignment and in place.  The buffers
+// are exactly as large as needed, so that sanitizers see any access beyond.
+template <size_t kSize>
+void CheckKernel(
+    typename nx::detail::ByteSwapArray<kSize>::Kernel kernel) {
+  for (size_t count = 0; count <= 200u / kSize; ++count) {
+    const size_t offset = test::Random() % kSize;
+    const std::vector<nx::uint8_t> values =
+        RandomBytes(offset + count * kSize);
+    std::vector<nx::uint8_t> expected(count * kSize);
+    for (size_t i = 0; i < count; ++i) {
+      for (size_t j = 0; j < kSize; ++j) {
+        expected[i * kSize + j] = values[offset + i * kSize + kSize - 1u - j];
+      }
+    }
+    std::vector<nx::uint8_t> results(count * kSize);
+    kernel(values.data() + offset, count, results.data());
+    CHECK(results == expected);
+    std::vector<nx::uint8_t> in_place(values.begin() + offset, values.end());
+    kernel(in_place.data(), count, in_place.data());
+    CHECK(in_place == expected);
+  }
+}
+
+template <size_t kSize>
+void CheckKernels() {
+  typedef nx::detail::ByteSwapArray<kSize> Kernels;
+  CheckKernel<kSize>(&Kernels::Scalar);
+#if defined(NX_SIMD_X86)
+  if (nx::Cpu::Supports(nx::Cpu::kSsse3)) {
+    CheckKernel<kSize>(&Kernels::Ssse3);
+  }
+  if (nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckKernel<kSize>(&Kernels::Avx2);
+  }
+#endif
+}
+
+}  // namespace
+
+int main() {
+  CheckType<nx::uint8_t>();
+  CheckType<nx::uint16_t>();
+  CheckType<nx::uint32_t>();
+  CheckType<nx::uint64_t>();
+#if defined(__SIZEOF_INT128__)
+  CheckType<nx::uint_t<128>>();
+#endif
+  CheckKernels<2>();
+  CheckKernels<4>();
+  CheckKernels<8>();
+#if defined(__SIZEOF_INT128__)
+  CheckKernels<16>();
+#endif
+
+  return test::Finish();
+}
@@ -0,0 +1,313 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file fixed_point_test.cc
+/// @brief Checks that Fixed and Decimal round-trip through text, that Fixed
+/// writes the fewest digits that do, that multiplication and division round
+/// to nearest with ties away from zero for operands of either sign, and that
+/// Parse() rejects values beyond the limits.  Exits nonzero on failure.
+
+#include <stdio.h>
+
+#include <string>
+
+#include "nx/core/fixed_point.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// A random raw value of Number, of either sign, shifted down so that small
+// magnitudes occur as well as large ones.
+template <class Number>
+typename Number::value_type RandomRaw() {
+  nx::uint64_t raw = test::Random() >> (test::Random() % 64u);
+  if (test::Random() & 1u) {
+    raw = 0u - raw;
+  }
+  return static_cast<typename Number::value_type>(raw);
+}
+
+template <class Number>
+std::string Text(const Number& value) {
+  char text[Number::MaxChars() + 1u];
+  text[Number::MaxChars()] = '#';
+  const size_t size = value.Format(text);
+  CHECK(size <= Number::MaxChars());
+  CHECK(text[Number::MaxChars()] == '#');
+  return std::string(text, size);
+}
+
+// Whether Parse() reads all of text as expected.
+template <class Number>
+bool Reads(const std::string& text, const Number& expected) {
+  Number value = -expected + Number::FromRaw(1);
+  return Number::Parse(text.data(), text.size(), &value) == text.size() &&
+      value == expected;
+}
+
+// Whether Parse() rejects text, leaving the value unchanged.
+template <class Number>
+bool Rejects(const std::string& text) {
+  Number value = Number::FromRaw(42);
+  return Number::Parse(text.data(), text.size(), &value) == 0 &&
+      value == Number::FromRaw(42);
+}
+
+// text, which may have a sign and a point, one unit in its last digit
+// further from zero.
+std::string Increment(std::string text) {
+  size_t i = text.size();
+  while (i && (text[i - 1u] == '9' || text[i - 1u] == '.')) {
+    if (text[--i] == '9') {
+      text[i] = '0';
+    }
+  }
+  if (i && text[i - 1u] != '-') {
+    ++text[i - 1u];
+  } else {
+    text.insert(i, "1");
+  }
+  return text;
+}
+
+#if defined(__SIZEOF_INT128__)
+// numerator / denominator rounded to nearest, with ties away from zero,
+// from the magnitudes.
+nx::int128_t Rounded(nx::int128_t numerator, nx::int128_t denominator) {
+  const bool negative = ((numerator < 0) != (denominator < 0));
+  const nx::uint128_t n = static_cast<nx::uint128_t>(
+      numerator < 0 ? -numerator : numerator);
+  const nx::uint128_t d = static_cast<nx::uint128_t>(
+      denominator < 0 ? -denominator : denominator);
+  const nx::uint128_t magnitude = (n * 2u + d) / (d * 2u);
+  return static_cast<nx::int128_t>(negative ? 0u - magnitude : magnitude);
+}
+
+// Checks multiplication and division by random operands of either sign
+// against Rounded(), given the divisor that undoes each raw scale.  Results
+// that do not fit wrap in both.
+template <class Number>
+void CheckArithmetic(nx::int128_t scale, unsigned int trials) {
+  typedef typename Number::value_type value_type;
+  for (unsigned int trial = 0; trial < trials; ++trial) {
+    const Number lhs = Number::FromRaw(RandomRaw<Number>());
+    Number rhs = Number::FromRaw(RandomRaw<Number>());
+    CHECK((lhs * rhs).raw() == static_cast<value_type>(Rounded(
+        static_cast<nx::int128_t>(lhs.raw()) * rhs.raw(), scale)));
+    if (rhs.raw() == 0) {
+      rhs = Number::FromRaw(1);
+    }
+    CHECK((lhs / rhs).raw() == static_cast<value_type>(Rounded(
+        static_cast<nx::int128_t>(lhs.raw()) * scale, rhs.raw())));
+  }
+}
+#endif
+
+template <class Number>
+void CheckFixedText(unsigned int trials) {
+  for (unsigned int trial = 0; trial < trials; ++trial) {
+    const Number value = Number::FromRaw(RandomRaw<Number>());
+    const std::string text = Text(value);
+    CHECK(Reads(text, value));
+    // no fewer fraction digits read back as the same value; the nearest
+    // candidates are the digits before the last, and those one unit larger
+    const size_t point = text.find('.');
+    if (point != std::string::npos) {
+      const std::string shorter = text.substr(0,
+          text.size() - (text.size() - point == 2u ? 2u : 1u));
+      CHECK(!Reads(shorter, value));
+      CHECK(!Reads(Increment(shorter), value));
+    }
+  }
+}
+
+void CheckFixed() {
+  typedef nx::Fixed<8, 8> Fixed8;
+  typedef nx::Fixed<16, 16> Fixed16;
+  typedef nx::Fixed<32, 32> Fixed32;
+
+  CheckFixedText<Fixed8>(10000u);
+  CheckFixedText<Fixed16>(10000u);
+  CheckFixedText<Fixed32>(10000u);
+  CheckFixedText<nx::Fixed<1, 63>>(10000u);
+  CheckFixedText<nx::Fixed<64, 0>>(1000u);
+  CHECK(Text(Fixed8::FromRaw(0x180)) == "1.5");
+  CHECK(Text(Fixed8::FromRaw(1)) == "0.004");
+  CHECK(Text(Fixed8::FromRaw(-1)) == "-0.004");
+  CHECK(Text(Fixed16::FromInteger(-3)) == "-3");
+  CHECK(Text(Fixed16()) == "0");
+  CHECK(Text(Fixed32::FromRaw(1)) == "0.0000000002");
+  CHECK(Fixed8::FromRaw(-1).Integer() == -1);
+  CHECK(Fixed8::FromRaw(0x180).Integer() == 1);
+
+  // a tie in the raw unit rounds away from zero
+  CHECK(Reads("0.001953125", Fixed8::FromRaw(1)));
+  CHECK(Reads("-0.001953125", Fixed8::FromRaw(-1)));
+  CHECK(Reads("0.0019531249", Fixed8()));
+  CHECK(Reads("+1.5", Fixed8::FromRaw(0x180)));
+  CHECK(Reads("2.", Fixed8::FromInteger(2)));
+  CHECK(Reads(".5", Fixed8::FromRaw(0x80)));
+  CHECK(Rejects<Fixed8>("."));
+  CHECK(Rejects<Fixed8>(""));
+  CHECK(Rejects<Fixed8>("-"));
+
+  // the limits of the integer part, and fractions that round past them
+  CHECK(Reads("127.99609375", Fixed8::FromRaw(0x7FFF)));
+  CHECK(Reads("-128", Fixed8::FromRaw(-0x8000)));
+  CHECK(Rejects<Fixed8>("128"));
+  CHECK(Rejects<Fixed8>("-128.001953125"));
+  CHECK(Rejects<Fixed8>("127.999"));
+  CHECK(Reads("-2147483648", Fixed32::FromInteger(-2147483647 - 1)));
+  CHECK(Rejects<Fixed32>("2147483648"));
+  CHECK(Rejects<Fixed32>("2147483647.9999999999"));
+  CHECK(Rejects<nx::Fixed<64, 0>>("9223372036854775808"));
+  CHECK(Reads("-9223372036854775808",
+      nx::Fixed<64, 0>::FromRaw(-9223372036854775807ll - 1)));
+  CHECK(Rejects<nx::Fixed<1, 63>>("1"));
+  CHECK(Reads("-1", nx::Fixed<1, 63>::FromRaw(-9223372036854775807ll - 1)));
+
+  // widened multiplication and division, with ties away from zero
+  const Fixed16 half = Fixed16::FromRaw(0x8000);
+  CHECK(Fixed16::FromRaw(0x18000) * -half == Fixed16::FromRaw(-0xC000));
+  CHECK(Fixed16::FromRaw(1) * half == Fixed16::FromRaw(1));
+  CHECK(Fixed16::FromRaw(-1) * half == Fixed16::FromRaw(-1));
+  CHECK(-Fixed16::FromRaw(1) * -half == Fixed16::FromRaw(1));
+  CHECK(Fixed16::FromInteger(1) / Fixed16::FromInteger(3) ==
+      Fixed16::FromRaw(0x5555));
+  CHECK(Fixed16::FromInteger(-2) / Fixed16::FromInteger(3) ==
+      Fixed16::FromRaw(-0xAAAB));
+  CHECK(Fixed16::FromRaw(1) / Fixed16::FromInteger(-2) ==
+      Fixed16::FromRaw(-1));
+#if defined(__SIZEOF_INT128__)
+  CheckArithmetic<Fixed8>(1 << 8, 100000u);
+  CheckArithmetic<Fixed16>(1 << 16, 100000u);
+  CheckArithmetic<Fixed32>(static_cast<nx::int128_t>(1) << 32u, 100000u);
+  CheckArithmetic<nx::Fixed<1, 63>>(static_cast<nx::int128_t>(1) << 63u,
+      100000u);
+#endif
+}
+
+// Checks that Format() writes the integer part and exactly kScale fraction
+// digits, and that Parse() reads them back.
+template <unsigned int kDigits, unsigned int kScale>
+void CheckDecimalText(unsigned int trials) {
+  typedef nx::Decimal<kDigits, kScale> Number;
+  nx::uint64_t scale = 1u;
+  for (unsigned int i = 0; i < kScale; ++i) {
+    scale *= 10u;
+  }
+  const nx::uint64_t limit = nx::Bits<nx::uint64_t>::Power<10u, kDigits>();
+  for (unsigned int trial = 0; trial < trials; ++trial) {
+    const nx::uint64_t magnitude = test::Random() % limit /
+        nx::detail::DecimalText::Power10(test::Random() % (kDigits + 1u));
+    const bool negative = (test::Random() & 1u);
+    const Number value = Number::FromRaw(static_cast<
+        typename Number::value_type>(negative ? 0u - magnitude : magnitude));
+    char expected[64];
+    if (kScale) {
+      snprintf(expected, sizeof(expected), "%s%llu.%0*llu",
+          negative && magnitude ? "-" : "",
+          static_cast<unsigned long long>(magnitude / scale),  // NOLINT
+          static_cast<int>(kScale),
+          static_cast<unsigned long long>(magnitude % scale));  // NOLINT
+    } else {
+      snprintf(expected, sizeof(expected), "%s%llu",
+          negative && magnitude ? "-" : "",
+          static_cast<unsigned long long>(magnitude));  // NOLINT
+    }
+    CHECK(Text(value) == expected);
+    CHECK(Reads(expected, value));
+  }
+  // the most negative raw value still fits
+  Text(Number::FromRaw(static_cast<typename Number::value_type>(
+      static_cast<nx::MakeUnsigned<typename Number::value_type>>(1u) <<
+      (nx::Bits<typename Number::value_type>::Size() - 1u))));
+}
+
+void CheckDecimal() {
+  typedef nx::Decimal<18, 4> Money;
+  typedef nx::Decimal<4, 2> Small;
+
+  CheckDecimalText<18, 4>(10000u);
+  CheckDecimalText<9, 2>(10000u);
+  CheckDecimalText<4, 2>(10000u);
+  CheckDecimalText<18, 0>(10000u);
+  CheckDecimalText<18, 18>(10000u);
+  CheckDecimalText<1, 1>(100u);
+  CHECK(Money::FromRaw(-1).Integer() == 0);
+  CHECK(Money::FromRaw(-12345).Integer() == -1);
+
+  // fraction digits beyond kScale round to nearest, ties away from zero
+  CHECK(Reads("1.23455", Money::FromRaw(12346)));
+  CHECK(Reads("-1.23455", Money::FromRaw(-12346)));
+  CHECK(Reads("1.234549999", Money::FromRaw(12345)));
+  CHECK(Reads("0.99995", Money::FromInteger(1)));
+  CHECK(Reads("-0.00005", Money::FromRaw(-1)));
+  CHECK(Reads("-0.00004", Money()));
+  CHECK(Reads("+007.5", Money::FromRaw(75000)));
+
+  // the limits of kDigits, and fractions that round past them
+  CHECK(Reads("99.99", Small::FromRaw(9999)));
+  CHECK(Reads("-99.99", Small::FromRaw(-9999)));
+  CHECK(Rejects<Small>("100"));
+  CHECK(Rejects<Small>("-100"));
+  CHECK(Rejects<Small>("99.995"));
+  CHECK(Rejects<Small>("-99.995"));
+  CHECK(Reads("99.994999", Small::FromRaw(9999)));
+  CHECK(Reads("99999999999999.9999", Money::FromRaw(999999999999999999ll)));
+  CHECK(Rejects<Money>("99999999999999.99995"));
+  CHECK(Rejects<Money>("100000000000000"));
+  CHECK(Reads("999999999999999999",
+      nx::Decimal<18, 0>::FromRaw(999999999999999999ll)));
+  CHECK(Rejects<nx::Decimal<18, 0>>("1000000000000000000"));
+  CHECK(Reads("-0.999999999999999999",
+      nx::Decimal<18, 18>::FromRaw(-999999999999999999ll)));
+  CHECK(Rejects<nx::Decimal<18, 18>>("1"));
+  CHECK(Rejects<nx::Decimal<18, 18>>("0.9999999999999999995"));
+
+  // widened multiplication and division, with ties away from zero
+  CHECK(Money::FromRaw(12345) * Money::FromInteger(-2) ==
+      Money::FromRaw(-24690));
+  CHECK(Money::FromRaw(-12345) * Money::FromInteger(-2) ==
+      Money::FromRaw(24690));
+  CHECK(Text(Money::FromRaw(12345) * Money::FromInteger(-2)) == "-2.4690");
+  CHECK(Small::FromRaw(5) * Small::FromRaw(50) == Small::FromRaw(3));
+  CHECK(Small::FromRaw(-5) * Small::FromRaw(50) == Small::FromRaw(-3));
+  CHECK(Small::FromRaw(5) * Small::FromRaw(-49) == Small::FromRaw(-2));
+  CHECK(Small::FromInteger(1) / Small::FromInteger(3) == Small::FromRaw(33));
+  CHECK(Small::FromInteger(2) / Small::FromInteger(-3) ==
+      Small::FromRaw(-67));
+  CHECK(Small::FromInteger(-1) / Small::FromInteger(8) ==
+      Small::FromRaw(-13));
+  CHECK(Small::FromInteger(-1) / Small::FromInteger(-8) ==
+      Small::FromRaw(13));
+#if defined(__SIZEOF_INT128__)
+  CheckArithmetic<Money>(10000, 100000u);
+  CheckArithmetic<Small>(100, 100000u);
+  CheckArithmetic<nx::Decimal<18, 18>>(1000000000000000000ll, 100000u);
+#endif
+}
+
+}  // namespace
+
+int main() {
+  CheckFixed();
+  CheckDecimal();
+
+  return test::Finish();
+}
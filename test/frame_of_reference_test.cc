@@ -0,0 +1,187 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file frame_of_reference_test.cc
+/// @brief Checks that FrameOfReference round-trips blocks of every width in
+/// both modes, whole and partial, and that the packing and unpacking kernels
+/// of every instruction set the processor supports agree with a plain
+/// reference.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/frame_of_reference.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+// The largest offset of width bits.
+nx::uint32_t Mask(unsigned int width) {
+  return static_cast<nx::uint32_t>((static_cast<nx::uint64_t>(1) << width) -
+      1u);
+}
+
+// A random offset of at most width bits.
+nx::uint32_t RandomOffset(unsigned int width) {
+  return static_cast<nx::uint32_t>(test::Random()) & Mask(width);
+}
+
+// Values for blocks whose offsets in mode need exactly width bits: the
+// first lane of each block is at the reference, and one offset is the
+// largest of width bits.  References leave room for the largest offset, so
+// that values do not wrap below the reference.
+template <unsigned int kBlockSize>
+std::vector<nx::uint32_t> BlockValues(unsigned int width,
+    typename nx::FrameOfReference<kBlockSize>::Mode mode, size_t blocks) {
+  const unsigned int lanes = kBlockSize / 32u;
+  std::vector<nx::uint32_t> values(blocks * kBlockSize);
+  for (size_t block = 0; block < blocks; ++block) {
+    nx::uint32_t* target = values.data() + block * kBlockSize;
+    const nx::uint32_t reference = static_cast<nx::uint32_t>(test::Random() %
+        ((static_cast<nx::uint64_t>(1) << 32u) - Mask(width)));
+    const size_t largest = 1u + test::Random() % (kBlockSize - 1u);
+    for (unsigned int i = 0; i < kBlockSize; ++i) {
+      const nx::uint32_t offset = (i == 0 ? 0u :
+          i == largest ? Mask(width) : RandomOffset(width));
+      if (mode == nx::FrameOfReference<kBlockSize>::kDelta && i >= lanes) {
+        // differences from the value a row earlier, wrapping as they may
+        target[i] = target[i - lanes] + offset;
+      } else {
+        target[i] = reference + offset;
+      }
+    }
+  }
+  return values;
+}
+
+template <unsigned int kBlockSize>
+void CheckRoundTrip(typename nx::FrameOfReference<kBlockSize>::Mode mode) {
+  typedef nx::FrameOfReference<kBlockSize> Codec;
+  for (unsigned int width = 0; width <= 32u; ++width) {
+    const std::vector<nx::uint32_t> values =
+        BlockValues<kBlockSize>(width, mode, 3u);
+    // whole blocks, then a partial block after them, then a lone partial
+    // block; partial blocks are padded, so their widths are not checked
+    const size_t counts[] = {values.size(),
+        values.size() - 1u - test::Random() % (kBlockSize - 1u),
+        1u + test::Random() % (kBlockSize - 1u)};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+      const size_t count = counts[c];
+      std::vector<nx::uint8_t> bytes(Codec::MaxSize(count));
+      const size_t size = Codec::Encode(values.data(), count, mode,
+          bytes.data());
+      CHECK(size <= bytes.size());
+      for (size_t block = 0; block < count / kBlockSize; ++block) {
+        const size_t header = block * (5u + width * kBlockSize / 8u);
+        CHECK((bytes[header] & 0x7fu) == width);
+        CHECK(((bytes[header] & 0x80u) != 0) ==
+            (mode == Codec::kDelta));
+      }
+      std::vector<nx::uint32_t> decoded(count + 1u, 0xdeadbeefu);
+      CHECK(Codec::Decode(bytes.data(), size, count, decoded.data()) ==
+          size);
+      CHECK(std::vector<nx::uint32_t>(decoded.begin(), decoded.end() - 1) ==
+          std::vector<nx::uint32_t>(values.begin(), values.begin() + count));
+      // nothing written past the values
+      CHECK(decoded.back() == 0xdeadbeefu);
+      // truncated input is rejected
+      CHECK(Codec::Decode(bytes.data(), size - 1u, count, decoded.data()) ==
+          0);
+    }
+  }
+  // a width beyond 32 is malformed
+  const nx::uint32_t value = 7u;
+  nx::uint8_t bytes[Codec::MaxSize(1u)];
+  const size_t size = Codec::Encode(&value, 1u, mode, bytes);
+  bytes[0] = static_cast<nx::uint8_t>((bytes[0] & 0x80u) | 33u);
+  nx::uint32_t decoded = 0;
+  CHECK(Codec::Decode(bytes, size, 1u, &decoded) == 0);
+}
+
+// Checks Isa's kernels for kWidth: that Pack stores what the scalar kernel
+// does, and that both modes of Unpack reverse it.
+template <unsigned int kBlockSize, class Isa, unsigned int kWidth>
+void CheckIsa(const nx::uint32_t* offsets, const nx::uint8_t* expected) {
+  typedef nx::detail::FrameOfReferenceKernels<kBlockSize> Kernels;
+  const size_t packed_size = kWidth * kBlockSize / 8u;
+  // exactly the packed bytes, so that sanitizers see any reads beyond them
+  std::vector<nx::uint8_t> packed(packed_size + !packed_size);
+  Isa::Pack(offsets, kWidth, packed.data());
+  CHECK(std::vector<nx::uint8_t>(packed.begin(), packed.begin() +
+      packed_size) == std::vector<nx::uint8_t>(expected, expected +
+      packed_size));
+
+  const nx::uint32_t reference = static_cast<nx::uint32_t>(test::Random());
+  nx::uint32_t values[kBlockSize];
+  Isa::template Unpack<kWidth, false>(packed.data(), reference, values);
+  bool exact = true;
+  for (unsigned int i = 0; i < kBlockSize; ++i) {
+    exact = exact && values[i] == reference + offsets[i];
+  }
+  CHECK(exact);
+  Isa::template Unpack<kWidth, true>(packed.data(), reference, values);
+  exact = true;
+  for (unsigned int i = 0; i < kBlockSize; ++i) {
+    exact = exact && values[i] == (i < Kernels::kLanes ? reference :
+        values[i - Kernels::kLanes]) + offsets[i];
+  }
+  CHECK(exact);
+}
+
+// Checks the kernels for kWidth and every wider width.
+template <unsigned int kBlockSize, unsigned int kWidth>
+void CheckKernels(nx::Bool<false>) {
+}
+template <unsigned int kBlockSize, unsigned int kWidth>
+void CheckKernels(nx::Bool<true>) {
+  typedef nx::detail::FrameOfReferenceKernels<kBlockSize> Kernels;
+  for (unsigned int trial = 0; trial < 4u; ++trial) {
+    nx::uint32_t offsets[kBlockSize];
+    for (unsigned int i = 0; i < kBlockSize; ++i) {
+      offsets[i] = (trial == 0 ? Mask(kWidth) : RandomOffset(kWidth));
+    }
+    nx::uint8_t expected[32u * kBlockSize / 8u];
+    Kernels::Scalar::Pack(offsets, kWidth, expected);
+    CheckIsa<kBlockSize, typename Kernels::Scalar, kWidth>(offsets,
+        expected);
+#if defined(NX_SIMD_X86)
+    if (nx::Cpu::Supports(nx::Cpu::kSse2)) {
+      CheckIsa<kBlockSize, typename Kernels::Sse2, kWidth>(offsets,
+          expected);
+    }
+    // eight lanes at a time, so only for 256-value blocks
+    if (kBlockSize == 256u && nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+      CheckIsa<kBlockSize, typename Kernels::Avx2, kWidth>(offsets,
+          expected);
+    }
+#endif
+  }
+  CheckKernels<kBlockSize, kWidth + 1u>(nx::Bool<(kWidth < 32u)>());
+}
+
+}  // namespace
+
+int main() {
+  CheckRoundTrip<128>(nx::FrameOfReference<128>::kMinimum);
+  CheckRoundTrip<128>(nx::FrameOfReference<128>::kDelta);
+  CheckRoundTrip<256>(nx::FrameOfReference<256>::kMinimum);
+  CheckRoundTrip<256>(nx::FrameOfReference<256>::kDelta);
+  CheckKernels<128, 0>(nx::Bool<true>());
+  CheckKernels<256, 0>(nx::Bool<true>());
+
+  return test::Finish();
+}
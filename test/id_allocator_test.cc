@@ -0,0 +1,187 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file id_allocator_test.cc
+/// @brief Checks that IdAllocator always provides the lowest free index,
+/// against a set of the free indexes, over random sequences of allocations,
+/// claims of chosen indexes and frees, for capacities of one, two, three and
+/// four levels and either side of their word boundaries, and that a full
+/// allocator provides capacity().  Exits nonzero on failure.
+
+#include <set>
+#include <vector>
+
+#include "nx/core/id_allocator.h"
+#include "nx/core/integer.h"
+
+#include "test.h"
+
+namespace {
+
+template <unsigned int kIndexBits>
+class Model {
+ public:
+  typedef nx::IdAllocator<kIndexBits> Allocator;
+  typedef typename Allocator::index_type Index;
+
+  explicit Model(size_t capacity)
+      : allocator_(capacity),
+        exact_(true) {
+    for (size_t i = 0; i < capacity; ++i) {
+      free_.insert(i);
+    }
+  }
+
+  bool exact() const {
+    return exact_;
+  }
+  size_t allocated() const {
+    return allocated_.size();
+  }
+
+  // Allocates the lowest free index.
+  void Allocate() {
+    const Index index = allocator_.Allocate();
+    if (free_.empty()) {
+      Expect(index == allocator_.capacity());
+    } else {
+      Expect(index == *free_.begin());
+      Take(*free_.begin());
+    }
+    Expect(allocator_.full() == free_.empty());
+  }
+  // Claims a random free index.
+  void Claim() {
+    if (free_.empty()) {
+      return;
+    }
+    // the free index at or after a random one, or the lowest
+    std::set<size_t>::const_iterator it = free_.lower_bound(
+        static_cast<size_t>(test::Random() % allocator_.capacity()));
+    if (it == free_.end()) {
+      it = free_.begin();
+    }
+    const size_t index = *it;
+    Expect(allocator_.IsFree(static_cast<Index>(index)));
+    allocator_.Allocate(static_cast<Index>(index));
+    Take(index);
+  }
+  // Frees a random allocated index.
+  void Free() {
+    if (allocated_.empty()) {
+      return;
+    }
+    const size_t position = static_cast<size_t>(
+        test::Random() % allocated_.size());
+    const size_t index = allocated_[position];
+    allocated_[position] = allocated_.back();
+    allocated_.pop_back();
+    Expect(!allocator_.IsFree(static_cast<Index>(index)));
+    allocator_.Free(static_cast<Index>(index));
+    free_.insert(index);
+    Expect(allocator_.IsFree(static_cast<Index>(index)));
+    Expect(allocator_.size() == allocated_.size());
+    Expect(!allocator_.full());
+  }
+  // Compares every index, and the counts.
+  void Verify() {
+    for (size_t i = 0; i < allocator_.capacity(); ++i) {
+      Expect(allocator_.IsFree(static_cast<Index>(i)) ==
+          (free_.count(i) != 0));
+    }
+    Expect(allocator_.size() == allocated_.size());
+    Expect(allocator_.full() == free_.empty());
+  }
+
+ private:
+  void Expect(bool condition) {
+    exact_ = exact_ && condition;
+  }
+  void Take(size_t index) {
+    free_.erase(index);
+    allocated_.push_back(index);
+    Expect(!allocator_.IsFree(static_cast<Index>(index)));
+    Expect(allocator_.size() == allocated_.size());
+  }
+
+  Allocator allocator_;
+  std::set<size_t> free_;
+  std::vector<size_t> allocated_;
+  bool exact_;
+};
+
+// Alternates between filling the allocator and draining it, by random
+// allocations, claims and frees, so that the lowest free index moves across
+// words and levels in both directions.
+template <unsigned int kIndexBits>
+void Check(size_t capacity) {
+  Model<kIndexBits> model(capacity);
+  CHECK(model.exact());
+  model.Verify();
+  // a fill to exhaustion, so that the sentinel is seen at every capacity
+  for (size_t i = 0; i <= capacity; ++i) {
+    model.Allocate();
+  }
+  model.Allocate();
+  model.Verify();
+  CHECK(model.exact());
+
+  const size_t operations = (capacity < 5000u ? 20000u : 3u * capacity);
+  for (unsigned int phase = 0; phase < 6u; ++phase) {
+    // mostly freeing in even phases, mostly allocating in odd ones
+    const unsigned int free_odds = (phase % 2u ? 1u : 3u);
+    for (size_t i = 0; i < operations / 6u; ++i) {
+      const unsigned int choice = static_cast<unsigned int>(
+          test::Random() % 5u);
+      if (choice < free_odds) {
+        model.Free();
+      } else if (choice == 4u) {
+        model.Claim();
+      } else {
+        model.Allocate();
+      }
+    }
+    model.Verify();
+    CHECK(model.exact());
+  }
+  // drain, then fill again from the bottom
+  while (model.allocated()) {
+    model.Free();
+  }
+  model.Verify();
+  for (size_t i = 0; i <= capacity; ++i) {
+    model.Allocate();
+  }
+  model.Verify();
+  CHECK(model.exact());
+}
+
+}  // namespace
+
+int main() {
+  const size_t kCapacities[] = {0u, 1u, 2u, 63u, 64u, 65u, 4095u, 4096u,
+      4097u, 262143u, 262144u, 262145u};
+  for (size_t c = 0; c < sizeof(kCapacities) / sizeof(kCapacities[0]); ++c) {
+    Check<32>(kCapacities[c]);
+    if (kCapacities[c] < 65536u) {
+      Check<16>(kCapacities[c]);
+    }
+  }
+  Check<8>(255u);
+  Check<64>(4097u);
+
+  return test::Finish();
+}
@@ -0,0 +1,154 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file montgomery_test.cc
+/// @brief Checks Montgomery's conversions, products and powers, and PowMod
+/// for odd and even moduli, against 128-bit square-and-multiply, including
+/// moduli of 1, 2 and 2^64 - 1, exponents of 0 and 1, and bases at or above
+/// the modulus.  Requires a compiler with 128-bit integers.  Exits nonzero
+/// on failure.
+
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/montgomery.h"
+
+#include "test.h"
+
+namespace {
+
+#if defined(__SIZEOF_INT128__)
+
+typedef nx::uint_t<128> uint128_t;
+
+nx::uint64_t MultiplyReference(nx::uint64_t lhs, nx::uint64_t rhs,
+    nx::uint64_t modulus) {
+  return static_cast<nx::uint64_t>(
+      static_cast<uint128_t>(lhs) * rhs % modulus);
+}
+
+nx::uint64_t PowerReference(nx::uint64_t base, nx::uint64_t exponent,
+    nx::uint64_t modulus) {
+  nx::uint64_t power = 1u % modulus;
+  nx::uint64_t factor = base % modulus;
+  for (; exponent; exponent >>= 1u) {
+    if (exponent & 1u) {
+      power = MultiplyReference(power, factor, modulus);
+    }
+    factor = MultiplyReference(factor, factor, modulus);
+  }
+  return power;
+}
+
+// Values around the modulus and the ends of the range, then random ones.
+std::vector<nx::uint64_t> Values(nx::uint64_t modulus) {
+  const nx::uint64_t kMax = ~static_cast<nx::uint64_t>(0);
+  const nx::uint64_t values[] = {0u, 1u, 2u, modulus - 1u, modulus,
+      modulus + 1u, modulus * 2u, kMax - 1u, kMax};
+  std::vector<nx::uint64_t> result(values,
+      values + sizeof(values) / sizeof(values[0]));
+  for (unsigned int i = 0; i < 20u; ++i) {
+    result.push_back(test::Random());
+    result.push_back(test::Random() % modulus);
+  }
+  return result;
+}
+
+std::vector<nx::uint64_t> Exponents() {
+  const nx::uint64_t kMax = ~static_cast<nx::uint64_t>(0);
+  const nx::uint64_t exponents[] = {0u, 1u, 2u, 3u, 64u, kMax - 1u, kMax};
+  std::vector<nx::uint64_t> result(exponents,
+      exponents + sizeof(exponents) / sizeof(exponents[0]));
+  for (unsigned int i = 0; i < 10u; ++i) {
+    result.push_back(test::Random());
+    result.push_back(test::Random() % 1000u);
+  }
+  return result;
+}
+
+void CheckMontgomery(nx::uint64_t modulus) {
+  const nx::Montgomery montgomery(modulus);
+  CHECK(montgomery.modulus() == modulus);
+  const std::vector<nx::uint64_t> values = Values(modulus);
+  const std::vector<nx::uint64_t> exponents = Exponents();
+  bool exact = true;
+  for (size_t i = 0; i < values.size(); ++i) {
+    const nx::uint64_t form = montgomery.ToForm(values[i]);
+    exact = exact && form < modulus;
+    exact = exact && montgomery.FromForm(form) == values[i] % modulus;
+    for (size_t j = 0; j < values.size(); ++j) {
+      const nx::uint64_t product = montgomery.Multiply(form,
+          montgomery.ToForm(values[j]));
+      exact = exact && product < modulus;
+      exact = exact && montgomery.FromForm(product) ==
+          MultiplyReference(values[i], values[j], modulus);
+    }
+    for (size_t j = 0; j < exponents.size(); ++j) {
+      const nx::uint64_t expected =
+          PowerReference(values[i], exponents[j], modulus);
+      exact = exact && montgomery.Power(values[i], exponents[j]) == expected;
+      exact = exact && nx::PowMod(values[i], exponents[j], modulus) ==
+          expected;
+    }
+  }
+  CHECK(exact);
+}
+
+void CheckPowMod(nx::uint64_t modulus) {
+  const std::vector<nx::uint64_t> values = Values(modulus);
+  const std::vector<nx::uint64_t> exponents = Exponents();
+  bool exact = true;
+  for (size_t i = 0; i < values.size(); ++i) {
+    for (size_t j = 0; j < exponents.size(); ++j) {
+      exact = exact && nx::PowMod(values[i], exponents[j], modulus) ==
+          PowerReference(values[i], exponents[j], modulus);
+    }
+  }
+  CHECK(exact);
+}
+
+#endif
+
+}  // namespace
+
+int main() {
+#if defined(__SIZEOF_INT128__)
+  const nx::uint64_t kMax = ~static_cast<nx::uint64_t>(0);
+  // 2^64 - 59 is the largest 64-bit prime
+  const nx::uint64_t kOdd[] = {1u, 3u, 5u, 7u, 9u, 0xffffffffu,
+      0x100000001ull, 0x8000000000000001ull, kMax - 58u, kMax - 2u, kMax};
+  for (size_t i = 0; i < sizeof(kOdd) / sizeof(kOdd[0]); ++i) {
+    CheckMontgomery(kOdd[i]);
+  }
+  for (unsigned int i = 0; i < 20u; ++i) {
+    CheckMontgomery(test::Random() | 1u);
+    CheckMontgomery((test::Random() >> (test::Random() % 64u)) | 1u);
+  }
+
+  const nx::uint64_t kEven[] = {2u, 4u, 6u, 0x100000000ull,
+      0x8000000000000000ull, kMax - 1u};
+  for (size_t i = 0; i < sizeof(kEven) / sizeof(kEven[0]); ++i) {
+    CheckPowMod(kEven[i]);
+  }
+  for (unsigned int i = 0; i < 20u; ++i) {
+    CheckPowMod((test::Random() | 2u) & ~static_cast<nx::uint64_t>(1));
+    CheckPowMod(((test::Random() >> (test::Random() % 64u)) | 2u) &
+        ~static_cast<nx::uint64_t>(1));
+  }
+#endif
+
+  return test::Finish();
+}
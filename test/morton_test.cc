@@ -0,0 +1,254 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file morton_test.cc
+/// @brief Checks Morton's single and batch conversions, in 2D and 3D for
+/// coordinates of many widths, against a bit-at-a-time interleaving, up to
+/// the largest coordinates, and that the batch kernels of every instruction
+/// set the processor supports agree for every count.  Single conversions use
+/// PDEP/PEXT when built with -mbmi2 and magic masks otherwise; build both
+/// ways.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/morton.h"
+
+#include "test.h"
+
+namespace {
+
+template <unsigned int kDimensions, unsigned int kBits>
+class Reference {
+ public:
+  typedef nx::Morton<kDimensions, kBits> Morton;
+  typedef typename Morton::coordinate_type coordinate_type;
+  typedef typename Morton::key_type key_type;
+
+  // Bit i of axis a becomes bit i * kDimensions + a of the key; bits of the
+  // coordinates beyond kBits are ignored.
+  static key_type Encode(const coordinate_type* point) {
+    nx::uint64_t key = 0;
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      for (unsigned int i = 0; i < kBits; ++i) {
+        key |= static_cast<nx::uint64_t>((point[axis] >> i) & 1u) <<
+            (i * kDimensions + axis);
+      }
+    }
+    return static_cast<key_type>(key);
+  }
+  // Bits of the key beyond kDimensions * kBits are ignored.
+  static void Decode(key_type key, coordinate_type* point) {
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      nx::uint64_t coordinate = 0;
+      for (unsigned int i = 0; i < kBits; ++i) {
+        coordinate |= static_cast<nx::uint64_t>(
+            (key >> (i * kDimensions + axis)) & 1u) << i;
+      }
+      point[axis] = static_cast<coordinate_type>(coordinate);
+    }
+  }
+  static nx::uint64_t Mask() {
+    return (kBits == 64u ? ~static_cast<nx::uint64_t>(0) :
+        (static_cast<nx::uint64_t>(1) << kBits) - 1u);
+  }
+  // Zero, the largest coordinate, or any value of coordinate_type, whose
+  // bits beyond kBits must be ignored.
+  static coordinate_type RandomCoordinate() {
+    switch (test::Random() % 4u) {
+      case 0:
+        return 0;
+      case 1:
+        return static_cast<coordinate_type>(Mask());
+      default:
+        return static_cast<coordinate_type>(test::Random());
+    }
+  }
+  // Any key, including bits beyond kDimensions * kBits, or all ones.
+  static key_type RandomKey() {
+    return static_cast<key_type>(test::Random() % 8u ? test::Random() :
+        ~static_cast<nx::uint64_t>(0));
+  }
+};
+
+template <unsigned int kDimensions>
+struct Single;
+template <>
+struct Single<2> {
+  template <class Morton, typename C>
+  static typename Morton::key_type Encode(const C* point) {
+    return Morton::Encode(point[0], point[1]);
+  }
+  template <class Morton, typename K, typename C>
+  static void Decode(K key, C* point) {
+    Morton::Decode(key, &point[0], &point[1]);
+  }
+};
+template <>
+struct Single<3> {
+  template <class Morton, typename C>
+  static typename Morton::key_type Encode(const C* point) {
+    return Morton::Encode(point[0], point[1], point[2]);
+  }
+  template <class Morton, typename K, typename C>
+  static void Decode(K key, C* point) {
+    Morton::Decode(key, &point[0], &point[1], &point[2]);
+  }
+};
+
+// Checks the single conversions against the reference, and their round
+// trip.
+template <unsigned int kDimensions, unsigned int kBits>
+void CheckSingle() {
+  typedef Reference<kDimensions, kBits> Ref;
+  typedef typename Ref::Morton Morton;
+  typedef typename Ref::coordinate_type coordinate_type;
+  typedef typename Ref::key_type key_type;
+
+  nx::uint64_t axis_mask = 0;
+  for (unsigned int i = 0; i < kBits; ++i) {
+    axis_mask |= static_cast<nx::uint64_t>(1) << (i * kDimensions);
+  }
+  CHECK(Morton::AxisMask() == axis_mask);
+
+  bool exact = true;
+  for (unsigned int trial = 0; trial < 10000u; ++trial) {
+    coordinate_type point[kDimensions];
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      point[axis] = Ref::RandomCoordinate();
+    }
+    const key_type key = Single<kDimensions>::template Encode<Morton>(point);
+    exact = exact && key == Ref::Encode(point);
+    coordinate_type decoded[kDimensions];
+    Single<kDimensions>::template Decode<Morton>(key, decoded);
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      exact = exact && decoded[axis] == (point[axis] & Ref::Mask());
+    }
+
+    const key_type other = Ref::RandomKey();
+    coordinate_type expected[kDimensions];
+    Ref::Decode(other, expected);
+    Single<kDimensions>::template Decode<Morton>(other, decoded);
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      exact = exact && decoded[axis] == expected[axis];
+    }
+  }
+  CHECK(exact);
+}
+
+// Checks batch kernels against the reference for every count up to several
+// steps, with buffers exactly count long, so that sanitizers see any access
+// beyond.
+template <unsigned int kDimensions, unsigned int kBits>
+void CheckBatch(
+    void (*encode)(const typename Reference<kDimensions,
+        kBits>::coordinate_type* const*, size_t,
+        typename Reference<kDimensions, kBits>::key_type*),
+    void (*decode)(const typename Reference<kDimensions, kBits>::key_type*,
+        size_t, typename Reference<kDimensions,
+        kBits>::coordinate_type* const*)) {
+  typedef Reference<kDimensions, kBits> Ref;
+  typedef typename Ref::coordinate_type coordinate_type;
+  typedef typename Ref::key_type key_type;
+  for (size_t count = 0; count <= 19u; ++count) {
+    std::vector<std::vector<coordinate_type>> axes(kDimensions,
+        std::vector<coordinate_type>(count));
+    const coordinate_type* inputs[kDimensions];
+    std::vector<key_type> expected(count);
+    for (size_t i = 0; i < count; ++i) {
+      coordinate_type point[kDimensions];
+      for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+        point[axis] = Ref::RandomCoordinate();
+        axes[axis][i] = point[axis];
+      }
+      expected[i] = Ref::Encode(point);
+    }
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      inputs[axis] = axes[axis].data();
+    }
+    std::vector<key_type> keys(count);
+    encode(inputs, count, keys.data());
+    CHECK(keys == expected);
+
+    for (size_t i = 0; i < count; ++i) {
+      keys[i] = Ref::RandomKey();
+    }
+    std::vector<std::vector<coordinate_type>> decoded(kDimensions,
+        std::vector<coordinate_type>(count));
+    coordinate_type* outputs[kDimensions];
+    for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+      outputs[axis] = decoded[axis].data();
+    }
+    decode(keys.data(), count, outputs);
+    bool exact = true;
+    for (size_t i = 0; i < count; ++i) {
+      coordinate_type point[kDimensions];
+      Ref::Decode(keys[i], point);
+      for (unsigned int axis = 0; axis < kDimensions; ++axis) {
+        exact = exact && decoded[axis][i] == point[axis];
+      }
+    }
+    CHECK(exact);
+  }
+}
+
+template <unsigned int kDimensions, unsigned int kBits>
+void Check() {
+  typedef nx::detail::MortonKernels<kDimensions, kBits> Kernels;
+  typedef typename Kernels::coordinate_type coordinate_type;
+  CheckSingle<kDimensions, kBits>();
+  CheckBatch<kDimensions, kBits>(&Kernels::EncodeScalar,
+      &Kernels::DecodeScalar);
+#if defined(NX_SIMD_X86)
+  if (sizeof(coordinate_type) > 1u && nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckBatch<kDimensions, kBits>(&Kernels::EncodeAvx2,
+        &Kernels::DecodeAvx2);
+  }
+#endif
+  // and whichever Morton dispatches to
+  CheckBatch<kDimensions, kBits>(&nx::Morton<kDimensions, kBits>::Encode,
+      &nx::Morton<kDimensions, kBits>::Decode);
+}
+
+}  // namespace
+
+int main() {
+  // either side of each coordinate and key size, and the widest keys
+  Check<2, 1>();
+  Check<2, 4>();
+  Check<2, 7>();
+  Check<2, 8>();
+  Check<2, 9>();
+  Check<2, 15>();
+  Check<2, 16>();
+  Check<2, 17>();
+  Check<2, 24>();
+  Check<2, 31>();
+  Check<2, 32>();
+  Check<3, 1>();
+  Check<3, 2>();
+  Check<3, 5>();
+  Check<3, 8>();
+  Check<3, 9>();
+  Check<3, 10>();
+  Check<3, 11>();
+  Check<3, 16>();
+  Check<3, 17>();
+  Check<3, 20>();
+  Check<3, 21>();
+
+  return test::Finish();
+}
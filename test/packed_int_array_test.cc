@@ -0,0 +1,163 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file packed_int_array_test.cc
+/// @brief Checks PackedIntArray of every width from 1 to 64 bits against a
+/// vector of the same values, through get, set, Pack and Unpack at any
+/// offset, so that elements straddle words, and through resize.  For 17 to
+/// 32 bits, the AVX2 unpacking kernel must agree with the scalar one.  Exits
+/// nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/packed_int_array.h"
+
+#include "test.h"
+
+namespace {
+
+// Checks that array holds exactly values.
+template <unsigned int kBits>
+bool Matches(const nx::PackedIntArray<kBits>& array,
+    const std::vector<nx::uint64_t>& values) {
+  bool exact = array.size() == values.size();
+  for (size_t i = 0; exact && i < values.size(); ++i) {
+    exact = array.get(i) == values[i];
+  }
+  return exact;
+}
+
+template <unsigned int kBits>
+void CheckWidth() {
+  typedef nx::PackedIntArray<kBits> Array;
+  typedef typename Array::value_type value_type;
+  const nx::uint64_t mask = Array::Mask();
+  CHECK(mask == (kBits == 64u ? ~static_cast<nx::uint64_t>(0) :
+      (static_cast<nx::uint64_t>(1) << kBits) - 1u));
+
+  for (unsigned int trial = 0; trial < 20u; ++trial) {
+    const size_t size = test::Random() % 300u;
+    Array array(size);
+    std::vector<nx::uint64_t> values(size, 0);
+    CHECK(Matches(array, values));
+
+    // set ignores the bits of value_type above kBits, and leaves the
+    // neighbours of each element, in either word it spans, unchanged
+    for (size_t i = 0; i < size; ++i) {
+      const value_type value = static_cast<value_type>(test::Random());
+      array.set(i, value);
+      values[i] = value & mask;
+    }
+    CHECK(Matches(array, values));
+    for (size_t i = 0; i < size; i += 1u + test::Random() % 4u) {
+      // all ones or all zeros, to catch bits leaking into neighbours
+      const value_type value = static_cast<value_type>(
+          test::Random() & 1u ? ~static_cast<nx::uint64_t>(0) : 0);
+      array.set(i, value);
+      values[i] = value & mask;
+    }
+    CHECK(Matches(array, values));
+
+    for (unsigned int run = 0; run < 20u && size; ++run) {
+      const size_t first = test::Random() % size;
+      const size_t count = test::Random() % (size - first + 1u);
+      // Unpack writes exactly count values
+      std::vector<value_type> unpacked(count + 1u,
+          static_cast<value_type>(0x5a));
+      array.Unpack(first, count, unpacked.data());
+      bool exact = unpacked.back() == static_cast<value_type>(0x5a);
+      for (size_t i = 0; i < count; ++i) {
+        exact = exact && unpacked[i] == values[first + i];
+      }
+      CHECK(exact);
+
+      std::vector<value_type> packed(count);
+      for (size_t i = 0; i < count; ++i) {
+        packed[i] = static_cast<value_type>(test::Random());
+        values[first + i] = packed[i] & mask;
+      }
+      array.Pack(first, count, packed.data());
+      CHECK(Matches(array, values));
+    }
+
+    // shrinking discards elements, and growing again provides zeros
+    const size_t smaller = (size ? test::Random() % size : 0);
+    array.resize(smaller);
+    values.resize(smaller);
+    CHECK(Matches(array, values));
+    const size_t larger = smaller + test::Random() % 300u;
+    array.resize(larger);
+    values.resize(larger, 0);
+    CHECK(Matches(array, values));
+  }
+}
+
+// Compares kernel with the scalar kernel on random words, from every offset
+// within a word and for counts of several steps and a tail.  The words are
+// exactly those spanned, and their padding, so that sanitizers see any
+// access beyond.
+template <unsigned int kBits>
+void CheckKernel(void (*kernel)(const nx::uint64_t*, size_t, size_t,
+    typename nx::detail::PackedIntArrayKernels<kBits>::value_type*)) {
+  typedef nx::detail::PackedIntArrayKernels<kBits> Kernels;
+  typedef typename Kernels::value_type value_type;
+  for (size_t first = 0; first < 64u; ++first) {
+    for (size_t count = 0; count <= 40u; count += 1u + first % 3u) {
+      std::vector<nx::uint64_t> words(
+          ((first + count) * kBits + 63u) / 64u + 1u + Kernels::kPaddingWords);
+      for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = test::Random();
+      }
+      std::vector<value_type> expected(count);
+      Kernels::UnpackScalar(words.data(), first, count, expected.data());
+      std::vector<value_type> values(count);
+      kernel(words.data(), first, count, values.data());
+      CHECK(values == expected);
+    }
+  }
+}
+
+template <unsigned int kBits>
+void CheckKernels(nx::Bool<false>) {
+}
+template <unsigned int kBits>
+void CheckKernels(nx::Bool<true>) {
+#if defined(NX_SIMD_X86)
+  if (nx::Cpu::Supports(nx::Cpu::kAvx2)) {
+    CheckKernel<kBits>(&nx::detail::PackedIntArrayKernels<kBits>::UnpackAvx2);
+  }
+#endif
+}
+
+// Checks kBits and every wider width.
+template <unsigned int kBits>
+void CheckWidths(nx::Bool<false>) {
+}
+template <unsigned int kBits>
+void CheckWidths(nx::Bool<true>) {
+  CheckWidth<kBits>();
+  CheckKernels<kBits>(nx::Bool<(kBits >= 17u && kBits <= 32u)>());
+  CheckWidths<kBits + 1u>(nx::Bool<(kBits < 64u)>());
+}
+
+}  // namespace
+
+int main() {
+  CheckWidths<1>(nx::Bool<true>());
+
+  return test::Finish();
+}
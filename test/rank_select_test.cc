@@ -0,0 +1,156 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file rank_select_test.cc
+/// @brief Checks RankSelect's Rank at every position, up to and including
+/// size(), and Select of every set bit against naive counts, for empty,
+/// clear, full, random and sparse arrays whose sizes and counts straddle the
+/// 512-bit sub-blocks, 2048-bit blocks and 8192-bit select samples.  Select
+/// finds the bit within a word with PDEP when built with -mbmi2 and with
+/// broadword arithmetic otherwise; build both ways.  Exits nonzero on
+/// failure.
+
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/rank_select.h"
+
+#include "test.h"
+
+namespace {
+
+enum Fill {
+  kZero,
+  kOnes,
+  kRandom,
+  // about one bit in a hundred, so that set bits are words apart
+  kSparse,
+  // all but about one bit in a hundred
+  kDense
+};
+
+// Exactly the words holding size bits, so that sanitizers see any access
+// beyond them.  The bits past size in the last word are random, and must be
+// ignored.
+std::vector<nx::uint64_t> RandomWords(size_t size, Fill fill) {
+  std::vector<nx::uint64_t> words((size + 63u) / 64u);
+  for (size_t i = 0; i < size; ++i) {
+    bool bit = false;
+    switch (fill) {
+      case kZero:
+        break;
+      case kOnes:
+        bit = true;
+        break;
+      case kRandom:
+        bit = test::Random() & 1u;
+        break;
+      case kSparse:
+        bit = test::Random() % 100u == 0;
+        break;
+      case kDense:
+        bit = test::Random() % 100u != 0;
+        break;
+    }
+    if (bit) {
+      words[i / 64u] |= static_cast<nx::uint64_t>(1) << (i % 64u);
+    }
+  }
+  if (size % 64u) {
+    words.back() |= test::Random() << (size % 64u);
+  }
+  return words;
+}
+
+void Check(size_t size, Fill fill) {
+  const std::vector<nx::uint64_t> words = RandomWords(size, fill);
+  const nx::RankSelect index(words.data(), size);
+  // the naive count before each position, and the positions of set bits
+  std::vector<nx::uint64_t> ranks(1, 0);
+  std::vector<size_t> positions;
+  for (size_t i = 0; i < size; ++i) {
+    const bool bit = (words[i / 64u] >> (i % 64u)) & 1u;
+    if (bit) {
+      positions.push_back(i);
+    }
+    ranks.push_back(ranks.back() + bit);
+  }
+  CHECK(index.size() == size);
+  CHECK(index.Count() == positions.size());
+
+  bool exact = true;
+  for (size_t i = 0; i <= size; ++i) {
+    exact = exact && index.Rank(i) == ranks[i];
+  }
+  CHECK(exact);
+  exact = true;
+  for (size_t rank = 0; rank < positions.size(); ++rank) {
+    exact = exact && index.Select(rank) == positions[rank];
+  }
+  CHECK(exact);
+  // fewer bits set than requested
+  CHECK(index.Select(positions.size()) == size);
+  CHECK(index.Select(positions.size() + 1u) == size);
+  CHECK(index.Select(~static_cast<nx::uint64_t>(0)) == size);
+}
+
+}  // namespace
+
+int main() {
+  // either side of each sub-block, block, and select sample, in bits or,
+  // when every bit is set, in set bits
+  const size_t kBoundaries[] = {64u, 512u, 1024u, 2048u, 4096u, 8192u,
+      16384u, 24576u};
+  const Fill kFills[] = {kZero, kOnes, kRandom, kSparse, kDense};
+  for (size_t f = 0; f < sizeof(kFills) / sizeof(kFills[0]); ++f) {
+    Check(0, kFills[f]);
+    Check(1u, kFills[f]);
+    for (size_t b = 0; b < sizeof(kBoundaries) / sizeof(kBoundaries[0]);
+        ++b) {
+      Check(kBoundaries[b] - 1u, kFills[f]);
+      Check(kBoundaries[b], kFills[f]);
+      Check(kBoundaries[b] + 1u, kFills[f]);
+    }
+    // counts crossing several select samples partway through blocks
+    for (unsigned int trial = 0; trial < 8u; ++trial) {
+      Check(1u + test::Random() % 100000u, kFills[f]);
+    }
+  }
+  // words that are full or clear, so that counts jump by whole words
+  for (unsigned int trial = 0; trial < 8u; ++trial) {
+    const size_t size = 512u * (1u + test::Random() % 64u) +
+        test::Random() % 512u;
+    std::vector<nx::uint64_t> words((size + 63u) / 64u);
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] = (test::Random() % 3u ? ~static_cast<nx::uint64_t>(0) : 0);
+    }
+    const nx::RankSelect index(words.data(), size);
+    bool exact = true;
+    nx::uint64_t rank = 0;
+    for (size_t i = 0; i < size; ++i) {
+      exact = exact && index.Rank(i) == rank;
+      if ((words[i / 64u] >> (i % 64u)) & 1u) {
+        exact = exact && index.Select(rank) == i;
+        ++rank;
+      }
+    }
+    CHECK(exact);
+    CHECK(index.Rank(size) == rank);
+    CHECK(index.Count() == rank);
+  }
+
+  return test::Finish();
+}
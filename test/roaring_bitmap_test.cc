@@ -0,0 +1,307 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file roaring_bitmap_test.cc
+/// @brief Checks RoaringBitmap against std::set: Add and Remove across the
+/// array and bitmap boundary, Optimize, and |=, &=, AndNot and AndCount for
+/// every pairing of array, bitmap and run chunks, and of a set with itself.
+/// Exits nonzero on failure.
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/roaring_bitmap.h"
+
+#include "test.h"
+
+namespace {
+
+typedef std::set<nx::uint32_t> Reference;
+
+// The shapes a chunk is filled in.  Arrays draw from the low 8192 values so
+// that they overlap each other substantially; kFullArray holds exactly the
+// most values an array chunk may, and kSmallBitmap one more.
+enum Shape {
+  kTinyArray,
+  kArray,
+  kFullArray,
+  kSmallBitmap,
+  kBitmap,
+  kRuns,
+  kShapes
+};
+
+// Adds count distinct random values below limit to the chunk high.
+void AddRandom(nx::uint32_t high, size_t count, nx::uint32_t limit,
+    nx::RoaringBitmap* bitmap, Reference* reference) {
+  const size_t target = reference->size() + count;
+  while (reference->size() < target) {
+    const nx::uint32_t value = (high << 16u) |
+        static_cast<nx::uint32_t>(test::Random() % limit);
+    reference->insert(value);
+    bitmap->Add(value);
+  }
+}
+
+// Adds first through last, inclusive, to the chunk high.
+void AddRange(nx::uint32_t high, nx::uint32_t first, nx::uint32_t last,
+    nx::RoaringBitmap* bitmap, Reference* reference) {
+  for (nx::uint32_t low = first; low <= last; ++low) {
+    reference->insert((high << 16u) | low);
+    bitmap->Add((high << 16u) | low);
+  }
+}
+
+// Fills the chunk high in shape.  Runs only become run chunks once the
+// bitmap is optimized.
+void Fill(Shape shape, nx::uint32_t high, nx::RoaringBitmap* bitmap,
+    Reference* reference) {
+  switch (shape) {
+    case kTinyArray:
+      AddRandom(high, 1u + test::Random() % 20u, 8192u, bitmap, reference);
+      break;
+    case kArray:
+      AddRandom(high, 500u + test::Random() % 1000u, 8192u, bitmap, reference);
+      break;
+    case kFullArray:
+      AddRandom(high, 4096u, 8192u, bitmap, reference);
+      break;
+    case kSmallBitmap:
+      AddRandom(high, 4097u, 8192u, bitmap, reference);
+      break;
+    case kBitmap:
+      AddRandom(high, 20000u, 65536u, bitmap, reference);
+      break;
+    default: {
+      // a few runs, some within the range the arrays draw from
+      const nx::uint32_t start =
+          static_cast<nx::uint32_t>(test::Random() % 512u);
+      AddRange(high, start, start + 700u, bitmap, reference);
+      AddRange(high, 3000u, 3000u + static_cast<nx::uint32_t>(
+          test::Random() % 2000u), bitmap, reference);
+      AddRange(high, 7000u, 40000u, bitmap, reference);
+      AddRange(high, 65530u, 65535u, bitmap, reference);
+      break;
+    }
+  }
+}
+
+class Collect {
+ public:
+  explicit Collect(std::vector<nx::uint32_t>* values) : values_(values) {
+  }
+  void operator()(nx::uint32_t value) const {
+    values_->push_back(value);
+  }
+
+ private:
+  std::vector<nx::uint32_t>* values_;
+};
+
+bool Matches(const nx::RoaringBitmap& bitmap, const Reference& reference) {
+  std::vector<nx::uint32_t> values;
+  bitmap.ForEach(Collect(&values));
+  return bitmap.Count() == reference.size() &&
+      bitmap.empty() == reference.empty() &&
+      values.size() == reference.size() &&
+      std::equal(values.begin(), values.end(), reference.begin());
+}
+
+Reference Union(const Reference& lhs, const Reference& rhs) {
+  Reference result;
+  std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      std::inserter(result, result.end()));
+  return result;
+}
+
+Reference Intersection(const Reference& lhs, const Reference& rhs) {
+  Reference result;
+  std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      std::inserter(result, result.end()));
+  return result;
+}
+
+Reference Difference(const Reference& lhs, const Reference& rhs) {
+  Reference result;
+  std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      std::inserter(result, result.end()));
+  return result;
+}
+
+// Adds and removes values around an array chunk holding exactly as many
+// values as an array may, in and out of its run form.
+void CheckBoundary() {
+  nx::RoaringBitmap bitmap;
+  Reference reference;
+  AddRange(3u, 0u, 4095u, &bitmap, &reference);
+  CHECK(Matches(bitmap, reference));
+
+  // an array, then runs once optimized; present values change nothing
+  bitmap.Optimize();
+  CHECK(Matches(bitmap, reference));
+  bitmap.Add((3u << 16u) | 100u);
+  bitmap.Remove((3u << 16u) | 5000u);
+  bitmap.Remove((4u << 16u) | 100u);
+  CHECK(Matches(bitmap, reference));
+
+  // the 4097th value makes a bitmap, and removing it an array again
+  bitmap.Add((3u << 16u) | 60000u);
+  reference.insert((3u << 16u) | 60000u);
+  CHECK(Matches(bitmap, reference));
+  CHECK(bitmap.Contains((3u << 16u) | 60000u));
+  bitmap.Remove((3u << 16u) | 60000u);
+  reference.erase((3u << 16u) | 60000u);
+  CHECK(Matches(bitmap, reference));
+  CHECK(!bitmap.Contains((3u << 16u) | 60000u));
+
+  // back and forth across the boundary from both sides
+  for (nx::uint32_t low = 4096u; low < 4200u; ++low) {
+    bitmap.Add((3u << 16u) | low);
+    reference.insert((3u << 16u) | low);
+  }
+  CHECK(Matches(bitmap, reference));
+  for (nx::uint32_t low = 0; low < 200u; ++low) {
+    bitmap.Remove((3u << 16u) | (low * 7u));
+    reference.erase((3u << 16u) | (low * 7u));
+  }
+  CHECK(Matches(bitmap, reference));
+
+  // removing the last value of a chunk drops it
+  bitmap.Add(42u);
+  bitmap.Remove(42u);
+  CHECK(Matches(bitmap, reference));
+  CHECK(!bitmap.Contains(42u));
+
+  // a run chunk holding more than an array may expands to a bitmap
+  nx::RoaringBitmap runs;
+  Reference run_reference;
+  AddRange(0u, 1000u, 9999u, &runs, &run_reference);
+  runs.Optimize();
+  runs.Remove(5000u);
+  run_reference.erase(5000u);
+  runs.Add(60000u);
+  run_reference.insert(60000u);
+  CHECK(Matches(runs, run_reference));
+  runs.Optimize();
+  CHECK(Matches(runs, run_reference));
+}
+
+// Random additions and removals over a few chunks, optimizing now and then.
+void CheckAddRemove() {
+  nx::RoaringBitmap bitmap;
+  Reference reference;
+  for (unsigned int i = 0; i < 200000u; ++i) {
+    const nx::uint32_t value = static_cast<nx::uint32_t>(
+        (test::Random() % 4u) << 16u | test::Random() % 12000u);
+    const bool add = (test::Random() % 3u != 0);
+    CHECK(bitmap.Contains(value) == (reference.count(value) != 0));
+    if (add) {
+      bitmap.Add(value);
+      reference.insert(value);
+    } else {
+      bitmap.Remove(value);
+      reference.erase(value);
+    }
+    if (i % 50000u == 49999u) {
+      CHECK(Matches(bitmap, reference));
+      bitmap.Optimize();
+      CHECK(Matches(bitmap, reference));
+    }
+  }
+  CHECK(Matches(bitmap, reference));
+}
+
+// Combines sets with a chunk of every pairing of shapes, plus chunks that
+// only one side has, and the results with themselves.
+void CheckOperations(bool optimize) {
+  nx::RoaringBitmap lhs, rhs;
+  Reference lhs_reference, rhs_reference;
+  nx::uint32_t high = 0;
+  for (int lhs_shape = 0; lhs_shape < kShapes; ++lhs_shape) {
+    for (int rhs_shape = 0; rhs_shape < kShapes; ++rhs_shape, ++high) {
+      Fill(static_cast<Shape>(lhs_shape), high, &lhs, &lhs_reference);
+      Fill(static_cast<Shape>(rhs_shape), high, &rhs, &rhs_reference);
+    }
+  }
+  for (int shape = 0; shape < kShapes; ++shape, high += 2u) {
+    Fill(static_cast<Shape>(shape), high, &lhs, &lhs_reference);
+    Fill(static_cast<Shape>(shape), high + 1u, &rhs, &rhs_reference);
+  }
+  if (optimize) {
+    lhs.Optimize();
+    rhs.Optimize();
+  }
+  CHECK(Matches(lhs, lhs_reference));
+  CHECK(Matches(rhs, rhs_reference));
+
+  nx::RoaringBitmap result = lhs;
+  result |= rhs;
+  CHECK(Matches(result, Union(lhs_reference, rhs_reference)));
+  result = lhs;
+  result &= rhs;
+  CHECK(Matches(result, Intersection(lhs_reference, rhs_reference)));
+  result = lhs;
+  result.AndNot(rhs);
+  CHECK(Matches(result, Difference(lhs_reference, rhs_reference)));
+  result = rhs;
+  result.AndNot(lhs);
+  CHECK(Matches(result, Difference(rhs_reference, lhs_reference)));
+  CHECK(lhs.AndCount(rhs) ==
+      Intersection(lhs_reference, rhs_reference).size());
+  CHECK(rhs.AndCount(lhs) ==
+      Intersection(lhs_reference, rhs_reference).size());
+
+  // the operands are left as they were
+  CHECK(Matches(lhs, lhs_reference));
+  CHECK(Matches(rhs, rhs_reference));
+
+  // a set combined with itself
+  result = lhs;
+  result |= result;
+  CHECK(Matches(result, lhs_reference));
+  result &= result;
+  CHECK(Matches(result, lhs_reference));
+  CHECK(result.AndCount(result) == lhs_reference.size());
+  result.AndNot(result);
+  CHECK(Matches(result, Reference()));
+
+  // with an empty set
+  nx::RoaringBitmap empty;
+  result = lhs;
+  result |= empty;
+  CHECK(Matches(result, lhs_reference));
+  result.AndNot(empty);
+  CHECK(Matches(result, lhs_reference));
+  CHECK(result.AndCount(empty) == 0u);
+  result &= empty;
+  CHECK(Matches(result, Reference()));
+}
+
+}  // namespace
+
+int main() {
+  CheckBoundary();
+  CheckAddRemove();
+  for (unsigned int i = 0; i < 3u; ++i) {
+    CheckOperations(false);
+    CheckOperations(true);
+  }
+
+  return test::Finish();
+}
@@ -0,0 +1,192 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file set_bits_test.cc
+/// @brief Checks that SetBits yields the index of each set bit, in order,
+/// against a bit-at-a-time scan: of integers of every width and signedness,
+/// including the sign bit, and of arrays of words as bits either side of
+/// each word boundary are set, cleared and flipped, leaving words empty at
+/// either end and between.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/bits.h"
+#include "nx/core/integer.h"
+#include "nx/core/mpl.h"
+#include "nx/core/set_bits.h"
+
+#include "test.h"
+
+namespace {
+
+// The bit at index, which for the last is the sign bit of signed types.
+template <typename T>
+T Bit(unsigned int index) {
+  return static_cast<T>(static_cast<nx::MakeUnsigned<T>>(1) << index);
+}
+
+// The set bits of count words, scanned one at a time.
+template <typename T>
+std::vector<size_t> Reference(const T* words, size_t count) {
+  std::vector<size_t> indexes;
+  for (size_t w = 0; w < count; ++w) {
+    for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+      if (words[w] & Bit<T>(i)) {
+        indexes.push_back(w * nx::Bits<T>::Size() + i);
+      }
+    }
+  }
+  return indexes;
+}
+
+// Zero, all set, a single bit, or random bits, dense or sparse.
+template <typename T>
+T RandomWord() {
+  switch (test::Random() % 6u) {
+    case 0:
+      return 0;
+    case 1:
+      return static_cast<T>(~static_cast<T>(0));
+    case 2:
+      return Bit<T>(static_cast<unsigned int>(
+          test::Random() % nx::Bits<T>::Size()));
+    case 3:
+      return static_cast<T>(test::Random() & test::Random() &
+          test::Random());
+    default:
+      return static_cast<T>(test::Random());
+  }
+}
+
+template <typename T>
+void CheckInteger() {
+  std::vector<T> values;
+  values.push_back(0);
+  values.push_back(static_cast<T>(~static_cast<T>(0)));
+  for (unsigned int i = 0; i < nx::Bits<T>::Size(); ++i) {
+    values.push_back(Bit<T>(i));
+    values.push_back(static_cast<T>(Bit<T>(i) |
+        Bit<T>(nx::Bits<T>::Size() - 1u)));
+  }
+  for (unsigned int i = 0; i < 1000u; ++i) {
+    values.push_back(RandomWord<T>());
+  }
+  bool exact = true;
+  for (size_t v = 0; v < values.size(); ++v) {
+    const std::vector<size_t> expected = Reference(&values[v], 1u);
+    std::vector<size_t> indexes;
+    for (unsigned int index : nx::SetBits(values[v])) {
+      indexes.push_back(index);
+    }
+    exact = exact && indexes == expected;
+    // and stepping by post-increment
+    const nx::SetBitRange<T> range = nx::SetBits(values[v]);
+    typename nx::SetBitRange<T>::iterator it = range.begin();
+    for (size_t i = 0; i < expected.size(); ++i) {
+      exact = exact && it != range.end() && *it++ == expected[i];
+    }
+    exact = exact && it == range.end();
+  }
+  CHECK(exact);
+}
+
+// Compares the range over words with the reference; the words are exactly
+// as many as given, so that sanitizers see any access beyond.
+template <typename T>
+bool Matches(const std::vector<T>& words) {
+  const std::vector<size_t> expected = Reference(words.data(),
+      words.size());
+  std::vector<size_t> indexes;
+  for (size_t index : nx::SetBits(words.data(), words.size())) {
+    indexes.push_back(index);
+  }
+  const nx::SetBitArrayRange<T> range = nx::SetBits(words.data(),
+      words.size());
+  typename nx::SetBitArrayRange<T>::iterator it = range.begin();
+  bool exact = indexes == expected;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    // iterators at successive bits, even of the same word, differ
+    typename nx::SetBitArrayRange<T>::iterator next = it;
+    exact = exact && ++next != it && it != range.end() &&
+        *it++ == expected[i] && it == next;
+  }
+  return exact && it == range.end();
+}
+
+// Sets, clears and flips single bits, mostly either side of a word
+// boundary, in arrays of up to several words whose remaining words are
+// empty, full or random.
+template <typename T>
+void CheckArray() {
+  const unsigned int size = nx::Bits<T>::Size();
+  CHECK(Matches(std::vector<T>()));
+  bool exact = true;
+  for (size_t count = 1; count <= 9u; ++count) {
+    for (unsigned int trial = 0; trial < 100u; ++trial) {
+      std::vector<T> words(count, 0);
+      if (trial % 2u) {
+        for (size_t w = 0; w < count; ++w) {
+          words[w] = RandomWord<T>();
+        }
+      }
+      exact = exact && Matches(words);
+      for (unsigned int step = 0; step < 20u; ++step) {
+        const size_t boundary = static_cast<size_t>(
+            test::Random() % (count + 1u)) * size;
+        size_t index = (test::Random() % 4u ?
+            boundary + static_cast<size_t>(test::Random() % 4u) - 2u :
+            static_cast<size_t>(test::Random()));
+        index %= count * size;
+        T* word = &words[index / size];
+        const T mask = Bit<T>(static_cast<unsigned int>(index % size));
+        switch (test::Random() % 3u) {
+          case 0:
+            *word = static_cast<T>(*word | mask);
+            break;
+          case 1:
+            *word = static_cast<T>(*word & ~mask);
+            break;
+          default:
+            *word = static_cast<T>(*word ^ mask);
+            break;
+        }
+        exact = exact && Matches(words);
+      }
+    }
+  }
+  CHECK(exact);
+}
+
+template <typename T>
+void Check() {
+  CheckInteger<T>();
+  CheckArray<T>();
+}
+
+}  // namespace
+
+int main() {
+  Check<nx::int8_t>();
+  Check<nx::uint8_t>();
+  Check<nx::int16_t>();
+  Check<nx::uint16_t>();
+  Check<nx::int32_t>();
+  Check<nx::uint32_t>();
+  Check<nx::int64_t>();
+  Check<nx::uint64_t>();
+
+  return test::Finish();
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file test.h
+/// @brief The checks and random numbers shared by the tests.  Each test is a
+/// program of its own, whose main() returns test::Finish().
+
+#ifndef TEST_TEST_H_
+#define TEST_TEST_H_
+
+#include <stdio.h>
+
+#include "nx/core/integer.h"
+
+namespace test {
+
+// The number of checks that have failed.
+inline int& Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline void Check(bool condition, const char* what, const char* file,
+    int line) {
+  if (!condition) {
+    printf("%s:%d: check failed: %s\n", file, line, what);
+    ++Failures();
+  }
+}
+
+// xorshift64, so that runs are repeatable
+inline nx::uint64_t Random() {
+  static nx::uint64_t state = 0x9e3779b97f4a7c15ull;
+  state ^= state << 13u;
+  state ^= state >> 7u;
+  state ^= state << 17u;
+  return state;
+}
+
+// Reports any failures, and provides the exit status.
+inline int Finish() {
+  if (Failures()) {
+    printf("%d checks failed\n", Failures());
+  }
+  return (Failures() ? 1 : 0);
+}
+
+}  // namespace test
+
+#define CHECK(...) \
+    ::test::Check((__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+#endif  // TEST_TEST_H_
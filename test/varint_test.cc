@@ -0,0 +1,234 @@
+//
+// Copyright (C) 2014 Jacob McIntosh <nacitar at ubercpp dot com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/// @file varint_test.cc
+/// @brief Checks that Varint round-trips values of several widths and signs,
+/// with and without room for the wide load, and that it rejects truncated,
+/// overlong and out-of-range input.  Exits nonzero on failure.
+
+#include <vector>
+
+#include "nx/core/integer.h"
+#include "nx/core/varint.h"
+
+#include "test.h"
+
+namespace {
+
+// A value of kBits bits, of every magnitude.
+template <unsigned int kBits, bool kSigned>
+typename nx::Varint<kBits, kSigned>::value_type RandomValue() {
+  typedef typename nx::Varint<kBits, kSigned>::value_type value_type;
+  const nx::uint64_t bits = test::Random() << (64u - kBits);
+  const unsigned int shift = 64u - kBits +
+      static_cast<unsigned int>(test::Random() % kBits);
+  // an arithmetic shift when signed, so that small values of either sign
+  // are as common as large ones
+  return static_cast<value_type>(kSigned ?
+      static_cast<nx::uint64_t>(static_cast<nx::int64_t>(bits) >> shift) :
+      bits >> shift);
+}
+
+template <unsigned int kBits, bool kSigned>
+void CheckRoundTrip() {
+  typedef nx::Varint<kBits, kSigned> Varint;
+  typedef typename Varint::value_type value_type;
+  std::vector<value_type> values;
+  for (unsigned int i = 0; i < 10000u; ++i) {
+    values.push_back(RandomValue<kBits, kSigned>());
+  }
+  std::vector<nx::uint8_t> bytes(values.size() * Varint::MaxSize() + 8u);
+  const size_t size = Varint::Encode(values.data(), values.size(),
+      bytes.data());
+  size_t length = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    const size_t expected = Varint::Size(values[i]);
+    value_type value = 0;
+    // exactly the varint, then with room for the wide load
+    CHECK(Varint::Decode(bytes.data() + length, expected, &value) ==
+        expected && value == values[i]);
+    CHECK(Varint::Decode(bytes.data() + length, expected - 1u, &value) == 0);
+    CHECK(Varint::Decode(bytes.data() + length, size + 8u - length, &value) ==
+        expected && value == values[i]);
+    length += expected;
+  }
+  CHECK(length == size);
+  std::vector<value_type> decoded(values.size());
+  CHECK(Varint::Decode(bytes.data(), size, values.size(), decoded.data()) ==
+      size && decoded == values);
+  CHECK(Varint::Decode(bytes.data(), size - 1u, values.size(),
+      decoded.data()) == 0);
+}
+
+// Checks that decoding many values at once agrees with decoding them one at
+// a time over bytes.
+template <unsigned int kBits>
+void CheckAgainstSingle(const std::vector<nx::uint8_t>& bytes) {
+  typedef nx::Varint<kBits> Varint;
+  typedef typename Varint::value_type value_type;
+  std::vector<value_type> expected;
+  size_t length = 0;
+  for (;;) {
+    value_type value = 0;
+    const size_t read = Varint::Decode(bytes.data() + length,
+        bytes.size() - length, &value);
+    if (!read) {
+      break;
+    }
+    expected.push_back(value);
+    length += read;
+  }
+  // every value that decodes, then one more where there is any input
+  std::vector<value_type> values(expected.size() + 1u);
+  CHECK(Varint::Decode(bytes.data(), bytes.size(), expected.size(),
+      values.data()) == length &&
+      std::vector<value_type>(values.begin(), values.end() - 1) ==
+          expected);
+  CHECK(Varint::Decode(bytes.data(), bytes.size(), expected.size() + 1u,
+      values.data()) == 0);
+}
+
+// Checks decoding many values over random bytes of which about one in
+// continuation is the last of a varint; some are overlong or out of range.
+template <unsigned int kBits>
+void CheckBulk(unsigned int continuation) {
+  for (unsigned int trial = 0; trial < 1000u; ++trial) {
+    std::vector<nx::uint8_t> bytes(test::Random() % 64u);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      const nx::uint64_t random = test::Random();
+      bytes[i] = static_cast<nx::uint8_t>(
+          (random % continuation ? 0x80u : 0u) | (random >> 57u));
+    }
+    CheckAgainstSingle<kBits>(bytes);
+  }
+}
+
+// Checks decoding many values over runs of varints of one length, of every
+// length, broken by single varints of another.  In some trials, the last
+// bytes of a few varints are changed, or one byte is changed at random.
+template <unsigned int kBits>
+void CheckRuns() {
+  typedef nx::Varint<kBits> Varint;
+  typedef typename Varint::value_type value_type;
+  for (unsigned int trial = 0; trial < 200u; ++trial) {
+    std::vector<nx::uint8_t> bytes;
+    nx::uint8_t encoded[16];
+    while (bytes.size() < 1000u) {
+      const nx::uint64_t run_length = test::Random() % 64u;
+      const nx::uint64_t bits = kBits - test::Random() % kBits;
+      for (nx::uint64_t i = 0; i < run_length; ++i) {
+        // a value of exactly bits bits, or now and then of any width
+        nx::uint64_t value = test::Random() >> (64u - bits);
+        if (test::Random() % 16u) {
+          value |= static_cast<nx::uint64_t>(1u) << (bits - 1u);
+        }
+        const size_t size = Varint::Encode(static_cast<value_type>(value),
+            encoded);
+        if (trial % 4u == 3u && test::Random() % 64u == 0) {
+          // the same length, but overlong or perhaps out of range
+          encoded[size - 1u] = (test::Random() % 2u ? 0x00u : 0x7fu);
+        }
+        bytes.insert(bytes.end(), encoded, encoded + size);
+      }
+    }
+    if (trial % 4u == 1u) {
+      bytes[test::Random() % bytes.size()] =
+          static_cast<nx::uint8_t>(test::Random());
+    }
+    CheckAgainstSingle<kBits>(bytes);
+  }
+}
+
+// Checks that the varint of the given bytes is rejected, with and without
+// room for the wide load.
+template <unsigned int kBits>
+void CheckRejected(const nx::uint8_t* bytes, size_t size) {
+  typedef nx::Varint<kBits> Varint;
+  nx::uint8_t padded[16] = {0};
+  for (size_t i = 0; i < size; ++i) {
+    padded[i] = bytes[i];
+  }
+  typename Varint::value_type value = 0;
+  CHECK(Varint::Decode(bytes, size, &value) == 0);
+  CHECK(Varint::Decode(padded, sizeof(padded), &value) == 0);
+}
+
+}  // namespace
+
+int main() {
+  CheckRoundTrip<1, false>();
+  CheckRoundTrip<3, true>();
+  CheckRoundTrip<7, false>();
+  CheckRoundTrip<8, false>();
+  CheckRoundTrip<32, false>();
+  CheckRoundTrip<32, true>();
+  CheckRoundTrip<57, false>();
+  CheckRoundTrip<63, true>();
+  CheckRoundTrip<64, false>();
+  CheckRoundTrip<64, true>();
+
+  CheckBulk<7>(2u);
+  CheckBulk<32>(2u);
+  CheckBulk<32>(4u);
+  CheckBulk<64>(4u);
+  CheckBulk<64>(10u);
+  CheckRuns<7>();
+  CheckRuns<32>();
+  CheckRuns<57>();
+  CheckRuns<64>();
+
+  // overlong: a final zero byte pads a shorter encoding
+  const nx::uint8_t zero[] = {0x80u, 0x00u};
+  CheckRejected<32>(zero, sizeof(zero));
+  const nx::uint8_t one[] = {0x81u, 0x80u, 0x00u};
+  CheckRejected<32>(one, sizeof(one));
+  const nx::uint8_t padded[] = {0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x80u,
+      0x80u, 0x80u, 0x80u, 0x00u};
+  CheckRejected<64>(padded, sizeof(padded));
+  // longer than MaxSize()
+  const nx::uint8_t eleven[] = {0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x80u,
+      0x80u, 0x80u, 0x80u, 0x80u, 0x01u};
+  CheckRejected<64>(eleven, sizeof(eleven));
+  // out of range
+  const nx::uint8_t wide[] = {0xffu, 0xffu, 0xffu, 0xffu, 0x1fu};
+  CheckRejected<32>(wide, sizeof(wide));
+  const nx::uint8_t high[] = {0x80u, 0x80u, 0x80u, 0x80u, 0x80u, 0x80u,
+      0x80u, 0x80u, 0x80u, 0x02u};
+  CheckRejected<64>(high, sizeof(high));
+
+  // the canonical forms of the above are accepted
+  nx::Varint<32>::value_type value = 0;
+  const nx::uint8_t canonical[] = {0x80u, 0x01u};
+  CHECK(nx::Varint<32>::Decode(canonical, sizeof(canonical), &value) == 2u &&
+      value == 128u);
+  const nx::uint8_t maximum[] = {0xffu, 0xffu, 0xffu, 0xffu, 0x0fu};
+  CHECK(nx::Varint<32>::Decode(maximum, sizeof(maximum), &value) == 5u &&
+      value == 0xffffffffu);
+  const nx::uint8_t nothing[] = {0x00u};
+  CHECK(nx::Varint<32>::Decode(nothing, sizeof(nothing), &value) == 1u &&
+      value == 0u);
+
+#if defined(__SIZEOF_INT128__)
+  // ZigZag takes the 128-bit integers, even where std::is_integral does not
+  typedef nx::ZigZag<nx::int128_t> ZigZag128;
+  const nx::int128_t least = -(static_cast<nx::int128_t>(1) << 126u) * 2;
+  CHECK(ZigZag128::Encode(-1) == 1u && ZigZag128::Encode(1) == 2u);
+  CHECK(ZigZag128::Encode(least) == ~static_cast<nx::uint128_t>(0));
+  CHECK(ZigZag128::Decode(ZigZag128::Encode(least)) == least);
+#endif
+
+  return test::Finish();
+}